@@ -0,0 +1,162 @@
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include "arena.h"
+
+/*
+ * Every allocation is aligned to this, which fits any scalar type.
+ */
+const size_t ARENA_ALIGNMENT = 16;
+
+/*
+ * ArenaBlock is a chunk of memory allocations are carved from.
+ *
+ * previous - Block filled before this one.
+ * size     - Usable bytes in data.
+ * used     - Bytes of data already handed out.
+ * data     - The memory itself.
+ */
+struct ArenaBlock {
+    ArenaBlock *previous;
+    size_t size;
+    size_t used;
+    _Alignas(16) unsigned char data[];
+};
+
+static inline size_t alignSize(size_t size) {
+    return (size + ARENA_ALIGNMENT - 1) & ~(ARENA_ALIGNMENT - 1);
+}
+
+Arena *newArena(size_t blockSize) {
+    Arena *arena = calloc(1, sizeof(Arena));
+
+    if (arena == NULL) {
+        return NULL;
+    }
+
+    arena->blockSize = blockSize > 0 ? blockSize : ARENA_BLOCK_SIZE;
+    return arena;
+}
+
+/*
+ * pushBlock links a new block with room for at least `size` bytes. Big
+ * allocations get a block of their own, kept behind the current one so its
+ * remaining room isn't wasted.
+ */
+static ArenaBlock *pushBlock(Arena *arena, size_t size) {
+    bool ownBlock = size > arena->blockSize / 4;
+    size_t blockSize = ownBlock ? size : arena->blockSize;
+    ArenaBlock *block = malloc(sizeof(ArenaBlock) + blockSize);
+
+    if (block == NULL) {
+        return NULL;
+    }
+
+    block->size = blockSize;
+    block->used = 0;
+
+    if (ownBlock && arena->head != NULL) {
+        block->previous = arena->head->previous;
+        arena->head->previous = block;
+    } else {
+        block->previous = arena->head;
+        arena->head = block;
+    }
+
+    return block;
+}
+
+void *arenaAlloc(Arena *arena, size_t size) {
+    size = alignSize(size > 0 ? size : 1);
+    ArenaBlock *block = arena->head;
+
+    if (block == NULL || block->size - block->used < size) {
+        block = pushBlock(arena, size);
+
+        if (block == NULL) {
+            return NULL;
+        }
+    }
+
+    void *result = block->data + block->used;
+    block->used += size;
+    arena->last = result;
+    return result;
+}
+
+void *arenaCalloc(Arena *arena, size_t count, size_t size) {
+    if (size != 0 && count > SIZE_MAX / size) {
+        return NULL;
+    }
+
+    void *result = arenaAlloc(arena, count * size);
+
+    if (result != NULL) {
+        memset(result, 0, count * size);
+    }
+
+    return result;
+}
+
+void *arenaRealloc(Arena *arena, void *ptr, size_t oldSize, size_t newSize) {
+    if (ptr == NULL) {
+        return arenaAlloc(arena, newSize);
+    }
+
+    if (newSize <= oldSize) {
+        return ptr;
+    }
+
+    ArenaBlock *block = arena->head;
+
+    if (ptr == arena->last && block != NULL && (unsigned char *)ptr >= block->data &&
+        (unsigned char *)ptr < block->data + block->size) {
+        size_t offset = (size_t)((unsigned char *)ptr - block->data);
+        size_t grown = alignSize(newSize);
+
+        if (block->size - offset >= grown) {
+            block->used = offset + grown;
+            return ptr;
+        }
+    }
+
+    void *result = arenaAlloc(arena, newSize);
+
+    if (result != NULL) {
+        memcpy(result, ptr, oldSize);
+    }
+
+    return result;
+}
+
+char *arenaStrndup(Arena *arena, const char *str, size_t size) {
+    char *result = arenaAlloc(arena, size + 1);
+
+    if (result == NULL) {
+        return NULL;
+    }
+
+    memcpy(result, str, size);
+    result[size] = '\0';
+    return result;
+}
+
+char *arenaStrdup(Arena *arena, const char *str) {
+    return arenaStrndup(arena, str, strlen(str));
+}
+
+void freeArena(Arena *arena) {
+    if (arena == NULL) {
+        return;
+    }
+
+    ArenaBlock *block = arena->head;
+
+    while (block != NULL) {
+        ArenaBlock *previous = block->previous;
+        free(block);
+        block = previous;
+    }
+
+    free(arena);
+}
@@ -0,0 +1,86 @@
+#ifndef arena_h
+#define arena_h
+#include <stdlib.h>
+
+/*
+ * Arena is a bump allocator. Every allocation is carved from large blocks
+ * and nothing is freed individually: the whole arena is released at once by
+ * freeArena, which is meant to happen at the end of a fetch-parse-render cycle.
+ *
+ * head      - Block currently being carved. Older blocks are linked from it.
+ * blockSize - Size of each new block. Bigger allocations get a block of
+ *             their own.
+ * last      - Last allocation made, which arenaRealloc can grow in place.
+ */
+typedef struct ArenaBlock ArenaBlock;
+
+typedef struct {
+    ArenaBlock *head;
+    size_t blockSize;
+    void *last;
+} Arena;
+
+/*
+ * Default size of each arena block.
+ */
+#define ARENA_BLOCK_SIZE ((size_t)1 << 20)
+
+/*
+ * newArena attempts to allocate an empty Arena.
+ *
+ * blockSize - Size of each block, or 0 for ARENA_BLOCK_SIZE.
+ *
+ * Returns NULL in case allocation fails. The result must be released with
+ * freeArena.
+ */
+Arena *newArena(size_t blockSize);
+
+/*
+ * arenaAlloc returns `size` bytes from the arena, aligned for any type.
+ *
+ * Returns NULL in case allocation fails. The memory is not zeroed.
+ */
+void *arenaAlloc(Arena *arena, size_t size);
+
+/*
+ * arenaCalloc returns `count * size` zeroed bytes from the arena.
+ *
+ * Returns NULL in case allocation fails or the size overflows.
+ */
+void *arenaCalloc(Arena *arena, size_t count, size_t size);
+
+/*
+ * arenaRealloc grows an allocation to `newSize` bytes. When `ptr` is the last
+ * allocation and its block has room, it grows in place. Otherwise, a new
+ * allocation receives a copy of the old contents, which stay in the arena
+ * until it's released.
+ *
+ * ptr     - Previous allocation, or NULL.
+ * oldSize - Size ptr was allocated with.
+ * newSize - Size wanted.
+ *
+ * Returns NULL in case allocation fails, leaving ptr untouched.
+ */
+void *arenaRealloc(Arena *arena, void *ptr, size_t oldSize, size_t newSize);
+
+/*
+ * arenaStrndup copies `size` bytes of a string into the arena and NUL
+ * terminates the copy.
+ *
+ * Returns NULL in case allocation fails.
+ */
+char *arenaStrndup(Arena *arena, const char *str, size_t size);
+
+/*
+ * arenaStrdup copies a NUL terminated string into the arena.
+ *
+ * Returns NULL in case allocation fails.
+ */
+char *arenaStrdup(Arena *arena, const char *str);
+
+/*
+ * freeArena releases every block, and so every allocation, of an Arena.
+ */
+void freeArena(Arena *arena);
+
+#endif
@@ -0,0 +1,190 @@
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "bench.h"
+
+/*
+ * Words titles are made of, borrowed from the jsonplaceholder ones.
+ */
+static const char *WORDS[] = {
+    "delectus", "aut", "autem", "quis", "ut", "nam", "facilis", "et", "officia", "qui",
+    "fugiat", "veniam", "minus", "laboriosam", "mollitia", "repellendus", "sunt", "dolores"
+};
+
+/*
+ * Words mixed into unicode titles: accented, CJK and emoji.
+ */
+static const char *UNICODE_WORDS[] = { "délectus", "ação", "日本語", "🚀", "naïve", "中文", "ü" };
+
+double benchNow(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)now.tv_sec + (double)now.tv_nsec / 1e9;
+}
+
+/*
+ * readCount reads the value of a numeric option.
+ */
+static bool readCount(int argc, char **argv, int *i, size_t *outValue) {
+    if (*i + 1 >= argc) {
+        return false;
+    }
+
+    char *end = NULL;
+    const char *value = argv[++*i];
+    unsigned long long number = strtoull(value, &end, 10);
+
+    if (end == value || *end != '\0' || value[0] == '-') {
+        return false;
+    }
+
+    *outValue = (size_t)number;
+    return true;
+}
+
+bool parseBenchOptions(int argc, char **argv, const size_t *defaults, size_t defaultsCount, BenchOptions *outOptions) {
+    BenchOptions options = { sizes: { 0 }, sizesCount: 0, titleLength: 40, unicodePercent: 0, repetitions: 5 };
+    bool ok = true;
+
+    for (int i = 1; i < argc && ok; i++) {
+        if (strcmp(argv[i], "--title-length") == 0) {
+            ok = readCount(argc, argv, &i, &options.titleLength);
+        } else if (strcmp(argv[i], "--unicode") == 0) {
+            ok = readCount(argc, argv, &i, &options.unicodePercent) && options.unicodePercent <= 100;
+        } else if (strcmp(argv[i], "--repetitions") == 0) {
+            ok = readCount(argc, argv, &i, &options.repetitions) && options.repetitions > 0;
+        } else if (options.sizesCount < BENCH_MAX_SIZES && atoll(argv[i]) > 0) {
+            options.sizes[options.sizesCount++] = (size_t)atoll(argv[i]);
+        } else {
+            ok = false;
+        }
+    }
+
+    if (!ok) {
+        fprintf(stderr,
+                "Usage: %s [sizes...] [--title-length N] [--unicode PERCENT] [--repetitions N]\n",
+                argv[0]);
+        return false;
+    }
+
+    for (size_t i = 0; options.sizesCount == 0 && i < defaultsCount && i < BENCH_MAX_SIZES; i++) {
+        options.sizes[i] = defaults[i];
+    }
+
+    if (options.sizesCount == 0) {
+        options.sizesCount = defaultsCount < BENCH_MAX_SIZES ? defaultsCount : BENCH_MAX_SIZES;
+    }
+
+    *outOptions = options;
+    return true;
+}
+
+void benchReport(const BenchResult *result) {
+    const char *commit = getenv("BENCH_COMMIT");
+
+    printf("{\"bench\":\"%s\",\"name\":\"%s\",\"entries\":%zu,\"bytes\":%zu,\"threads\":%zu,"
+           "\"seconds\":%.9f,\"ns_per_entry\":%.3f,\"mb_per_s\":%.3f",
+           result->bench, result->name, result->entries, result->bytes, result->threads > 0 ? result->threads : 1,
+           result->seconds, result->entries > 0 ? result->seconds * 1e9 / result->entries : 0.0,
+           result->seconds > 0 ? result->bytes / result->seconds / 1e6 : 0.0);
+
+    if (commit != NULL) {
+        printf(",\"commit\":\"%s\"", commit);
+    }
+
+    printf("}\n");
+    fflush(stdout);
+}
+
+/*
+ * writeTitle fills `title` with `length` bytes of words separated by spaces.
+ * When unicode is set, every third word is a non ASCII one, unless it
+ * doesn't fit whole.
+ */
+static void writeTitle(char *title, size_t length, size_t seed, bool unicode) {
+    size_t wordsCount = sizeof(WORDS) / sizeof(WORDS[0]);
+    size_t unicodeCount = sizeof(UNICODE_WORDS) / sizeof(UNICODE_WORDS[0]);
+    size_t written = 0;
+
+    while (written < length) {
+        bool unicodeWord = unicode && seed % 3 == 0;
+        const char *word = unicodeWord ? UNICODE_WORDS[seed / 3 % unicodeCount] : WORDS[seed % wordsCount];
+
+        seed++;
+        if (written > 0) {
+            title[written++] = ' ';
+        }
+
+        size_t wordSize = strlen(word);
+
+        if (unicodeWord && written + wordSize > length) {
+            word = "x";
+            wordSize = 1;
+        }
+
+        for (size_t i = 0; i < wordSize && written < length; i++) {
+            title[written++] = word[i];
+        }
+    }
+
+    if (length > 0 && title[length - 1] == ' ') {
+        title[length - 1] = 'x';
+    }
+    title[length] = '\0';
+}
+
+char *generateTODOJson(size_t count, size_t titleLength, size_t unicodePercent, size_t *outSize) {
+    size_t entrySize = titleLength + 96;
+    size_t capacity = count * entrySize + 8;
+    char *json = malloc(capacity);
+    char *title = malloc(titleLength + 1);
+
+    if (json == NULL || title == NULL) {
+        free(json);
+        free(title);
+        return NULL;
+    }
+
+    size_t size = 0;
+    json[size++] = '[';
+
+    for (size_t i = 0; i < count; i++) {
+        writeTitle(title, titleLength, i * 7, i * 37 % 100 < unicodePercent);
+        size += (size_t)snprintf(json + size, capacity - size,
+                                 "%s\n  {\n    \"userId\": %zu,\n    \"id\": %zu,\n    \"title\": \"%s\",\n"
+                                 "    \"completed\": %s\n  }",
+                                 i > 0 ? "," : "", i / BENCH_TODOS_PER_USER + 1, i + 1, title, i % 3 == 0 ? "true" : "false");
+    }
+
+    json[size++] = '\n';
+    json[size++] = ']';
+    json[size] = '\0';
+    free(title);
+    *outSize = size;
+    return json;
+}
+
+char *generateUsersJson(size_t count, size_t *outSize) {
+    size_t capacity = count * 96 + 8;
+    char *json = malloc(capacity);
+
+    if (json == NULL) {
+        return NULL;
+    }
+
+    size_t size = 0;
+    json[size++] = '[';
+
+    for (size_t i = 0; i < count; i++) {
+        size += (size_t)snprintf(json + size, capacity - size,
+                                 "%s\n  {\n    \"id\": %zu,\n    \"name\": \"User %zu\",\n"
+                                 "    \"username\": \"user%zu\"\n  }",
+                                 i > 0 ? "," : "", i + 1, i + 1, i + 1);
+    }
+
+    json[size++] = '\n';
+    json[size++] = ']';
+    json[size] = '\0';
+    *outSize = size;
+    return json;
+}
@@ -0,0 +1,164 @@
+#ifndef bench_h
+#define bench_h
+#include <stdlib.h>
+#include <stdbool.h>
+
+/*
+ * Most sizes a benchmark accepts.
+ */
+#define BENCH_MAX_SIZES 16
+
+/*
+ * BenchOptions holds the arguments every benchmark accepts:
+ * `[sizes...] [--title-length N] [--unicode PERCENT] [--repetitions N]`.
+ *
+ * sizes          - Amount of entries of each run.
+ * sizesCount     - Amount of sizes.
+ * titleLength    - Bytes of every generated title.
+ * unicodePercent - Share of generated titles mixing accented, CJK and
+ *                  emoji words in, from 0 to 100.
+ * repetitions    - Runs of each measurement. The fastest one is reported.
+ */
+typedef struct {
+    size_t sizes[BENCH_MAX_SIZES];
+    size_t sizesCount;
+    size_t titleLength;
+    size_t unicodePercent;
+    size_t repetitions;
+} BenchOptions;
+
+/*
+ * BenchResult is a single measurement, reported by benchReport.
+ *
+ * bench   - Benchmark it belongs to.
+ * name    - What was measured.
+ * entries - Amount of entries, rows or titles processed.
+ * bytes   - Amount of bytes processed, or 0.
+ * threads - Amount of threads used.
+ * seconds - Fastest run.
+ */
+typedef struct {
+    const char *bench;
+    const char *name;
+    size_t entries;
+    size_t bytes;
+    size_t threads;
+    double seconds;
+} BenchResult;
+
+/*
+ * benchNow returns the current monotonic time, in seconds.
+ */
+double benchNow(void);
+
+/*
+ * parseBenchOptions reads the benchmark arguments, falling back to `defaults`
+ * when no size is provided.
+ *
+ * Returns false, after printing the usage to stderr, for invalid arguments.
+ */
+bool parseBenchOptions(int argc, char **argv, const size_t *defaults, size_t defaultsCount, BenchOptions *outOptions);
+
+/*
+ * benchReport prints a result to stdout as a single json line, so runs can be
+ * collected and compared between commits. When the BENCH_COMMIT environment
+ * variable is set, it's added to the line.
+ */
+void benchReport(const BenchResult *result);
+
+/*
+ * generateTODOJson builds a synthetic TODO list json, shaped like the
+ * jsonplaceholder one.
+ *
+ * count          - Amount of entries.
+ * titleLength    - Bytes of every title.
+ * unicodePercent - Share of titles mixing non ASCII words in, from 0 to 100.
+ * outSize        - Receives the json size.
+ *
+ * Returns the NUL terminated json, which must be freed, or NULL if it
+ * cannot be allocated.
+ */
+char *generateTODOJson(size_t count, size_t titleLength, size_t unicodePercent, size_t *outSize);
+
+/*
+ * Entries of a generated TODO list sharing each userId, counted from 1.
+ */
+#define BENCH_TODOS_PER_USER 20
+
+/*
+ * generateUsersJson builds a synthetic users list json, shaped like the
+ * jsonplaceholder one, with the ids 1 to count named `User <id>`.
+ *
+ * Returns the NUL terminated json, which must be freed, or NULL if it
+ * cannot be allocated.
+ */
+char *generateUsersJson(size_t count, size_t *outSize);
+
+/*
+ * BenchServer is a loopback HTTP server standing in for jsonplaceholder.
+ * It answers every get request with the same body, except `/users` ones
+ * once it has users, keeps connections alive and answers a matching
+ * `If-None-Match` with a 304.
+ */
+typedef struct BenchServer BenchServer;
+
+/*
+ * startBenchServer starts serving body on 127.0.0.1 from a background thread.
+ *
+ * body      - Served body. It must outlive the server.
+ * size      - Size of body.
+ * port      - Port to listen on, or 0 for any free one.
+ * outServer - Receives the server, stopped with stopBenchServer.
+ *
+ * Returns false if the socket or the thread cannot be created.
+ */
+bool startBenchServer(const char *body, size_t size, unsigned short port, BenchServer **outServer);
+
+/*
+ * BenchFaults makes a BenchServer misbehave on some of its requests,
+ * counted from 1 across every connection, to exercise timeouts, retries
+ * and hedging.
+ *
+ * failEvery  - Every failEvery-th request is answered with a 503, or none
+ *              when 0.
+ * dropEvery  - Every dropEvery-th request has its connection closed without
+ *              an answer, or none when 0.
+ * delayEvery - Every delayEvery-th request is answered delay milliseconds
+ *              late, or none when 0.
+ * delay      - Milliseconds of the delays.
+ */
+typedef struct {
+    size_t failEvery;
+    size_t dropEvery;
+    size_t delayEvery;
+    size_t delay;
+} BenchFaults;
+
+/*
+ * benchServerSetFaults changes the faults of a server, which has none when
+ * started. The request count starts over.
+ */
+void benchServerSetFaults(BenchServer *server, const BenchFaults *faults);
+
+/*
+ * benchServerSetUsers makes the server answer `/users` requests with body,
+ * which must outlive the server.
+ */
+void benchServerSetUsers(BenchServer *server, const char *body, size_t size);
+
+/*
+ * benchServerUrl returns the url the server answers on.
+ */
+const char *benchServerUrl(const BenchServer *server);
+
+/*
+ * benchServerUsersUrl returns the url of the users, next to benchServerUrl.
+ */
+const char *benchServerUsersUrl(const BenchServer *server);
+
+/*
+ * stopBenchServer closes every connection and releases the server.
+ */
+void stopBenchServer(BenchServer *server);
+
+#endif
@@ -0,0 +1,28 @@
+#include <stdio.h>
+#include "bench.h"
+
+/*
+ * Writes a synthetic TODO list json to stdout, for feeding other tools:
+ * `bench_generate ENTRIES [--title-length N] [--unicode PERCENT]`.
+ */
+
+int main(int argc, char **argv) {
+    const size_t defaults[] = { 1000 };
+    BenchOptions options;
+
+    if (!parseBenchOptions(argc, argv, defaults, 1, &options)) {
+        return 1;
+    }
+
+    size_t jsonSize = 0;
+    char *json = generateTODOJson(options.sizes[0], options.titleLength, options.unicodePercent, &jsonSize);
+
+    if (json == NULL) {
+        fprintf(stderr, "Could not generate %zu entries.\n", options.sizes[0]);
+        return 1;
+    }
+
+    size_t written = fwrite(json, 1, jsonSize, stdout);
+    free(json);
+    return written == jsonSize ? 0 : 1;
+}
@@ -0,0 +1,475 @@
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <http/http.h>
+#include <http/cache.h>
+#include <stats/stats.h>
+#include "main/models.h"
+#include "main/store.h"
+#include "main/users.h"
+#include "bench.h"
+
+/*
+ * Measures fetching synthetic lists from a loopback BenchServer: httpGet,
+ * httpGetStream feeding the streaming parser, concurrent requests through
+ * httpClientGetMany, httpCacheGet revalidating a cached body, and
+ * httpGetStreams fetching the list along with its users as --join-users
+ * does, checking every joined row shows its user name. The fault
+ * cases time a series of requests to a server failing or stalling some of
+ * them, retried or hedged by the client policy, after checking each fault
+ * ends with the error and counts the events it should.
+ */
+
+size_t repetitions = 5;
+
+/*
+ * Requests made concurrently by the httpClientGetMany case.
+ */
+const size_t CONCURRENT_REQUESTS = 4;
+
+/*
+ * Requests of each fault case, whose total time is reported.
+ */
+const size_t FAULTY_REQUESTS = 20;
+
+json_err skipEntry(const TODOEntry *entry, void *context) {
+    (void)entry;
+    (*(size_t *)context)++;
+    return json_err_ok;
+}
+
+size_t feedParser(const char *chunk, size_t size, void *context) {
+    return feedTODOStreamParser((TODOStreamParser *)context, chunk, size) == json_err_ok ? size : 0;
+}
+
+void fail(const char *what, int err) {
+    fprintf(stderr, "%s failed: %d\n", what, err);
+    exit(1);
+}
+
+double benchGet(const char *url) {
+    double best = 0;
+
+    for (size_t r = 0; r < repetitions; r++) {
+        char *body = NULL;
+        double start = benchNow();
+        http_err err = httpGet(url, &body);
+        double elapsed = benchNow() - start;
+
+        if (err != http_err_ok) {
+            fail("httpGet", err);
+        }
+
+        free(body);
+        best = r == 0 || elapsed < best ? elapsed : best;
+    }
+
+    return best;
+}
+
+double benchStream(const char *url, size_t count) {
+    double best = 0;
+
+    for (size_t r = 0; r < repetitions; r++) {
+        size_t entries = 0;
+        TODOStreamParser *parser = NULL;
+        double start = benchNow();
+        json_err parseErr = newTODOStreamParser(skipEntry, &entries, &parser);
+        http_err err = parseErr == json_err_ok ? httpGetStream(url, feedParser, parser) : http_err_write_error;
+
+        if (err == http_err_ok) {
+            parseErr = finishTODOStreamParser(parser);
+        }
+
+        double elapsed = benchNow() - start;
+        freeTODOStreamParser(parser);
+
+        if (err != http_err_ok || parseErr != json_err_ok || entries != count) {
+            fail("httpGetStream", err != http_err_ok ? (int)err : (int)parseErr);
+        }
+
+        best = r == 0 || elapsed < best ? elapsed : best;
+    }
+
+    return best;
+}
+
+double benchMany(HttpClient *client, const char *url) {
+    const char *urls[CONCURRENT_REQUESTS];
+    HttpResponse responses[CONCURRENT_REQUESTS];
+    double best = 0;
+
+    for (size_t i = 0; i < CONCURRENT_REQUESTS; i++) {
+        urls[i] = url;
+    }
+
+    for (size_t r = 0; r < repetitions; r++) {
+        double start = benchNow();
+        http_err err = httpClientGetMany(client, urls, CONCURRENT_REQUESTS, responses);
+        double elapsed = benchNow() - start;
+
+        freeHttpResponses(responses, CONCURRENT_REQUESTS);
+        if (err != http_err_ok) {
+            fail("httpClientGetMany", err);
+        }
+
+        best = r == 0 || elapsed < best ? elapsed : best;
+    }
+
+    return best;
+}
+
+double benchCache(HttpClient *client, const char *url) {
+    char directory[] = "/tmp/bench_http.XXXXXX";
+    HttpCache *cache = NULL;
+    HttpCachedBody body;
+    double best = 0;
+
+    if (mkdtemp(directory) == NULL || newHttpCache(directory, &cache) != http_err_ok ||
+        httpCacheGet(cache, client, url, &body) != http_err_ok) {
+        fail("newHttpCache", 0);
+    }
+
+    releaseHttpCachedBody(&body);
+
+    for (size_t r = 0; r < repetitions; r++) {
+        double start = benchNow();
+        http_err err = httpCacheGet(cache, client, url, &body);
+        double elapsed = benchNow() - start;
+
+        if (err != http_err_ok || !body.mapped) {
+            fail("httpCacheGet", err);
+        }
+
+        releaseHttpCachedBody(&body);
+        best = r == 0 || elapsed < best ? elapsed : best;
+    }
+
+    freeHttpCache(cache);
+
+    char command[64];
+    snprintf(command, sizeof(command), "rm -rf %s", directory);
+    if (system(command) != 0) {
+        fprintf(stderr, "Could not remove %s.\n", directory);
+    }
+
+    return best;
+}
+
+/*
+ * UsersBuffer collects the users body of benchJoin.
+ */
+typedef struct {
+    char *data;
+    size_t size;
+} UsersBuffer;
+
+size_t collectUsers(const char *chunk, size_t size, void *context) {
+    UsersBuffer *users = (UsersBuffer *)context;
+    char *data = realloc(users->data, users->size + size + 1);
+
+    if (data == NULL) {
+        return 0;
+    }
+
+    memcpy(data + users->size, chunk, size);
+    users->data = data;
+    users->size += size;
+    return size;
+}
+
+json_err appendEntry(const TODOEntry *entry, void *context) {
+    return todoStoreAppend((TodoStore *)context, entry);
+}
+
+/*
+ * checkJoined makes sure every row of a joined list shows the name of its
+ * user, as served by the BenchServer.
+ */
+void checkJoined(const TodoStore *store, const UserMap *users, const uint32_t *rowUsers) {
+    JoinedTodoView joined = { view: { store: store, rows: NULL, length: store->length }, users: users,
+                              rowUsers: rowUsers };
+    uint32_t *rows = malloc(store->length * sizeof(uint32_t) + 1);
+    char scratch[64], expected[32];
+
+    if (rows == NULL) {
+        fail("checkJoined", 0);
+    }
+
+    for (size_t i = 0; i < store->length; i++) {
+        rows[i] = (uint32_t)i;
+    }
+
+    joined.view.rows = rows;
+    for (size_t i = 0; i < store->length; i++) {
+        size_t size = 0;
+        const char *name = joinedTodoCell(&joined, i, 0, scratch, &size);
+        int expectedSize = snprintf(expected, sizeof(expected), "User %d", store->userIDs[i]);
+
+        if (size != (size_t)expectedSize || memcmp(name, expected, size) != 0) {
+            fprintf(stderr, "Row %zu shows user %.*s instead of %s.\n", i, (int)size, name, expected);
+            exit(1);
+        }
+    }
+
+    free(rows);
+}
+
+double benchJoin(BenchServer *server, size_t count) {
+    double best = 0;
+
+    for (size_t r = 0; r < repetitions; r++) {
+        Arena *arena = newArena(ARENA_BLOCK_SIZE);
+        TodoStore *store = NULL;
+        TODOStreamParser *parser = NULL;
+        UsersBuffer users = { data: NULL, size: 0 };
+        UserMap *map = NULL;
+        uint32_t *rowUsers = NULL;
+        double start = benchNow();
+
+        if (arena == NULL || newTodoStore(arena, false, &store) != json_err_ok ||
+            newTODOStreamParser(appendEntry, store, &parser) != json_err_ok) {
+            fail("newTODOStreamParser", 0);
+        }
+
+        HttpStreamRequest requests[2] = {
+            { url: benchServerUrl(server), onChunk: feedParser, context: parser, status: 0, err: http_err_ok },
+            { url: benchServerUsersUrl(server), onChunk: collectUsers, context: &users, status: 0,
+              err: http_err_ok }
+        };
+        http_err err = httpGetStreams(requests, 2);
+        json_err parseErr = err == http_err_ok ? finishTODOStreamParser(parser) : json_err_parse_failed;
+
+        if (parseErr == json_err_ok) {
+            parseErr = parseUserMap(arena, users.data != NULL ? users.data : "", users.size, &map);
+        }
+
+        if (parseErr == json_err_ok) {
+            parseErr = joinTodoUsers(arena, store, map, &rowUsers);
+        }
+
+        double elapsed = benchNow() - start;
+
+        if (err != http_err_ok || parseErr != json_err_ok || store->length != count) {
+            fail("httpGetStreams", err != http_err_ok ? (int)err : (int)parseErr);
+        }
+
+        checkJoined(store, map, rowUsers);
+        freeTODOStreamParser(parser);
+        free(users.data);
+        freeArena(arena);
+        best = r == 0 || elapsed < best ? elapsed : best;
+    }
+
+    return best;
+}
+
+double benchFaulty(BenchServer *server, const BenchFaults *faults, const HttpPolicy *policy) {
+    const BenchFaults none = { failEvery: 0, dropEvery: 0, delayEvery: 0, delay: 0 };
+    HttpClient *client = NULL;
+
+    /*
+     * Two connections, so a hedged request doesn't wait for the slow one.
+     */
+    if (newHttpClient(2, &client) != http_err_ok) {
+        fail("newHttpClient", 0);
+    }
+
+    httpClientSetPolicy(client, policy);
+    benchServerSetFaults(server, faults);
+
+    double start = benchNow();
+
+    for (size_t i = 0; i < FAULTY_REQUESTS; i++) {
+        char *body = NULL;
+        http_err err = httpClientGet(client, benchServerUrl(server), &body, NULL);
+
+        if (err != http_err_ok) {
+            fail("httpClientGet", err);
+        }
+
+        free(body);
+    }
+
+    double elapsed = benchNow() - start;
+    benchServerSetFaults(server, &none);
+    freeHttpClient(client);
+    return elapsed;
+}
+
+/*
+ * refusedUrl writes to url the address of a loopback port nothing listens
+ * on, found by binding a socket to any free port and closing it.
+ */
+void refusedUrl(char *url, size_t size) {
+    struct sockaddr_in address = { sin_family: AF_INET, sin_port: 0, sin_addr: { htonl(INADDR_LOOPBACK) } };
+    socklen_t length = sizeof(address);
+    int listener = socket(AF_INET, SOCK_STREAM, 0);
+
+    if (listener < 0 || bind(listener, (struct sockaddr *)&address, sizeof(address)) != 0 ||
+        getsockname(listener, (struct sockaddr *)&address, &length) != 0) {
+        fail("refusedUrl", 0);
+    }
+
+    close(listener);
+    snprintf(url, size, "http://127.0.0.1:%u/todos", (unsigned)ntohs(address.sin_port));
+}
+
+/*
+ * checkFault makes requests to url with the server misbehaving as faults
+ * says, and exits if the last one doesn't end with expected or an event
+ * isn't counted as many times as the events array says, -1 meaning at
+ * least once.
+ */
+void checkFault(const char *what, BenchServer *server, const char *url, size_t requests, const BenchFaults *faults,
+                const HttpPolicy *policy, http_err expected, const long events[stats_http_event_count]) {
+    const BenchFaults none = { failEvery: 0, dropEvery: 0, delayEvery: 0, delay: 0 };
+    uint64_t before[stats_http_event_count];
+    HttpClient *client = NULL;
+    http_err err = http_err_ok;
+
+    if (newHttpClient(2, &client) != http_err_ok) {
+        fail("newHttpClient", 0);
+    }
+
+    httpClientSetPolicy(client, policy);
+    benchServerSetFaults(server, faults);
+
+    for (size_t e = 0; e < stats_http_event_count; e++) {
+        before[e] = statsHttpEvents((stats_http_event)e);
+    }
+
+    for (size_t i = 0; i < requests; i++) {
+        char *body = NULL;
+        err = httpClientGet(client, url, &body, NULL);
+        free(body);
+    }
+
+    benchServerSetFaults(server, &none);
+    freeHttpClient(client);
+
+    if (err != expected) {
+        fprintf(stderr, "%s: expected error %d, got %d\n", what, (int)expected, (int)err);
+        exit(1);
+    }
+
+    for (size_t e = 0; e < stats_http_event_count; e++) {
+        uint64_t counted = statsHttpEvents((stats_http_event)e) - before[e];
+
+        if (events[e] < 0 ? counted == 0 : counted != (uint64_t)events[e]) {
+            fprintf(stderr, "%s: event %zu counted %llu times, expected %ld\n", what, e,
+                    (unsigned long long)counted, events[e]);
+            exit(1);
+        }
+    }
+}
+
+void checkFaults(BenchServer *server) {
+    const BenchFaults none = { failEvery: 0, dropEvery: 0, delayEvery: 0, delay: 0 };
+    const BenchFaults stalled = { failEvery: 0, dropEvery: 0, delayEvery: 1, delay: 300 };
+    const BenchFaults failing = { failEvery: 1, dropEvery: 0, delayEvery: 0, delay: 0 };
+    const BenchFaults secondDelayed = { failEvery: 0, dropEvery: 0, delayEvery: 2, delay: 300 };
+    const char *url = benchServerUrl(server);
+    char refused[64];
+    HttpPolicy policy;
+    httpDefaultPolicy(&policy);
+    policy.timeout = 100;
+    policy.retries = 1;
+    policy.backoff = 10;
+    HttpPolicy hedged = policy;
+    hedged.timeout = 0;
+    hedged.retries = 0;
+    hedged.hedgePercentile = 90;
+    hedged.hedgeDelay = 50;
+    refusedUrl(refused, sizeof(refused));
+
+    /*
+     * Counts of retry, timeout, hedge, hedge_won and failure events.
+     */
+    const long stallEvents[] = { 1, 2, 0, 0, 1 };
+    const long refusedEvents[] = { 1, 0, 0, 0, 1 };
+    const long failingEvents[] = { 1, 0, 0, 0, 1 };
+    const long hedgedEvents[] = { 0, 0, -1, -1, 0 };
+    const long malformedEvents[] = { 0, 0, 0, 0, 1 };
+
+    checkFault("stall", server, url, 1, &stalled, &policy, http_err_timeout, stallEvents);
+    checkFault("refused", server, refused, 1, &none, &policy, http_err_connect_failed, refusedEvents);
+    checkFault("503", server, url, 1, &failing, &policy, http_err_server_error, failingEvents);
+    checkFault("hedged", server, url, 2, &secondDelayed, &hedged, http_err_ok, hedgedEvents);
+    checkFault("malformed", server, "http://[::1", 1, &none, &policy, http_err_request_failed, malformedEvents);
+}
+
+int main(int argc, char **argv) {
+    const size_t defaults[] = { 1000, 100000 };
+    BenchOptions options;
+
+    if (!parseBenchOptions(argc, argv, defaults, 2, &options)) {
+        return 1;
+    }
+
+    repetitions = options.repetitions;
+    statsEnable();
+
+    for (size_t i = 0; i < options.sizesCount; i++) {
+        size_t count = options.sizes[i];
+        size_t jsonSize = 0, usersSize = 0;
+        char *json = generateTODOJson(count, options.titleLength, options.unicodePercent, &jsonSize);
+        char *users = generateUsersJson(count / BENCH_TODOS_PER_USER + 1, &usersSize);
+        BenchServer *server = NULL;
+        HttpClient *client = NULL;
+
+        if (json == NULL || users == NULL || !startBenchServer(json, jsonSize, 0, &server)) {
+            fprintf(stderr, "Could not serve %zu entries.\n", count);
+            return 1;
+        }
+
+        benchServerSetUsers(server, users, usersSize);
+
+        if (newHttpClient(CONCURRENT_REQUESTS, &client) != http_err_ok) {
+            fail("newHttpClient", 0);
+        }
+
+        checkFaults(server);
+
+        const char *url = benchServerUrl(server);
+        const BenchFaults failing = { failEvery: 3, dropEvery: 0, delayEvery: 0, delay: 0 };
+        const BenchFaults delayed = { failEvery: 0, dropEvery: 0, delayEvery: 5, delay: 200 };
+        HttpPolicy retried;
+        HttpPolicy hedged;
+        httpDefaultPolicy(&retried);
+        retried.backoff = 10;
+        hedged = retried;
+        hedged.hedgePercentile = 90;
+        hedged.hedgeDelay = 50;
+        BenchResult results[] = {
+            { bench: "http", name: "httpGet", entries: count, bytes: jsonSize, threads: 1, seconds: benchGet(url) },
+            { bench: "http", name: "httpGetStream+TODOStreamParser", entries: count, bytes: jsonSize, threads: 1,
+              seconds: benchStream(url, count) },
+            { bench: "http", name: "httpClientGetMany", entries: count * CONCURRENT_REQUESTS,
+              bytes: jsonSize * CONCURRENT_REQUESTS, threads: CONCURRENT_REQUESTS, seconds: benchMany(client, url) },
+            { bench: "http", name: "httpCacheGet/revalidated", entries: count, bytes: jsonSize, threads: 1,
+              seconds: benchCache(client, url) },
+            { bench: "http", name: "httpGetStreams/todos+users", entries: count, bytes: jsonSize + usersSize,
+              threads: 2, seconds: benchJoin(server, count) },
+            { bench: "http", name: "httpClientGet/503+retried", entries: count * FAULTY_REQUESTS,
+              bytes: jsonSize * FAULTY_REQUESTS, threads: 1, seconds: benchFaulty(server, &failing, &retried) },
+            { bench: "http", name: "httpClientGet/delayed", entries: count * FAULTY_REQUESTS,
+              bytes: jsonSize * FAULTY_REQUESTS, threads: 1, seconds: benchFaulty(server, &delayed, &retried) },
+            { bench: "http", name: "httpClientGet/delayed+hedged", entries: count * FAULTY_REQUESTS,
+              bytes: jsonSize * FAULTY_REQUESTS, threads: 1, seconds: benchFaulty(server, &delayed, &hedged) }
+        };
+
+        for (size_t r = 0; r < sizeof(results) / sizeof(results[0]); r++) {
+            benchReport(&results[r]);
+        }
+
+        freeHttpClient(client);
+        stopBenchServer(server);
+        free(json);
+        free(users);
+    }
+
+    return 0;
+}
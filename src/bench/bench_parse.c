@@ -0,0 +1,176 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdbool.h>
+#include "main/models.h"
+#include "main/store.h"
+#include "bench.h"
+
+/*
+ * Compares the json-c based parseTODOListDOM against the schema specialized
+ * scanTODOList, parseTODOList filling a TodoStore and the streaming parser,
+ * on synthetic lists of the sizes received as arguments.
+ */
+
+size_t repetitions = 5;
+const size_t STREAM_CHUNK_SIZE = 1 << 14;
+
+json_err countEntry(const TODOEntry *entry, void *context) {
+    (*(size_t *)context) += (size_t)entry->ID;
+    return json_err_ok;
+}
+
+double benchDOM(char *json, size_t size, size_t count) {
+    double best = 0;
+
+    for (size_t i = 0; i < repetitions; i++) {
+        Arena *arena = newArena(ARENA_BLOCK_SIZE);
+        TodoStore *store = NULL;
+        double start = benchNow();
+        json_err err = newTodoStore(arena, false, &store);
+
+        if (err == json_err_ok) {
+            err = parseTODOListDOM(store, json, size);
+        }
+
+        double elapsed = benchNow() - start;
+
+        if (err != json_err_ok || store->length != count) {
+            fprintf(stderr, "parseTODOListDOM failed: %d\n", err);
+            exit(1);
+        }
+
+        freeArena(arena);
+        best = i == 0 || elapsed < best ? elapsed : best;
+    }
+
+    return best;
+}
+
+double benchScan(const char *json, size_t size, size_t count) {
+    char *copy = malloc(size + 1);
+    double best = 0;
+
+    for (size_t i = 0; i < repetitions; i++) {
+        memcpy(copy, json, size + 1);
+        Arena *arena = newArena(ARENA_BLOCK_SIZE);
+        TODOEntry *entries = NULL;
+        size_t length = 0;
+        double start = benchNow();
+        json_err err = scanTODOList(arena, copy, size, &length, &entries);
+        double elapsed = benchNow() - start;
+
+        if (err != json_err_ok || length != count) {
+            fprintf(stderr, "scanTODOList failed: %d\n", err);
+            exit(1);
+        }
+
+        freeArena(arena);
+        best = i == 0 || elapsed < best ? elapsed : best;
+    }
+
+    free(copy);
+    return best;
+}
+
+double benchStore(const char *json, size_t size, size_t count, bool internTitles) {
+    char *copy = malloc(size + 1);
+    double best = 0;
+
+    for (size_t i = 0; i < repetitions; i++) {
+        memcpy(copy, json, size + 1);
+        Arena *arena = newArena(ARENA_BLOCK_SIZE);
+        TodoStore *store = NULL;
+        double start = benchNow();
+        json_err err = newTodoStore(arena, internTitles, &store);
+
+        if (err == json_err_ok) {
+            err = parseTODOList(store, copy, size);
+        }
+
+        double elapsed = benchNow() - start;
+
+        if (err != json_err_ok || store->length != count) {
+            fprintf(stderr, "parseTODOList failed: %d\n", err);
+            exit(1);
+        }
+
+        freeArena(arena);
+        best = i == 0 || elapsed < best ? elapsed : best;
+    }
+
+    free(copy);
+    return best;
+}
+
+double benchStream(const char *json, size_t size) {
+    double best = 0;
+
+    for (size_t i = 0; i < repetitions; i++) {
+        size_t checksum = 0;
+        TODOStreamParser *parser = NULL;
+        double start = benchNow();
+        json_err err = newTODOStreamParser(countEntry, &checksum, &parser);
+
+        for (size_t offset = 0; offset < size && err == json_err_ok; offset += STREAM_CHUNK_SIZE) {
+            size_t chunk = size - offset < STREAM_CHUNK_SIZE ? size - offset : STREAM_CHUNK_SIZE;
+            err = feedTODOStreamParser(parser, json + offset, chunk);
+        }
+
+        if (err == json_err_ok) {
+            err = finishTODOStreamParser(parser);
+        }
+
+        double elapsed = benchNow() - start;
+        freeTODOStreamParser(parser);
+
+        if (err != json_err_ok) {
+            fprintf(stderr, "TODOStreamParser failed: %d\n", err);
+            exit(1);
+        }
+
+        best = i == 0 || elapsed < best ? elapsed : best;
+    }
+
+    return best;
+}
+
+int main(int argc, char **argv) {
+    const size_t defaults[] = { 1000, 100000, 1000000 };
+    BenchOptions options;
+
+    if (!parseBenchOptions(argc, argv, defaults, 3, &options)) {
+        return 1;
+    }
+
+    repetitions = options.repetitions;
+
+    for (size_t i = 0; i < options.sizesCount; i++) {
+        size_t count = options.sizes[i];
+        size_t jsonSize = 0;
+        char *json = generateTODOJson(count, options.titleLength, options.unicodePercent, &jsonSize);
+
+        if (json == NULL) {
+            fprintf(stderr, "Could not generate %zu entries.\n", count);
+            return 1;
+        }
+
+        BenchResult results[] = {
+            { bench: "parse", name: "parseTODOListDOM", seconds: benchDOM(json, jsonSize, count) },
+            { bench: "parse", name: "scanTODOList", seconds: benchScan(json, jsonSize, count) },
+            { bench: "parse", name: "parseTODOList", seconds: benchStore(json, jsonSize, count, false) },
+            { bench: "parse", name: "parseTODOList/interned", seconds: benchStore(json, jsonSize, count, true) },
+            { bench: "parse", name: "TODOStreamParser", seconds: benchStream(json, jsonSize) }
+        };
+
+        for (size_t r = 0; r < sizeof(results) / sizeof(results[0]); r++) {
+            results[r].entries = count;
+            results[r].bytes = jsonSize;
+            results[r].threads = 1;
+            benchReport(&results[r]);
+        }
+
+        free(json);
+    }
+
+    return 0;
+}
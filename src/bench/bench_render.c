@@ -0,0 +1,87 @@
+#include <stdio.h>
+#include <string.h>
+#include <table/table.h>
+#include <parallel/parallel.h>
+#include "bench.h"
+
+/*
+ * Measures how renderTableParallel scales from 1 to N threads on a
+ * synthetic table, writing to a sink which only counts bytes. The amount
+ * of threads goes up to the online cpus, or to BENCH_MAX_THREADS when set.
+ */
+
+
+static const char *TITLES[] = {
+    "delectus aut autem", "quis ut nam facilis et officia qui", "fugiat veniam minus",
+    "laboriosam mollitia et enim quasi adipisci quia provident illum", "ação 日本語 🚀"
+};
+
+const char *syntheticCell(void *source, size_t row, size_t column, char *scratch, size_t *outSize) {
+    (void)source;
+
+    switch (column) {
+        case 0:
+            *outSize = (size_t)snprintf(scratch, TABLE_CELL_SCRATCH_SIZE, "%zu", row / 20 + 1);
+            return scratch;
+        case 1:
+            *outSize = (size_t)snprintf(scratch, TABLE_CELL_SCRATCH_SIZE, "%zu", row + 1);
+            return scratch;
+        case 2:
+            *outSize = strlen(TITLES[row % 5]);
+            return TITLES[row % 5];
+        default:
+            *outSize = row % 3 == 0 ? 3 : 2;
+            return row % 3 == 0 ? "Yes" : "No";
+    }
+}
+
+size_t countingSink(const char *data, size_t size, void *context) {
+    (void)data;
+    *(size_t *)context += size;
+    return size;
+}
+
+int main(int argc, char **argv) {
+    const size_t defaults[] = { 1000000 };
+    BenchOptions options;
+    size_t maxThreads = parallelAvailableThreads();
+    const char *maxThreadsEnv = getenv("BENCH_MAX_THREADS");
+
+    if (!parseBenchOptions(argc, argv, defaults, 1, &options)) {
+        return 1;
+    }
+
+    if (maxThreadsEnv != NULL && atoi(maxThreadsEnv) > 0) {
+        maxThreads = (size_t)atoi(maxThreadsEnv);
+    }
+    TABLE_DATA_ITEM headers[4] = { "User ID", "ID", "Title", "Completed?" };
+
+    for (size_t i = 0; i < options.sizesCount; i++) {
+        Table table = { headers: headers, headersCount: 4, rows: NULL, rowsCount: options.sizes[i],
+                        getCell: syntheticCell, source: NULL };
+
+        for (size_t threads = 1; threads <= maxThreads; threads *= 2) {
+            BenchResult result = { bench: "render", name: "renderTableParallel", entries: options.sizes[i],
+                                   threads: threads };
+
+            for (size_t r = 0; r < options.repetitions; r++) {
+                size_t bytes = 0;
+                double start = benchNow();
+                table_err err = renderTableParallel(&table, threads, countingSink, &bytes);
+                double elapsed = benchNow() - start;
+
+                if (err != table_err_ok) {
+                    fprintf(stderr, "renderTableParallel failed: %d\n", err);
+                    return 1;
+                }
+
+                result.bytes = bytes;
+                result.seconds = r == 0 || elapsed < result.seconds ? elapsed : result.seconds;
+            }
+
+            benchReport(&result);
+        }
+    }
+
+    return 0;
+}
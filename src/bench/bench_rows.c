@@ -0,0 +1,213 @@
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <table/table.h>
+#include "main/models.h"
+#include "main/store.h"
+#include "main/query.h"
+#include "main/trigram.h"
+#include "bench.h"
+
+/*
+ * Measures what main does once the list is parsed: building every row cell
+ * with todoStoreCell, rendering the table into a sink which only counts
+ * bytes, drawTable writing to stdout, which is pointed at /dev/null, and
+ * runQuery searching the titles through their trigram index. Before the
+ * search is timed, a search nothing matches is checked to return no rows
+ * along with each sort key.
+ */
+
+size_t repetitions = 5;
+
+size_t countingSink(const char *data, size_t size, void *context) {
+    (void)data;
+    *(size_t *)context += size;
+    return size;
+}
+
+double benchCells(TodoStore *store, size_t *outBytes) {
+    char scratch[TABLE_CELL_SCRATCH_SIZE];
+    double best = 0;
+
+    for (size_t r = 0; r < repetitions; r++) {
+        size_t bytes = 0;
+        double start = benchNow();
+
+        for (size_t row = 0; row < store->length; row++) {
+            for (size_t column = 0; column < 4; column++) {
+                size_t size = 0;
+                todoStoreCell(store, row, column, scratch, &size);
+                bytes += size;
+            }
+        }
+
+        double elapsed = benchNow() - start;
+        *outBytes = bytes;
+        best = r == 0 || elapsed < best ? elapsed : best;
+    }
+
+    return best;
+}
+
+double benchRender(Table *table, size_t *outBytes) {
+    double best = 0;
+
+    for (size_t r = 0; r < repetitions; r++) {
+        size_t bytes = 0;
+        double start = benchNow();
+        table_err err = renderTable(table, countingSink, &bytes);
+        double elapsed = benchNow() - start;
+
+        if (err != table_err_ok) {
+            fprintf(stderr, "renderTable failed: %d\n", err);
+            exit(1);
+        }
+
+        *outBytes = bytes;
+        best = r == 0 || elapsed < best ? elapsed : best;
+    }
+
+    return best;
+}
+
+double benchDraw(Table *table) {
+    int devNull = open("/dev/null", O_WRONLY);
+    int savedStdout = dup(STDOUT_FILENO);
+    double best = 0;
+
+    if (devNull < 0 || savedStdout < 0) {
+        fprintf(stderr, "Could not redirect stdout.\n");
+        exit(1);
+    }
+
+    fflush(stdout);
+    dup2(devNull, STDOUT_FILENO);
+
+    for (size_t r = 0; r < repetitions; r++) {
+        double start = benchNow();
+        table_err err = drawTable(table);
+        fflush(stdout);
+        double elapsed = benchNow() - start;
+
+        if (err != table_err_ok) {
+            fprintf(stderr, "drawTable failed: %d\n", err);
+            exit(1);
+        }
+
+        best = r == 0 || elapsed < best ? elapsed : best;
+    }
+
+    dup2(savedStdout, STDOUT_FILENO);
+    close(savedStdout);
+    close(devNull);
+    return best;
+}
+
+/*
+ * runSearch runs a search through the index, sorted by a single key when
+ * sortField isn't query_field_count.
+ */
+TodoView runSearch(TodoIndex *index, const char *search, query_field sortField) {
+    Query query = { predicatesCount: 0, sortKeysCount: sortField != query_field_count, limit: 0, search: search };
+    TodoView view;
+
+    query.sortKeys[0].field = sortField;
+    query.sortKeys[0].descending = false;
+
+    if (runQuery(index, &query, &view) != query_err_ok) {
+        fprintf(stderr, "runQuery failed.\n");
+        exit(1);
+    }
+
+    return view;
+}
+
+void checkMissingSearch(TodoIndex *index) {
+    for (query_field field = 0; field <= query_field_count; field++) {
+        TodoView view = runSearch(index, "zzzq", field);
+
+        if (view.length != 0) {
+            fprintf(stderr, "Search without matches sorted by field %d returned %zu rows.\n", field, view.length);
+            exit(1);
+        }
+    }
+}
+
+double benchSearch(TodoIndex *index) {
+    double best = 0;
+
+    for (size_t r = 0; r < repetitions; r++) {
+        double start = benchNow();
+        runSearch(index, "facilis", query_field_id);
+        double elapsed = benchNow() - start;
+
+        best = r == 0 || elapsed < best ? elapsed : best;
+    }
+
+    return best;
+}
+
+int main(int argc, char **argv) {
+    const size_t defaults[] = { 1000, 100000, 1000000 };
+    BenchOptions options;
+
+    if (!parseBenchOptions(argc, argv, defaults, 3, &options)) {
+        return 1;
+    }
+
+    repetitions = options.repetitions;
+    TABLE_DATA_ITEM headers[4] = { "User ID", "ID", "Title", "Completed?" };
+
+    for (size_t i = 0; i < options.sizesCount; i++) {
+        size_t count = options.sizes[i];
+        size_t jsonSize = 0;
+        char *json = generateTODOJson(count, options.titleLength, options.unicodePercent, &jsonSize);
+        Arena *arena = newArena(ARENA_BLOCK_SIZE);
+        TodoStore *store = NULL;
+
+        if (json == NULL || arena == NULL || newTodoStore(arena, false, &store) != json_err_ok ||
+            parseTODOList(store, json, jsonSize) != json_err_ok) {
+            fprintf(stderr, "Could not parse %zu entries.\n", count);
+            return 1;
+        }
+
+        Table table = { headers: headers, headersCount: 4, rows: NULL, rowsCount: store->length,
+                        getCell: todoStoreCell, source: store };
+        BenchResult result = { bench: "rows", name: "todoStoreCell", entries: count, threads: 1 };
+
+        result.seconds = benchCells(store, &result.bytes);
+        benchReport(&result);
+
+        result.name = "renderTable";
+        result.seconds = benchRender(&table, &result.bytes);
+        benchReport(&result);
+
+        result.name = "drawTable";
+        result.seconds = benchDraw(&table);
+        benchReport(&result);
+
+        TrigramIndex *trigrams = NULL;
+        TodoIndex *index = NULL;
+
+        if (newTrigramIndex(&trigrams) != json_err_ok || trigramIndexAddStore(trigrams, store) != json_err_ok ||
+            newTodoIndex(arena, store, &index) != query_err_ok) {
+            fprintf(stderr, "Could not index %zu entries.\n", count);
+            return 1;
+        }
+
+        index->trigrams = trigrams;
+        checkMissingSearch(index);
+
+        result.name = "runQuery/search";
+        result.bytes = 0;
+        result.seconds = benchSearch(index);
+        benchReport(&result);
+
+        freeTrigramIndex(trigrams);
+        freeArena(arena);
+        free(json);
+    }
+
+    return 0;
+}
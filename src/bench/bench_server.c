@@ -0,0 +1,69 @@
+#include <stdio.h>
+#include <signal.h>
+#include <unistd.h>
+#include "bench.h"
+
+/*
+ * Serves a synthetic TODO list on loopback until interrupted, standing in
+ * for jsonplaceholder: `bench_server ENTRIES [--title-length N] [--unicode
+ * PERCENT]`. Its users are served on `/users`, so `--join-users` shows
+ * their names. The port is any free one, or BENCH_PORT when set.
+ *
+ * BENCH_FAIL_EVERY, BENCH_DROP_EVERY, BENCH_DELAY_EVERY and BENCH_DELAY_MS
+ * inject the matching BenchFaults.
+ */
+
+static volatile sig_atomic_t stopping = 0;
+
+static size_t envSize(const char *name) {
+    const char *value = getenv(name);
+    return value != NULL ? (size_t)strtoull(value, NULL, 10) : 0;
+}
+
+static void stop(int signal) {
+    (void)signal;
+    stopping = 1;
+}
+
+int main(int argc, char **argv) {
+    const size_t defaults[] = { 200 };
+    BenchOptions options;
+    const char *portEnv = getenv("BENCH_PORT");
+    unsigned short port = portEnv != NULL ? (unsigned short)atoi(portEnv) : 0;
+
+    if (!parseBenchOptions(argc, argv, defaults, 1, &options)) {
+        return 1;
+    }
+
+    size_t jsonSize = 0, usersSize = 0;
+    char *json = generateTODOJson(options.sizes[0], options.titleLength, options.unicodePercent, &jsonSize);
+    char *users = generateUsersJson(options.sizes[0] / BENCH_TODOS_PER_USER + 1, &usersSize);
+    BenchServer *server = NULL;
+
+    if (json == NULL || users == NULL || !startBenchServer(json, jsonSize, port, &server)) {
+        fprintf(stderr, "Could not serve %zu entries.\n", options.sizes[0]);
+        free(json);
+        free(users);
+        return 1;
+    }
+
+    benchServerSetUsers(server, users, usersSize);
+
+    BenchFaults faults = { failEvery: envSize("BENCH_FAIL_EVERY"), dropEvery: envSize("BENCH_DROP_EVERY"),
+                           delayEvery: envSize("BENCH_DELAY_EVERY"), delay: envSize("BENCH_DELAY_MS") };
+    benchServerSetFaults(server, &faults);
+
+    signal(SIGINT, stop);
+    signal(SIGTERM, stop);
+    printf("%s\n", benchServerUrl(server));
+    fflush(stdout);
+
+    while (!stopping) {
+        pause();
+    }
+
+    stopBenchServer(server);
+    free(json);
+    free(users);
+    return 0;
+}
@@ -0,0 +1,110 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdbool.h>
+#include <table/width.h>
+#include "bench.h"
+
+/*
+ * Compares the strlen loop calculateWidths used to run against displayWidth,
+ * on ASCII only titles and on titles mixing accented, CJK and emoji chars.
+ */
+
+size_t repetitions = 5;
+const size_t TITLE_LENGTH = 40;
+
+static const char *MIXED_WORDS[] = { "délectus", "aut", "日本語", "autem", "quis", "🚀", "ação", "ut" };
+
+/*
+ * buildTitles fills a blob with `count` NUL terminated titles.
+ */
+char *buildTitles(size_t count, bool mixed, size_t *outSize) {
+    size_t capacity = count * (TITLE_LENGTH + 16);
+    char *titles = malloc(capacity);
+    size_t size = 0;
+
+    for (size_t i = 0; i < count; i++) {
+        size_t start = size;
+
+        for (size_t word = i; size - start < TITLE_LENGTH; word++) {
+            const char *text = mixed ? MIXED_WORDS[word % 8] : (word % 2 == 0 ? "delectus" : "aut");
+            size += (size_t)snprintf(titles + size, capacity - size, "%s ", text);
+        }
+
+        titles[size++] = '\0';
+    }
+
+    *outSize = size;
+    return titles;
+}
+
+typedef size_t (*Measure)(const char *title, size_t size, width_impl impl);
+
+size_t measureStrlen(const char *title, size_t size, width_impl impl) {
+    (void)size;
+    (void)impl;
+    return strlen(title);
+}
+
+size_t measureWidth(const char *title, size_t size, width_impl impl) {
+    return displayWidthUsing(impl, title, size);
+}
+
+double run(Measure measure, width_impl impl, const char *titles, size_t size, size_t *outWidest) {
+    double best = 0;
+
+    for (size_t r = 0; r < repetitions; r++) {
+        size_t widest = 0;
+        double start = benchNow();
+
+        for (const char *title = titles; title < titles + size;) {
+            size_t titleSize = strlen(title);
+            size_t width = measure(title, titleSize, impl);
+            widest = width > widest ? width : widest;
+            title += titleSize + 1;
+        }
+
+        double elapsed = benchNow() - start;
+        best = r == 0 || elapsed < best ? elapsed : best;
+        *outWidest = widest;
+    }
+
+    return best;
+}
+
+int main(int argc, char **argv) {
+    const size_t defaults[] = { 1000000 };
+    const char *names[2][3] = {
+        { "ascii/displayWidth/scalar", "ascii/displayWidth/sse2", "ascii/displayWidth/avx2" },
+        { "mixed/displayWidth/scalar", "mixed/displayWidth/sse2", "mixed/displayWidth/avx2" }
+    };
+    BenchOptions options;
+
+    if (!parseBenchOptions(argc, argv, defaults, 1, &options)) {
+        return 1;
+    }
+
+    repetitions = options.repetitions;
+
+    for (size_t i = 0; i < options.sizesCount; i++) {
+        for (int mixed = 0; mixed < 2; mixed++) {
+            size_t size = 0;
+            size_t widest = 0;
+            char *titles = buildTitles(options.sizes[i], mixed, &size);
+            BenchResult result = { bench: "width", name: mixed ? "mixed/strlen" : "ascii/strlen",
+                                   entries: options.sizes[i], bytes: size, threads: 1 };
+
+            result.seconds = run(measureStrlen, width_impl_scalar, titles, size, &widest);
+            benchReport(&result);
+
+            for (width_impl impl = width_impl_scalar; impl <= displayWidthImpl(); impl++) {
+                result.name = names[mixed][impl];
+                result.seconds = run(measureWidth, impl, titles, size, &widest);
+                benchReport(&result);
+            }
+
+            free(titles);
+        }
+    }
+
+    return 0;
+}
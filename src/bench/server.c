@@ -0,0 +1,306 @@
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <strings.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include "bench.h"
+
+/*
+ * Most connections a BenchServer keeps open at once.
+ */
+#define BENCH_SERVER_CONNECTIONS 64
+
+/*
+ * Size of the buffer each connection reads request headers into.
+ */
+#define BENCH_SERVER_REQUEST_SIZE 8192
+
+/*
+ * ETag every response carries, and the one of the users.
+ */
+#define BENCH_SERVER_ETAG "\"bench-server\""
+#define BENCH_SERVER_USERS_ETAG "\"bench-users\""
+
+struct BenchServer {
+    const char *body;
+    size_t size;
+    const char *users;
+    size_t usersSize;
+    int listener;
+    pthread_t acceptThread;
+    pthread_mutex_t lock;
+    pthread_cond_t idle;
+    int connections[BENCH_SERVER_CONNECTIONS];
+    size_t connectionsCount;
+    bool stopping;
+    BenchFaults faults;
+    size_t requests;
+    char url[64];
+    char usersUrl[64];
+};
+
+typedef struct {
+    BenchServer *server;
+    int socket;
+} BenchConnection;
+
+static bool sendAll(int socket, const char *data, size_t size) {
+    while (size > 0) {
+        ssize_t sent = send(socket, data, size, MSG_NOSIGNAL);
+
+        if (sent < 0 && errno == EINTR) {
+            continue;
+        }
+
+        if (sent <= 0) {
+            return false;
+        }
+
+        data += sent;
+        size -= (size_t)sent;
+    }
+
+    return true;
+}
+
+/*
+ * respond answers one request, whose headers are in `request`. Returns
+ * false when the connection must be closed.
+ */
+static bool respond(BenchServer *server, int socket, const char *request) {
+    char headers[256];
+    bool notModified = false;
+    bool closing = false;
+
+    pthread_mutex_lock(&server->lock);
+    BenchFaults faults = server->faults;
+    size_t number = ++server->requests;
+    const char *users = server->users;
+    size_t usersSize = server->usersSize;
+    pthread_mutex_unlock(&server->lock);
+
+    if (faults.dropEvery > 0 && number % faults.dropEvery == 0) {
+        return false;
+    }
+
+    if (faults.delayEvery > 0 && number % faults.delayEvery == 0) {
+        usleep((useconds_t)(faults.delay * 1000));
+    }
+
+    if (faults.failEvery > 0 && number % faults.failEvery == 0) {
+        static const char unavailable[] = "HTTP/1.1 503 Service Unavailable\r\nContent-Length: 0\r\n\r\n";
+        return sendAll(socket, unavailable, sizeof(unavailable) - 1);
+    }
+
+    bool usersRequest = users != NULL && strncmp(request + strcspn(request, " "), " /users", 7) == 0;
+    const char *body = usersRequest ? users : server->body;
+    size_t bodySize = usersRequest ? usersSize : server->size;
+    const char *etag = usersRequest ? BENCH_SERVER_USERS_ETAG : BENCH_SERVER_ETAG;
+
+    for (const char *line = strstr(request, "\r\n"); line != NULL && line[2] != '\r'; line = strstr(line + 2, "\r\n")) {
+        const char *name = line + 2;
+
+        if (strncasecmp(name, "If-None-Match:", 14) == 0) {
+            notModified = strstr(name, etag) != NULL;
+        } else if (strncasecmp(name, "Connection:", 11) == 0) {
+            closing = strncasecmp(name + 11 + strspn(name + 11, " "), "close", 5) == 0;
+        }
+    }
+
+    int size = snprintf(headers, sizeof(headers),
+                        "HTTP/1.1 %s\r\nContent-Type: application/json\r\nContent-Length: %zu\r\n"
+                        "ETag: %s\r\n\r\n",
+                        notModified ? "304 Not Modified" : "200 OK", notModified ? 0 : bodySize, etag);
+
+    return sendAll(socket, headers, (size_t)size) && (notModified || sendAll(socket, body, bodySize)) && !closing;
+}
+
+static void *serveConnection(void *context) {
+    BenchConnection *connection = (BenchConnection *)context;
+    BenchServer *server = connection->server;
+    int socket = connection->socket;
+    char request[BENCH_SERVER_REQUEST_SIZE + 1];
+    size_t used = 0;
+    bool open = true;
+
+    free(connection);
+
+    while (open) {
+        ssize_t received = recv(socket, request + used, BENCH_SERVER_REQUEST_SIZE - used, 0);
+
+        if (received < 0 && errno == EINTR) {
+            continue;
+        }
+
+        if (received <= 0) {
+            break;
+        }
+
+        used += (size_t)received;
+        request[used] = '\0';
+
+        char *end;
+
+        while (open && (end = strstr(request, "\r\n\r\n")) != NULL) {
+            end[2] = '\0';
+            open = respond(server, socket, request);
+            used -= (size_t)(end + 4 - request);
+            memmove(request, end + 4, used + 1);
+        }
+
+        open = open && used < BENCH_SERVER_REQUEST_SIZE;
+    }
+
+    pthread_mutex_lock(&server->lock);
+    for (size_t i = 0; i < server->connectionsCount; i++) {
+        if (server->connections[i] == socket) {
+            server->connections[i] = server->connections[--server->connectionsCount];
+            break;
+        }
+    }
+    close(socket);
+    pthread_cond_broadcast(&server->idle);
+    pthread_mutex_unlock(&server->lock);
+    return NULL;
+}
+
+static void *acceptConnections(void *context) {
+    BenchServer *server = (BenchServer *)context;
+
+    for (;;) {
+        int socket = accept(server->listener, NULL, NULL);
+
+        if (socket < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) {
+                continue;
+            }
+            break;
+        }
+
+        int noDelay = 1;
+        setsockopt(socket, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+
+        BenchConnection *connection = malloc(sizeof(BenchConnection));
+        pthread_t thread;
+        bool accepted = false;
+
+        pthread_mutex_lock(&server->lock);
+        if (!server->stopping && connection != NULL && server->connectionsCount < BENCH_SERVER_CONNECTIONS) {
+            connection->server = server;
+            connection->socket = socket;
+            server->connections[server->connectionsCount++] = socket;
+            accepted = pthread_create(&thread, NULL, serveConnection, connection) == 0;
+
+            if (accepted) {
+                pthread_detach(thread);
+            } else {
+                server->connectionsCount--;
+            }
+        }
+        pthread_mutex_unlock(&server->lock);
+
+        if (!accepted) {
+            free(connection);
+            close(socket);
+        }
+    }
+
+    return NULL;
+}
+
+bool startBenchServer(const char *body, size_t size, unsigned short port, BenchServer **outServer) {
+    BenchServer *server = calloc(1, sizeof(BenchServer));
+
+    if (server == NULL) {
+        return false;
+    }
+
+    struct sockaddr_in address = { 0 };
+    socklen_t addressSize = sizeof(address);
+    int reuse = 1;
+
+    address.sin_family = AF_INET;
+    address.sin_port = htons(port);
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    server->body = body;
+    server->size = size;
+    server->listener = socket(AF_INET, SOCK_STREAM, 0);
+
+    if (server->listener < 0 ||
+        setsockopt(server->listener, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse)) != 0 ||
+        bind(server->listener, (struct sockaddr *)&address, sizeof(address)) != 0 ||
+        listen(server->listener, BENCH_SERVER_CONNECTIONS) != 0 ||
+        getsockname(server->listener, (struct sockaddr *)&address, &addressSize) != 0) {
+        if (server->listener >= 0) {
+            close(server->listener);
+        }
+        free(server);
+        return false;
+    }
+
+    snprintf(server->url, sizeof(server->url), "http://127.0.0.1:%u/todos", ntohs(address.sin_port));
+    snprintf(server->usersUrl, sizeof(server->usersUrl), "http://127.0.0.1:%u/users", ntohs(address.sin_port));
+    pthread_mutex_init(&server->lock, NULL);
+    pthread_cond_init(&server->idle, NULL);
+
+    if (pthread_create(&server->acceptThread, NULL, acceptConnections, server) != 0) {
+        close(server->listener);
+        pthread_mutex_destroy(&server->lock);
+        pthread_cond_destroy(&server->idle);
+        free(server);
+        return false;
+    }
+
+    *outServer = server;
+    return true;
+}
+
+void benchServerSetFaults(BenchServer *server, const BenchFaults *faults) {
+    pthread_mutex_lock(&server->lock);
+    server->faults = *faults;
+    server->requests = 0;
+    pthread_mutex_unlock(&server->lock);
+}
+
+void benchServerSetUsers(BenchServer *server, const char *body, size_t size) {
+    pthread_mutex_lock(&server->lock);
+    server->users = body;
+    server->usersSize = size;
+    pthread_mutex_unlock(&server->lock);
+}
+
+const char *benchServerUrl(const BenchServer *server) {
+    return server->url;
+}
+
+const char *benchServerUsersUrl(const BenchServer *server) {
+    return server->usersUrl;
+}
+
+void stopBenchServer(BenchServer *server) {
+    pthread_mutex_lock(&server->lock);
+    server->stopping = true;
+    pthread_mutex_unlock(&server->lock);
+
+    shutdown(server->listener, SHUT_RDWR);
+    pthread_join(server->acceptThread, NULL);
+    close(server->listener);
+
+    pthread_mutex_lock(&server->lock);
+    for (size_t i = 0; i < server->connectionsCount; i++) {
+        shutdown(server->connections[i], SHUT_RDWR);
+    }
+    while (server->connectionsCount > 0) {
+        pthread_cond_wait(&server->idle, &server->lock);
+    }
+    pthread_mutex_unlock(&server->lock);
+
+    pthread_mutex_destroy(&server->lock);
+    pthread_cond_destroy(&server->idle);
+    free(server);
+}
@@ -0,0 +1,422 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <curl/curl.h>
+#include <stats/stats.h>
+#include "cache.h"
+#include "internal.h"
+
+/*
+ * Longest `ETag` or `Last-Modified` value kept. Responses with longer ones
+ * aren't cached.
+ */
+#define HTTP_CACHE_HEADER_SIZE 256
+
+/*
+ * Length of the hex url hash naming each cached file.
+ */
+#define HTTP_CACHE_KEY_SIZE 16
+
+struct HttpCache {
+    char *directory;
+    HttpCacheStats stats;
+};
+
+/*
+ * CacheEntry holds the metadata kept next to a cached body.
+ *
+ * size         - Size of the cached body.
+ * etag         - `ETag` of the cached response, empty if it had none.
+ * lastModified - `Last-Modified` of the cached response, empty if it had none.
+ */
+typedef struct {
+    size_t size;
+    char etag[HTTP_CACHE_HEADER_SIZE];
+    char lastModified[HTTP_CACHE_HEADER_SIZE];
+} CacheEntry;
+
+/*
+ * cachePath writes into path the cache file of a url with the given suffix.
+ * path must hold strlen(directory) + HTTP_CACHE_KEY_SIZE + 16 bytes.
+ */
+static void cachePath(const HttpCache *cache, const char *url, const char *suffix, char *path) {
+    uint64_t hash = 14695981039346656037ULL;
+
+    for (const char *c = url; *c != '\0'; c++) {
+        hash = (hash ^ (unsigned char)*c) * 1099511628211ULL;
+    }
+
+    sprintf(path, "%s/%016llx%s", cache->directory, (unsigned long long)hash, suffix);
+}
+
+static char *newCachePath(const HttpCache *cache) {
+    return malloc(strlen(cache->directory) + HTTP_CACHE_KEY_SIZE + 16);
+}
+
+/*
+ * entryValidator hashes the validators of an entry, or returns 0 when it has
+ * none.
+ */
+static uint64_t entryValidator(const CacheEntry *entry) {
+    if (entry->etag[0] == '\0' && entry->lastModified[0] == '\0') {
+        return 0;
+    }
+
+    uint64_t hash = 14695981039346656037ULL ^ entry->size;
+
+    for (const char *c = entry->etag; *c != '\0'; c++) {
+        hash = (hash ^ (unsigned char)*c) * 1099511628211ULL;
+    }
+
+    hash = (hash ^ '\n') * 1099511628211ULL;
+    for (const char *c = entry->lastModified; *c != '\0'; c++) {
+        hash = (hash ^ (unsigned char)*c) * 1099511628211ULL;
+    }
+
+    return hash != 0 ? hash : 1;
+}
+
+/*
+ * readLine reads a line of a metadata file without its newline.
+ */
+static bool readLine(FILE *file, char *line, size_t size) {
+    if (fgets(line, (int)size, file) == NULL) {
+        return false;
+    }
+
+    size_t length = strlen(line);
+
+    if (length == 0 || line[length - 1] != '\n') {
+        return false;
+    }
+
+    line[length - 1] = '\0';
+    return true;
+}
+
+/*
+ * readEntry loads the metadata of a cached url. It fails when there's none,
+ * when it belongs to another url or when the body doesn't match it.
+ */
+static bool readEntry(const HttpCache *cache, const char *url, CacheEntry *outEntry) {
+    char *path = newCachePath(cache);
+    size_t urlSize = strlen(url) + 2;
+    char *line = malloc(urlSize > HTTP_CACHE_HEADER_SIZE ? urlSize : HTTP_CACHE_HEADER_SIZE);
+    bool ok = false;
+    FILE *file = NULL;
+    struct stat bodyStat;
+
+    if (path == NULL || line == NULL) {
+        goto done;
+    }
+
+    cachePath(cache, url, ".meta", path);
+    file = fopen(path, "r");
+
+    if (file == NULL ||
+        !readLine(file, line, HTTP_CACHE_HEADER_SIZE) ||
+        !readLine(file, outEntry->etag, HTTP_CACHE_HEADER_SIZE) ||
+        !readLine(file, outEntry->lastModified, HTTP_CACHE_HEADER_SIZE)) {
+        goto done;
+    }
+
+    outEntry->size = strtoull(line, NULL, 10);
+
+    if (!readLine(file, line, urlSize) || strcmp(line, url) != 0) {
+        goto done;
+    }
+
+    cachePath(cache, url, ".body", path);
+    ok = stat(path, &bodyStat) == 0 && (size_t)bodyStat.st_size == outEntry->size &&
+         (outEntry->etag[0] != '\0' || outEntry->lastModified[0] != '\0');
+
+done:
+    if (file != NULL) {
+        fclose(file);
+    }
+    free(path);
+    free(line);
+    return ok;
+}
+
+/*
+ * writeCacheFile atomically replaces a cache file, writing to a temporary
+ * file first and renaming it over.
+ */
+static bool writeCacheFile(const HttpCache *cache, const char *url, const char *suffix, const char *data, size_t size) {
+    char *path = newCachePath(cache);
+    char *temporaryPath = newCachePath(cache);
+    bool ok = false;
+
+    if (path == NULL || temporaryPath == NULL) {
+        goto done;
+    }
+
+    cachePath(cache, url, suffix, path);
+    cachePath(cache, url, ".XXXXXX", temporaryPath);
+    int fd = mkstemp(temporaryPath);
+
+    if (fd < 0) {
+        goto done;
+    }
+
+    ok = true;
+    for (size_t written = 0; ok && written < size;) {
+        ssize_t count = write(fd, data + written, size - written);
+
+        if (count < 0 && errno != EINTR) {
+            ok = false;
+        } else if (count > 0) {
+            written += (size_t)count;
+        }
+    }
+
+    ok = close(fd) == 0 && ok && rename(temporaryPath, path) == 0;
+
+    if (!ok) {
+        unlink(temporaryPath);
+    }
+
+done:
+    free(path);
+    free(temporaryPath);
+    return ok;
+}
+
+/*
+ * storeEntry caches a downloaded body. Its metadata is removed first, so
+ * a half written entry is never read back.
+ */
+static void storeEntry(const HttpCache *cache, const char *url, const CacheEntry *entry, const char *body) {
+    char *path = newCachePath(cache);
+    char *meta = malloc(strlen(url) + 2 * HTTP_CACHE_HEADER_SIZE + 32);
+
+    if (path != NULL && meta != NULL) {
+        cachePath(cache, url, ".meta", path);
+        unlink(path);
+
+        int metaSize = sprintf(meta, "%zu\n%s\n%s\n%s\n", entry->size, entry->etag, entry->lastModified, url);
+
+        if (writeCacheFile(cache, url, ".body", body, entry->size)) {
+            writeCacheFile(cache, url, ".meta", meta, (size_t)metaSize);
+        }
+    }
+
+    free(path);
+    free(meta);
+}
+
+/*
+ * mapEntry maps a cached body read only, so nothing done with it can reach
+ * the cached file or copy its pages.
+ */
+static bool mapEntry(const HttpCache *cache, const char *url, const CacheEntry *entry, HttpCachedBody *outBody) {
+    if (entry->size == 0) {
+        outBody->data = malloc(1);
+        outBody->size = 0;
+        outBody->mapped = false;
+        return outBody->data != NULL;
+    }
+
+    char *path = newCachePath(cache);
+
+    if (path == NULL) {
+        return false;
+    }
+
+    cachePath(cache, url, ".body", path);
+    int fd = open(path, O_RDONLY);
+    free(path);
+
+    if (fd < 0) {
+        return false;
+    }
+
+    void *data = mmap(NULL, entry->size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+
+    if (data == MAP_FAILED) {
+        return false;
+    }
+
+    outBody->data = data;
+    outBody->size = entry->size;
+    outBody->mapped = true;
+    return true;
+}
+
+/*
+ * copyHeader keeps the last value of a response header, or leaves it empty
+ * when it's missing or too long.
+ */
+static void copyHeader(CURL *curl, const char *name, char *value) {
+    struct curl_header *header = NULL;
+
+    value[0] = '\0';
+    if (curl_easy_header(curl, name, 0, CURLH_HEADER, -1, &header) == CURLHE_OK &&
+        strlen(header->value) < HTTP_CACHE_HEADER_SIZE) {
+        strcpy(value, header->value);
+    }
+}
+
+/*
+ * addHeader appends a `name: value` request header, skipping empty values.
+ */
+static bool addHeader(struct curl_slist **headers, const char *name, const char *value) {
+    if (value[0] == '\0') {
+        return true;
+    }
+
+    char line[HTTP_CACHE_HEADER_SIZE + 32];
+    snprintf(line, sizeof(line), "%s: %s", name, value);
+
+    struct curl_slist *appended = curl_slist_append(*headers, line);
+
+    if (appended == NULL) {
+        return false;
+    }
+
+    *headers = appended;
+    return true;
+}
+
+/*
+ * CachedAnswer receives the status and validators of the answer which
+ * settled a cached request.
+ */
+typedef struct {
+    long status;
+    CacheEntry entry;
+} CachedAnswer;
+
+/*
+ * readAnswer is the onSettled hook of cachedRequest.
+ */
+static void readAnswer(CURL *curl, void *rawAnswer) {
+    CachedAnswer *answer = (CachedAnswer *)rawAnswer;
+
+    curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &answer->status);
+    copyHeader(curl, "ETag", answer->entry.etag);
+    copyHeader(curl, "Last-Modified", answer->entry.lastModified);
+}
+
+/*
+ * cachedRequest does a single request through the client, conditional when
+ * cached isn't NULL.
+ */
+static http_err cachedRequest(HttpCache *cache, HttpClient *client, const char *url, const CacheEntry *cached,
+                              HttpCachedBody *outBody) {
+    HttpBody body = { data: NULL, size: 0, capacity: 0 };
+    CachedAnswer answer = { status: 0 };
+    HttpRequestHooks hooks = { headers: NULL, onSettled: readAnswer, context: &answer };
+
+    if (cached != NULL && (!addHeader(&hooks.headers, "If-None-Match", cached->etag) ||
+                           !addHeader(&hooks.headers, "If-Modified-Since", cached->lastModified))) {
+        curl_slist_free_all(hooks.headers);
+        return http_err_request_failed;
+    }
+
+    http_err err = performRequest(client, url, &hooks, (curl_write_callback)bodyWriteCallback, &body);
+    curl_slist_free_all(hooks.headers);
+
+    if (err != http_err_ok) {
+        free(body.data);
+        return err;
+    }
+
+    if (answer.status == 304 && cached != NULL) {
+        free(body.data);
+
+        if (!mapEntry(cache, url, cached, outBody)) {
+            return cachedRequest(cache, client, url, NULL, outBody);
+        }
+
+        outBody->validator = entryValidator(cached);
+        cache->stats.hits++;
+        cache->stats.bytesSaved += cached->size;
+        if (STATS_ACTIVE) {
+            statsRecordCache(true, cached->size);
+        }
+        return http_err_ok;
+    }
+
+    if (body.data == NULL) {
+        bodyWriteCallback("", 0, 0, &body);
+
+        if (body.data == NULL) {
+            return http_err_write_error;
+        }
+    }
+
+    answer.entry.size = body.size;
+    outBody->validator = 0;
+    if (answer.status == 200 && (answer.entry.etag[0] != '\0' || answer.entry.lastModified[0] != '\0')) {
+        storeEntry(cache, url, &answer.entry, body.data);
+        outBody->validator = entryValidator(&answer.entry);
+    }
+
+    cache->stats.misses++;
+    if (STATS_ACTIVE) {
+        statsRecordCache(false, 0);
+    }
+    outBody->data = body.data;
+    outBody->size = body.size;
+    outBody->mapped = false;
+    return http_err_ok;
+}
+
+http_err newHttpCache(const char *directory, HttpCache **outCache) {
+    struct stat directoryStat;
+
+    if (mkdir(directory, 0755) != 0 && errno != EEXIST) {
+        return http_err_write_error;
+    }
+
+    if (stat(directory, &directoryStat) != 0 || !S_ISDIR(directoryStat.st_mode)) {
+        return http_err_write_error;
+    }
+
+    HttpCache *cache = calloc(1, sizeof(HttpCache));
+
+    if (cache == NULL || (cache->directory = strdup(directory)) == NULL) {
+        free(cache);
+        return http_err_write_error;
+    }
+
+    *outCache = cache;
+    return http_err_ok;
+}
+
+void freeHttpCache(HttpCache *cache) {
+    if (cache == NULL) {
+        return;
+    }
+
+    free(cache->directory);
+    free(cache);
+}
+
+http_err httpCacheGet(HttpCache *cache, HttpClient *client, const char *url, HttpCachedBody *outBody) {
+    CacheEntry cached;
+    return cachedRequest(cache, client, url, readEntry(cache, url, &cached) ? &cached : NULL, outBody);
+}
+
+void releaseHttpCachedBody(HttpCachedBody *body) {
+    if (body->mapped) {
+        munmap(body->data, body->size);
+    } else {
+        free(body->data);
+    }
+
+    body->data = NULL;
+    body->size = 0;
+}
+
+void httpCacheStats(const HttpCache *cache, HttpCacheStats *outStats) {
+    *outStats = cache->stats;
+}
@@ -0,0 +1,87 @@
+#ifndef http_cache_h
+#define http_cache_h
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include "http.h"
+
+/*
+ * HttpCache keeps response bodies on disk, along with their `ETag` and
+ * `Last-Modified` headers, and revalidates them with conditional requests.
+ */
+typedef struct HttpCache HttpCache;
+
+/*
+ * HttpCacheStats counts what a HttpCache did since it was created.
+ *
+ * hits       - Requests answered with a 304 and served from disk.
+ * misses     - Requests which downloaded the whole body.
+ * bytesSaved - Size of every body served from disk instead of downloaded.
+ */
+typedef struct {
+    size_t hits;
+    size_t misses;
+    size_t bytesSaved;
+} HttpCacheStats;
+
+/*
+ * HttpCachedBody is a response body returned by httpCacheGet.
+ *
+ * data      - Body contents. It isn't NUL terminated, and can only be
+ *             written to when it isn't mapped: a body served from disk is a
+ *             read only mapping of the cached file.
+ * size      - Size of data.
+ * mapped    - Whether data is mapped from the cache instead of allocated.
+ * validator - Hash of the response `ETag`, `Last-Modified` and size, or 0
+ *             when it had no validator. A body with the same validator as a
+ *             previous one is the same body, so it can key anything derived
+ *             from it.
+ */
+typedef struct {
+    char *data;
+    size_t size;
+    bool mapped;
+    uint64_t validator;
+} HttpCachedBody;
+
+/*
+ * newHttpCache attempts to create a HttpCache.
+ *
+ * directory - Where the cached responses are kept. It's created if missing.
+ * outCache  - Receives the cache, released with freeHttpCache.
+ *
+ * Returns a `http_err_write_error` if the directory cannot be used.
+ */
+http_err newHttpCache(const char *directory, HttpCache **outCache);
+
+/*
+ * Releases a HttpCache. The cached files are kept.
+ */
+void freeHttpCache(HttpCache *cache);
+
+/*
+ * httpCacheGet does a get request through the cache. When the url is cached,
+ * the request carries `If-None-Match` and `If-Modified-Since`, and a 304
+ * answer is served by mapping the cached body. Any other successful answer
+ * replaces the cached copy when it's a 200.
+ *
+ * client  - Client doing the request.
+ * url     - Url to be requested.
+ * outBody - Receives the body, released with releaseHttpCachedBody.
+ *
+ * Returns the same errors as httpGet. Failing to update the cache isn't an
+ * error, the downloaded body is returned anyway.
+ */
+http_err httpCacheGet(HttpCache *cache, HttpClient *client, const char *url, HttpCachedBody *outBody);
+
+/*
+ * Releases a body returned by httpCacheGet.
+ */
+void releaseHttpCachedBody(HttpCachedBody *body);
+
+/*
+ * httpCacheStats reads the cache counters.
+ */
+void httpCacheStats(const HttpCache *cache, HttpCacheStats *outStats);
+
+#endif
@@ -0,0 +1,852 @@
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
+#include <curl/curl.h>
+#include <stats/stats.h>
+#include "http.h"
+#include "internal.h"
+
+/*
+ * Idle handles kept by a HttpClient. Handles released above it are cleaned up.
+ */
+const size_t HTTP_IDLE_HANDLES = 16;
+
+/*
+ * Initial capacity of a buffered response body.
+ */
+const size_t HTTP_BODY_CAPACITY = 1 << 14;
+
+/*
+ * HttpClient keeps, along with its handles, the latencies of its last
+ * requests, in milliseconds until their body started, to pick when to
+ * hedge.
+ */
+struct HttpClient {
+    CURLSH *share;
+    CURLM *multi;
+    CURL **idle;
+    size_t idleCount;
+    size_t maxConnections;
+    HttpPolicy policy;
+    long latencies[HTTP_LATENCY_SAMPLES];
+    size_t latenciesCount;
+    size_t latenciesNext;
+};
+
+static HttpPolicy defaultPolicy = { connectTimeout: 10000, timeout: 0, stallTimeout: 30000, retries: 2,
+                                    backoff: 200, hedgePercentile: 0, hedgeDelay: 0 };
+
+static pthread_mutex_t globalLock = PTHREAD_MUTEX_INITIALIZER;
+static size_t clientsCount = 0;
+
+/*
+ * globalInit runs curl_global_init along with the first client, and
+ * globalCleanup runs curl_global_cleanup along with the last one.
+ */
+static bool globalInit(void) {
+    bool ok = true;
+
+    pthread_mutex_lock(&globalLock);
+    if (clientsCount == 0) {
+        ok = curl_global_init(CURL_GLOBAL_ALL) == CURLE_OK;
+    }
+    if (ok) {
+        clientsCount++;
+    }
+    pthread_mutex_unlock(&globalLock);
+    return ok;
+}
+
+static void globalCleanup(void) {
+    pthread_mutex_lock(&globalLock);
+    if (--clientsCount == 0) {
+        curl_global_cleanup();
+    }
+    pthread_mutex_unlock(&globalLock);
+}
+
+http_err mapCurlError(CURLcode err) {
+    switch(err) {
+        case CURLE_OK: return http_err_ok;
+        case CURLE_COULDNT_RESOLVE_HOST: return http_err_host_error;
+        case CURLE_COULDNT_RESOLVE_PROXY: return http_err_proxy_error;
+        case CURLE_WRITE_ERROR: return http_err_write_error;
+        case CURLE_OPERATION_TIMEDOUT: return http_err_timeout;
+        case CURLE_COULDNT_CONNECT:
+        case CURLE_GOT_NOTHING:
+        case CURLE_SEND_ERROR:
+        case CURLE_RECV_ERROR: return http_err_connect_failed;
+        default: return http_err_request_failed;
+    }
+}
+
+http_err transferOutcome(CURL *curl, CURLcode result) {
+    long status = 0;
+
+    if (result == CURLE_OPERATION_TIMEDOUT && STATS_ACTIVE) {
+        statsRecordHttpEvent(stats_http_timeout);
+    }
+
+    if (result != CURLE_OK) {
+        return mapCurlError(result);
+    }
+
+    curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &status);
+    return status >= 500 ? http_err_server_error : http_err_ok;
+}
+
+long retryDelay(const HttpClient *client, size_t attempt, http_err err) {
+    if (attempt >= client->policy.retries ||
+        (err != http_err_timeout && err != http_err_connect_failed && err != http_err_server_error)) {
+        return -1;
+    }
+
+    long delay = client->policy.backoff;
+
+    for (size_t i = 0; i < attempt && delay < HTTP_MAX_BACKOFF; i++) {
+        delay *= 2;
+    }
+
+    return delay < HTTP_MAX_BACKOFF ? delay : HTTP_MAX_BACKOFF;
+}
+
+/*
+ * sleepMilliseconds waits for an interval, going on after signals.
+ */
+static void sleepMilliseconds(long milliseconds) {
+    struct timespec interval = { tv_sec: milliseconds / 1000, tv_nsec: (milliseconds % 1000) * 1000000 };
+
+    while (nanosleep(&interval, &interval) != 0 && errno == EINTR) {
+    }
+}
+
+bool retryAfter(const HttpClient *client, size_t attempt, http_err err) {
+    long delay = retryDelay(client, attempt, err);
+
+    if (delay < 0) {
+        return false;
+    }
+
+    if (STATS_ACTIVE) {
+        statsRecordHttpEvent(stats_http_retry);
+    }
+
+    sleepMilliseconds(delay);
+    return true;
+}
+
+/*
+ * nowMilliseconds returns the monotonic time, in milliseconds.
+ */
+static long nowMilliseconds(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (long)now.tv_sec * 1000 + now.tv_nsec / 1000000;
+}
+
+size_t bodyWriteCallback(void *contents, size_t size, size_t nMembers, void *rawBody) {
+    size_t realSize = size * nMembers;
+    HttpBody *body = (HttpBody *)rawBody;
+
+    if (body->size + realSize + 1 > body->capacity) {
+        size_t capacity = body->capacity > 0 ? body->capacity : HTTP_BODY_CAPACITY;
+
+        while (capacity < body->size + realSize + 1) {
+            capacity *= 2;
+        }
+
+        char *data = realloc(body->data, capacity);
+
+        if (data == NULL) {
+            return 0;
+        }
+
+        body->data = data;
+        body->capacity = capacity;
+    }
+
+    memcpy(body->data + body->size, contents, realSize);
+    body->size += realSize;
+    body->data[body->size] = '\0';
+    return realSize;
+}
+
+size_t streamWriteCallback(void *contents, size_t size, size_t nMembers, void *rawStream) {
+    HttpStream *stream = (HttpStream *)rawStream;
+    long status = 0;
+
+    if (stream->delivered == 0 && stream->curl != NULL) {
+        curl_easy_getinfo(stream->curl, CURLINFO_RESPONSE_CODE, &status);
+
+        if (status >= 500) {
+            return size * nMembers;
+        }
+    }
+
+    size_t consumed = stream->onChunk((const char *)contents, size * nMembers, stream->context);
+    stream->delivered += consumed;
+    return consumed;
+}
+
+void httpDefaultPolicy(HttpPolicy *outPolicy) {
+    *outPolicy = defaultPolicy;
+}
+
+void httpSetDefaultPolicy(const HttpPolicy *policy) {
+    defaultPolicy = *policy;
+}
+
+void httpClientSetPolicy(HttpClient *client, const HttpPolicy *policy) {
+    client->policy = *policy;
+}
+
+http_err newHttpClient(size_t maxConnections, HttpClient **outClient) {
+    if (!globalInit()) {
+        return http_err_request_failed;
+    }
+
+    HttpClient *client = calloc(1, sizeof(HttpClient));
+
+    if (client == NULL) {
+        globalCleanup();
+        return http_err_request_failed;
+    }
+
+    client->maxConnections = maxConnections > 0 ? maxConnections : HTTP_MAX_CONNECTIONS;
+    client->policy = defaultPolicy;
+    client->share = curl_share_init();
+    client->multi = curl_multi_init();
+    client->idle = calloc(HTTP_IDLE_HANDLES, sizeof(CURL *));
+
+    if (client->share == NULL || client->multi == NULL || client->idle == NULL) {
+        freeHttpClient(client);
+        return http_err_request_failed;
+    }
+
+    curl_share_setopt(client->share, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+    curl_share_setopt(client->share, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+    curl_share_setopt(client->share, CURLSHOPT_SHARE, CURL_LOCK_DATA_CONNECT);
+    curl_multi_setopt(client->multi, CURLMOPT_MAX_TOTAL_CONNECTIONS, (long)client->maxConnections);
+    curl_multi_setopt(client->multi, CURLMOPT_MAX_HOST_CONNECTIONS, (long)client->maxConnections);
+    *outClient = client;
+    return http_err_ok;
+}
+
+void freeHttpClient(HttpClient *client) {
+    if (client == NULL) {
+        return;
+    }
+
+    for (size_t i = 0; i < client->idleCount; i++) {
+        curl_easy_cleanup(client->idle[i]);
+    }
+
+    if (client->multi != NULL) {
+        curl_multi_cleanup(client->multi);
+    }
+
+    if (client->share != NULL) {
+        curl_share_cleanup(client->share);
+    }
+
+    free(client->idle);
+    free(client);
+    globalCleanup();
+}
+
+void recordTransfer(CURL *curl) {
+    curl_off_t bytesReceived = 0, nameLookup = 0, connect = 0, tls = 0, startTransfer = 0, total = 0;
+
+    curl_easy_getinfo(curl, CURLINFO_SIZE_DOWNLOAD_T, &bytesReceived);
+    curl_easy_getinfo(curl, CURLINFO_NAMELOOKUP_TIME_T, &nameLookup);
+    curl_easy_getinfo(curl, CURLINFO_CONNECT_TIME_T, &connect);
+    curl_easy_getinfo(curl, CURLINFO_APPCONNECT_TIME_T, &tls);
+    curl_easy_getinfo(curl, CURLINFO_STARTTRANSFER_TIME_T, &startTransfer);
+    curl_easy_getinfo(curl, CURLINFO_TOTAL_TIME_T, &total);
+
+    StatsTransfer transfer = { bytesReceived: (uint64_t)bytesReceived, nameLookupUs: (uint64_t)nameLookup,
+                               connectUs: (uint64_t)connect, tlsUs: (uint64_t)tls,
+                               startTransferUs: (uint64_t)startTransfer, totalUs: (uint64_t)total };
+    statsRecordTransfer(&transfer);
+}
+
+CURL *acquireHandle(HttpClient *client) {
+    CURL *curl = client->idleCount > 0 ? client->idle[--client->idleCount] : curl_easy_init();
+
+    if (curl != NULL) {
+        curl_easy_setopt(curl, CURLOPT_SHARE, client->share);
+        curl_easy_setopt(curl, CURLOPT_TCP_KEEPALIVE, 1L);
+        curl_easy_setopt(curl, CURLOPT_CONNECTTIMEOUT_MS, client->policy.connectTimeout);
+        curl_easy_setopt(curl, CURLOPT_TIMEOUT_MS, client->policy.timeout);
+
+        if (client->policy.stallTimeout > 0) {
+            curl_easy_setopt(curl, CURLOPT_LOW_SPEED_LIMIT, 1L);
+            curl_easy_setopt(curl, CURLOPT_LOW_SPEED_TIME, (client->policy.stallTimeout + 999) / 1000);
+        }
+    }
+
+    return curl;
+}
+
+void releaseHandle(HttpClient *client, CURL *curl) {
+    if (client->idleCount == HTTP_IDLE_HANDLES) {
+        curl_easy_cleanup(curl);
+        return;
+    }
+
+    curl_easy_reset(curl);
+    client->idle[client->idleCount++] = curl;
+}
+
+/*
+ * HttpRace is a request whose attempts race each other: the first one to
+ * hand over any of the body wins, and the other one is aborted on its next
+ * chunk.
+ *
+ * writeFunc - Receives the body of the winner.
+ * writeData - Passed untouched to writeFunc.
+ * winner    - The winning attempt, once one wrote.
+ * delivered - Bytes consumed by writeFunc.
+ */
+typedef struct HttpRace HttpRace;
+
+/*
+ * HttpAttempt is one of the transfers of a HttpRace.
+ */
+typedef struct {
+    HttpRace *race;
+    CURL *curl;
+} HttpAttempt;
+
+struct HttpRace {
+    curl_write_callback writeFunc;
+    void *writeData;
+    const HttpRequestHooks *hooks;
+    HttpAttempt *winner;
+    size_t delivered;
+};
+
+static size_t raceWriteCallback(char *contents, size_t size, size_t nMembers, void *rawAttempt) {
+    HttpAttempt *attempt = (HttpAttempt *)rawAttempt;
+    HttpRace *race = attempt->race;
+    long status = 0;
+
+    if (race->winner == NULL) {
+        curl_easy_getinfo(attempt->curl, CURLINFO_RESPONSE_CODE, &status);
+
+        /*
+         * Bodies of server errors are dropped, so the request can be
+         * retried.
+         */
+        if (status >= 500) {
+            return size * nMembers;
+        }
+
+        race->winner = attempt;
+    }
+
+    if (race->winner != attempt) {
+        return 0;
+    }
+
+    size_t consumed = race->writeFunc(contents, size, nMembers, race->writeData);
+    race->delivered += consumed;
+    return consumed;
+}
+
+/*
+ * hedgeDelay returns the milliseconds after which a request is sent again,
+ * or -1 when the client doesn't hedge.
+ */
+static long hedgeDelay(const HttpClient *client) {
+    long sorted[HTTP_LATENCY_SAMPLES];
+    size_t count = client->latenciesCount;
+
+    if (client->policy.hedgePercentile == 0) {
+        return -1;
+    }
+
+    if (count < HTTP_HEDGE_MIN_SAMPLES) {
+        return client->policy.hedgeDelay;
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        size_t j = i;
+
+        for (; j > 0 && sorted[j - 1] > client->latencies[i]; j--) {
+            sorted[j] = sorted[j - 1];
+        }
+        sorted[j] = client->latencies[i];
+    }
+
+    size_t rank = (count * client->policy.hedgePercentile + 99) / 100;
+    return sorted[rank > 0 ? rank - 1 : 0];
+}
+
+/*
+ * startAttempt adds a new attempt of a race to the client multi.
+ */
+static bool startAttempt(HttpClient *client, const char *url, HttpRace *race, HttpAttempt *attempt) {
+    attempt->race = race;
+    attempt->curl = acquireHandle(client);
+
+    if (attempt->curl == NULL) {
+        return false;
+    }
+
+    curl_easy_setopt(attempt->curl, CURLOPT_URL, url);
+    curl_easy_setopt(attempt->curl, CURLOPT_WRITEFUNCTION, raceWriteCallback);
+    curl_easy_setopt(attempt->curl, CURLOPT_WRITEDATA, attempt);
+    curl_easy_setopt(attempt->curl, CURLOPT_PRIVATE, (void *)attempt);
+
+    if (race->hooks != NULL && race->hooks->headers != NULL) {
+        curl_easy_setopt(attempt->curl, CURLOPT_HTTPHEADER, race->hooks->headers);
+    }
+
+    if (curl_multi_add_handle(client->multi, attempt->curl) != CURLM_OK) {
+        releaseHandle(client, attempt->curl);
+        return false;
+    }
+
+    return true;
+}
+
+/*
+ * raceRequest runs one attempt of a request, hedged by a second one when
+ * the first one is slower than the client hedgeDelay.
+ *
+ * outResult - Receives the curl result of the attempt which settled it.
+ */
+static http_err raceRequest(HttpClient *client, const char *url, HttpRace *race, CURLcode *outResult) {
+    HttpAttempt attempts[2];
+    size_t started = 0;
+    size_t running = 0;
+    long hedgeAfter = hedgeDelay(client);
+    long start = nowMilliseconds();
+    http_err err = http_err_request_failed;
+    bool settled = false;
+
+    race->winner = NULL;
+    *outResult = CURLE_FAILED_INIT;
+
+    if (!startAttempt(client, url, race, &attempts[started])) {
+        return http_err_request_failed;
+    }
+
+    started++;
+    running++;
+
+    while (!settled) {
+        int active;
+        CURLMsg *message;
+        int queued;
+
+        curl_multi_perform(client->multi, &active);
+
+        while (!settled && (message = curl_multi_info_read(client->multi, &queued)) != NULL) {
+            if (message->msg != CURLMSG_DONE) {
+                continue;
+            }
+
+            HttpAttempt *attempt;
+            curl_easy_getinfo(message->easy_handle, CURLINFO_PRIVATE, (char **)&attempt);
+            http_err outcome = transferOutcome(attempt->curl, message->data.result);
+            running--;
+
+            if (STATS_ACTIVE) {
+                recordTransfer(attempt->curl);
+            }
+
+            /*
+             * The winner settles the race. Without one, a success does, or
+             * a failure once no other attempt is left.
+             */
+            if (race->winner == attempt || (race->winner == NULL && (outcome == http_err_ok || running == 0))) {
+                err = outcome;
+                settled = true;
+                *outResult = message->data.result;
+                race->winner = attempt;
+            }
+        }
+
+        long elapsed = nowMilliseconds() - start;
+
+        if (!settled && started == 1 && hedgeAfter >= 0 && race->winner == NULL && elapsed >= hedgeAfter &&
+            startAttempt(client, url, race, &attempts[started])) {
+            started++;
+            running++;
+
+            if (STATS_ACTIVE) {
+                statsRecordHttpEvent(stats_http_hedge);
+            }
+        }
+
+        if (!settled) {
+            long wait = started == 1 && hedgeAfter >= 0 && hedgeAfter - elapsed < 1000 ? hedgeAfter - elapsed : 1000;
+            curl_multi_poll(client->multi, NULL, 0, wait > 0 ? (int)wait : 0, NULL);
+        }
+    }
+
+    if (err == http_err_ok) {
+        curl_off_t latency = 0;
+        curl_easy_getinfo(race->winner->curl, CURLINFO_STARTTRANSFER_TIME_T, &latency);
+        client->latencies[client->latenciesNext] = (long)(latency / 1000);
+        client->latenciesNext = (client->latenciesNext + 1) % HTTP_LATENCY_SAMPLES;
+        client->latenciesCount += client->latenciesCount < HTTP_LATENCY_SAMPLES;
+
+        if (race->winner == &attempts[1] && STATS_ACTIVE) {
+            statsRecordHttpEvent(stats_http_hedge_won);
+        }
+    }
+
+    if (*outResult == CURLE_OK && race->hooks != NULL && race->hooks->onSettled != NULL) {
+        race->hooks->onSettled(race->winner->curl, race->hooks->context);
+    }
+
+    for (size_t i = 0; i < started; i++) {
+        curl_multi_remove_handle(client->multi, attempts[i].curl);
+        releaseHandle(client, attempts[i].curl);
+    }
+
+    return err;
+}
+
+http_err performRequest(HttpClient *client, const char *url, const HttpRequestHooks *hooks,
+                        curl_write_callback writeFunc, void *writeData) {
+    HttpRace race = { writeFunc: writeFunc, writeData: writeData, hooks: hooks, winner: NULL, delivered: 0 };
+    CURLcode result;
+    http_err err = raceRequest(client, url, &race, &result);
+
+    for (size_t attempt = 0; err != http_err_ok && race.delivered == 0 && retryAfter(client, attempt, err);
+         attempt++) {
+        err = raceRequest(client, url, &race, &result);
+    }
+
+    if (err != http_err_ok && STATS_ACTIVE) {
+        statsRecordHttpEvent(stats_http_failure);
+    }
+
+    if (result != CURLE_OK) {
+        fprintf(stderr, "(ERROR http.c) CURL ERROR: %d.\n", result);
+    }
+
+    return err;
+}
+
+http_err httpClientGet(HttpClient *client, const char *url, char **result, size_t *outSize) {
+    HttpBody body = { data: NULL, size: 0, capacity: 0 };
+
+    if (bodyWriteCallback("", 0, 0, &body) != 0 || body.data == NULL) {
+        return http_err_write_error;
+    }
+
+    http_err err = performRequest(client, url, NULL, (curl_write_callback)bodyWriteCallback, &body);
+
+    if (err != http_err_ok) {
+        free(body.data);
+        return err;
+    }
+
+    *result = body.data;
+    if (outSize != NULL) {
+        *outSize = body.size;
+    }
+    return http_err_ok;
+}
+
+http_err httpClientGetStream(HttpClient *client, const char *url, HttpChunkCallback onChunk, void *context) {
+    if (onChunk == NULL) {
+        return http_err_request_failed;
+    }
+
+    HttpStream stream = { onChunk: onChunk, context: context, curl: NULL, delivered: 0 };
+    return performRequest(client, url, NULL, (curl_write_callback)streamWriteCallback, &stream);
+}
+
+/*
+ * HttpTransfer is one of the requests run by performMulti.
+ *
+ * curl     - Its handle, or NULL when it couldn't be started.
+ * response - Receives its status and error.
+ * body     - Where its body is buffered, emptied before a retry. May be NULL.
+ * stream   - Where its body is streamed, in which case it's only retried
+ *            while nothing was handed over. May be NULL.
+ * attempts - Attempts made so far.
+ * retryAt  - When a failed attempt is retried, on the monotonic clock in
+ *            milliseconds, or -1 while it isn't waiting.
+ */
+typedef struct {
+    CURL *curl;
+    HttpResponse *response;
+    HttpBody *body;
+    HttpStream *stream;
+    size_t attempts;
+    long retryAt;
+} HttpTransfer;
+
+/*
+ * finishTransfer settles a finished attempt of a transfer. A failure the
+ * client policy retries takes the handle out of the multi, to be added
+ * back once its backoff passed, instead of blocking the other transfers.
+ *
+ * Returns whether the transfer is waiting to be retried.
+ */
+static bool finishTransfer(HttpClient *client, HttpTransfer *transfer, CURLcode result) {
+    http_err err = transferOutcome(transfer->curl, result);
+    long delay = transfer->stream == NULL || transfer->stream->delivered == 0
+                     ? retryDelay(client, transfer->attempts, err)
+                     : -1;
+
+    curl_easy_getinfo(transfer->curl, CURLINFO_RESPONSE_CODE, &transfer->response->status);
+    transfer->response->err = err;
+    transfer->attempts++;
+
+    if (STATS_ACTIVE) {
+        recordTransfer(transfer->curl);
+    }
+
+    if (delay >= 0) {
+        curl_multi_remove_handle(client->multi, transfer->curl);
+        transfer->retryAt = nowMilliseconds() + delay;
+
+        if (STATS_ACTIVE) {
+            statsRecordHttpEvent(stats_http_retry);
+        }
+        return true;
+    }
+
+    if (err != http_err_ok && STATS_ACTIVE) {
+        statsRecordHttpEvent(stats_http_failure);
+    }
+
+    if (result != CURLE_OK) {
+        fprintf(stderr, "(ERROR http.c) CURL ERROR: %d.\n", result);
+    }
+    return false;
+}
+
+/*
+ * performMulti runs the transfers added to the client multi until every one
+ * is done, retrying them as the client policy asks for. The CURLINFO_PRIVATE
+ * of each handle must point to its HttpTransfer.
+ */
+static void performMulti(HttpClient *client, HttpTransfer *transfers, size_t count) {
+    int running = 1;
+    size_t waiting = 0;
+
+    while (running > 0 || waiting > 0) {
+        if (curl_multi_perform(client->multi, &running) != CURLM_OK) {
+            break;
+        }
+
+        CURLMsg *message;
+        int queued;
+
+        while ((message = curl_multi_info_read(client->multi, &queued)) != NULL) {
+            if (message->msg != CURLMSG_DONE) {
+                continue;
+            }
+
+            HttpTransfer *transfer;
+            curl_easy_getinfo(message->easy_handle, CURLINFO_PRIVATE, (char **)&transfer);
+            waiting += finishTransfer(client, transfer, message->data.result);
+        }
+
+        long now = nowMilliseconds();
+        long wait = 1000;
+
+        for (size_t i = 0; waiting > 0 && i < count; i++) {
+            HttpTransfer *transfer = &transfers[i];
+
+            if (transfer->retryAt < 0) {
+                continue;
+            }
+
+            if (transfer->retryAt > now) {
+                wait = transfer->retryAt - now < wait ? transfer->retryAt - now : wait;
+                continue;
+            }
+
+            if (transfer->body != NULL) {
+                transfer->body->size = 0;
+            }
+
+            transfer->retryAt = -1;
+            waiting--;
+            if (curl_multi_add_handle(client->multi, transfer->curl) == CURLM_OK) {
+                running++;
+            }
+        }
+
+        if (running > 0 || waiting > 0) {
+            curl_multi_poll(client->multi, NULL, 0, (int)wait, NULL);
+        }
+    }
+}
+
+/*
+ * copyEtag keeps the ETag of a response, or leaves it empty when it's
+ * missing or too long.
+ */
+static void copyEtag(CURL *curl, char *etag) {
+    struct curl_header *header = NULL;
+
+    etag[0] = '\0';
+    if (curl_easy_header(curl, "ETag", 0, CURLH_HEADER, -1, &header) == CURLHE_OK &&
+        strlen(header->value) < HTTP_ETAG_SIZE) {
+        strcpy(etag, header->value);
+    }
+}
+
+/*
+ * getMany runs httpClientGetMany. When etags isn't NULL, each non empty one
+ * is sent as If-None-Match, and receives the ETag of a successful response.
+ */
+static http_err getMany(HttpClient *client, const char **urls, char (*etags)[HTTP_ETAG_SIZE], size_t count,
+                        HttpResponse *outResponses) {
+    HttpBody *bodies = calloc(count > 0 ? count : 1, sizeof(HttpBody));
+    HttpTransfer *transfers = calloc(count > 0 ? count : 1, sizeof(HttpTransfer));
+    struct curl_slist **headers = calloc(count > 0 ? count : 1, sizeof(struct curl_slist *));
+    http_err err = http_err_ok;
+
+    if (bodies == NULL || transfers == NULL || headers == NULL) {
+        free(bodies);
+        free(transfers);
+        free(headers);
+        return http_err_write_error;
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        outResponses[i] = (HttpResponse){ body: NULL, size: 0, status: 0, err: http_err_request_failed };
+        transfers[i] = (HttpTransfer){ curl: acquireHandle(client), response: &outResponses[i], body: &bodies[i],
+                                       stream: NULL, attempts: 0, retryAt: -1 };
+
+        if (transfers[i].curl == NULL) {
+            continue;
+        }
+
+        if (etags != NULL && etags[i][0] != '\0') {
+            char line[HTTP_ETAG_SIZE + 16];
+            snprintf(line, sizeof(line), "If-None-Match: %s", etags[i]);
+            headers[i] = curl_slist_append(NULL, line);
+            curl_easy_setopt(transfers[i].curl, CURLOPT_HTTPHEADER, headers[i]);
+        }
+
+        curl_easy_setopt(transfers[i].curl, CURLOPT_URL, urls[i]);
+        curl_easy_setopt(transfers[i].curl, CURLOPT_WRITEFUNCTION, bodyWriteCallback);
+        curl_easy_setopt(transfers[i].curl, CURLOPT_WRITEDATA, &bodies[i]);
+        curl_easy_setopt(transfers[i].curl, CURLOPT_PRIVATE, (void *)&transfers[i]);
+
+        if (curl_multi_add_handle(client->multi, transfers[i].curl) != CURLM_OK) {
+            releaseHandle(client, transfers[i].curl);
+            transfers[i].curl = NULL;
+        }
+    }
+
+    performMulti(client, transfers, count);
+
+    for (size_t i = 0; i < count; i++) {
+        if (transfers[i].curl != NULL) {
+            if (etags != NULL && outResponses[i].err == http_err_ok && outResponses[i].status != 304) {
+                copyEtag(transfers[i].curl, etags[i]);
+            }
+
+            curl_multi_remove_handle(client->multi, transfers[i].curl);
+            releaseHandle(client, transfers[i].curl);
+        }
+        curl_slist_free_all(headers[i]);
+
+        if (outResponses[i].err == http_err_ok && bodies[i].data == NULL) {
+            bodyWriteCallback("", 0, 0, &bodies[i]);
+            outResponses[i].err = bodies[i].data == NULL ? http_err_write_error : http_err_ok;
+        }
+
+        if (outResponses[i].err == http_err_ok) {
+            outResponses[i].body = bodies[i].data;
+            outResponses[i].size = bodies[i].size;
+        } else {
+            free(bodies[i].data);
+            err = err == http_err_ok ? outResponses[i].err : err;
+        }
+    }
+
+    free(bodies);
+    free(transfers);
+    free(headers);
+    return err;
+}
+
+http_err httpClientGetMany(HttpClient *client, const char **urls, size_t count, HttpResponse *outResponses) {
+    return getMany(client, urls, NULL, count, outResponses);
+}
+
+http_err httpClientGetManyIfChanged(HttpClient *client, const char **urls, char (*etags)[HTTP_ETAG_SIZE],
+                                    size_t count, HttpResponse *outResponses) {
+    return getMany(client, urls, etags, count, outResponses);
+}
+
+http_err httpClientGetStreams(HttpClient *client, HttpStreamRequest *requests, size_t count) {
+    HttpStream *streams = calloc(count > 0 ? count : 1, sizeof(HttpStream));
+    HttpResponse *responses = calloc(count > 0 ? count : 1, sizeof(HttpResponse));
+    HttpTransfer *transfers = calloc(count > 0 ? count : 1, sizeof(HttpTransfer));
+    http_err err = http_err_ok;
+
+    if (streams == NULL || responses == NULL || transfers == NULL) {
+        free(streams);
+        free(responses);
+        free(transfers);
+        return http_err_write_error;
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        CURL *curl = requests[i].onChunk != NULL ? acquireHandle(client) : NULL;
+        streams[i] = (HttpStream){ onChunk: requests[i].onChunk, context: requests[i].context, curl: curl,
+                                   delivered: 0 };
+        responses[i] = (HttpResponse){ body: NULL, size: 0, status: 0, err: http_err_request_failed };
+        transfers[i] = (HttpTransfer){ curl: curl, response: &responses[i], body: NULL, stream: &streams[i],
+                                       attempts: 0, retryAt: -1 };
+
+        if (curl == NULL) {
+            continue;
+        }
+
+        curl_easy_setopt(curl, CURLOPT_URL, requests[i].url);
+        curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, streamWriteCallback);
+        curl_easy_setopt(curl, CURLOPT_WRITEDATA, &streams[i]);
+        curl_easy_setopt(curl, CURLOPT_PRIVATE, (void *)&transfers[i]);
+
+        if (curl_multi_add_handle(client->multi, curl) != CURLM_OK) {
+            releaseHandle(client, curl);
+            transfers[i].curl = NULL;
+        }
+    }
+
+    performMulti(client, transfers, count);
+
+    for (size_t i = 0; i < count; i++) {
+        if (transfers[i].curl != NULL) {
+            curl_multi_remove_handle(client->multi, transfers[i].curl);
+            releaseHandle(client, transfers[i].curl);
+        }
+
+        requests[i].status = responses[i].status;
+        requests[i].err = responses[i].err;
+        err = err == http_err_ok ? responses[i].err : err;
+    }
+
+    free(streams);
+    free(responses);
+    free(transfers);
+    return err;
+}
+
+void freeHttpResponses(HttpResponse *responses, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        free(responses[i].body);
+        responses[i].body = NULL;
+    }
+}
@@ -1,58 +1,56 @@
 #include <stdlib.h>
-#include <string.h>
-#include <curl/curl.h>
+#include <pthread.h>
 #include "http.h"
 
-typedef struct {
-    char *response;
-    size_t size;
-} MemoryStruct;
+static pthread_once_t defaultClientOnce = PTHREAD_ONCE_INIT;
+static HttpClient *defaultClient = NULL;
 
-size_t writeCallback(void *contents, size_t size, size_t nMembers, void *rawMemory) {
-    size_t realSize = size * nMembers;
-    MemoryStruct *memory = (MemoryStruct *)rawMemory;
-    char *newMemory = realloc(memory->response, realSize + memory->size + 1);
+static void freeDefaultClient(void) {
+    freeHttpClient(defaultClient);
+    defaultClient = NULL;
+}
 
-    if (newMemory == NULL) {
-        return 0;
+static void createDefaultClient(void) {
+    if (newHttpClient(0, &defaultClient) == http_err_ok) {
+        atexit(freeDefaultClient);
     }
+}
 
-    memory->response = newMemory;
-    memcpy(memory->response + memory->size, contents, realSize);
-    memory->size += realSize;
-    memory->response[memory->size] = '\0';
-    return realSize;
+/*
+ * getDefaultClient returns the HttpClient shared by httpGet and httpGetStream,
+ * or NULL if it couldn't be created.
+ */
+static HttpClient *getDefaultClient(void) {
+    pthread_once(&defaultClientOnce, createDefaultClient);
+    return defaultClient;
 }
 
 http_err httpGet(const char *url, char **result) {
-    curl_global_init(CURL_GLOBAL_ALL);
-    CURL *curl = curl_easy_init();
-    MemoryStruct memory;
-    memory.response = calloc(1, sizeof(char));
-
-    if (memory.response == NULL) {
-        curl_easy_cleanup(curl);
-        return http_err_write_error;
+    HttpClient *client = getDefaultClient();
+
+    if (client == NULL) {
+        return http_err_request_failed;
     }
 
-    memory.size = 0;
-    curl_easy_setopt(curl, CURLOPT_URL, url);
-    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, writeCallback);
-    curl_easy_setopt(curl, CURLOPT_WRITEDATA, (void *)&memory);
-    CURLcode err = curl_easy_perform(curl);
-
-    if (err != CURLE_OK) {
-        free(memory.response);
-        printf("(ERROR http.c) CURL ERROR: %d.\n", err);
-        curl_easy_cleanup(curl);
-        switch(err) {
-            case CURLE_COULDNT_RESOLVE_HOST: return http_err_host_error;
-            case CURLE_COULDNT_RESOLVE_PROXY: return http_err_proxy_error;
-            default: return http_err_request_failed;
-        }
+    return httpClientGet(client, url, result, NULL);
+}
+
+http_err httpGetStream(const char *url, HttpChunkCallback onChunk, void *context) {
+    HttpClient *client = getDefaultClient();
+
+    if (client == NULL) {
+        return http_err_request_failed;
+    }
+
+    return httpClientGetStream(client, url, onChunk, context);
+}
+
+http_err httpGetStreams(HttpStreamRequest *requests, size_t count) {
+    HttpClient *client = getDefaultClient();
+
+    if (client == NULL) {
+        return http_err_request_failed;
     }
 
-    *result = memory.response;
-    curl_easy_cleanup(curl);
-    return http_err_ok;
+    return httpClientGetStreams(client, requests, count);
 }
@@ -1,5 +1,6 @@
 #ifndef http_h
 #define http_h
+#include <stdlib.h>
 
 typedef enum {
     http_err_ok = 0,
@@ -7,9 +8,210 @@ typedef enum {
     http_err_host_error = 2,
     http_err_proxy_error = 3,
     http_err_write_error = 4,
-
+    http_err_timeout = 5,
+    http_err_connect_failed = 6,
+    http_err_server_error = 7
 } http_err;
 
+/*
+ * HttpChunkCallback receives each chunk of a response body as it arrives.
+ *
+ * chunk   - Bytes received. They are only valid during the call and are not
+ *           NUL terminated.
+ * size    - Amount of bytes in chunk.
+ * context - The context provided to httpGetStream.
+ *
+ * Must return the amount of bytes consumed. Anything different from `size`
+ * aborts the transfer with a `http_err_write_error`.
+ */
+typedef size_t (*HttpChunkCallback)(const char *chunk, size_t size, void *context);
+
+/*
+ * HttpResponse holds the outcome of one of the requests of httpClientGetMany.
+ *
+ * body   - NUL terminated response body, or NULL when err isn't `http_err_ok`.
+ * size   - Size of body, without the NUL terminator.
+ * status - HTTP status code of the response.
+ * err    - Outcome of the request.
+ */
+typedef struct {
+    char *body;
+    size_t size;
+    long status;
+    http_err err;
+} HttpResponse;
+
+/*
+ * HttpClient owns long lived curl handles. Connections, DNS results and TLS
+ * sessions are shared between them, so consecutive and concurrent requests
+ * to the same host reuse them instead of starting from scratch. A client
+ * must be used by one thread at a time.
+ */
+typedef struct HttpClient HttpClient;
+
+/*
+ * Default amount of concurrent connections of a HttpClient.
+ */
+#define HTTP_MAX_CONNECTIONS 8
+
+/*
+ * Longest wait between two attempts of a request, in milliseconds.
+ */
+#define HTTP_MAX_BACKOFF 10000
+
+/*
+ * Latencies a HttpClient remembers to pick its hedging delay, and how many
+ * it needs before trusting them over the policy hedgeDelay.
+ */
+#define HTTP_LATENCY_SAMPLES 64
+#define HTTP_HEDGE_MIN_SAMPLES 8
+
+/*
+ * HttpPolicy bounds how long requests may take and how they're retried.
+ * Timeouts end a request with a `http_err_timeout`.
+ *
+ * connectTimeout  - Milliseconds to connect, or 0 for curl's default.
+ * timeout         - Milliseconds each attempt may take, or 0 for no limit.
+ * stallTimeout    - Milliseconds an attempt may go without receiving
+ *                   anything, rounded up to seconds, or 0 for no limit.
+ * retries         - Attempts made after the first one, for timeouts,
+ *                   failed or dropped connections and server errors. Other
+ *                   failures, such as a malformed url, aren't retried, nor
+ *                   is a request once any of its body was handed over.
+ * backoff         - Milliseconds before the first retry, doubled for each
+ *                   next one up to HTTP_MAX_BACKOFF.
+ * hedgePercentile - When not 0, a single request whose body hasn't started
+ *                   after this percentile of the client recent latencies
+ *                   is sent a second time, and the first one to answer is
+ *                   used.
+ * hedgeDelay      - Milliseconds used instead of the percentile until
+ *                   HTTP_HEDGE_MIN_SAMPLES latencies are known.
+ */
+typedef struct {
+    long connectTimeout;
+    long timeout;
+    long stallTimeout;
+    size_t retries;
+    long backoff;
+    size_t hedgePercentile;
+    long hedgeDelay;
+} HttpPolicy;
+
+/*
+ * httpDefaultPolicy returns the policy new clients start with: a 10s
+ * connect timeout, a 30s stall timeout, 2 retries from 200ms, and no
+ * hedging unless httpSetDefaultPolicy changed it.
+ */
+void httpDefaultPolicy(HttpPolicy *outPolicy);
+
+/*
+ * httpSetDefaultPolicy changes the policy of the clients created after it,
+ * the one shared by httpGet included. Must be called before any other
+ * thread uses a client.
+ */
+void httpSetDefaultPolicy(const HttpPolicy *policy);
+
+/*
+ * httpClientSetPolicy changes the policy of a single client.
+ */
+void httpClientSetPolicy(HttpClient *client, const HttpPolicy *policy);
+
+/*
+ * newHttpClient attempts to create a HttpClient.
+ *
+ * maxConnections - Most connections open at once by httpClientGetMany, or 0
+ *                  for HTTP_MAX_CONNECTIONS.
+ * outClient      - Receives the client, released with freeHttpClient.
+ *
+ * Returns a `http_err_request_failed` if curl cannot be initialized.
+ */
+http_err newHttpClient(size_t maxConnections, HttpClient **outClient);
+
+/*
+ * Releases a HttpClient, closing its connections. curl itself is cleaned up
+ * along with the last client.
+ */
+void freeHttpClient(HttpClient *client);
+
+/*
+ * httpClientGet does the same as httpGet using one of the client handles.
+ *
+ * outSize - Receives the body size. May be NULL.
+ */
+http_err httpClientGet(HttpClient *client, const char *url, char **result, size_t *outSize);
+
+/*
+ * httpClientGetStream does the same as httpGetStream using one of the
+ * client handles.
+ */
+http_err httpClientGetStream(HttpClient *client, const char *url, HttpChunkCallback onChunk, void *context);
+
+/*
+ * httpClientGetMany fetches several urls concurrently through curl_multi,
+ * with at most the client maxConnections open at once.
+ *
+ * urls         - Urls to be fetched.
+ * count        - Amount of urls.
+ * outResponses - Receives a response per url, in the same order. Bodies must
+ *                be released with freeHttpResponses.
+ *
+ * Returns a `http_err_ok` when every request succeeded. Otherwise, returns the
+ * error of the first failed request, and each response has its own error.
+ */
+http_err httpClientGetMany(HttpClient *client, const char **urls, size_t count, HttpResponse *outResponses);
+
+/*
+ * Longest ETag kept by httpClientGetManyIfChanged, NUL terminator included.
+ */
+#define HTTP_ETAG_SIZE 128
+
+/*
+ * httpClientGetManyIfChanged does the same as httpClientGetMany revalidating
+ * copies the caller already holds.
+ *
+ * etags - An ETag per url. Non empty ones are sent as If-None-Match, so an
+ *         unchanged url answers a 304 with an empty body. Receives the ETag
+ *         of every other successful response, empty when it had none.
+ */
+http_err httpClientGetManyIfChanged(HttpClient *client, const char **urls, char (*etags)[HTTP_ETAG_SIZE],
+                                    size_t count, HttpResponse *outResponses);
+
+/*
+ * HttpStreamRequest is a url whose body is handed to a callback as it
+ * arrives, along with other ones.
+ *
+ * url     - Url to be fetched.
+ * onChunk - Called with every chunk of the body, in order.
+ * context - Passed untouched to onChunk.
+ * status  - Receives the response status code.
+ * err     - Receives the request error, as for httpGetStream.
+ */
+typedef struct {
+    const char *url;
+    HttpChunkCallback onChunk;
+    void *context;
+    long status;
+    http_err err;
+} HttpStreamRequest;
+
+/*
+ * httpClientGetStreams streams several urls concurrently through curl_multi,
+ * so their transfers overlap. Chunks of different requests are interleaved,
+ * always on the calling thread.
+ *
+ * requests - Requests to be run, each one receiving its own status and error.
+ * count    - Amount of requests.
+ *
+ * Returns a `http_err_ok` when every request succeeded, or the error of the
+ * first failed one otherwise.
+ */
+http_err httpClientGetStreams(HttpClient *client, HttpStreamRequest *requests, size_t count);
+
+/*
+ * Releases the bodies of a list of HttpResponse.
+ */
+void freeHttpResponses(HttpResponse *responses, size_t count);
+
 /*
  * httpGet attempts to make a get request based on a provided (char *)
  * and writes the result content onto a (char **)
@@ -20,9 +222,33 @@ typedef enum {
  *
  * Returns a http_err. It returns a `http_err_write_error` if the
  * response could not be allocated, a `http_err_ok` on success, a
- * proxy or host error based on the curl_easy_perform result. In
- * case of any other curl error, it returns a generic `http_err_request_failed`.
+ * proxy, host, connection or timeout error based on the curl result, and
+ * a `http_err_server_error` for 5xx responses. In case of any other curl
+ * error, it returns a generic `http_err_request_failed`. Those happening
+ * after every retry of the client policy are the ones returned.
+ *
+ * It goes through a HttpClient shared by the whole process, created on the
+ * first call and released at exit.
  */
 http_err httpGet(const char *url, char **result);
 
+/*
+ * httpGetStream makes a get request handing each received chunk straight to
+ * a callback instead of buffering the whole response.
+ *
+ * url     - String from where we should point our request
+ * onChunk - Called with every chunk of the body, in order.
+ * context - Passed untouched to onChunk.
+ *
+ * Returns the same errors as httpGet. A `http_err_write_error` means onChunk
+ * aborted the transfer.
+ */
+http_err httpGetStream(const char *url, HttpChunkCallback onChunk, void *context);
+
+/*
+ * httpGetStreams does the same as httpClientGetStreams through the client
+ * shared by httpGet.
+ */
+http_err httpGetStreams(HttpStreamRequest *requests, size_t count);
+
 #endif
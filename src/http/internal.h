@@ -0,0 +1,113 @@
+#ifndef http_internal_h
+#define http_internal_h
+#include <stdbool.h>
+#include <curl/curl.h>
+#include "http.h"
+
+/*
+ * HttpBody accumulates a response body, doubling its capacity as it grows.
+ */
+typedef struct {
+    char *data;
+    size_t size;
+    size_t capacity;
+} HttpBody;
+
+/*
+ * HttpStream holds the consumer of a streamed response.
+ *
+ * onChunk   - Receives the body.
+ * context   - Passed untouched to onChunk.
+ * curl      - Handle of the transfer, whose server errors aren't handed
+ *             over. May be NULL.
+ * delivered - Bytes handed to onChunk so far.
+ */
+typedef struct {
+    HttpChunkCallback onChunk;
+    void *context;
+    CURL *curl;
+    size_t delivered;
+} HttpStream;
+
+/*
+ * bodyWriteCallback is the curl write function appending to a HttpBody.
+ * Called with no contents, it just makes sure the body is allocated.
+ */
+size_t bodyWriteCallback(void *contents, size_t size, size_t nMembers, void *rawBody);
+
+/*
+ * streamWriteCallback is the curl write function handing chunks to a
+ * HttpStream. The body of a server error is dropped instead, so the request
+ * can be retried.
+ */
+size_t streamWriteCallback(void *contents, size_t size, size_t nMembers, void *rawStream);
+
+/*
+ * mapCurlError turns a curl result into a http_err. Connections dropped
+ * before an answer count as failed connections, so they're retried.
+ */
+http_err mapCurlError(CURLcode err);
+
+/*
+ * transferOutcome returns the http_err of a finished transfer, which is a
+ * `http_err_server_error` for 5xx responses, counting its timeouts.
+ */
+http_err transferOutcome(CURL *curl, CURLcode result);
+
+/*
+ * retryDelay returns the milliseconds to wait before retrying a request
+ * which failed with err on its attempt-th attempt, starting at 0, or -1
+ * when it must not be retried. Only timeouts, failed connections and
+ * server errors are retried.
+ */
+long retryDelay(const HttpClient *client, size_t attempt, http_err err);
+
+/*
+ * retryAfter waits the retryDelay of a failed attempt, counting the retry.
+ * Returns false without waiting when it must not be retried.
+ */
+bool retryAfter(const HttpClient *client, size_t attempt, http_err err);
+
+/*
+ * acquireHandle returns an idle handle of the client, or a new one, set to
+ * share the client connections. Returns NULL if it cannot be created.
+ */
+CURL *acquireHandle(HttpClient *client);
+
+/*
+ * releaseHandle resets a handle and keeps it idle for the next request.
+ */
+void releaseHandle(HttpClient *client, CURL *curl);
+
+/*
+ * HttpRequestHooks customizes a request run by performRequest.
+ *
+ * headers   - Extra request headers, or NULL.
+ * onSettled - Called with the handle of the attempt which settled the
+ *             request, when it got an answer, before the handle is reset.
+ *             Called again for each retry. May be NULL.
+ * context   - Passed untouched to onSettled.
+ */
+typedef struct {
+    struct curl_slist *headers;
+    void (*onSettled)(CURL *curl, void *context);
+    void *context;
+} HttpRequestHooks;
+
+/*
+ * performRequest runs a single get request with the client handles,
+ * following its policy: failed attempts are retried while nothing was
+ * handed to writeFunc, and slow ones may be hedged.
+ *
+ * hooks - Customizes the request. May be NULL.
+ */
+http_err performRequest(HttpClient *client, const char *url, const HttpRequestHooks *hooks,
+                        curl_write_callback writeFunc, void *writeData);
+
+/*
+ * recordTransfer hands the curl timings of a finished transfer to the stats.
+ * Must only be called while they're enabled.
+ */
+void recordTransfer(CURL *curl);
+
+#endif
@@ -0,0 +1,111 @@
+#include <stdio.h>
+#include <string.h>
+#include <stats/stats.h>
+#include "diff.h"
+
+/*
+ * hashEntry folds the fields of a row, except its ID, into a FNV-1a hash.
+ */
+static uint64_t hashEntry(const TodoStore *store, uint32_t row) {
+    int32_t userID = store->userIDs[row];
+    unsigned char completed = todoStoreCompleted(store, row);
+    const char *title = todoStoreTitle(store, row);
+    uint64_t hash = 0xcbf29ce484222325ULL;
+
+    for (size_t i = 0; i < sizeof(userID); i++) {
+        hash = (hash ^ ((uint32_t)userID >> (i * 8) & 0xff)) * 0x100000001b3ULL;
+    }
+
+    hash = (hash ^ completed) * 0x100000001b3ULL;
+    for (size_t i = 0; i < store->titleLengths[row]; i++) {
+        hash = (hash ^ (unsigned char)title[i]) * 0x100000001b3ULL;
+    }
+
+    return hash;
+}
+
+static int compareDigestEntries(const void *a, const void *b) {
+    const TodoDigestEntry *left = (const TodoDigestEntry *)a;
+    const TodoDigestEntry *right = (const TodoDigestEntry *)b;
+
+    if (left->ID != right->ID) {
+        return left->ID < right->ID ? -1 : 1;
+    }
+
+    return (left->position > right->position) - (left->position < right->position);
+}
+
+query_err newTodoDigest(Arena *arena, const TodoView *view, TodoDigest *outDigest) {
+    TodoDigestEntry *entries = arenaAlloc(arena, view->length * sizeof(TodoDigestEntry) + 1);
+    statsCountAlloc(stats_component_models, view->length * sizeof(TodoDigestEntry));
+
+    if (entries == NULL) {
+        return query_err_alloc_failed;
+    }
+
+    bool sorted = true;
+
+    for (size_t i = 0; i < view->length; i++) {
+        uint32_t row = view->rows[i];
+
+        entries[i].ID = view->store->IDs[row];
+        entries[i].position = (uint32_t)i;
+        entries[i].hash = hashEntry(view->store, row);
+        sorted = sorted && (i == 0 || entries[i - 1].ID <= entries[i].ID);
+    }
+
+    /*
+     * Lists come sorted by ID unless a query reordered them.
+     */
+    if (!sorted) {
+        qsort(entries, view->length, sizeof(TodoDigestEntry), compareDigestEntries);
+    }
+
+    outDigest->entries = entries;
+    outDigest->length = view->length;
+    return query_err_ok;
+}
+
+TodoDelta diffTodoDigests(const TodoDigest *previous, const TodoDigest *current, size_t *outSources) {
+    TodoDelta delta = { inserted: 0, removed: 0, changed: 0, moved: false };
+    size_t i = 0, j = 0;
+
+    while (i < previous->length && j < current->length) {
+        const TodoDigestEntry *before = &previous->entries[i];
+        const TodoDigestEntry *after = &current->entries[j];
+
+        if (before->ID < after->ID) {
+            delta.removed++;
+            i++;
+        } else if (before->ID > after->ID) {
+            delta.inserted++;
+            j++;
+
+            if (outSources != NULL) {
+                outSources[after->position] = SIZE_MAX;
+            }
+        } else {
+            delta.changed += before->hash != after->hash;
+            delta.moved = delta.moved || before->position != after->position;
+            i++;
+            j++;
+
+            if (outSources != NULL) {
+                outSources[after->position] = before->position;
+            }
+        }
+    }
+
+    delta.removed += previous->length - i;
+    delta.inserted += current->length - j;
+
+    for (; outSources != NULL && j < current->length; j++) {
+        outSources[current->entries[j].position] = SIZE_MAX;
+    }
+
+    return delta;
+}
+
+bool todoDeltaIsEmpty(const TodoDelta *delta) {
+    return delta->inserted == 0 && delta->removed == 0 && delta->changed == 0 && !delta->moved;
+}
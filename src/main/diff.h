@@ -0,0 +1,75 @@
+#ifndef diff_h
+#define diff_h
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <arena/arena.h>
+#include "query.h"
+
+/*
+ * TodoDigestEntry sums up an entry of a TodoView.
+ *
+ * ID       - ID of the entry.
+ * position - Where the entry is in the view.
+ * hash     - Hash of its userID, title and completed flag.
+ */
+typedef struct {
+    int32_t ID;
+    uint32_t position;
+    uint64_t hash;
+} TodoDigestEntry;
+
+/*
+ * TodoDigest sums up a TodoView, so it can be compared with a later one
+ * after its store is gone.
+ *
+ * entries - One per view row, sorted by ID, then by position.
+ * length  - Amount of entries.
+ */
+typedef struct {
+    TodoDigestEntry *entries;
+    size_t length;
+} TodoDigest;
+
+/*
+ * TodoDelta is what changed from a TodoDigest to another one.
+ *
+ * inserted - Entries whose ID wasn't there before.
+ * removed  - Entries whose ID isn't there anymore.
+ * changed  - Entries whose ID stayed but some other field changed.
+ * moved    - Whether any kept entry is at another position.
+ */
+typedef struct {
+    size_t inserted;
+    size_t removed;
+    size_t changed;
+    bool moved;
+} TodoDelta;
+
+/*
+ * newTodoDigest sums up a view.
+ *
+ * arena     - Where the entries are allocated.
+ * view      - View to be summed up.
+ * outDigest - Receives the digest.
+ *
+ * Returns a `query_err_alloc_failed` if the entries cannot be allocated.
+ */
+query_err newTodoDigest(Arena *arena, const TodoView *view, TodoDigest *outDigest);
+
+/*
+ * diffTodoDigests matches the entries of two digests by ID. Repeated IDs
+ * are matched in the order they appear.
+ *
+ * outSources - When not NULL, receives for each position of the current
+ *              view the position its entry had in the previous one, or
+ *              SIZE_MAX when it was inserted.
+ */
+TodoDelta diffTodoDigests(const TodoDigest *previous, const TodoDigest *current, size_t *outSources);
+
+/*
+ * todoDeltaIsEmpty tells whether nothing changed.
+ */
+bool todoDeltaIsEmpty(const TodoDelta *delta);
+
+#endif
@@ -0,0 +1,135 @@
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <stats/stats.h>
+#include "input.h"
+
+void parseInputSource(const char *text, InputSource *outSource) {
+    if (strcmp(text, "-") == 0) {
+        *outSource = (InputSource){ kind: input_kind_stdin, location: NULL };
+    } else if (strncmp(text, "http://", 7) == 0 || strncmp(text, "https://", 8) == 0) {
+        *outSource = (InputSource){ kind: input_kind_url, location: text };
+    } else {
+        *outSource = (InputSource){ kind: input_kind_file, location: text };
+    }
+}
+
+/*
+ * readMapped hands a regular file to onChunk from a read only mapping, one
+ * window at a time, dropping each window from the mapping once consumed.
+ */
+static input_err readMapped(int fd, size_t size, HttpChunkCallback onChunk, void *context) {
+    if (size == 0) {
+        return input_err_ok;
+    }
+
+    char *data = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+    if (data == MAP_FAILED) {
+        return input_err_open_failed;
+    }
+
+    madvise(data, size, MADV_SEQUENTIAL);
+
+    input_err err = input_err_ok;
+
+    for (size_t offset = 0; offset < size && err == input_err_ok; offset += INPUT_WINDOW_SIZE) {
+        size_t window = size - offset < INPUT_WINDOW_SIZE ? size - offset : INPUT_WINDOW_SIZE;
+
+        if (onChunk(data + offset, window, context) != window) {
+            err = input_err_aborted;
+        }
+
+        madvise(data + offset, window, MADV_DONTNEED);
+    }
+
+    munmap(data, size);
+    return err;
+}
+
+/*
+ * readStream hands a stream to onChunk through a single reused buffer.
+ */
+static input_err readStream(int fd, HttpChunkCallback onChunk, void *context) {
+    char *buffer = malloc(INPUT_READ_SIZE);
+    input_err err = input_err_ok;
+    statsCountAlloc(stats_component_models, INPUT_READ_SIZE);
+
+    if (buffer == NULL) {
+        return input_err_read_failed;
+    }
+
+    for (;;) {
+        ssize_t size = read(fd, buffer, INPUT_READ_SIZE);
+
+        if (size < 0 && errno == EINTR) {
+            continue;
+        }
+
+        if (size < 0) {
+            err = input_err_read_failed;
+        } else if (size > 0 && onChunk(buffer, (size_t)size, context) != (size_t)size) {
+            err = input_err_aborted;
+        }
+
+        if (size <= 0 || err != input_err_ok) {
+            break;
+        }
+    }
+
+    free(buffer);
+    return err;
+}
+
+/*
+ * readDescriptor maps fd when it's a regular file, or streams it otherwise.
+ */
+static input_err readDescriptor(int fd, HttpChunkCallback onChunk, void *context) {
+    struct stat fileStat;
+
+    if (fstat(fd, &fileStat) == 0 && S_ISREG(fileStat.st_mode)) {
+        off_t offset = lseek(fd, 0, SEEK_CUR);
+
+        /*
+         * A redirected stdin may not start at the beginning of its file.
+         * Such leftovers are rare enough to just be read.
+         */
+        if (offset == 0) {
+            return readMapped(fd, (size_t)fileStat.st_size, onChunk, context);
+        }
+    }
+
+    return readStream(fd, onChunk, context);
+}
+
+input_err readInputSource(const InputSource *source, HttpChunkCallback onChunk, void *context, http_err *outHttpErr) {
+    *outHttpErr = http_err_ok;
+
+    if (source->kind == input_kind_url) {
+        *outHttpErr = httpGetStream(source->location, onChunk, context);
+
+        if (*outHttpErr == http_err_write_error) {
+            return input_err_aborted;
+        }
+
+        return *outHttpErr == http_err_ok ? input_err_ok : input_err_request_failed;
+    }
+
+    if (source->kind == input_kind_stdin) {
+        return readDescriptor(STDIN_FILENO, onChunk, context);
+    }
+
+    int fd = open(source->location, O_RDONLY);
+
+    if (fd < 0) {
+        return input_err_open_failed;
+    }
+
+    input_err err = readDescriptor(fd, onChunk, context);
+    close(fd);
+    return err;
+}
@@ -0,0 +1,71 @@
+#ifndef input_h
+#define input_h
+#include <stdlib.h>
+#include <http/http.h>
+
+typedef enum {
+    input_err_ok = 0,
+    input_err_open_failed = 1,
+    input_err_read_failed = 2,
+    input_err_aborted = 3,
+    input_err_request_failed = 4
+} input_err;
+
+typedef enum {
+    input_kind_url = 0,
+    input_kind_file = 1,
+    input_kind_stdin = 2
+} input_kind;
+
+/*
+ * Size of the windows of a mapped file handed to the consumer at once.
+ * Pages behind the current window are released, so a file of any size is
+ * read with about this much of it resident.
+ */
+#define INPUT_WINDOW_SIZE ((size_t)1 << 22)
+
+/*
+ * Size of each read from a stream which cannot be mapped.
+ */
+#define INPUT_READ_SIZE ((size_t)1 << 16)
+
+/*
+ * InputSource is where a TODO list is read from.
+ *
+ * kind     - How it's read.
+ * location - The url or the file path. Unused for stdin.
+ */
+typedef struct {
+    input_kind kind;
+    const char *location;
+} InputSource;
+
+/*
+ * parseInputSource reads an `--input` argument: `-` is stdin, anything
+ * starting with `http://` or `https://` is a url and everything else is a
+ * file path.
+ */
+void parseInputSource(const char *text, InputSource *outSource);
+
+/*
+ * readInputSource hands the whole input to a callback, in order, in chunks
+ * of any size.
+ *
+ * Files, and stdin when it's redirected from one, are mapped read only and
+ * handed over window by window straight from the mapping, so nothing is
+ * copied. Other streams are read into a single reused buffer, and urls
+ * are streamed through httpGetStream.
+ *
+ * source     - Where to read from.
+ * onChunk    - Receives every chunk, which is only valid during the call.
+ * context    - Passed untouched to onChunk.
+ * outHttpErr - Receives the request error of a url source.
+ *
+ * Returns a `input_err_open_failed` if the file cannot be opened or mapped,
+ * a `input_err_read_failed` if reading fails, a `input_err_aborted` if
+ * onChunk doesn't consume a chunk and a `input_err_request_failed` if the
+ * request fails for another reason, described by outHttpErr.
+ */
+input_err readInputSource(const InputSource *source, HttpChunkCallback onChunk, void *context, http_err *outHttpErr);
+
+#endif
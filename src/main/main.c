@@ -1,82 +1,1432 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdarg.h>
 #include <string.h>
 #include <stdbool.h>
+#include <errno.h>
+#include <time.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <signal.h>
+#include <termios.h>
+#include <sys/ioctl.h>
 #include <json-c/json.h>
+#include <arena/arena.h>
 #include <table/table.h>
+#include <table/screen.h>
+#include <table/format.h>
 #include <http/http.h>
+#include <http/cache.h>
+#include <parallel/parallel.h>
+#include <stats/stats.h>
 #include "models.h"
+#include "store.h"
+#include "snapshot.h"
+#include "query.h"
+#include "trigram.h"
+#include "diff.h"
+#include "input.h"
+#include "users.h"
+#include "summary.h"
+#include "serve.h"
+#include "sync.h"
+#include "options.h"
 
-int main() {
+/*
+ * TODOCollector feeds streamed chunks to a parser filling a TodoStore.
+ *
+ * store    - Receives every parsed entry.
+ * parser   - Parser receiving the response chunks.
+ * trigrams - When not NULL, indexes each title as it's parsed.
+ * stream   - When not NULL, receives each entry as a row instead of the
+ *            store, so nothing is kept.
+ * counters - When not NULL, counts each entry instead of the store.
+ * err      - Error which interrupted the transfer, if any.
+ * drawErr  - Error of the stream, which also interrupts the transfer.
+ */
+typedef struct {
+    TodoStore *store;
+    TODOStreamParser *parser;
+    TrigramIndex *trigrams;
+    TableStream *stream;
+    UserCounters *counters;
+    json_err err;
+    table_err drawErr;
+} TODOCollector;
+
+/*
+ * streamTODOEntry writes an entry to the collector stream.
+ */
+static json_err streamTODOEntry(const TODOEntry *entry, TODOCollector *collector) {
+    char scratch[4][TABLE_CELL_SCRATCH_SIZE];
+    const char *cells[4];
+    size_t sizes[4];
+
+    for (size_t i = 0; i < 4; i++) {
+        cells[i] = todoEntryCell(entry, i, scratch[i], &sizes[i]);
+    }
+
+    collector->drawErr = tableStreamRow(collector->stream, cells, sizes);
+    return collector->drawErr == table_err_ok ? json_err_ok : json_err_invalid_type;
+}
+
+json_err collectTODOEntry(const TODOEntry *entry, void *context) {
+    TODOCollector *collector = (TODOCollector *)context;
+    TodoStore *store = collector->store;
+
+    if (collector->stream != NULL) {
+        return streamTODOEntry(entry, collector);
+    }
+
+    if (collector->counters != NULL) {
+        return userCountersAdd(collector->counters, entry->userID, entry->completed);
+    }
+    json_err err = todoStoreAppend(store, entry);
+    size_t row = store->length - 1;
+
+    if (err == json_err_ok && collector->trigrams != NULL) {
+        err = trigramIndexAdd(collector->trigrams, (uint32_t)row, todoStoreTitle(store, row), store->titleLengths[row]);
+    }
+
+    return err;
+}
+
+size_t feedTODOChunk(const char *chunk, size_t size, void *context) {
+    TODOCollector *collector = (TODOCollector *)context;
+    uint64_t span = statsSpanStart();
+    collector->err = feedTODOStreamParser(collector->parser, chunk, size);
+    statsSpanEnd(stats_stage_parse, span);
+
+    /*
+     * Streamed rows are handed on with each chunk, not once a whole
+     * output chunk is full.
+     */
+    if (collector->err == json_err_ok && collector->stream != NULL) {
+        collector->drawErr = flushTableStream(collector->stream);
+        collector->err = collector->drawErr == table_err_ok ? json_err_ok : json_err_invalid_type;
+    }
+    return collector->err == json_err_ok ? size : 0;
+}
+
+/*
+ * TODOS_URL is where the TODO list is fetched from.
+ */
+const char *TODOS_URL = "https://jsonplaceholder.typicode.com/todos";
+
+/*
+ * fetchTODOPages requests `pages` pages of the TODO list at url
+ * concurrently, over at most HTTP_MAX_CONNECTIONS connections, and parses
+ * each of them into the store, in page order.
+ *
+ * outErr - Receives the parse error, if any.
+ */
+http_err fetchTODOPages(TodoStore *store, const char *url, size_t pages, size_t pageSize, json_err *outErr) {
+    HttpClient *client = NULL;
+    HttpResponse *responses = calloc(pages, sizeof(HttpResponse));
+    char **urls = calloc(pages, sizeof(char *));
+    statsCountAlloc(stats_component_main, pages * (sizeof(HttpResponse) + sizeof(char *)));
+    size_t connections = pages < HTTP_MAX_CONNECTIONS ? pages : HTTP_MAX_CONNECTIONS;
+    http_err err = responses != NULL && urls != NULL ? newHttpClient(connections, &client) : http_err_write_error;
+
+    *outErr = json_err_ok;
+    for (size_t i = 0; err == http_err_ok && i < pages; i++) {
+        urls[i] = arenaAlloc(store->arena, strlen(url) + 64);
+        statsCountAlloc(stats_component_main, strlen(url) + 64);
+        if (urls[i] == NULL) {
+            err = http_err_write_error;
+            break;
+        }
+        sprintf(urls[i], "%s?_page=%zu&_limit=%zu", url, i + 1, pageSize);
+    }
+
+    if (err == http_err_ok) {
+        err = httpClientGetMany(client, (const char **)urls, pages, responses);
+    }
+
+    uint64_t span = statsSpanStart();
+
+    for (size_t i = 0; err == http_err_ok && *outErr == json_err_ok && i < pages; i++) {
+        *outErr = parseTODOList(store, responses[i].body, responses[i].size);
+    }
+
+    statsSpanEnd(stats_stage_parse, span);
+
+    if (responses != NULL) {
+        freeHttpResponses(responses, pages);
+    }
+    freeHttpClient(client);
+    free(responses);
+    free(urls);
+    return err;
+}
+
+/*
+ * cachedTrigramIndex maps the trigram index kept in directory for the store,
+ * or builds it and writes it there when it's missing or stale.
+ *
+ * sourceKey - Validator of the cached body the store comes from.
+ */
+json_err cachedTrigramIndex(const TodoStore *store, const char *directory, uint64_t sourceKey,
+                            TrigramIndex **outTrigrams) {
+    char *path = arenaAlloc(store->arena, strlen(directory) + sizeof("/todos.trigrams"));
+    statsCountAlloc(stats_component_main, strlen(directory) + sizeof("/todos.trigrams"));
+
+    if (path != NULL) {
+        sprintf(path, "%s/todos.trigrams", directory);
+    }
+
+    if (path != NULL && sourceKey != 0 &&
+        openTrigramIndex(path, sourceKey, store->length, outTrigrams) == snapshot_err_ok) {
+        return json_err_ok;
+    }
+
+    json_err err = newTrigramIndex(outTrigrams);
+
+    if (err == json_err_ok) {
+        err = trigramIndexAddStore(*outTrigrams, store);
+    }
+
+    if (err == json_err_ok && path != NULL && sourceKey != 0) {
+        writeTrigramIndex(*outTrigrams, path, sourceKey);
+    }
+
+    return err;
+}
+
+/*
+ * cacheClient makes every request through a HttpCache. It's kept for the
+ * whole run, so watch ticks and refreshes of a served list reuse its
+ * connection. Lists are only ever loaded one at a time.
+ */
+static HttpClient *cacheClient = NULL;
+
+static void freeCacheClient(void) {
+    freeHttpClient(cacheClient);
+    cacheClient = NULL;
+}
+
+/*
+ * fetchCachedTODOs requests the TODO list at url through a HttpCache kept
+ * in directory. When the response is the same one a snapshot kept next to the
+ * cache was written from, the snapshot is mapped instead of parsing the
+ * body. Otherwise the body is parsed into the store and the snapshot is
+ * written again. The trigram index of the titles is kept the same way.
+ *
+ * outSnapshot - Receives the snapshot when one was mapped.
+ * outTrigrams - When not NULL, receives the trigram index of the titles.
+ * outErr      - Receives the parse error, if any.
+ */
+http_err fetchCachedTODOs(TodoStore *store, const char *url, const char *directory, TodoSnapshot **outSnapshot,
+                          TrigramIndex **outTrigrams, json_err *outErr) {
+    HttpCache *cache = NULL;
+    HttpCachedBody body;
+    http_err err = http_err_ok;
+
+    if (cacheClient == NULL) {
+        err = newHttpClient(1, &cacheClient);
+
+        if (err == http_err_ok) {
+            atexit(freeCacheClient);
+        }
+    }
+
+    *outErr = json_err_ok;
+    if (err == http_err_ok) {
+        err = newHttpCache(directory, &cache);
+    }
+
+    if (err == http_err_ok) {
+        err = httpCacheGet(cache, cacheClient, url, &body);
+    }
+
+    if (err == http_err_ok) {
+        char *snapshotPath = arenaAlloc(store->arena, strlen(directory) + sizeof("/todos.snapshot"));
+        uint64_t span = statsSpanStart();
+        statsCountAlloc(stats_component_main, strlen(directory) + sizeof("/todos.snapshot"));
+
+        if (snapshotPath != NULL) {
+            sprintf(snapshotPath, "%s/todos.snapshot", directory);
+        }
+
+        if (snapshotPath == NULL || body.validator == 0 ||
+            openTodoSnapshot(store->arena, snapshotPath, body.validator, outSnapshot) != snapshot_err_ok) {
+            *outErr = body.mapped ? parseTODOListReadOnly(store, body.data, body.size)
+                                  : parseTODOList(store, body.data, body.size);
+
+            if (*outErr == json_err_ok && snapshotPath != NULL && body.validator != 0) {
+                writeTodoSnapshot(store, snapshotPath, body.validator);
+            }
+        }
+
+        if (*outErr == json_err_ok && outTrigrams != NULL) {
+            *outErr = cachedTrigramIndex(*outSnapshot != NULL ? &(*outSnapshot)->store : store, directory,
+                                         body.validator, outTrigrams);
+        }
+
+        statsSpanEnd(stats_stage_parse, span);
+
+        releaseHttpCachedBody(&body);
+    }
+
+    freeHttpCache(cache);
+    return err;
+}
+
+/*
+ * TODOList is a fetched TODO list along with what's built over it.
+ *
+ * arena    - Where the store and everything built over it is allocated.
+ * store    - Fetched entries. Points inside the snapshot when one was mapped.
+ * snapshot - Snapshot mapped instead of parsing the response, if any.
+ * trigrams - Trigram index of the titles, when searching.
+ * users    - Users joined to the entries, when asked for.
+ * rowUsers - User of each store row, from joinTodoUsers.
+ * counters - Entries of each user, when they were counted as they were
+ *            parsed instead of kept in the store.
+ */
+typedef struct {
+    Arena *arena;
+    TodoStore *store;
+    TodoSnapshot *snapshot;
+    TrigramIndex *trigrams;
+    UserMap *users;
+    uint32_t *rowUsers;
+    UserCounters counters;
+} TODOList;
+
+/*
+ * releaseTODOList frees a list and everything built over it.
+ */
+static void releaseTODOList(TODOList *list) {
+    freeTrigramIndex(list->trigrams);
+    closeTodoSnapshot(list->snapshot);
+    freeUserCounters(&list->counters);
+    freeArena(list->arena);
+    *list = (TODOList){ arena: NULL, store: NULL, snapshot: NULL, trigrams: NULL, users: NULL, rowUsers: NULL };
+}
+
+/*
+ * UsersBody buffers the users list, which is only parsed once complete.
+ */
+typedef struct {
     char *data;
-    http_err requestErr = httpGet("https://jsonplaceholder.typicode.com/todos", &data);
+    size_t size;
+    size_t capacity;
+} UsersBody;
 
-    if (requestErr != http_err_ok) {
-        printf("Error: (HTTP Request) get request error: %d", requestErr);
+size_t collectUsersChunk(const char *chunk, size_t size, void *context) {
+    UsersBody *body = (UsersBody *)context;
+
+    if (body->size + size > body->capacity) {
+        size_t capacity = body->capacity > 0 ? body->capacity : 1 << 14;
+
+        while (capacity < body->size + size) {
+            capacity *= 2;
+        }
+
+        char *data = realloc(body->data, capacity);
+        statsCountAlloc(stats_component_main, capacity);
+
+        if (data == NULL) {
+            return 0;
+        }
+
+        body->data = data;
+        body->capacity = capacity;
+    }
+
+    memcpy(body->data + body->size, chunk, size);
+    body->size += size;
+    return size;
+}
+
+/*
+ * usersSourceFor picks where the users are read from: the `--users` source
+ * when there's one, or the `users` url next to a todos url ending in
+ * `/todos`.
+ *
+ * Returns false when there's no such source.
+ */
+static bool usersSourceFor(const Options *options, const InputSource *todos, Arena *arena, InputSource *outSource) {
+    size_t length = todos->location != NULL ? strlen(todos->location) : 0;
+
+    if (options->users.kind != input_kind_url || options->users.location != NULL) {
+        *outSource = options->users;
+        return true;
+    }
+
+    if (todos->kind != input_kind_url || length < 6 || strcmp(todos->location + length - 6, "/todos") != 0) {
+        return false;
+    }
+
+    char *location = arenaStrdup(arena, todos->location);
+    statsCountAlloc(stats_component_main, length + 1);
+
+    if (location == NULL) {
+        return false;
+    }
+
+    memcpy(location + length - 5, "users", 5);
+    *outSource = (InputSource){ kind: input_kind_url, location: location };
+    return true;
+}
+
+/*
+ * joinTODOUsers parses the users body and resolves the user of every entry.
+ */
+static json_err joinTODOUsers(TODOList *list, const UsersBody *body) {
+    uint64_t span = statsSpanStart();
+    json_err err = parseUserMap(list->arena, body->data != NULL ? body->data : "", body->size, &list->users);
+
+    if (err == json_err_ok) {
+        err = joinTodoUsers(list->arena, list->store, list->users, &list->rowUsers);
+    }
+
+    statsSpanEnd(stats_stage_parse, span);
+    return err;
+}
+
+/*
+ * loadTODOList fetches the TODO list the way the options ask for, printing
+ * what went wrong when it fails.
+ *
+ * stream - When not NULL, streamed entries are written to it as they're
+ *          parsed, and the list is left empty.
+ *
+ * A streamed summary without query counts the entries as they're parsed,
+ * so the list is left empty as well.
+ *
+ * Returns 0 on success, or 1 after releasing everything.
+ */
+static int loadTODOList(const Options *options, TableStream *stream, TODOList *outList) {
+    Arena *arena = newArena(ARENA_BLOCK_SIZE);
+    statsCountAlloc(stats_component_main, ARENA_BLOCK_SIZE);
+
+    if (arena == NULL) {
+        printf("Error: (Arena) Could not allocate memory.\n");
         return 1;
     }
 
-    TODOEntry **outEntries = NULL;
-    size_t outListLength;
-    json_err err = parseTODOList(data, strlen(data), &outListLength, &outEntries);
+    UserCounters counters = { base: 0, range: 0, totals: NULL, completed: NULL };
+    TODOCollector collector = { store: NULL, parser: NULL, trigrams: NULL, stream: stream, counters: NULL,
+                                err: json_err_ok, drawErr: table_err_ok };
+    json_err err = newTodoStore(arena, false, &collector.store);
+    bool streamed = options->pages == 0 && options->cacheDir == NULL && options->syncDir == NULL;
+
+    if (streamed && options->summary && queryIsEmpty(&options->query)) {
+        collector.counters = &counters;
+    }
+
+    if (err == json_err_ok && streamed) {
+        err = newTODOStreamParser(collectTODOEntry, &collector, &collector.parser);
+    }
+
+    if (err == json_err_ok && streamed && options->query.search != NULL) {
+        err = newTrigramIndex(&collector.trigrams);
+    }
+
 
     if (err != json_err_ok) {
         printf("Error: (Json Error ID) %d.\n", err);
+        freeTODOStreamParser(collector.parser);
+        freeArena(arena);
         return 1;
     }
 
-    TABLE_DATA_ITEM headers[4] = { "User ID", "ID", "Title", "Completed?" };
-    TABLE_DATA_ROW rows[outListLength];
+    TodoSnapshot *snapshot = NULL;
+    InputSource source = options->input;
+    InputSource usersSource;
+    UsersBody users = { data: NULL, size: 0, capacity: 0 };
+    uint64_t span = statsSpanStart();
+    http_err requestErr = http_err_ok;
+    input_err inputErr = input_err_ok;
 
-    for (size_t i = 0; i < outListLength; i++) {
-        TODOEntry *e = outEntries[i];
-        TABLE_DATA_ITEM userID = calloc(11, sizeof(char));
+    if (source.kind == input_kind_url && source.location == NULL) {
+        source.location = TODOS_URL;
+    }
 
-        if (userID == NULL) {
-            printf("Error: (UserID) Could not allocate memory.\n");
-            freeRows(rows, i);
-            freeTODOList(outEntries, outListLength);
-            return 1;
+    if (options->joinUsers && !usersSourceFor(options, &source, arena, &usersSource)) {
+        printf("Error: (Input) No users source for %s. Set one with --users.\n",
+               source.location != NULL ? source.location : "stdin");
+        freeTODOStreamParser(collector.parser);
+        freeTrigramIndex(collector.trigrams);
+        freeArena(arena);
+        return 1;
+    }
+
+    bool concurrent = options->joinUsers && streamed && source.kind == input_kind_url &&
+                      usersSource.kind == input_kind_url;
+
+    /*
+     * Users which can't be streamed along with the entries are read first,
+     * as they're small.
+     */
+    if (options->joinUsers && !concurrent) {
+        inputErr = readInputSource(&usersSource, collectUsersChunk, &users, &requestErr);
+    }
+
+    if (inputErr != input_err_ok) {
+        source = usersSource;
+        freeTODOStreamParser(collector.parser);
+    } else if (concurrent) {
+        HttpStreamRequest requests[2] = {
+            { url: source.location, onChunk: feedTODOChunk, context: &collector, status: 0, err: http_err_ok },
+            { url: usersSource.location, onChunk: collectUsersChunk, context: &users, status: 0, err: http_err_ok }
+        };
+
+        requestErr = httpGetStreams(requests, 2);
+        inputErr = requestErr == http_err_ok            ? input_err_ok
+                   : requestErr == http_err_write_error ? input_err_aborted
+                                                        : input_err_request_failed;
+
+        if (requestErr == http_err_ok || collector.err != json_err_ok) {
+            uint64_t parseSpan = statsSpanStart();
+            err = finishTODOStreamParser(collector.parser);
+            statsSpanEnd(stats_stage_parse, parseSpan);
+        }
+
+        freeTODOStreamParser(collector.parser);
+    } else if (options->pages > 0) {
+        requestErr = fetchTODOPages(collector.store, source.location, options->pages, options->pageSize, &err);
+    } else if (options->cacheDir != NULL) {
+        requestErr = fetchCachedTODOs(collector.store, source.location, options->cacheDir, &snapshot,
+                                      options->query.search != NULL ? &collector.trigrams : NULL, &err);
+    } else if (options->syncDir != NULL) {
+        requestErr = syncTodoStore(collector.store, source.location, options->syncDir,
+                                   options->query.search != NULL ? &collector.trigrams : NULL, &err);
+    } else {
+        inputErr = readInputSource(&source, feedTODOChunk, &collector, &requestErr);
+
+        if (inputErr == input_err_ok || collector.err != json_err_ok) {
+            uint64_t parseSpan = statsSpanStart();
+            err = finishTODOStreamParser(collector.parser);
+            statsSpanEnd(stats_stage_parse, parseSpan);
         }
 
-        TABLE_DATA_ITEM ID = calloc(11, sizeof(char));
+        freeTODOStreamParser(collector.parser);
+    }
+
+    statsSpanEnd(stats_stage_fetch, span);
+
+    TODOList list = { arena: arena, store: snapshot != NULL ? &snapshot->store : collector.store,
+                      snapshot: snapshot, trigrams: collector.trigrams, users: NULL, rowUsers: NULL,
+                      counters: counters };
+
+    if (err == json_err_ok && requestErr == http_err_ok && inputErr == input_err_ok && options->joinUsers) {
+        err = joinTODOUsers(&list, &users);
+    }
+
+    free(users.data);
+
+    if (err == json_err_ok && requestErr == http_err_ok && inputErr == input_err_ok &&
+        options->query.search != NULL && list.trigrams == NULL) {
+        err = newTrigramIndex(&list.trigrams);
+
+        if (err == json_err_ok) {
+            err = trigramIndexAddStore(list.trigrams, list.store);
+        }
+    }
+
+    if (collector.drawErr != table_err_ok) {
+        printf("Error: (drawTable) Could not draw. err %d.\n", collector.drawErr);
+        releaseTODOList(&list);
+        return 1;
+    }
+
+    if (err != json_err_ok) {
+        printf("Error: (Json Error ID) %d.\n", err);
+        releaseTODOList(&list);
+        return 1;
+    }
+
+    if (requestErr != http_err_ok) {
+        printf("Error: (HTTP Request) get request error: %d", requestErr);
+        releaseTODOList(&list);
+        return 1;
+    }
+
+    if (inputErr != input_err_ok) {
+        printf("Error: (Input) Could not read %s. err %d.\n", source.location != NULL ? source.location : "stdin",
+               inputErr);
+        releaseTODOList(&list);
+        return 1;
+    }
+
+    *outList = list;
+    return 0;
+}
+
+/*
+ * viewTODOList runs the query of the options over a list. An empty query
+ * views every entry in order.
+ *
+ * arena  - Where the view is allocated, which may not be the list one.
+ * errors - Where the error is written.
+ *
+ * Returns 0 on success, or 1 after writing the error.
+ */
+static int viewTODOList(const Options *options, const TODOList *list, Arena *arena, FILE *errors,
+                        TodoView *outView) {
+    if (queryIsEmpty(&options->query)) {
+        uint32_t *rows = arenaAlloc(arena, list->store->length * sizeof(uint32_t) + 1);
+        statsCountAlloc(stats_component_main, list->store->length * sizeof(uint32_t));
 
-        if (ID == NULL) {
-            free(userID);
-            printf("Error: (ID) Could not allocate memory.\n");
-            freeRows(rows, i);
-            freeTODOList(outEntries, outListLength);
+        if (rows == NULL) {
+            fprintf(errors, "Error: (Query) Could not run the query. err %d.\n", query_err_alloc_failed);
             return 1;
         }
 
-        snprintf(userID, 10, "%d", e->userID);
-        snprintf(ID, 10, "%d", e->ID);
-        TABLE_DATA_ROW row = calloc(4, sizeof(TABLE_DATA_ITEM));
+        for (size_t i = 0; i < list->store->length; i++) {
+            rows[i] = (uint32_t)i;
+        }
+
+        *outView = (TodoView){ store: list->store, rows: rows, length: list->store->length };
+        return 0;
+    }
+
+    TodoIndex *index = NULL;
+    query_err queryErr = newTodoIndex(arena, list->store, &index);
+
+    if (queryErr == query_err_ok) {
+        index->trigrams = list->trigrams;
+        queryErr = runQuery(index, &options->query, outView);
+    }
+
+    if (queryErr != query_err_ok) {
+        fprintf(errors, "Error: (Query) Could not run the query. err %d.\n", queryErr);
+        return 1;
+    }
+
+    return 0;
+}
+
+/*
+ * TODO_HEADERS are the columns of the rendered table.
+ */
+static TABLE_DATA_ITEM TODO_HEADERS[4] = { "User ID", "ID", "Title", "Completed?" };
+
+/*
+ * TODO_KEYS and TODO_TYPES are the json keys and types of the columns, for
+ * the formats keeping them.
+ */
+static TABLE_DATA_ITEM TODO_KEYS[4] = { "userId", "id", "title", "completed" };
+static const table_column_type TODO_TYPES[4] = { table_column_number, table_column_number, table_column_text,
+                                                  table_column_boolean };
+
+/*
+ * JOINED_HEADERS, JOINED_KEYS and JOINED_TYPES replace them when users are
+ * joined.
+ */
+static TABLE_DATA_ITEM JOINED_HEADERS[4] = { "User", "ID", "Title", "Completed?" };
+static TABLE_DATA_ITEM JOINED_KEYS[4] = { "user", "id", "title", "completed" };
+static const table_column_type JOINED_TYPES[4] = { table_column_text, table_column_number, table_column_text,
+                                                   table_column_boolean };
+
+/*
+ * viewTable sets a Table reading from a view of a list, showing user names
+ * when the list has users joined.
+ *
+ * joined - Source of the table when users are joined.
+ */
+static void viewTable(const TODOList *list, TodoView *view, JoinedTodoView *joined, Table *outTable) {
+    *outTable = (Table){ headers: TODO_HEADERS, headersCount: 4, rows: NULL, rowsCount: view->length,
+                         getCell: todoViewCell, source: view, types: TODO_TYPES, keys: TODO_KEYS };
+
+    if (list->users != NULL) {
+        *joined = (JoinedTodoView){ view: *view, users: list->users, rowUsers: list->rowUsers };
+        outTable->headers = JOINED_HEADERS;
+        outTable->types = JOINED_TYPES;
+        outTable->keys = JOINED_KEYS;
+        outTable->getCell = joinedTodoCell;
+        outTable->source = joined;
+    }
+}
+
+/*
+ * SUMMARY_HEADERS, SUMMARY_KEYS and SUMMARY_TYPES are the columns of a
+ * summary, with the JOINED_SUMMARY ones replacing them when users are
+ * joined.
+ */
+static TABLE_DATA_ITEM SUMMARY_HEADERS[4] = { "User ID", "Total", "Completed", "Completed %" };
+static TABLE_DATA_ITEM SUMMARY_KEYS[4] = { "userId", "total", "completed", "completedPercent" };
+static const table_column_type SUMMARY_TYPES[4] = { table_column_number, table_column_number, table_column_number,
+                                                     table_column_text };
+static TABLE_DATA_ITEM JOINED_SUMMARY_HEADERS[4] = { "User", "Total", "Completed", "Completed %" };
+static TABLE_DATA_ITEM JOINED_SUMMARY_KEYS[4] = { "user", "total", "completed", "completedPercent" };
+static const table_column_type JOINED_SUMMARY_TYPES[4] = { table_column_text, table_column_number,
+                                                            table_column_number, table_column_text };
+
+/*
+ * PAGE_ROWS are the rows of a page which isn't scrolled on a terminal, and
+ * PAGE_COLUMN_WIDTH the widest a column of a page gets.
+ */
+const size_t PAGE_ROWS = 20;
+const size_t PAGE_COLUMN_WIDTH = 60;
+
+/*
+ * Lines of a scrolled page besides its rows: the borders, the headers and
+ * the status line under them.
+ */
+const size_t PAGE_EXTRA_LINES = 5;
+
+/*
+ * pageStart returns the first row of a page, clamped to the last page.
+ */
+static size_t pageStart(size_t rowsCount, size_t page, size_t rows) {
+    size_t pages = rowsCount > 0 ? (rowsCount + rows - 1) / rows : 1;
+    return ((page < pages ? page : pages) - 1) * rows;
+}
+
+/*
+ * formatPageStatus describes which rows of a table a page holds. A page
+ * scrolled off the page boundaries is numbered after its last row.
+ */
+static void formatPageStatus(const TablePage *page, size_t rows, char *out, size_t size) {
+    size_t rowsCount = page->source->rowsCount;
+    size_t pages = rowsCount > 0 ? (rowsCount + rows - 1) / rows : 1;
+
+    if (page->table.rowsCount == 0) {
+        snprintf(out, size, "Page 1 of 1, no rows");
+        return;
+    }
+
+    snprintf(out, size, "Page %zu of %zu, rows %zu to %zu of %zu",
+             (page->first + page->table.rowsCount - 1) / rows + 1, pages, page->first + 1,
+             page->first + page->table.rowsCount, rowsCount);
+}
+
+/*
+ * terminalSize reads the lines and columns of the terminal on stdout.
+ *
+ * Returns false when stdout isn't a terminal.
+ */
+static bool terminalSize(size_t *outLines, size_t *outColumns) {
+    struct winsize size;
+
+    if (ioctl(STDOUT_FILENO, TIOCGWINSZ, &size) != 0 || size.ws_row == 0 || size.ws_col == 0) {
+        return false;
+    }
+
+    *outLines = size.ws_row;
+    *outColumns = size.ws_col;
+    return true;
+}
+
+/*
+ * readPagerKey waits for a key on the terminal, turning the arrows, page
+ * up and down, home and end into the letters doing the same.
+ *
+ * Returns the key, or EOF once stdin is closed.
+ */
+static int readPagerKey(void) {
+    unsigned char key;
+    unsigned char sequence[3] = { 0 };
+
+    if (read(STDIN_FILENO, &key, 1) != 1) {
+        return EOF;
+    }
+
+    if (key != '\x1b' || read(STDIN_FILENO, sequence, 2) != 2 || sequence[0] != '[') {
+        return key;
+    }
+
+    switch (sequence[1]) {
+        case 'A': return 'k';
+        case 'B': return 'j';
+        case 'H': return 'g';
+        case 'F': return 'G';
+        case '5': return read(STDIN_FILENO, sequence + 2, 1) == 1 ? 'b' : EOF;
+        case '6': return read(STDIN_FILENO, sequence + 2, 1) == 1 ? ' ' : EOF;
+        default: return key;
+    }
+}
+
+/*
+ * Terminal settings browseTable found, put back by restoreTerminal while
+ * terminalRaw is set.
+ */
+static struct termios savedTerminal;
+static volatile sig_atomic_t terminalRaw = 0;
+
+/*
+ * restoreTerminal puts back the terminal settings a browsed table changed.
+ * It's also run at exit, and only uses calls safe in a signal handler.
+ */
+static void restoreTerminal(void) {
+    if (terminalRaw) {
+        tcsetattr(STDIN_FILENO, TCSANOW, &savedTerminal);
+        terminalRaw = 0;
+    }
+}
+
+/*
+ * restoreTerminalOnSignal restores the terminal before a signal ends the
+ * program the way it would have otherwise.
+ */
+static void restoreTerminalOnSignal(int signalNumber) {
+    restoreTerminal();
+    signal(signalNumber, SIG_DFL);
+    raise(signalNumber);
+}
+
+/*
+ * BROWSE_SIGNALS end the program while a table is browsed, so the terminal
+ * is restored on them.
+ */
+static const int BROWSE_SIGNALS[3] = { SIGINT, SIGTERM, SIGHUP };
+
+/*
+ * browseTable shows a page of a table on the terminal, and scrolls it until
+ * q is pressed. Each move only paints the window of rows on screen, through
+ * a TableScreen writing just the rows that changed, so it costs as much as
+ * a page whatever the size of the table. Pages fit the terminal unless the
+ * options set their rows, and are measured again after every key so
+ * resizing the terminal is followed. The terminal is restored when done,
+ * at exit, or when interrupted, terminated or hung up meanwhile.
+ */
+static table_err browseTable(const Options *options, Table *table) {
+    static bool restoredAtExit = false;
+    TableScreen *screen = NULL;
+    struct sigaction previous[3];
+    table_err err = newTableScreen(&screen);
+
+    if (err != table_err_ok) {
+        return err;
+    }
+
+    if (tcgetattr(STDIN_FILENO, &savedTerminal) == 0) {
+        struct termios raw = savedTerminal;
+        struct sigaction restoring = { 0 };
+        raw.c_lflag &= ~(tcflag_t)(ICANON | ECHO);
+        raw.c_cc[VMIN] = 1;
+        raw.c_cc[VTIME] = 0;
+        restoring.sa_handler = restoreTerminalOnSignal;
+        sigemptyset(&restoring.sa_mask);
+
+        if (!restoredAtExit) {
+            restoredAtExit = atexit(restoreTerminal) == 0;
+        }
+
+        for (size_t i = 0; i < 3; i++) {
+            sigaction(BROWSE_SIGNALS[i], &restoring, &previous[i]);
+        }
+
+        terminalRaw = 1;
+        tcsetattr(STDIN_FILENO, TCSANOW, &raw);
+    }
+
+    bool browsing = terminalRaw;
+
+    size_t first = SIZE_MAX;
+    int key = 0;
+
+    while (err == table_err_ok && key != 'q' && key != EOF) {
+        size_t lines = 0, columns = 0;
+        bool sized = terminalSize(&lines, &columns);
+        size_t rows = options->pageRows > 0                  ? options->pageRows
+                      : sized && lines > PAGE_EXTRA_LINES ? lines - PAGE_EXTRA_LINES
+                                                            : PAGE_ROWS;
+        size_t last = table->rowsCount > rows ? table->rowsCount - rows : 0;
+
+        if (first == SIZE_MAX) {
+            first = pageStart(table->rowsCount, options->page, rows);
+        }
+
+        switch (key) {
+            case 'j': first++; break;
+            case 'k': first -= first > 0; break;
+            case ' ': case 'f': first += rows; break;
+            case 'b': first = first > rows ? first - rows : 0; break;
+            case 'g': first = 0; break;
+            case 'G': first = last; break;
+        }
+        first = first < last ? first : last;
+
+        TablePage page;
+        char status[128];
+        tablePage(table, first, rows, &page);
+        page.table.maxWidth = sized && columns / 2 < PAGE_COLUMN_WIDTH ? (columns / 2 > 8 ? columns / 2 : 8)
+                                                                      : PAGE_COLUMN_WIDTH;
+
+        err = paintTableScreen(screen, &page.table, tableFileSink, stdout);
+        formatPageStatus(&page, rows, status, sizeof(status));
+        printf("%s. j/k: row, space/b: page, g/G: first/last, q: quit\x1b[K", status);
+        fflush(stdout);
+
+        key = err == table_err_ok ? readPagerKey() : EOF;
+    }
+
+    restoreTerminal();
+
+    for (size_t i = 0; browsing && i < 3; i++) {
+        sigaction(BROWSE_SIGNALS[i], &previous[i], NULL);
+    }
+
+    printf("\n");
+    freeTableScreen(screen);
+    return err;
+}
+
+/*
+ * renderTODOTable renders a table the way the options ask for: whole, or
+ * only the page they ask for. Pages are cut to PAGE_COLUMN_WIDTH wide
+ * columns, and boxes get a status line under them.
+ *
+ * interactive - Whether the page is scrolled on the terminal instead.
+ */
+static table_err renderTODOTable(const Options *options, Table *table, bool interactive, TableSink sink,
+                                 void *sinkContext) {
+    if (options->page == 0) {
+        return renderTableWith(options->format, table, options->threads, sink, sinkContext);
+    }
+
+    if (interactive) {
+        return browseTable(options, table);
+    }
+
+    size_t rows = options->pageRows > 0 ? options->pageRows : PAGE_ROWS;
+    TablePage page;
+    tablePage(table, pageStart(table->rowsCount, options->page, rows), rows, &page);
+    page.table.maxWidth = PAGE_COLUMN_WIDTH;
+
+    table_err err = renderTableWith(options->format, &page.table, 1, sink, sinkContext);
+
+    if (err == table_err_ok && !tableRendererStreams(options->format)) {
+        char status[128];
+        formatPageStatus(&page, rows, status, sizeof(status) - 1);
+        strcat(status, "\n");
+        err = sink(status, strlen(status), sinkContext) == strlen(status) ? table_err_ok : table_err_write_failed;
+    }
 
-        if (row == NULL) {
-            free(ID);
-            free(userID);
-            freeRows(rows, i);
-            freeTODOList(outEntries, outListLength);
+    return err;
+}
+
+/*
+ * summarizeTODOList renders the entries of each user of a list, the ones
+ * the query views, counting them first when they weren't counted as they
+ * were parsed. Only the summary goes through the renderer, and counting is
+ * timed along with rendering.
+ *
+ * arena       - Where the summary is allocated.
+ * interactive - Whether a page is scrolled on the terminal.
+ * errors      - Where the error is written.
+ *
+ * Returns 0 on success, or 1 after writing the error.
+ */
+static int summarizeTODOList(const Options *options, const TODOList *list, Arena *arena, bool interactive,
+                             FILE *errors, TableSink sink, void *sinkContext) {
+    UserCounters counters = list->counters;
+    TodoSummary summary;
+    json_err err = json_err_ok;
+    uint64_t span = statsSpanStart();
+
+    if (counters.range == 0 && queryIsEmpty(&options->query)) {
+        err = countTodoUsers(list->store, NULL, list->store->length, options->threads, &counters);
+    } else if (counters.range == 0) {
+        TodoView view;
+
+        if (viewTODOList(options, list, arena, errors, &view) != 0) {
             return 1;
         }
 
-        row[0] = userID;
-        row[1] = ID;
-        row[2] = (char *)e->title;
-        row[3] = e->completed ? "Yes" : "No";
-        rows[i] = row;
+        err = countTodoUsers(list->store, view.rows, view.length, options->threads, &counters);
+    }
+
+    if (err == json_err_ok) {
+        err = newTodoSummary(arena, &counters, list->users, &summary);
     }
 
-    Table table = { headers: headers, headersCount: 4, rows: rows, rowsCount: outListLength };
-    table_err drawErr = drawTable(&table);
+    if (err != json_err_ok) {
+        fprintf(errors, "Error: (Summary) Could not count the entries of each user. err %d.\n", err);
+    }
+
+    table_err drawErr = table_err_ok;
+
+    if (err == json_err_ok) {
+        Table table = { headers: list->users != NULL ? JOINED_SUMMARY_HEADERS : SUMMARY_HEADERS, headersCount: 4,
+                        rows: NULL, rowsCount: summary.length, getCell: todoSummaryCell, source: &summary,
+                        types: list->users != NULL ? JOINED_SUMMARY_TYPES : SUMMARY_TYPES,
+                        keys: list->users != NULL ? JOINED_SUMMARY_KEYS : SUMMARY_KEYS };
+        drawErr = renderTODOTable(options, &table, interactive, sink, sinkContext);
+        statsSpanEnd(stats_stage_render, span);
+    }
+
+    if (counters.totals != list->counters.totals) {
+        freeUserCounters(&counters);
+    }
+
+    if (drawErr != table_err_ok) {
+        fprintf(errors, "Error: (drawTable) Could not draw. err %d.\n", drawErr);
+    }
+    return err != json_err_ok || drawErr != table_err_ok;
+}
+
+/*
+ * drawTODOList renders a loaded list the way the options ask for, leaving
+ * the list untouched so it can be rendered again.
+ *
+ * arena       - Where the view of the list is allocated.
+ * interactive - Whether a page is scrolled on the terminal.
+ * errors      - Where the error is written.
+ *
+ * Returns 0 on success, or 1 after writing the error.
+ */
+static int drawTODOList(const Options *options, const TODOList *list, Arena *arena, bool interactive,
+                        FILE *errors, TableSink sink, void *sinkContext) {
+    if (options->summary) {
+        return summarizeTODOList(options, list, arena, interactive, errors, sink, sinkContext);
+    }
+
+    Table table = { headers: TODO_HEADERS, headersCount: 4, rows: NULL, rowsCount: list->store->length,
+                    getCell: todoStoreCell, source: list->store, types: TODO_TYPES, keys: TODO_KEYS };
+    TodoView view;
+    JoinedTodoView joined;
+
+    if (!queryIsEmpty(&options->query) || list->users != NULL) {
+        if (viewTODOList(options, list, arena, errors, &view) != 0) {
+            return 1;
+        }
+
+        viewTable(list, &view, &joined, &table);
+    }
+    uint64_t span = statsSpanStart();
+    table_err drawErr = renderTODOTable(options, &table, interactive, sink, sinkContext);
+    statsSpanEnd(stats_stage_render, span);
 
-    free(data);
-    freeTODOList(outEntries, outListLength);
-    freeRows(rows, outListLength);
     if (drawErr != table_err_ok) {
-        printf("Error: (drawTable) Could not draw. err %d.\n", drawErr);
+        fprintf(errors, "Error: (drawTable) Could not draw. err %d.\n", drawErr);
         return 1;
     }
     return 0;
 }
+
+/*
+ * sleepMilliseconds waits for an interval, going on after signals.
+ */
+static void sleepMilliseconds(size_t milliseconds) {
+    struct timespec interval = { tv_sec: milliseconds / 1000, tv_nsec: (milliseconds % 1000) * 1000000 };
+
+    while (nanosleep(&interval, &interval) != 0 && errno == EINTR) {
+    }
+}
+
+/*
+ * watchTODOs fetches the list again on every interval, until the process
+ * is interrupted. Each fetch is diffed by ID against the previous one, and
+ * only when something changed, or the terminal was resized, is the table
+ * repainted. The diff tells the TableScreen where each row was, so it only
+ * writes the changed rows and moves the lines around inserted or removed
+ * ones. On a terminal, only the rows fitting its height are painted, with a
+ * status line under them. Requests go through the same client, so its
+ * connections stay alive between fetches.
+ *
+ * Fetch errors are printed under the table and retried on the next tick.
+ */
+static int watchTODOs(const Options *options) {
+    TableScreen *screen = NULL;
+    TODOList previous = { arena: NULL, store: NULL, snapshot: NULL, trigrams: NULL };
+    TodoDigest previousDigest = { entries: NULL, length: 0 };
+    bool painted = false;
+    size_t paintedRows = 0;
+
+    if (newTableScreen(&screen) != table_err_ok) {
+        printf("Error: (drawTable) Could not draw. err %d.\n", table_err_allocation_failed);
+        return 1;
+    }
+
+    for (;;) {
+        TODOList list;
+        TodoView view;
+        TodoDigest digest;
+
+        if (loadTODOList(options, NULL, &list) != 0) {
+            fflush(stdout);
+            sleepMilliseconds(options->watchInterval);
+            continue;
+        }
+
+        if (viewTODOList(options, &list, list.arena, stdout, &view) != 0 || newTodoDigest(list.arena, &view, &digest) != query_err_ok) {
+            releaseTODOList(&list);
+            fflush(stdout);
+            sleepMilliseconds(options->watchInterval);
+            continue;
+        }
+
+        size_t *sources = arenaAlloc(list.arena, view.length * sizeof(size_t) + 1);
+        statsCountAlloc(stats_component_main, view.length * sizeof(size_t));
+
+        if (sources == NULL) {
+            printf("Error: (drawTable) Could not draw. err %d.\n", table_err_allocation_failed);
+            releaseTODOList(&list);
+            fflush(stdout);
+            sleepMilliseconds(options->watchInterval);
+            continue;
+        }
+
+        TodoDelta delta = diffTodoDigests(&previousDigest, &digest, sources);
+        size_t lines = 0, columns = 0;
+        size_t rows = terminalSize(&lines, &columns) && lines > PAGE_EXTRA_LINES ? lines - PAGE_EXTRA_LINES
+                                                                                 : view.length;
+
+        if (!painted || rows != paintedRows || !todoDeltaIsEmpty(&delta)) {
+            JoinedTodoView joined;
+            Table table;
+            TablePage page;
+            viewTable(&list, &view, &joined, &table);
+            tablePage(&table, 0, rows, &page);
+            uint64_t span = statsSpanStart();
+            table_err drawErr = paintTableScreenMoved(screen, &page.table, sources, tableFileSink, stdout);
+
+            if (drawErr == table_err_ok && table.rowsCount > rows) {
+                char status[128];
+                formatPageStatus(&page, rows, status, sizeof(status));
+                printf("%s.\x1b[K", status);
+            }
+
+            fflush(stdout);
+            statsSpanEnd(stats_stage_render, span);
+
+            painted = drawErr == table_err_ok;
+            paintedRows = rows;
+            if (!painted) {
+                printf("Error: (drawTable) Could not draw. err %d.\n", drawErr);
+            }
+        }
+
+        releaseTODOList(&previous);
+        previous = list;
+        previousDigest = digest;
+        sleepMilliseconds(options->watchInterval);
+    }
+}
+
+/*
+ * loadServedTODOs is the ServeLoader of a served list. Titles are always
+ * indexed, as any request may search them.
+ */
+static void *loadServedTODOs(void *context) {
+    const Options *options = (const Options *)context;
+    TODOList *list = malloc(sizeof(TODOList));
+    statsCountAlloc(stats_component_main, sizeof(TODOList));
+
+    if (list == NULL || loadTODOList(options, NULL, list) != 0) {
+        fflush(stdout);
+        free(list);
+        return NULL;
+    }
+
+    /*
+     * Searches scan the titles when they can't be indexed.
+     */
+    if (list->trigrams == NULL && (newTrigramIndex(&list->trigrams) != json_err_ok ||
+                                   trigramIndexAddStore(list->trigrams, list->store) != json_err_ok)) {
+        freeTrigramIndex(list->trigrams);
+        list->trigrams = NULL;
+    }
+
+    return list;
+}
+
+static void releaseServedTODOs(void *dataset, void *context) {
+    (void)context;
+    releaseTODOList((TODOList *)dataset);
+    free(dataset);
+}
+
+/*
+ * parseServedRequest reads the arguments of a request to a served list as
+ * the command line of a one shot run.
+ */
+static options_err parseServedRequest(int argc, char **argv, Options *outOptions) {
+    char **arguments = malloc((size_t)(argc + 2) * sizeof(char *));
+    statsCountAlloc(stats_component_main, (size_t)(argc + 2) * sizeof(char *));
+
+    if (arguments == NULL) {
+        return options_err_invalid_value;
+    }
+
+    arguments[0] = "main";
+    memcpy(arguments + 1, argv, (size_t)(argc + 1) * sizeof(char *));
+    options_err err = parseOptions(argc + 1, arguments, outOptions);
+    free(arguments);
+    return err;
+}
+
+/*
+ * servedOnlyOption returns the first option of a request which only the
+ * served list itself may set, as it changes how the list is loaded or what
+ * the process does, or NULL when there's none.
+ */
+static const char *servedOnlyOption(const Options *options) {
+    static char *program[2] = { "main", NULL };
+    Options defaults;
+    parseOptions(1, program, &defaults);
+
+    if (options->input.kind != defaults.input.kind || options->input.location != NULL) {
+        return "--input";
+    }
+    if (options->users.kind != defaults.users.kind || options->users.location != NULL) {
+        return "--users";
+    }
+    if (options->cacheDir != NULL) {
+        return "--cache-dir";
+    }
+    if (options->syncDir != NULL) {
+        return "--sync";
+    }
+    if (options->pages != defaults.pages || options->pageSize != defaults.pageSize) {
+        return "--fetch-pages";
+    }
+    if (options->serve != NULL) {
+        return "--serve";
+    }
+    if (options->watchInterval != defaults.watchInterval) {
+        return "--watch";
+    }
+    if (options->refreshInterval != defaults.refreshInterval) {
+        return "--refresh";
+    }
+    return NULL;
+}
+
+static int comparePredicates(const void *rawLeft, const void *rawRight) {
+    const QueryPredicate *left = rawLeft, *right = rawRight;
+
+    if (left->field != right->field) {
+        return left->field < right->field ? -1 : 1;
+    }
+    if (left->number != right->number) {
+        return left->number < right->number ? -1 : 1;
+    }
+    if (left->completed != right->completed) {
+        return left->completed < right->completed ? -1 : 1;
+    }
+    return strcmp(left->title != NULL ? left->title : "", right->title != NULL ? right->title : "");
+}
+
+/*
+ * appendKey formats at the end of a key of size bytes, counting what
+ * doesn't fit in used as well.
+ */
+static void appendKey(char *key, size_t size, size_t *used, const char *format, ...) {
+    va_list arguments;
+    va_start(arguments, format);
+    int length = *used < size ? vsnprintf(key + *used, size - *used, format, arguments)
+                              : vsnprintf(NULL, 0, format, arguments);
+    va_end(arguments);
+    *used += length > 0 ? (size_t)length : 0;
+}
+
+/*
+ * keyServedTODOs is the ServeKeyer of a served list. The key holds what of
+ * the parsed request changes the response: the format, summary and page,
+ * the predicates in a fixed order, the sort keys, limit and search. So
+ * requests spelling the same query differently share their response.
+ * Requests which can't be parsed or are refused are keyed by their bytes.
+ */
+static size_t keyServedTODOs(int argc, char **argv, char *key, size_t size, void *context) {
+    Options options;
+    size_t used = 0;
+    (void)context;
+
+    if (parseServedRequest(argc, argv, &options) != options_err_ok || servedOnlyOption(&options) != NULL) {
+        return 0;
+    }
+
+    Query *query = &options.query;
+    qsort(query->predicates, query->predicatesCount, sizeof(QueryPredicate), comparePredicates);
+    appendKey(key, size, &used, "%p %d %zu %zu %zu", (const void *)options.format, options.summary, options.page,
+              options.page > 0 ? options.pageRows : 0, query->limit);
+
+    for (size_t i = 0; i < query->sortKeysCount; i++) {
+        appendKey(key, size, &used, " %c%d", query->sortKeys[i].descending ? '-' : '+', query->sortKeys[i].field);
+    }
+
+    for (size_t i = 0; i < query->predicatesCount; i++) {
+        const QueryPredicate *predicate = &query->predicates[i];
+        const char *title = predicate->title != NULL ? predicate->title : "";
+        appendKey(key, size, &used, " %d=%d,%d,%zu:%s", predicate->field, predicate->number, predicate->completed,
+                  strlen(title), title);
+    }
+
+    if (query->search != NULL) {
+        appendKey(key, size, &used, " ?%zu:%s", strlen(query->search), query->search);
+    }
+
+    return used < size ? used : size + 1;
+}
+
+/*
+ * renderServedTODOs is the ServeRenderer of a served list, reading the
+ * arguments of each request as the command line of a one shot run. Every
+ * error is written in the response.
+ */
+static int renderServedTODOs(void *dataset, int argc, char **argv, FILE *output, void *context) {
+    const Options *served = (const Options *)context;
+    Options options;
+    options_err optionsErr = parseServedRequest(argc, argv, &options);
+
+    if (optionsErr != options_err_ok) {
+        fprintf(output, "Error: (Serve) Invalid request options. err %d.\n", optionsErr);
+        return 1;
+    }
+
+    const char *servedOnly = servedOnlyOption(&options);
+
+    if (servedOnly != NULL) {
+        fprintf(output, "Error: (Serve) %s can only be set by the served list.\n", servedOnly);
+        return 1;
+    }
+
+    Arena *arena = newArena(ARENA_BLOCK_SIZE);
+    statsCountAlloc(stats_component_main, ARENA_BLOCK_SIZE);
+
+    if (arena == NULL) {
+        fprintf(output, "Error: (Arena) Could not allocate memory.\n");
+        return 1;
+    }
+
+    options.threads = served->threads;
+    int status = drawTODOList(&options, (TODOList *)dataset, arena, false, output, tableFileSink, output);
+
+    if (status != 0) {
+        fprintf(output, "Error: (Serve) Could not render the request.\n");
+    }
+
+    freeArena(arena);
+    return status;
+}
+
+/*
+ * serveTODOs keeps the list in memory and serves it on the socket of the
+ * options until the process is killed. The query, format and summary of
+ * the options are left to each request.
+ */
+static int serveTODOs(const Options *options) {
+    Options served = *options;
+    memset(&served.query, 0, sizeof(Query));
+    served.summary = false;
+
+    ServeHandlers handlers = { load: loadServedTODOs, release: releaseServedTODOs, render: renderServedTODOs,
+                               key: keyServedTODOs, context: &served, refreshInterval: served.refreshInterval };
+    serve_err err = serveUnixSocket(served.serve, &handlers);
+
+    printf("Error: (Serve) Could not serve on %s. err %d.\n", served.serve, err);
+    return 1;
+}
+
+/*
+ * connectTODOs sends the arguments to a served list, other than the
+ * `--connect` ones, and writes its response.
+ */
+static int connectTODOs(const Options *options, int argc, char **argv) {
+    char **arguments = malloc((size_t)argc * sizeof(char *));
+    statsCountAlloc(stats_component_main, (size_t)argc * sizeof(char *));
+    int count = 0;
+    int status = 1;
+
+    if (arguments == NULL) {
+        printf("Error: (Arena) Could not allocate memory.\n");
+        return 1;
+    }
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--connect") == 0) {
+            i++;
+        } else {
+            arguments[count++] = argv[i];
+        }
+    }
+
+    fflush(stdout);
+    serve_err err = requestUnixSocket(options->connect, count, arguments, STDOUT_FILENO, &status);
+    free(arguments);
+
+    if (err != serve_err_ok) {
+        printf("Error: (Serve) Could not request %s. err %d.\n", options->connect, err);
+        return 1;
+    }
+    return status;
+}
+
+/*
+ * Start of the run, closing the total span when the stats are reported.
+ */
+static uint64_t runStart = 0;
+
+/*
+ * reportStats writes the stats on stderr, registered at exit by `--stats`.
+ */
+static void reportStats(void) {
+    statsSpanEnd(stats_stage_total, runStart);
+    statsReport(stderr);
+}
+
+int main(int argc, char **argv) {
+    Options options;
+    options_err optionsErr = parseOptions(argc, argv, &options);
+
+    if (optionsErr != options_err_ok) {
+        printUsage(argv[0]);
+        return optionsErr == options_err_help ? 0 : 1;
+    }
+
+    if (options.threads == 0) {
+        options.threads = parallelAvailableThreads();
+    }
+
+    httpSetDefaultPolicy(&options.http);
+
+    if (options.stats) {
+        statsEnable();
+        runStart = statsSpanStart();
+        atexit(reportStats);
+    }
+
+    if (options.connect != NULL) {
+        return connectTODOs(&options, argc, argv);
+    }
+
+    if (options.serve != NULL) {
+        return serveTODOs(&options);
+    }
+
+    if (options.watchInterval > 0) {
+        return watchTODOs(&options);
+    }
+
+    TODOList list;
+    TableStream *stream = NULL;
+
+    if (tableRendererStreams(options.format) && options.pages == 0 && options.cacheDir == NULL &&
+        options.syncDir == NULL && queryIsEmpty(&options.query) && !options.joinUsers && !options.summary &&
+        options.page == 0 &&
+        newTableStream(options.format, TODO_HEADERS, 4, TODO_KEYS, TODO_TYPES, tableFileSink, stdout, &stream) != table_err_ok) {
+        printf("Error: (drawTable) Could not draw. err %d.\n", table_err_allocation_failed);
+        return 1;
+    }
+
+    if (loadTODOList(&options, stream, &list) != 0) {
+        closeTableStream(stream);
+        return 1;
+    }
+
+    if (stream != NULL) {
+        table_err streamErr = closeTableStream(stream);
+        fflush(stdout);
+        releaseTODOList(&list);
+
+        if (streamErr != table_err_ok) {
+            printf("Error: (drawTable) Could not draw. err %d.\n", streamErr);
+            return 1;
+        }
+        return 0;
+    }
+
+    bool interactive = options.page > 0 && !tableRendererStreams(options.format) &&
+                       options.input.kind != input_kind_stdin && isatty(STDIN_FILENO) && isatty(STDOUT_FILENO);
+    int status = drawTODOList(&options, &list, list.arena, interactive, stdout, tableFileSink, stdout);
+    fflush(stdout);
+    releaseTODOList(&list);
+    return status;
+}
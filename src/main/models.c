@@ -3,25 +3,11 @@
 #include <string.h>
 #include <stdbool.h>
 #include <json-c/json.h>
+#include <arena/arena.h>
+#include <stats/stats.h>
 #include "models.h"
-
-void freeTODOList(TODOEntry **list, size_t listLength) {
-    for (size_t i = 0; i < listLength; i++) {
-        if (list[i] != NULL) {
-            free((char *)list[i]->title);
-        }
-        free(list[i]);
-    }
-    free(list);
-}
-
-void freeRows(char ***rows, size_t amount) {
-    for (size_t i = 0; i < amount; i++) {
-        free(rows[i][0]);
-        free(rows[i][1]);
-        free(rows[i]);
-    }
-}
+#include "scanner.h"
+#include "store.h"
 
 /*
  * JSON_GETTER is a macro responsible for expanding a function to get values from
@@ -48,37 +34,48 @@ JSON_GETTER(bool, Bool, boolean, false);
 JSON_GETTER(const char *, String, string, NULL);
 
 /*
- * parseTODOObject attempts to parse an individual TODOEntry based on
- * a json_object value and a TODOEntry out.
+ * readTODOObject reads the TODOEntry fields from a json_object without
+ * allocating anything. The title is borrowed from the json object.
  *
- * entry - Json object to be parsed.
- * todo  - `TODOEntry **` where the parsed TODOEntry will be written
+ * entry - Json object to be read.
+ * todo  - Where the fields are written.
  *
- * Returns a `json_err_alloc_failed` if it cannot allocate a TODOEntry.
+ * Returns a `json_err_invalid_type` if entry isn't an object.
  * Otherwise, returns a `json_err_ok`.
  */
-json_err parseTODOObject(json_object *entry, TODOEntry **todo) {
-    char *entryTitle = strdup(getJsonString(entry, "title"));
-
-    if (entryTitle == NULL) {
-        return json_err_alloc_failed;
+static json_err readTODOObject(json_object *entry, TODOEntry *todo) {
+    if (json_object_get_type(entry) != json_type_object) {
+        return json_err_invalid_type;
     }
 
-    TODOEntry *todoEntry = calloc(1, sizeof(TODOEntry));
+    const char *title = getJsonString(entry, "title");
 
-    todoEntry->userID = getJsonInt(entry, "userId");
-    todoEntry->ID = getJsonInt(entry, "id");
-    todoEntry->title = entryTitle;
-    todoEntry->completed = getJsonBool(entry, "completed");
-    *todo = todoEntry;
+    todo->userID = getJsonInt(entry, "userId");
+    todo->ID = getJsonInt(entry, "id");
+    todo->title = title != NULL ? title : "";
+    todo->completed = getJsonBool(entry, "completed");
     return json_err_ok;
 }
 
-json_err parseTODOList(char *json, size_t jsonSize, size_t *outListLength, TODOEntry ***outEntries) {
+/*
+ * tokenizeTODOList attempts to parse a json into a json-c object holding
+ * either a TODO object or a list of them.
+ *
+ * json     - A string containing the json contents.
+ * jsonSize - A number representing the size of json.
+ * outObj   - Receives the parsed object, released with `json_object_put`.
+ *
+ * Returns the same errors as parseTODOList.
+ */
+static json_err tokenizeTODOList(const char *json, size_t jsonSize, json_object **outObj) {
     struct json_tokener *tok = json_tokener_new();
-    enum json_type type;
+
+    if (tok == NULL) {
+        return json_err_alloc_failed;
+    }
+
     json_object *jsonObj = json_tokener_parse_ex(tok, json, jsonSize);
-    type = json_object_get_type(jsonObj);
+    enum json_type type = json_object_get_type(jsonObj);
 
     if (jsonObj == NULL) {
         json_tokener_free(tok);
@@ -92,48 +89,535 @@ json_err parseTODOList(char *json, size_t jsonSize, size_t *outListLength, TODOE
             return json_err_parse_failed;
         }
 
+    json_tokener_free(tok);
+
     if (type != json_type_object && type != json_type_array) {
         json_object_put(jsonObj);
-        json_tokener_free(tok);
         return json_err_invalid_type;
     }
 
-    size_t listLength = type == json_type_object ? 1 : json_object_array_length(jsonObj);
-    TODOEntry **entries = calloc(listLength, sizeof(TODOEntry *));
+    *outObj = jsonObj;
+    return json_err_ok;
+}
 
-    if (entries == NULL) {
-        json_object_put(jsonObj);
-        json_tokener_free(tok);
-        return json_err_alloc_failed;
+json_err parseTODOListDOM(TodoStore *store, const char *json, size_t jsonSize) {
+    json_object *jsonObj = NULL;
+    json_err err = tokenizeTODOList(json, jsonSize, &jsonObj);
+
+    if (err != json_err_ok) {
+        return err;
     }
 
-    if (type == json_type_object) {
-        json_err err = parseTODOObject(jsonObj, &entries[0]);
-        json_object_put(jsonObj);
-        json_tokener_free(tok);
-        if (err != json_err_ok) {
-            freeTODOList(entries, listLength);
-            return err;
+    bool isObject = json_object_get_type(jsonObj) == json_type_object;
+    size_t listLength = isObject ? 1 : json_object_array_length(jsonObj);
+
+    for (size_t i = 0; i < listLength && err == json_err_ok; i++) {
+        json_object *entry = isObject ? jsonObj : json_object_array_get_idx(jsonObj, i);
+        TODOEntry todo;
+        err = readTODOObject(entry, &todo);
+
+        if (err == json_err_ok) {
+            err = todoStoreAppend(store, &todo);
         }
-        *outListLength = listLength;
-        *outEntries = entries;
+    }
+
+    json_object_put(jsonObj);
+    return err;
+}
+
+/*
+ * scanTODOListDOM is the json-c fallback of scanTODOList. Once the json-c
+ * objects exist the raw json isn't needed anymore, so the decoded titles are
+ * copied back over it, one after the other. Each decoded title plus its NUL
+ * is smaller than its raw quoted form, so they always fit.
+ */
+static json_err scanTODOListDOM(Arena *arena, char *json, size_t jsonSize, size_t *outListLength, TODOEntry **outEntries) {
+    json_object *jsonObj = NULL;
+    json_err err = tokenizeTODOList(json, jsonSize, &jsonObj);
+
+    if (err != json_err_ok) {
         return err;
     }
 
+    bool isObject = json_object_get_type(jsonObj) == json_type_object;
+    size_t listLength = isObject ? 1 : json_object_array_length(jsonObj);
+    TODOEntry *entries = arenaCalloc(arena, listLength, sizeof(TODOEntry));
+    statsCountAlloc(stats_component_models, listLength * sizeof(TODOEntry));
+
+    if (entries == NULL) {
+        json_object_put(jsonObj);
+        return json_err_alloc_failed;
+    }
+
+    char *titles = json;
+
     for (size_t i = 0; i < listLength; i++) {
-        json_object *entry = json_object_array_get_idx(jsonObj, i);
-        json_err err = parseTODOObject(entry, &entries[i]);
+        json_object *entry = isObject ? jsonObj : json_object_array_get_idx(jsonObj, i);
+        err = readTODOObject(entry, &entries[i]);
 
         if (err != json_err_ok) {
-            freeTODOList(entries, listLength);
             json_object_put(jsonObj);
-            json_tokener_free(tok);
             return err;
         }
+
+        size_t titleSize = strlen(entries[i].title) + 1;
+        memcpy(titles, entries[i].title, titleSize);
+        entries[i].title = titles;
+        titles += titleSize;
     }
+
     json_object_put(jsonObj);
-    json_tokener_free(tok);
     *outListLength = listLength;
     *outEntries = entries;
     return json_err_ok;
 }
+
+/*
+ * scanRawTODOList reads every entry of a TODO list with scanTODOObject,
+ * leaving the json bytes untouched and the titles raw.
+ *
+ * outResult - Receives a `scan_result_fallback` when json-c is needed
+ *             instead, in which case the entries must not be used.
+ *
+ * Returns a `json_err_alloc_failed` if the entries cannot be allocated.
+ */
+static json_err scanRawTODOList(Arena *arena, const char *json, size_t jsonSize, size_t *outListLength,
+                                TODOEntry **outEntries, scan_result *outResult) {
+    const char *end = json + jsonSize;
+    const char *cursor = skipJsonSpace(json, end);
+
+    if (cursor >= end || (*cursor != '[' && *cursor != '{')) {
+        *outResult = scan_result_fallback;
+        return json_err_ok;
+    }
+
+    bool isArray = *cursor == '[';
+    size_t capacity = isArray ? jsonSize / 64 + 1 : 1;
+    size_t listLength = 0;
+    TODOEntry *entries = arenaAlloc(arena, capacity * sizeof(TODOEntry));
+    statsCountAlloc(stats_component_models, capacity * sizeof(TODOEntry));
+
+    if (entries == NULL) {
+        return json_err_alloc_failed;
+    }
+
+    scan_result result = scan_result_ok;
+
+    if (isArray) {
+        cursor = skipJsonSpace(cursor + 1, end);
+
+        if (cursor < end && *cursor == ']') {
+            cursor++;
+        } else {
+            while (true) {
+                if (listLength == capacity) {
+                    TODOEntry *newEntries = arenaRealloc(arena, entries, capacity * sizeof(TODOEntry),
+                                                         capacity * 2 * sizeof(TODOEntry));
+                    statsCountAlloc(stats_component_models, capacity * 2 * sizeof(TODOEntry));
+
+                    if (newEntries == NULL) {
+                        return json_err_alloc_failed;
+                    }
+
+                    entries = newEntries;
+                    capacity *= 2;
+                }
+
+                result = scanTODOObject(&cursor, end, &entries[listLength]);
+
+                if (result != scan_result_ok) {
+                    break;
+                }
+
+                listLength++;
+                cursor = skipJsonSpace(cursor, end);
+
+                if (cursor < end && *cursor == ',') {
+                    cursor = skipJsonSpace(cursor + 1, end);
+                    continue;
+                }
+
+                if (cursor < end && *cursor == ']') {
+                    break;
+                }
+
+                result = scan_result_fallback;
+                break;
+            }
+        }
+    } else {
+        result = scanTODOObject(&cursor, end, &entries[0]);
+        listLength = 1;
+    }
+
+    *outResult = result;
+    *outListLength = listLength;
+    *outEntries = entries;
+    return json_err_ok;
+}
+
+json_err scanTODOList(Arena *arena, char *json, size_t jsonSize, size_t *outListLength, TODOEntry **outEntries) {
+    TODOEntry *entries = NULL;
+    size_t listLength = 0;
+    scan_result result = scan_result_ok;
+    json_err err = scanRawTODOList(arena, json, jsonSize, &listLength, &entries, &result);
+
+    if (err != json_err_ok) {
+        return err;
+    }
+
+    if (result != scan_result_ok) {
+        return scanTODOListDOM(arena, json, jsonSize, outListLength, outEntries);
+    }
+
+    for (size_t i = 0; i < listLength; i++) {
+        decodeTODOTitle(&entries[i]);
+    }
+
+    *outListLength = listLength;
+    *outEntries = entries;
+    return json_err_ok;
+}
+
+json_err parseTODOList(TodoStore *store, char *json, size_t jsonSize) {
+    Arena *scratch = newArena(jsonSize / 4 + 1);
+
+    if (scratch == NULL) {
+        return json_err_alloc_failed;
+    }
+
+    TODOEntry *entries = NULL;
+    size_t listLength = 0;
+    json_err err = scanTODOList(scratch, json, jsonSize, &listLength, &entries);
+
+    for (size_t i = 0; i < listLength && err == json_err_ok; i++) {
+        err = todoStoreAppend(store, &entries[i]);
+    }
+
+    freeArena(scratch);
+    return err;
+}
+
+json_err parseTODOListReadOnly(TodoStore *store, const char *json, size_t jsonSize) {
+    Arena *scratch = newArena(jsonSize / 4 + 1);
+
+    if (scratch == NULL) {
+        return json_err_alloc_failed;
+    }
+
+    TODOEntry *entries = NULL;
+    size_t listLength = 0;
+    scan_result result = scan_result_ok;
+    json_err err = scanRawTODOList(scratch, json, jsonSize, &listLength, &entries, &result);
+
+    if (err == json_err_ok && result != scan_result_ok) {
+        freeArena(scratch);
+        return parseTODOListDOM(store, json, jsonSize);
+    }
+
+    /*
+     * Titles are decoded one at a time into a buffer sized for the longest
+     * raw one so far, which todoStoreAppend copies from.
+     */
+    char *title = NULL;
+    size_t titleCapacity = 0;
+
+    for (size_t i = 0; i < listLength && err == json_err_ok; i++) {
+        size_t rawSize = rawTODOTitleSize(&entries[i]);
+
+        if (rawSize + 1 > titleCapacity) {
+            size_t capacity = titleCapacity > 0 ? titleCapacity : 64;
+
+            while (capacity < rawSize + 1) {
+                capacity *= 2;
+            }
+
+            char *newTitle = arenaRealloc(scratch, title, titleCapacity, capacity);
+            statsCountAlloc(stats_component_models, capacity);
+
+            if (newTitle == NULL) {
+                err = json_err_alloc_failed;
+                break;
+            }
+
+            title = newTitle;
+            titleCapacity = capacity;
+        }
+
+        TODOEntry todo = entries[i];
+        decodeTODOTitleTo(&entries[i], title);
+        todo.title = title;
+        err = todoStoreAppend(store, &todo);
+    }
+
+    freeArena(scratch);
+    return err;
+}
+
+/*
+ * Initial capacity of the buffer holding the element being streamed.
+ */
+const size_t STREAM_ELEMENT_CAPACITY = 256;
+
+typedef enum {
+    stream_state_start,
+    stream_state_element_start,
+    stream_state_element,
+    stream_state_element_end,
+    stream_state_done
+} stream_state;
+
+/*
+ * TODOStreamParser only tracks enough of the json grammar to split the top
+ * level array into its elements. Each element is then parsed on its own.
+ *
+ * onEntry     - Consumer of the parsed entries.
+ * context     - Passed untouched to onEntry.
+ * tok         - Tokener reused for every element.
+ * state       - Where in the top level value the parser is.
+ * isArray     - Whether the top level value is an array or a single object.
+ * hasElements - Whether any element was already read from the array.
+ * depth       - Nesting depth inside the current element.
+ * inString    - Whether the element cursor is inside a string.
+ * escaped     - Whether the previous string char was a backslash.
+ * element     - Bytes of the current element.
+ * elementSize - Amount of bytes in element.
+ * capacity    - Allocated size of element.
+ * err         - First error found, returned by every following call.
+ */
+struct TODOStreamParser {
+    TODOEntryCallback onEntry;
+    void *context;
+    struct json_tokener *tok;
+    stream_state state;
+    bool isArray;
+    bool hasElements;
+    size_t depth;
+    bool inString;
+    bool escaped;
+    char *element;
+    size_t elementSize;
+    size_t capacity;
+    json_err err;
+};
+
+json_err newTODOStreamParser(TODOEntryCallback onEntry, void *context, TODOStreamParser **outParser) {
+    TODOStreamParser *parser = calloc(1, sizeof(TODOStreamParser));
+    statsCountAlloc(stats_component_models, sizeof(TODOStreamParser) + STREAM_ELEMENT_CAPACITY);
+
+    if (parser == NULL) {
+        return json_err_alloc_failed;
+    }
+
+    parser->tok = json_tokener_new();
+    parser->element = malloc(STREAM_ELEMENT_CAPACITY);
+
+    if (parser->tok == NULL || parser->element == NULL) {
+        freeTODOStreamParser(parser);
+        return json_err_alloc_failed;
+    }
+
+    parser->onEntry = onEntry;
+    parser->context = context;
+    parser->capacity = STREAM_ELEMENT_CAPACITY;
+    parser->state = stream_state_start;
+    parser->err = json_err_ok;
+    *outParser = parser;
+    return json_err_ok;
+}
+
+void freeTODOStreamParser(TODOStreamParser *parser) {
+    if (parser == NULL) {
+        return;
+    }
+
+    if (parser->tok != NULL) {
+        json_tokener_free(parser->tok);
+    }
+
+    free(parser->element);
+    free(parser);
+}
+
+/*
+ * appendElement copies bytes of the current element into the parser buffer.
+ */
+static json_err appendElement(TODOStreamParser *parser, const char *bytes, size_t size) {
+    if (parser->elementSize + size > parser->capacity) {
+        size_t newCapacity = parser->capacity * 2;
+
+        while (newCapacity < parser->elementSize + size) {
+            newCapacity *= 2;
+        }
+
+        char *newElement = realloc(parser->element, newCapacity);
+        statsCountAlloc(stats_component_models, newCapacity);
+
+        if (newElement == NULL) {
+            return json_err_alloc_failed;
+        }
+
+        parser->element = newElement;
+        parser->capacity = newCapacity;
+    }
+
+    memcpy(parser->element + parser->elementSize, bytes, size);
+    parser->elementSize += size;
+    return json_err_ok;
+}
+
+/*
+ * emitElement parses the buffered element and hands it to onEntry.
+ */
+static json_err emitElement(TODOStreamParser *parser) {
+    TODOEntry todo;
+    const char *cursor = parser->element;
+    json_object *entry = NULL;
+    json_err err = json_err_ok;
+
+    if (scanTODOObject(&cursor, parser->element + parser->elementSize, &todo) == scan_result_ok) {
+        decodeTODOTitle(&todo);
+    } else {
+        json_tokener_reset(parser->tok);
+        entry = json_tokener_parse_ex(parser->tok, parser->element, parser->elementSize);
+
+        if (entry == NULL || json_tokener_get_error(parser->tok) != json_tokener_success) {
+            json_object_put(entry);
+            return json_err_parse_failed;
+        }
+
+        err = readTODOObject(entry, &todo);
+    }
+
+    if (err == json_err_ok && parser->onEntry != NULL) {
+        err = parser->onEntry(&todo, parser->context);
+    }
+
+    json_object_put(entry);
+    parser->elementSize = 0;
+    return err;
+}
+
+/*
+ * isJsonSpace tells whether a char is insignificant whitespace in json.
+ */
+static inline bool isJsonSpace(char c) {
+    return c == ' ' || c == '\n' || c == '\r' || c == '\t';
+}
+
+/*
+ * scanElement advances through the current element until it ends or the
+ * chunk is over, buffering what it went through.
+ *
+ * Returns the offset right after the scanned bytes.
+ */
+static size_t scanElement(TODOStreamParser *parser, const char *chunk, size_t size, size_t offset) {
+    size_t i = offset;
+
+    for (; i < size; i++) {
+        char c = chunk[i];
+
+        if (parser->inString) {
+            if (parser->escaped) {
+                parser->escaped = false;
+            } else if (c == '\\') {
+                parser->escaped = true;
+            } else if (c == '"') {
+                parser->inString = false;
+            }
+            continue;
+        }
+
+        if (c == '"') {
+            parser->inString = true;
+        } else if (c == '{' || c == '[') {
+            parser->depth++;
+        } else if (c == '}' || c == ']') {
+            parser->depth--;
+
+            if (parser->depth == 0) {
+                i++;
+                parser->state = parser->isArray ? stream_state_element_end : stream_state_done;
+                break;
+            }
+        }
+    }
+
+    parser->err = appendElement(parser, chunk + offset, i - offset);
+
+    if (parser->err == json_err_ok && parser->state != stream_state_element) {
+        parser->err = emitElement(parser);
+    }
+
+    return i;
+}
+
+json_err feedTODOStreamParser(TODOStreamParser *parser, const char *chunk, size_t size) {
+    size_t i = 0;
+
+    while (i < size && parser->err == json_err_ok) {
+        if (parser->state == stream_state_element) {
+            i = scanElement(parser, chunk, size, i);
+            continue;
+        }
+
+        char c = chunk[i];
+
+        if (isJsonSpace(c)) {
+            i++;
+            continue;
+        }
+
+        switch (parser->state) {
+            case stream_state_start:
+                if (c == '[') {
+                    parser->isArray = true;
+                    parser->state = stream_state_element_start;
+                    i++;
+                } else if (c == '{') {
+                    parser->state = stream_state_element;
+                } else if (c != '\0' && strchr("\"-0123456789tfn", c) != NULL) {
+                    parser->err = json_err_invalid_type;
+                } else {
+                    parser->err = json_err_parse_failed;
+                }
+                break;
+            case stream_state_element_start:
+                if (c == '{') {
+                    parser->state = stream_state_element;
+                    parser->hasElements = true;
+                } else if (c == ']' && !parser->hasElements) {
+                    parser->state = stream_state_done;
+                    i++;
+                } else if (c != '\0' && strchr("[\"-0123456789tfn", c) != NULL) {
+                    parser->err = json_err_invalid_type;
+                } else {
+                    parser->err = json_err_parse_failed;
+                }
+                break;
+            case stream_state_element_end:
+                if (c == ',') {
+                    parser->state = stream_state_element_start;
+                } else if (c == ']') {
+                    parser->state = stream_state_done;
+                } else {
+                    parser->err = json_err_parse_failed;
+                }
+                i++;
+                break;
+            default:
+                parser->err = json_err_parse_failed;
+                break;
+        }
+    }
+
+    return parser->err;
+}
+
+json_err finishTODOStreamParser(TODOStreamParser *parser) {
+    if (parser->err == json_err_ok && parser->state != stream_state_done) {
+        parser->err = json_err_parse_failed;
+    }
+
+    return parser->err;
+}
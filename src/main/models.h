@@ -1,6 +1,8 @@
 #ifndef models_h
 #define models_h
 #include <stdlib.h>
+#include <stdbool.h>
+#include <arena/arena.h>
 
 typedef struct {
     int userID;
@@ -17,44 +19,114 @@ typedef enum {
 } json_err;
 
 /*
- * Utility function to free memory allocated for each dynamic
- * value from a row and then the row itself.
+ * TodoStore is the columnar TODO list parsers fill, declared in store.h.
+ */
+typedef struct TodoStore TodoStore;
+
+/*
+ * parseTODOList attempts to parse a json containing a TODO list.
  *
- * rows   - A string containing the rows to be freed.
- * amount - A number representing until when we still free the rows
- *          (for cases where an error occurs before allocating all existing rows)
+ * store    - TodoStore receiving every parsed entry at its end.
+ * json     - A string containing the json contents. It's overwritten while
+ *            parsing, see scanTODOList.
+ * jsonSize - A number representing the size of json.
  *
- * Be aware that we are considering here that the first two elements of each row
- * were allocated and we're freeing them.
+ * Returns a `json_err_aloc_failed` if any of the allocations fail. It also
+ * can returns a `json_err_parse-failed` if there's a error from json_tokener or
+ * the parsed json object became null.
+ *
+ * If the received json is not an object or an array, it can also return a `json_err_invalid_type`.
+ * Otherwise, returns a `json_err_ok`. On errors, the store may have received
+ * part of the entries.
  */
-void freeRows(char ***rows, size_t amount);
+json_err parseTODOList(TodoStore *store, char *json, size_t jsonSize);
 
 /*
- * Utility function to free memory allocated for each dynamic
- * TODOEntry from a TODOEntry list and then the list itself.
- *
- * list       - List containing each allocated TODOEntry.
- * listLength - A number representing the size of the list.
+ * parseTODOListDOM does the same as parseTODOList going through json-c
+ * objects only. It leaves json untouched, but is several times slower.
  */
-void freeTODOList(TODOEntry **list, size_t listLength);
+json_err parseTODOListDOM(TodoStore *store, const char *json, size_t jsonSize);
 
 /*
- * parseTODOList attempts to parse a json containing a TODO list.
+ * parseTODOListReadOnly does the same as parseTODOList without writing to
+ * json, decoding every title into the store instead, so it can parse a read
+ * only mapping.
+ */
+json_err parseTODOListReadOnly(TodoStore *store, const char *json, size_t jsonSize);
+
+/*
+ * scanTODOList parses a TODO list in place, reading the expected schema
+ * straight from the json bytes instead of building json-c objects. Anything
+ * it doesn't expect is handed to json-c instead, so the result is the same
+ * as parseTODOListDOM.
  *
- * json          - A string containing the json contents.
+ * arena         - Where the entries array is allocated.
+ * json          - A string containing the json contents. It's overwritten
+ *                 while parsing and must outlive the entries, as every title
+ *                 points inside it.
  * jsonSize      - A number representing the size of json.
- * outListLength - A number which will receive the final TODO list size
- *                  after parsing the list.
- * outEntries    - Responsible for receiving a `TODOEntry ***` containing the
- *                 resulted todo entries list.
+ * outListLength - A number which will receive the final TODO list size.
+ * outEntries    - Receives a single `TODOEntry` array.
  *
- * Returns a `json_err_aloc_failed` if any of the allocations fail. It also
- * can returns a `json_err_parse-failed` if there's a error from json_tokener or
- * the parsed json object became null.
+ * Returns the same errors as parseTODOList.
+ */
+json_err scanTODOList(Arena *arena, char *json, size_t jsonSize, size_t *outListLength, TODOEntry **outEntries);
+
+/*
+ * TODOEntryCallback receives each TODOEntry parsed by a TODOStreamParser.
  *
- * If the received json is not an object or an array, it can also return a `json_err_invalid_type`.
- * Otherwise, returns a `json_err_ok`.
+ * entry   - The parsed entry. Its title is only valid during the call.
+ * context - The context provided to newTODOStreamParser.
+ *
+ * Returning anything but `json_err_ok` stops the parser, which then keeps
+ * returning that error.
+ */
+typedef json_err (*TODOEntryCallback)(const TODOEntry *entry, void *context);
+
+/*
+ * TODOStreamParser incrementally parses a TODO list fed in arbitrary chunks,
+ * emitting each entry as soon as its object is complete. It only keeps the
+ * bytes of the element being read, so memory is bounded by the biggest entry
+ * rather than by the whole payload.
+ */
+typedef struct TODOStreamParser TODOStreamParser;
+
+/*
+ * newTODOStreamParser attempts to allocate a TODOStreamParser.
+ *
+ * onEntry   - Called for every parsed TODOEntry, in order.
+ * context   - Passed untouched to onEntry.
+ * outParser - Receives the parser, which must be released with
+ *             freeTODOStreamParser.
+ *
+ * Returns a `json_err_alloc_failed` if the parser cannot be allocated.
+ */
+json_err newTODOStreamParser(TODOEntryCallback onEntry, void *context, TODOStreamParser **outParser);
+
+/*
+ * feedTODOStreamParser parses the next chunk of a TODO list.
+ *
+ * parser - Parser receiving the chunk.
+ * chunk  - Next bytes of the json. They don't need to be NUL terminated and
+ *          can split values anywhere.
+ * size   - Amount of bytes in chunk.
+ *
+ * Returns the same errors as parseTODOList, or whatever onEntry returned.
+ * Once an error is returned, every following call returns it as well.
+ */
+json_err feedTODOStreamParser(TODOStreamParser *parser, const char *chunk, size_t size);
+
+/*
+ * finishTODOStreamParser checks the fed json was complete.
+ *
+ * Returns a `json_err_parse_failed` if the input ended in the middle of
+ * the list, or the error which stopped the parser before.
+ */
+json_err finishTODOStreamParser(TODOStreamParser *parser);
+
+/*
+ * Releases a TODOStreamParser and everything it holds.
  */
-json_err parseTODOList(char *json, size_t jsonSize, size_t *outListLength, TODOEntry ***outEntries);
+void freeTODOStreamParser(TODOStreamParser *parser);
 #endif
 
@@ -0,0 +1,304 @@
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include "options.h"
+
+/*
+ * readSize reads a non negative number argument.
+ */
+static options_err readSize(const char *value, size_t *outValue) {
+    char *end = NULL;
+    errno = 0;
+    unsigned long long number = strtoull(value, &end, 10);
+
+    if (errno != 0 || end == value || *end != '\0' || value[0] == '-') {
+        return options_err_invalid_value;
+    }
+
+    *outValue = (size_t)number;
+    return options_err_ok;
+}
+
+/*
+ * readInterval reads a positive amount of seconds, such as `2` or `0.5`, as
+ * milliseconds.
+ */
+static options_err readInterval(const char *value, size_t *outMilliseconds) {
+    char *end = NULL;
+    errno = 0;
+    double seconds = strtod(value, &end);
+
+    if (errno != 0 || end == value || *end != '\0' || !(seconds >= 0.001 && seconds <= 86400.0)) {
+        return options_err_invalid_value;
+    }
+
+    *outMilliseconds = (size_t)(seconds * 1000.0 + 0.5);
+    return options_err_ok;
+}
+
+options_err parseOptions(int argc, char **argv, Options *outOptions) {
+    Options options = { input: { kind: input_kind_url, location: NULL }, threads: 1, pages: 0, pageSize: 20,
+                        cacheDir: NULL, syncDir: NULL, stats: false, watchInterval: 0,
+                        format: findTableRenderer("box"), joinUsers: false,
+                        users: { kind: input_kind_url, location: NULL }, summary: false, page: 0, pageRows: 0,
+                        serve: NULL, connect: NULL, refreshInterval: 60000 };
+
+    memset(&options.query, 0, sizeof(Query));
+    httpDefaultPolicy(&options.http);
+
+    for (int i = 1; i < argc; i++) {
+        const char *arg = argv[i];
+        options_err err = options_err_ok;
+
+        if (strcmp(arg, "-h") == 0 || strcmp(arg, "--help") == 0) {
+            return options_err_help;
+        } else if (strcmp(arg, "--threads") == 0) {
+            if (i + 1 >= argc) {
+                return options_err_missing_value;
+            }
+            err = readSize(argv[++i], &options.threads);
+        } else if (strcmp(arg, "--fetch-pages") == 0) {
+            if (i + 1 >= argc) {
+                return options_err_missing_value;
+            }
+            err = readSize(argv[++i], &options.pages);
+        } else if (strcmp(arg, "--fetch-page-size") == 0) {
+            if (i + 1 >= argc) {
+                return options_err_missing_value;
+            }
+            err = readSize(argv[++i], &options.pageSize);
+            if (err == options_err_ok && options.pageSize == 0) {
+                err = options_err_invalid_value;
+            }
+        } else if (strcmp(arg, "--where") == 0) {
+            if (i + 1 >= argc) {
+                return options_err_missing_value;
+            }
+            if (options.query.predicatesCount == QUERY_MAX_PREDICATES ||
+                parseQueryPredicate(argv[++i], &options.query.predicates[options.query.predicatesCount++]) !=
+                    query_err_ok) {
+                err = options_err_invalid_value;
+            }
+        } else if (strcmp(arg, "--sort") == 0) {
+            if (i + 1 >= argc) {
+                return options_err_missing_value;
+            }
+            if (parseQuerySort(argv[++i], &options.query) != query_err_ok) {
+                err = options_err_invalid_value;
+            }
+        } else if (strcmp(arg, "--limit") == 0) {
+            if (i + 1 >= argc) {
+                return options_err_missing_value;
+            }
+            err = readSize(argv[++i], &options.query.limit);
+        } else if (strcmp(arg, "--search") == 0) {
+            if (i + 1 >= argc) {
+                return options_err_missing_value;
+            }
+            options.query.search = argv[++i];
+        } else if (strcmp(arg, "--summary") == 0) {
+            options.summary = true;
+        } else if (strcmp(arg, "--page") == 0) {
+            if (i + 1 >= argc) {
+                return options_err_missing_value;
+            }
+            err = readSize(argv[++i], &options.page);
+            if (err == options_err_ok && options.page == 0) {
+                err = options_err_invalid_value;
+            }
+        } else if (strcmp(arg, "--page-size") == 0) {
+            if (i + 1 >= argc) {
+                return options_err_missing_value;
+            }
+            err = readSize(argv[++i], &options.pageRows);
+            if (err == options_err_ok && options.pageRows == 0) {
+                err = options_err_invalid_value;
+            }
+        } else if (strcmp(arg, "--stats") == 0) {
+            options.stats = true;
+        } else if (strcmp(arg, "--watch") == 0) {
+            if (i + 1 >= argc) {
+                return options_err_missing_value;
+            }
+            err = readInterval(argv[++i], &options.watchInterval);
+        } else if (strcmp(arg, "--input") == 0) {
+            if (i + 1 >= argc) {
+                return options_err_missing_value;
+            }
+            parseInputSource(argv[++i], &options.input);
+        } else if (strcmp(arg, "--join-users") == 0) {
+            options.joinUsers = true;
+        } else if (strcmp(arg, "--users") == 0) {
+            if (i + 1 >= argc) {
+                return options_err_missing_value;
+            }
+            parseInputSource(argv[++i], &options.users);
+            options.joinUsers = true;
+        } else if (strcmp(arg, "--format") == 0) {
+            if (i + 1 >= argc) {
+                return options_err_missing_value;
+            }
+            options.format = findTableRenderer(argv[++i]);
+            if (options.format == NULL) {
+                err = options_err_invalid_value;
+            }
+        } else if (strcmp(arg, "--serve") == 0) {
+            if (i + 1 >= argc) {
+                return options_err_missing_value;
+            }
+            options.serve = argv[++i];
+        } else if (strcmp(arg, "--connect") == 0) {
+            if (i + 1 >= argc) {
+                return options_err_missing_value;
+            }
+            options.connect = argv[++i];
+        } else if (strcmp(arg, "--refresh") == 0) {
+            if (i + 1 >= argc) {
+                return options_err_missing_value;
+            }
+            err = readInterval(argv[++i], &options.refreshInterval);
+        } else if (strcmp(arg, "--connect-timeout") == 0 || strcmp(arg, "--timeout") == 0 ||
+                   strcmp(arg, "--hedge") == 0) {
+            size_t milliseconds = 0;
+
+            if (i + 1 >= argc) {
+                return options_err_missing_value;
+            }
+            err = readInterval(argv[++i], &milliseconds);
+            if (strcmp(arg, "--connect-timeout") == 0) {
+                options.http.connectTimeout = (long)milliseconds;
+            } else if (strcmp(arg, "--timeout") == 0) {
+                options.http.timeout = (long)milliseconds;
+            } else {
+                options.http.hedgeDelay = (long)milliseconds;
+                options.http.hedgePercentile = options.http.hedgePercentile > 0 ? options.http.hedgePercentile : 95;
+            }
+        } else if (strcmp(arg, "--hedge-percentile") == 0) {
+            if (i + 1 >= argc) {
+                return options_err_missing_value;
+            }
+            err = readSize(argv[++i], &options.http.hedgePercentile);
+            if (err == options_err_ok && (options.http.hedgePercentile == 0 || options.http.hedgePercentile > 100)) {
+                err = options_err_invalid_value;
+            }
+        } else if (strcmp(arg, "--retries") == 0) {
+            if (i + 1 >= argc) {
+                return options_err_missing_value;
+            }
+            err = readSize(argv[++i], &options.http.retries);
+            if (err == options_err_ok && options.http.retries > 10) {
+                err = options_err_invalid_value;
+            }
+        } else if (strcmp(arg, "--cache-dir") == 0) {
+            if (i + 1 >= argc) {
+                return options_err_missing_value;
+            }
+            options.cacheDir = argv[++i];
+        } else if (strcmp(arg, "--sync") == 0) {
+            if (i + 1 >= argc) {
+                return options_err_missing_value;
+            }
+            options.syncDir = argv[++i];
+        } else {
+            return options_err_unknown_option;
+        }
+
+        if (err != options_err_ok) {
+            return err;
+        }
+    }
+
+    if (options.watchInterval > 0 && tableRendererStreams(options.format)) {
+        return options_err_invalid_value;
+    }
+
+    if ((options.pages > 0 || options.cacheDir != NULL || options.syncDir != NULL) &&
+        options.input.kind != input_kind_url) {
+        return options_err_invalid_value;
+    }
+
+    if (options.syncDir != NULL && (options.pages > 0 || options.cacheDir != NULL)) {
+        return options_err_invalid_value;
+    }
+
+    if (options.watchInterval > 0 && (options.summary || options.page > 0 || options.pageRows > 0)) {
+        return options_err_invalid_value;
+    }
+
+    if (options.pageRows > 0 && options.page == 0) {
+        options.page = 1;
+    }
+
+    if (options.http.hedgePercentile > 0 && options.http.hedgeDelay == 0) {
+        return options_err_invalid_value;
+    }
+
+    if (options.serve != NULL && (options.watchInterval > 0 || options.connect != NULL ||
+                                  options.input.kind == input_kind_stdin ||
+                                  (options.joinUsers && options.users.kind == input_kind_stdin))) {
+        return options_err_invalid_value;
+    }
+
+    if (options.watchInterval > 0 && (options.input.kind == input_kind_stdin ||
+                                      (options.joinUsers && options.users.kind == input_kind_stdin))) {
+        return options_err_invalid_value;
+    }
+
+    *outOptions = options;
+    return options_err_ok;
+}
+
+void printUsage(const char *program) {
+    fprintf(stderr,
+            "Usage: %s [options]\n"
+            "\n"
+            "Options:\n"
+            "  --input SOURCE         Read the list from a url, a json file, or stdin when\n"
+            "                         SOURCE is -. Files are mapped instead of read.\n"
+            "  --join-users           Fetch the users along with the list and show their\n"
+            "                         names instead of their ids.\n"
+            "  --users SOURCE         Read the joined users from a url, a json file or stdin.\n"
+            "                         Defaults to the users url next to a /todos url.\n"
+            "  --threads N            Render the table with N threads (0 for one per cpu, default 1).\n"
+            "  --fetch-pages N        Fetch the list as N pages requested concurrently.\n"
+            "  --fetch-page-size N    Entries per fetched page (default 20).\n"
+            "  --connect-timeout SECONDS\n"
+            "                         Give up connecting after SECONDS (default 10).\n"
+            "  --timeout SECONDS      Give up on each attempt of a request after SECONDS.\n"
+            "  --retries N            Retry failed requests up to N times, waiting twice as\n"
+            "                         long each time from 0.2s (default 2, at most 10).\n"
+            "  --hedge SECONDS        Send a slow request again after SECONDS, then after the\n"
+            "                         95th percentile of the latest latencies, and use the\n"
+            "                         first answer.\n"
+            "  --hedge-percentile P   Percentile of the latencies used by --hedge.\n"
+            "  --cache-dir DIR        Cache the list in DIR, revalidating it on each run.\n"
+            "                         Not used along with --fetch-pages.\n"
+            "  --sync DIR             Keep a copy of the list in DIR, fetching only the ranges\n"
+            "                         of ids that changed since the last run.\n"
+            "  --where FIELD=VALUE    Only show entries whose userId, id, title or completed\n"
+            "                         field equals VALUE. May be repeated.\n"
+            "  --sort FIELDS          Sort by comma separated fields, descending when\n"
+            "                         prefixed by -, such as title,-id.\n"
+            "  --limit N              Show at most N entries.\n"
+            "  --search TEXT          Only show entries whose title contains TEXT.\n"
+            "  --summary              Show the amount of entries, completed ones and the\n"
+            "                         completed ratio of each user instead of the entries.\n"
+            "  --page N               Only show the Nth page of the rows, or the last one\n"
+            "                         when there are fewer, as the status line says. The\n"
+            "                         box can be scrolled on a terminal with j, k, space,\n"
+            "                         b, g and G, and q to quit.\n"
+            "  --page-size N          Rows of each page (default 20, or fit the terminal when\n"
+            "                         scrolling).\n"
+            "  --format FORMAT        Write the entries as a box, csv, ndjson or markdown\n"
+            "                         (default box). The others are written as they're\n"
+            "                         parsed when there's no query.\n"
+            "  --stats                Report stage timings, allocations and transfers as json on stderr.\n"
+            "  --watch SECONDS        Fetch the list again every SECONDS, repainting only\n"
+            "                         the rows that changed. Only for the box format.\n"
+            "  --serve SOCKET         Keep the list in memory and serve it on a unix socket,\n"
+            "                         keeping each rendered response until the next fetch.\n"
+            "  --refresh SECONDS      Fetch the served list again every SECONDS (default 60).\n"
+            "  --connect SOCKET       Send every other option to a list served on SOCKET.\n"
+            "  -h, --help             Show this message.\n",
+            program);
+}
@@ -0,0 +1,97 @@
+#ifndef options_h
+#define options_h
+#include <stdlib.h>
+#include <stdbool.h>
+#include <table/format.h>
+#include "query.h"
+#include "input.h"
+
+typedef enum {
+    options_err_ok = 0,
+    options_err_unknown_option = 1,
+    options_err_missing_value = 2,
+    options_err_invalid_value = 3,
+    options_err_help = 4
+} options_err;
+
+/*
+ * Options holds everything that can be set from the command line.
+ *
+ * input     - Where the list is read from. A url source without location
+ *             is the default TODO list url.
+ * threads   - Threads used to render the table. 0 means one per online cpu.
+ * pages     - When not 0, the list is fetched as this many pages requested
+ *             concurrently instead of a single streamed request.
+ * pageSize  - Entries per page when fetching pages.
+ * cacheDir  - When not NULL, the single request goes through a HttpCache
+ *             kept in this directory.
+ * syncDir   - When not NULL, a copy of the list kept in this directory is
+ *             synced, fetching only the ID ranges that changed.
+ * stats     - Whether timings and counters are reported on stderr as json.
+ * watchInterval - When not 0, milliseconds between fetches of the list,
+ *                 which is kept on screen and repainted where it changed.
+ * format    - How the entries are written.
+ * joinUsers - Whether users are fetched along with the list, to show their
+ *             names instead of their ids.
+ * users     - Where users are read from. A url source without location is
+ *             the `users` url next to the list one.
+ * summary   - Whether the entries are counted per user, showing only the
+ *             counts.
+ * page      - When not 0, only this page of the rendered rows is shown,
+ *             counted from 1, clamped to the last one. On a terminal, the
+ *             box can be scrolled from there.
+ * pageRows  - Rows of each shown page, or 0 to fit the terminal when it's
+ *             scrolled and 20 otherwise.
+ * serve     - When not NULL, the unix socket the list is served on.
+ * connect   - When not NULL, the unix socket of a served list every other
+ *             option is sent to, instead of fetching the list.
+ * refreshInterval - Milliseconds between fetches of a served list.
+ * http      - Timeouts, retries and hedging of every request.
+ * query     - Filters, search, order and limit of the rendered entries.
+ */
+typedef struct {
+    InputSource input;
+    size_t threads;
+    size_t pages;
+    size_t pageSize;
+    const char *cacheDir;
+    const char *syncDir;
+    bool stats;
+    size_t watchInterval;
+    const TableRenderer *format;
+    bool joinUsers;
+    InputSource users;
+    bool summary;
+    size_t page;
+    size_t pageRows;
+    const char *serve;
+    const char *connect;
+    size_t refreshInterval;
+    HttpPolicy http;
+    Query query;
+} Options;
+
+/*
+ * parseOptions attempts to read the command line arguments.
+ *
+ * argc       - Amount of arguments, as received by main.
+ * argv       - Arguments, as received by main.
+ * outOptions - Receives the defaults overridden by each argument.
+ *
+ * Returns a `options_err_unknown_option` for arguments it doesn't know, a
+ * `options_err_missing_value` when an option is the last argument but needs
+ * a value and a `options_err_invalid_value` when the value can't be read, or
+ * when `--watch` is asked for another format than the box. Fetching pages,
+ * caching or syncing is also invalid for other inputs than urls, syncing
+ * along with fetching pages or caching, and watching for stdin or along with
+ * `--summary` or `--page`. Serving is invalid for stdin, while watching, or
+ * along with `--connect`. `options_err_help` means usage was asked for.
+ */
+options_err parseOptions(int argc, char **argv, Options *outOptions);
+
+/*
+ * printUsage writes the supported options to stderr.
+ */
+void printUsage(const char *program);
+
+#endif
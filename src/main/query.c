@@ -0,0 +1,580 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <stats/stats.h>
+#include "query.h"
+#include "trigram.h"
+
+static const char *FIELD_NAMES[query_field_count] = { "userId", "id", "title", "completed" };
+
+/*
+ * readField looks up a field by its json key.
+ */
+static bool readField(const char *name, size_t size, query_field *outField) {
+    for (size_t i = 0; i < query_field_count; i++) {
+        if (strlen(FIELD_NAMES[i]) == size && strncmp(FIELD_NAMES[i], name, size) == 0) {
+            *outField = (query_field)i;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+query_err parseQueryPredicate(const char *text, QueryPredicate *outPredicate) {
+    const char *equals = strchr(text, '=');
+    QueryPredicate predicate = { field: query_field_id, number: 0, completed: false, title: NULL };
+
+    if (equals == NULL || !readField(text, (size_t)(equals - text), &predicate.field)) {
+        return query_err_invalid_predicate;
+    }
+
+    const char *value = equals + 1;
+
+    switch (predicate.field) {
+        case query_field_user_id:
+        case query_field_id: {
+            char *end = NULL;
+            errno = 0;
+            long number = strtol(value, &end, 10);
+
+            if (errno != 0 || end == value || *end != '\0' || number < INT32_MIN || number > INT32_MAX) {
+                return query_err_invalid_predicate;
+            }
+
+            predicate.number = (int32_t)number;
+            break;
+        }
+        case query_field_completed:
+            if (strcmp(value, "true") != 0 && strcmp(value, "false") != 0) {
+                return query_err_invalid_predicate;
+            }
+
+            predicate.completed = value[0] == 't';
+            break;
+        default:
+            predicate.title = value;
+            break;
+    }
+
+    *outPredicate = predicate;
+    return query_err_ok;
+}
+
+query_err parseQuerySort(const char *text, Query *query) {
+    const char *cursor = text;
+
+    while (true) {
+        const char *end = strchr(cursor, ',');
+        size_t size = end != NULL ? (size_t)(end - cursor) : strlen(cursor);
+        QuerySortKey key = { field: query_field_id, descending: size > 0 && cursor[0] == '-' };
+
+        if (!readField(cursor + key.descending, size - key.descending, &key.field)) {
+            return query_err_invalid_sort;
+        }
+
+        if (query->sortKeysCount == QUERY_MAX_SORT_KEYS) {
+            return query_err_too_many;
+        }
+
+        query->sortKeys[query->sortKeysCount++] = key;
+
+        if (end == NULL) {
+            return query_err_ok;
+        }
+
+        cursor = end + 1;
+    }
+}
+
+bool queryIsEmpty(const Query *query) {
+    return query->predicatesCount == 0 && query->sortKeysCount == 0 && query->limit == 0 && query->search == NULL;
+}
+
+/*
+ * sortRowsByNumber returns the rows sorted by a number column, then by row,
+ * through a stable radix sort of two 16 bits digits.
+ */
+static uint32_t *sortRowsByNumber(Arena *arena, const int32_t *values, size_t length) {
+    uint32_t *rows = arenaAlloc(arena, length * sizeof(uint32_t) + 1);
+    uint32_t *scratch = arenaAlloc(arena, length * sizeof(uint32_t) + 1);
+    uint32_t *counts = arenaAlloc(arena, (1 << 16) * sizeof(uint32_t));
+
+    statsCountAlloc(stats_component_models, 2 * length * sizeof(uint32_t) + (1 << 16) * sizeof(uint32_t));
+    if (rows == NULL || scratch == NULL || counts == NULL) {
+        return NULL;
+    }
+
+    for (size_t i = 0; i < length; i++) {
+        scratch[i] = (uint32_t)i;
+    }
+
+    for (int shift = 0; shift < 32; shift += 16) {
+        uint32_t *from = shift == 0 ? scratch : rows;
+        uint32_t *to = shift == 0 ? rows : scratch;
+        uint32_t total = 0;
+
+        memset(counts, 0, (1 << 16) * sizeof(uint32_t));
+        for (size_t i = 0; i < length; i++) {
+            counts[(((uint32_t)values[i] ^ 0x80000000u) >> shift) & 0xffff]++;
+        }
+
+        for (size_t digit = 0; digit < (1 << 16); digit++) {
+            uint32_t count = counts[digit];
+            counts[digit] = total;
+            total += count;
+        }
+
+        for (size_t i = 0; i < length; i++) {
+            uint32_t row = from[i];
+            to[counts[(((uint32_t)values[row] ^ 0x80000000u) >> shift) & 0xffff]++] = row;
+        }
+    }
+
+    memcpy(rows, scratch, length * sizeof(uint32_t));
+    return rows;
+}
+
+static int compareTitles(const TodoStore *store, uint32_t a, uint32_t b) {
+    uint32_t aLength = store->titleLengths[a];
+    uint32_t bLength = store->titleLengths[b];
+    int result = memcmp(todoStoreTitle(store, a), todoStoreTitle(store, b), aLength < bLength ? aLength : bLength);
+
+    return result != 0 ? result : (aLength > bLength) - (aLength < bLength);
+}
+
+static int compareTitleRows(const void *a, const void *b, void *context) {
+    uint32_t aRow = *(const uint32_t *)a;
+    uint32_t bRow = *(const uint32_t *)b;
+    int result = compareTitles((const TodoStore *)context, aRow, bRow);
+
+    return result != 0 ? result : (aRow > bRow) - (aRow < bRow);
+}
+
+/*
+ * buildTitleIndex sorts the rows by title and ranks every distinct title.
+ */
+static query_err buildTitleIndex(TodoIndex *index) {
+    const TodoStore *store = index->store;
+
+    if (index->titleRows != NULL) {
+        return query_err_ok;
+    }
+
+    uint32_t *rows = arenaAlloc(index->arena, store->length * sizeof(uint32_t) + 1);
+    uint32_t *ranks = arenaAlloc(index->arena, store->length * sizeof(uint32_t) + 1);
+
+    statsCountAlloc(stats_component_models, 2 * store->length * sizeof(uint32_t));
+    if (rows == NULL || ranks == NULL) {
+        return query_err_alloc_failed;
+    }
+
+    for (size_t i = 0; i < store->length; i++) {
+        rows[i] = (uint32_t)i;
+    }
+
+    qsort_r(rows, store->length, sizeof(uint32_t), compareTitleRows, (void *)store);
+
+    uint32_t rank = 0;
+
+    for (size_t i = 0; i < store->length; i++) {
+        if (i > 0 && compareTitles(store, rows[i - 1], rows[i]) != 0) {
+            rank++;
+        }
+
+        ranks[rows[i]] = rank;
+    }
+
+    index->titleRows = rows;
+    index->titleRanks = ranks;
+    return query_err_ok;
+}
+
+static query_err buildIdIndex(TodoIndex *index) {
+    if (index->idRows == NULL) {
+        index->idRows = sortRowsByNumber(index->arena, index->store->IDs, index->store->length);
+    }
+
+    return index->idRows != NULL ? query_err_ok : query_err_alloc_failed;
+}
+
+query_err newTodoIndex(Arena *arena, const TodoStore *store, TodoIndex **outIndex) {
+    TodoIndex *index = arenaCalloc(arena, 1, sizeof(TodoIndex));
+
+    statsCountAlloc(stats_component_models, sizeof(TodoIndex));
+    if (index == NULL) {
+        return query_err_alloc_failed;
+    }
+
+    index->store = store;
+    index->arena = arena;
+    index->userRows = sortRowsByNumber(arena, store->userIDs, store->length);
+
+    if (index->userRows == NULL) {
+        return query_err_alloc_failed;
+    }
+
+    for (size_t i = 0; i < store->length; i++) {
+        if (i == 0 || store->userIDs[index->userRows[i]] != store->userIDs[index->userRows[i - 1]]) {
+            index->usersCount++;
+        }
+    }
+
+    index->users = arenaAlloc(arena, index->usersCount * sizeof(int32_t) + 1);
+    index->userOffsets = arenaAlloc(arena, (index->usersCount + 1) * sizeof(uint32_t));
+    statsCountAlloc(stats_component_models, index->usersCount * (sizeof(int32_t) + sizeof(uint32_t)));
+
+    if (index->users == NULL || index->userOffsets == NULL) {
+        return query_err_alloc_failed;
+    }
+
+    size_t user = 0;
+
+    for (size_t i = 0; i < store->length; i++) {
+        int32_t userID = store->userIDs[index->userRows[i]];
+
+        if (i == 0 || userID != index->users[user - 1]) {
+            index->users[user] = userID;
+            index->userOffsets[user++] = (uint32_t)i;
+        }
+    }
+
+    index->userOffsets[index->usersCount] = (uint32_t)store->length;
+    *outIndex = index;
+    return query_err_ok;
+}
+
+/*
+ * fieldValue reads the value a row is sorted by. Titles must be ranked.
+ */
+static inline int64_t fieldValue(const TodoIndex *index, query_field field, uint32_t row) {
+    switch (field) {
+        case query_field_user_id:
+            return index->store->userIDs[row];
+        case query_field_id:
+            return index->store->IDs[row];
+        case query_field_title:
+            return index->titleRanks[row];
+        default:
+            return todoStoreCompleted(index->store, row);
+    }
+}
+
+/*
+ * compareRows orders two rows by the query sort keys, then by row.
+ */
+static inline int compareRows(const TodoIndex *index, const Query *query, uint32_t a, uint32_t b) {
+    for (size_t i = 0; i < query->sortKeysCount; i++) {
+        int64_t aValue = fieldValue(index, query->sortKeys[i].field, a);
+        int64_t bValue = fieldValue(index, query->sortKeys[i].field, b);
+
+        if (aValue != bValue) {
+            return (aValue < bValue) != query->sortKeys[i].descending ? -1 : 1;
+        }
+    }
+
+    return (a > b) - (a < b);
+}
+
+typedef struct {
+    const TodoIndex *index;
+    const Query *query;
+} SortContext;
+
+static int compareSortRows(const void *a, const void *b, void *context) {
+    SortContext *sort = (SortContext *)context;
+    return compareRows(sort->index, sort->query, *(const uint32_t *)a, *(const uint32_t *)b);
+}
+
+static bool matches(const TodoIndex *index, const Query *query, uint32_t row) {
+    const TodoStore *store = index->store;
+
+    if (query->search != NULL && index->trigrams == NULL &&
+        memmem(todoStoreTitle(store, row), store->titleLengths[row], query->search, strlen(query->search)) == NULL) {
+        return false;
+    }
+
+    for (size_t i = 0; i < query->predicatesCount; i++) {
+        const QueryPredicate *predicate = &query->predicates[i];
+
+        switch (predicate->field) {
+            case query_field_user_id:
+                if (store->userIDs[row] != predicate->number) {
+                    return false;
+                }
+                break;
+            case query_field_id:
+                if (store->IDs[row] != predicate->number) {
+                    return false;
+                }
+                break;
+            case query_field_title:
+                if (store->titleLengths[row] != strlen(predicate->title) ||
+                    memcmp(todoStoreTitle(store, row), predicate->title, store->titleLengths[row]) != 0) {
+                    return false;
+                }
+                break;
+            default:
+                if (todoStoreCompleted(store, row) != predicate->completed) {
+                    return false;
+                }
+                break;
+        }
+    }
+
+    return true;
+}
+
+/*
+ * searchSorted finds, in a column sorted through rows (or sorted itself when
+ * rows is NULL), the first position holding value, or the first one past
+ * it when `after` is set.
+ */
+static size_t searchSorted(const int32_t *values, const uint32_t *rows, size_t length, int32_t value, bool after) {
+    size_t low = 0, high = length;
+
+    while (low < high) {
+        size_t middle = low + (high - low) / 2;
+        int32_t current = rows != NULL ? values[rows[middle]] : values[middle];
+
+        if (current < value || (after && current == value)) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+
+    return low;
+}
+
+/*
+ * selectCandidates picks the rows a query has to look at: the titles
+ * matching a search, the posting list of a userId predicate or the ID range
+ * of an id predicate. Returns NULL when every row must be looked at.
+ */
+static const uint32_t *selectCandidates(TodoIndex *index, const Query *query, size_t *outCount, query_err *outErr) {
+    const TodoStore *store = index->store;
+
+    if (query->search != NULL && index->trigrams != NULL) {
+        uint32_t *rows = NULL;
+
+        *outErr = trigramSearch(index->trigrams, store, query->search, index->arena, &rows, outCount);
+        return rows;
+    }
+
+    *outErr = query_err_ok;
+    for (size_t i = 0; i < query->predicatesCount; i++) {
+        int32_t userID = query->predicates[i].number;
+
+        if (query->predicates[i].field != query_field_user_id) {
+            continue;
+        }
+
+        size_t user = searchSorted(index->users, NULL, index->usersCount, userID, false);
+
+        if (user == index->usersCount || index->users[user] != userID) {
+            *outCount = 0;
+            return index->userRows;
+        }
+
+        *outCount = index->userOffsets[user + 1] - index->userOffsets[user];
+        return index->userRows + index->userOffsets[user];
+    }
+
+    for (size_t i = 0; i < query->predicatesCount; i++) {
+        int32_t ID = query->predicates[i].number;
+
+        if (query->predicates[i].field != query_field_id) {
+            continue;
+        }
+
+        if ((*outErr = buildIdIndex(index)) != query_err_ok) {
+            return NULL;
+        }
+
+        size_t start = searchSorted(store->IDs, index->idRows, store->length, ID, false);
+        *outCount = searchSorted(store->IDs, index->idRows, store->length, ID, true) - start;
+        return index->idRows + start;
+    }
+
+    *outCount = store->length;
+    return NULL;
+}
+
+/*
+ * sortedPermutation returns the rows sorted by a single sort key field, or
+ * NULL when there's no such index.
+ */
+static const uint32_t *sortedPermutation(TodoIndex *index, query_field field, query_err *outErr) {
+    *outErr = query_err_ok;
+
+    switch (field) {
+        case query_field_user_id:
+            return index->userRows;
+        case query_field_id:
+            *outErr = buildIdIndex(index);
+            return index->idRows;
+        case query_field_title:
+            *outErr = buildTitleIndex(index);
+            return index->titleRows;
+        default:
+            return NULL;
+    }
+}
+
+/*
+ * walkPermutation collects the matching rows of a permutation already sorted
+ * by the single sort key, stopping at limit. Descending walks go through the
+ * groups of equal keys backwards, each group still in row order.
+ */
+static size_t walkPermutation(const TodoIndex *index, const Query *query, const uint32_t *permutation,
+                              size_t limit, uint32_t *outRows) {
+    size_t length = index->store->length;
+    query_field field = query->sortKeys[0].field;
+    size_t count = 0;
+
+    if (!query->sortKeys[0].descending) {
+        for (size_t i = 0; i < length && count < limit; i++) {
+            if (matches(index, query, permutation[i])) {
+                outRows[count++] = permutation[i];
+            }
+        }
+
+        return count;
+    }
+
+    for (size_t end = length; end > 0 && count < limit;) {
+        size_t start = end - 1;
+        int64_t value = fieldValue(index, field, permutation[start]);
+
+        while (start > 0 && fieldValue(index, field, permutation[start - 1]) == value) {
+            start--;
+        }
+
+        for (size_t i = start; i < end && count < limit; i++) {
+            if (matches(index, query, permutation[i])) {
+                outRows[count++] = permutation[i];
+            }
+        }
+
+        end = start;
+    }
+
+    return count;
+}
+
+/*
+ * siftDown restores a max heap of rows, by query order, from position `at`.
+ */
+static void siftDown(const TodoIndex *index, const Query *query, uint32_t *heap, size_t length, size_t at) {
+    while (true) {
+        size_t largest = at;
+        size_t left = at * 2 + 1;
+        size_t right = left + 1;
+
+        if (left < length && compareRows(index, query, heap[left], heap[largest]) > 0) {
+            largest = left;
+        }
+
+        if (right < length && compareRows(index, query, heap[right], heap[largest]) > 0) {
+            largest = right;
+        }
+
+        if (largest == at) {
+            return;
+        }
+
+        uint32_t row = heap[at];
+        heap[at] = heap[largest];
+        heap[largest] = row;
+        at = largest;
+    }
+}
+
+/*
+ * selectFirst moves the first `limit` rows of a query into the front of rows,
+ * keeping a max heap of the best ones seen so far, then sorts them.
+ */
+static void selectFirst(const TodoIndex *index, const Query *query, uint32_t *rows, size_t count, size_t limit) {
+    for (size_t i = limit / 2; i > 0; i--) {
+        siftDown(index, query, rows, limit, i - 1);
+    }
+
+    for (size_t i = limit; i < count; i++) {
+        if (compareRows(index, query, rows[i], rows[0]) < 0) {
+            rows[0] = rows[i];
+            siftDown(index, query, rows, limit, 0);
+        }
+    }
+
+    SortContext context = { index: index, query: query };
+    qsort_r(rows, limit, sizeof(uint32_t), compareSortRows, &context);
+}
+
+query_err runQuery(TodoIndex *index, const Query *query, TodoView *outView) {
+    const TodoStore *store = index->store;
+    size_t limit = query->limit > 0 ? query->limit : store->length;
+    query_err err = query_err_ok;
+
+    for (size_t i = 0; i < query->sortKeysCount && err == query_err_ok; i++) {
+        if (query->sortKeys[i].field == query_field_title) {
+            err = buildTitleIndex(index);
+        }
+    }
+
+    size_t candidatesCount = 0;
+    const uint32_t *candidates = err == query_err_ok ? selectCandidates(index, query, &candidatesCount, &err) : NULL;
+    uint32_t *rows = arenaAlloc(index->arena, candidatesCount * sizeof(uint32_t) + 1);
+
+    statsCountAlloc(stats_component_models, candidatesCount * sizeof(uint32_t));
+    if (err != query_err_ok || rows == NULL) {
+        return query_err_alloc_failed;
+    }
+
+    const uint32_t *permutation = NULL;
+    size_t count = 0;
+
+    if (candidates == NULL && query->sortKeysCount == 1) {
+        permutation = sortedPermutation(index, query->sortKeys[0].field, &err);
+
+        if (err != query_err_ok) {
+            return err;
+        }
+    }
+
+    if (permutation != NULL) {
+        count = walkPermutation(index, query, permutation, limit, rows);
+    } else {
+        size_t wanted = query->sortKeysCount > 0 ? candidatesCount : limit;
+
+        /*
+         * Candidates are always in row order, so without sort keys the
+         * first matches are the result.
+         */
+        for (size_t i = 0; i < candidatesCount && count < wanted; i++) {
+            uint32_t row = candidates != NULL ? candidates[i] : (uint32_t)i;
+
+            if (matches(index, query, row)) {
+                rows[count++] = row;
+            }
+        }
+
+        if (query->sortKeysCount > 0 && limit < count) {
+            selectFirst(index, query, rows, count, limit);
+        } else if (query->sortKeysCount > 0) {
+            SortContext context = { index: index, query: query };
+            qsort_r(rows, count, sizeof(uint32_t), compareSortRows, &context);
+        }
+    }
+
+    outView->store = store;
+    outView->rows = rows;
+    outView->length = count < limit ? count : limit;
+    return query_err_ok;
+}
+
+const char *todoViewCell(void *source, size_t row, size_t column, char *scratch, size_t *outSize) {
+    TodoView *view = (TodoView *)source;
+    return todoStoreCell((void *)view->store, view->rows[row], column, scratch, outSize);
+}
@@ -0,0 +1,172 @@
+#ifndef query_h
+#define query_h
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <arena/arena.h>
+#include "store.h"
+
+/*
+ * Most predicates and sort keys a Query holds.
+ */
+#define QUERY_MAX_PREDICATES 8
+#define QUERY_MAX_SORT_KEYS 4
+
+typedef struct TrigramIndex TrigramIndex;
+
+typedef enum {
+    query_err_ok = 0,
+    query_err_invalid_predicate = 1,
+    query_err_invalid_sort = 2,
+    query_err_too_many = 3,
+    query_err_alloc_failed = 4
+} query_err;
+
+/*
+ * Fields of a TODO entry, named after their json keys: `userId`, `id`,
+ * `title` and `completed`.
+ */
+typedef enum {
+    query_field_user_id = 0,
+    query_field_id = 1,
+    query_field_title = 2,
+    query_field_completed = 3,
+    query_field_count = 4
+} query_field;
+
+/*
+ * QueryPredicate keeps the entries whose field equals a value.
+ *
+ * field     - Compared field.
+ * number    - Value of userId and id predicates.
+ * completed - Value of completed predicates.
+ * title     - Value of title predicates, borrowed from the argument.
+ */
+typedef struct {
+    query_field field;
+    int32_t number;
+    bool completed;
+    const char *title;
+} QueryPredicate;
+
+/*
+ * QuerySortKey orders entries by a field. Entries comparing equal on every
+ * key keep the order they were fetched in.
+ */
+typedef struct {
+    query_field field;
+    bool descending;
+} QuerySortKey;
+
+/*
+ * Query is what gets from the store to the table.
+ *
+ * predicates      - Every one of them must match.
+ * predicatesCount - Amount of predicates.
+ * sortKeys        - Order of the result, from the first key to the last one.
+ * sortKeysCount   - Amount of sort keys. Without any, the fetch order is kept.
+ * limit           - Most entries in the result, or 0 for all of them.
+ * search          - Text every title must contain, or NULL.
+ */
+typedef struct {
+    QueryPredicate predicates[QUERY_MAX_PREDICATES];
+    size_t predicatesCount;
+    QuerySortKey sortKeys[QUERY_MAX_SORT_KEYS];
+    size_t sortKeysCount;
+    size_t limit;
+    const char *search;
+} Query;
+
+/*
+ * TodoIndex holds secondary indexes over a TodoStore, built once and shared
+ * by every query run against it.
+ *
+ * store       - Indexed store. It must not change while the index is used.
+ * arena       - Where the indexes are allocated.
+ * users       - Distinct userIDs, ascending.
+ * usersCount  - Amount of distinct userIDs.
+ * userOffsets - Where the posting list of each user starts in userRows,
+ *               with a final entry holding the store length.
+ * userRows    - Rows sorted by userID, then by row. It's the concatenation
+ *               of every user posting list, and the userId permutation.
+ * idRows      - Rows sorted by ID, then by row. Built on first use.
+ * titleRows   - Rows sorted by title, then by row. Built on first use.
+ * titleRanks  - Position of each row title among the distinct titles, so
+ *               titles compare as integers. Built along with titleRows.
+ * trigrams    - Trigram index of the titles, owned by the caller. Without
+ *               it, searches scan every title.
+ */
+typedef struct {
+    const TodoStore *store;
+    Arena *arena;
+    int32_t *users;
+    size_t usersCount;
+    uint32_t *userOffsets;
+    uint32_t *userRows;
+    uint32_t *idRows;
+    uint32_t *titleRows;
+    uint32_t *titleRanks;
+    TrigramIndex *trigrams;
+} TodoIndex;
+
+/*
+ * TodoView is a query result: rows of a store, in order.
+ */
+typedef struct {
+    const TodoStore *store;
+    const uint32_t *rows;
+    size_t length;
+} TodoView;
+
+/*
+ * parseQueryPredicate reads a `field=value` predicate, such as
+ * `completed=false` or `userId=3`.
+ */
+query_err parseQueryPredicate(const char *text, QueryPredicate *outPredicate);
+
+/*
+ * parseQuerySort reads a comma separated list of fields into the query sort
+ * keys, each one descending when prefixed by `-`, such as `title,-id`.
+ */
+query_err parseQuerySort(const char *text, Query *query);
+
+/*
+ * queryIsEmpty tells whether a query would return the store as it is.
+ */
+bool queryIsEmpty(const Query *query);
+
+/*
+ * newTodoIndex builds the posting lists of a store. The other indexes are
+ * built by the first query needing them.
+ *
+ * arena    - Where the index is allocated. It lives as long as the arena.
+ * store    - Store to be indexed.
+ * outIndex - Receives the index.
+ *
+ * Returns a `query_err_alloc_failed` if the index cannot be allocated.
+ */
+query_err newTodoIndex(Arena *arena, const TodoStore *store, TodoIndex **outIndex);
+
+/*
+ * runQuery filters and sorts the indexed store. Candidates come from the
+ * most selective index available: the trigram matches of a search, a userId
+ * posting list, the ID permutation, or the sorted permutation of a single
+ * sort key, which is walked in order and stops as soon as the limit is
+ * reached. Otherwise, matches are sorted, with a bounded heap keeping only
+ * the first `limit` ones when there's a limit.
+ *
+ * index   - Index of the queried store.
+ * query   - Query to be run.
+ * outView - Receives the result, allocated in the index arena.
+ *
+ * Returns a `query_err_alloc_failed` if the result cannot be allocated.
+ */
+query_err runQuery(TodoIndex *index, const Query *query, TodoView *outView);
+
+/*
+ * todoViewCell is the TableCellGetter reading a Table from a TodoView, with
+ * the same columns as todoStoreCell.
+ */
+const char *todoViewCell(void *source, size_t row, size_t column, char *scratch, size_t *outSize);
+
+#endif
@@ -0,0 +1,519 @@
+#include <stdint.h>
+#include <limits.h>
+#include <string.h>
+#include "scanner.h"
+
+/*
+ * Deepest nesting accepted inside skipped values before giving up to json-c.
+ */
+const int SCAN_MAX_DEPTH = 32;
+
+/*
+ * Longest integer literal parsed directly. Anything longer goes to json-c,
+ * which knows how to clamp it.
+ */
+const int SCAN_MAX_DIGITS = 18;
+
+static scan_result skipValue(const char **cursor, const char *end, int depth);
+
+const char *skipJsonSpace(const char *cursor, const char *end) {
+    while (cursor < end && (*cursor == ' ' || *cursor == '\n' || *cursor == '\r' || *cursor == '\t')) {
+        cursor++;
+    }
+    return cursor;
+}
+
+/*
+ * hexValue returns the value of a hex digit, or -1 if it isn't one.
+ */
+static inline int hexValue(char c) {
+    if (c >= '0' && c <= '9') {
+        return c - '0';
+    }
+    if (c >= 'a' && c <= 'f') {
+        return c - 'a' + 10;
+    }
+    if (c >= 'A' && c <= 'F') {
+        return c - 'A' + 10;
+    }
+    return -1;
+}
+
+/*
+ * readHex4 reads the 4 hex digits of a `\u` escape.
+ */
+static inline bool readHex4(const char *digits, const char *end, uint32_t *outValue) {
+    if (end - digits < 4) {
+        return false;
+    }
+
+    uint32_t value = 0;
+
+    for (int i = 0; i < 4; i++) {
+        int digit = hexValue(digits[i]);
+
+        if (digit < 0) {
+            return false;
+        }
+
+        value = (value << 4) | (uint32_t)digit;
+    }
+
+    *outValue = value;
+    return true;
+}
+
+/*
+ * scanString validates a string and moves the cursor past its closing quote.
+ *
+ * cursor     - Points to the opening quote.
+ * outContent - Receives the position right after the opening quote.
+ * outSize    - Receives the raw size of the contents.
+ * outEscaped - Receives whether the contents hold any escape.
+ */
+static scan_result scanString(const char **cursor, const char *end, const char **outContent, size_t *outSize,
+                              bool *outEscaped) {
+    const char *start = *cursor + 1;
+    const char *c = start;
+    bool escaped = false;
+
+    while (c < end) {
+        unsigned char byte = (unsigned char)*c;
+
+        if (byte == '"') {
+            *outContent = start;
+            *outSize = (size_t)(c - start);
+            *outEscaped = escaped;
+            *cursor = c + 1;
+            return scan_result_ok;
+        }
+
+        if (byte < 0x20) {
+            return scan_result_fallback;
+        }
+
+        if (byte != '\\') {
+            c++;
+            continue;
+        }
+
+        escaped = true;
+
+        if (c + 1 >= end) {
+            return scan_result_fallback;
+        }
+
+        char kind = c[1];
+
+        if (kind != 'u') {
+            if (strchr("\"\\/bfnrt", kind) == NULL || kind == '\0') {
+                return scan_result_fallback;
+            }
+            c += 2;
+            continue;
+        }
+
+        uint32_t unit;
+
+        if (!readHex4(c + 2, end, &unit) || unit == 0 || (unit >= 0xDC00 && unit <= 0xDFFF)) {
+            return scan_result_fallback;
+        }
+
+        c += 6;
+
+        if (unit >= 0xD800 && unit <= 0xDBFF) {
+            uint32_t low;
+
+            if (end - c < 2 || c[0] != '\\' || c[1] != 'u' || !readHex4(c + 2, end, &low) ||
+                low < 0xDC00 || low > 0xDFFF) {
+                return scan_result_fallback;
+            }
+            c += 6;
+        }
+    }
+
+    return scan_result_fallback;
+}
+
+/*
+ * scanInt reads an integer value the same way json-c would hand it to
+ * `json_object_get_int`.
+ */
+static scan_result scanInt(const char **cursor, const char *end, int *outValue) {
+    const char *c = *cursor;
+    bool negative = false;
+
+    if (c < end && *c == '-') {
+        negative = true;
+        c++;
+    }
+
+    const char *digits = c;
+    int64_t value = 0;
+
+    while (c < end && *c >= '0' && *c <= '9') {
+        value = value * 10 + (*c - '0');
+        c++;
+    }
+
+    int count = (int)(c - digits);
+
+    if (count == 0 || count > SCAN_MAX_DIGITS || (count > 1 && *digits == '0')) {
+        return scan_result_fallback;
+    }
+
+    if (c < end && (*c == '.' || *c == 'e' || *c == 'E')) {
+        return scan_result_fallback;
+    }
+
+    value = negative ? -value : value;
+
+    if (value > INT_MAX) {
+        value = INT_MAX;
+    } else if (value < INT_MIN) {
+        value = INT_MIN;
+    }
+
+    *outValue = (int)value;
+    *cursor = c;
+    return scan_result_ok;
+}
+
+/*
+ * scanLiteral moves the cursor past `literal` if it's there.
+ */
+static inline bool scanLiteral(const char **cursor, const char *end, const char *literal, size_t size) {
+    if ((size_t)(end - *cursor) < size || memcmp(*cursor, literal, size) != 0) {
+        return false;
+    }
+
+    *cursor += size;
+    return true;
+}
+
+/*
+ * skipNumber validates any json number and moves the cursor past it.
+ */
+static scan_result skipNumber(const char **cursor, const char *end) {
+    const char *c = *cursor;
+
+    if (c < end && *c == '-') {
+        c++;
+    }
+
+    const char *digits = c;
+
+    while (c < end && *c >= '0' && *c <= '9') {
+        c++;
+    }
+
+    if (c == digits) {
+        return scan_result_fallback;
+    }
+
+    if (c < end && *c == '.') {
+        const char *fraction = ++c;
+
+        while (c < end && *c >= '0' && *c <= '9') {
+            c++;
+        }
+
+        if (c == fraction) {
+            return scan_result_fallback;
+        }
+    }
+
+    if (c < end && (*c == 'e' || *c == 'E')) {
+        c++;
+
+        if (c < end && (*c == '+' || *c == '-')) {
+            c++;
+        }
+
+        const char *exponent = c;
+
+        while (c < end && *c >= '0' && *c <= '9') {
+            c++;
+        }
+
+        if (c == exponent) {
+            return scan_result_fallback;
+        }
+    }
+
+    *cursor = c;
+    return scan_result_ok;
+}
+
+/*
+ * skipContainer validates an object or array and moves the cursor past it.
+ */
+static scan_result skipContainer(const char **cursor, const char *end, int depth) {
+    bool isObject = **cursor == '{';
+    char close = isObject ? '}' : ']';
+    const char *c = skipJsonSpace(*cursor + 1, end);
+
+    if (c < end && *c == close) {
+        *cursor = c + 1;
+        return scan_result_ok;
+    }
+
+    while (c < end) {
+        if (isObject) {
+            const char *content;
+            size_t size;
+            bool escaped;
+
+            if (*c != '"' || scanString(&c, end, &content, &size, &escaped) != scan_result_ok) {
+                return scan_result_fallback;
+            }
+
+            c = skipJsonSpace(c, end);
+
+            if (c >= end || *c != ':') {
+                return scan_result_fallback;
+            }
+
+            c = skipJsonSpace(c + 1, end);
+        }
+
+        if (skipValue(&c, end, depth + 1) != scan_result_ok) {
+            return scan_result_fallback;
+        }
+
+        c = skipJsonSpace(c, end);
+
+        if (c >= end) {
+            return scan_result_fallback;
+        }
+
+        if (*c == close) {
+            *cursor = c + 1;
+            return scan_result_ok;
+        }
+
+        if (*c != ',') {
+            return scan_result_fallback;
+        }
+
+        c = skipJsonSpace(c + 1, end);
+    }
+
+    return scan_result_fallback;
+}
+
+/*
+ * skipValue validates any json value and moves the cursor past it.
+ */
+static scan_result skipValue(const char **cursor, const char *end, int depth) {
+    if (*cursor >= end || depth > SCAN_MAX_DEPTH) {
+        return scan_result_fallback;
+    }
+
+    const char *content;
+    size_t size;
+    bool escaped;
+
+    switch (**cursor) {
+        case '"': return scanString(cursor, end, &content, &size, &escaped);
+        case '{':
+        case '[': return skipContainer(cursor, end, depth);
+        case 't': return scanLiteral(cursor, end, "true", 4) ? scan_result_ok : scan_result_fallback;
+        case 'f': return scanLiteral(cursor, end, "false", 5) ? scan_result_ok : scan_result_fallback;
+        case 'n': return scanLiteral(cursor, end, "null", 4) ? scan_result_ok : scan_result_fallback;
+        default: return skipNumber(cursor, end);
+    }
+}
+
+/*
+ * keyIs compares a raw, unescaped key against a known one.
+ */
+static inline bool keyIs(const char *key, size_t keySize, const char *known, size_t knownSize) {
+    return keySize == knownSize && memcmp(key, known, knownSize) == 0;
+}
+
+scan_result scanTODOObject(const char **cursor, const char *end, TODOEntry *todo) {
+    const char *c = *cursor;
+
+    if (c >= end || *c != '{') {
+        return scan_result_fallback;
+    }
+
+    todo->userID = 0;
+    todo->ID = 0;
+    todo->title = "";
+    todo->completed = false;
+    c = skipJsonSpace(c + 1, end);
+
+    if (c < end && *c == '}') {
+        *cursor = c + 1;
+        return scan_result_ok;
+    }
+
+    while (c < end) {
+        const char *key;
+        size_t keySize;
+        bool escaped;
+
+        if (*c != '"' || scanString(&c, end, &key, &keySize, &escaped) != scan_result_ok || escaped) {
+            return scan_result_fallback;
+        }
+
+        c = skipJsonSpace(c, end);
+
+        if (c >= end || *c != ':') {
+            return scan_result_fallback;
+        }
+
+        c = skipJsonSpace(c + 1, end);
+
+        if (c >= end) {
+            return scan_result_fallback;
+        }
+
+        scan_result result;
+
+        if (keyIs(key, keySize, "userId", 6)) {
+            result = scanInt(&c, end, &todo->userID);
+        } else if (keyIs(key, keySize, "id", 2)) {
+            result = scanInt(&c, end, &todo->ID);
+        } else if (keyIs(key, keySize, "title", 5)) {
+            const char *title;
+            size_t titleSize;
+
+            result = *c == '"' ? scanString(&c, end, &title, &titleSize, &escaped) : scan_result_fallback;
+            if (result == scan_result_ok) {
+                todo->title = title;
+            }
+        } else if (keyIs(key, keySize, "completed", 9)) {
+            if (scanLiteral(&c, end, "true", 4)) {
+                todo->completed = true;
+                result = scan_result_ok;
+            } else if (scanLiteral(&c, end, "false", 5)) {
+                todo->completed = false;
+                result = scan_result_ok;
+            } else {
+                result = scan_result_fallback;
+            }
+        } else {
+            result = skipValue(&c, end, 1);
+        }
+
+        if (result != scan_result_ok) {
+            return scan_result_fallback;
+        }
+
+        c = skipJsonSpace(c, end);
+
+        if (c >= end) {
+            return scan_result_fallback;
+        }
+
+        if (*c == '}') {
+            *cursor = c + 1;
+            return scan_result_ok;
+        }
+
+        if (*c != ',') {
+            return scan_result_fallback;
+        }
+
+        c = skipJsonSpace(c + 1, end);
+    }
+
+    return scan_result_fallback;
+}
+
+/*
+ * writeUTF8 encodes a code point, returning how many bytes were written.
+ */
+static inline size_t writeUTF8(char *out, uint32_t codePoint) {
+    if (codePoint < 0x80) {
+        out[0] = (char)codePoint;
+        return 1;
+    }
+    if (codePoint < 0x800) {
+        out[0] = (char)(0xC0 | (codePoint >> 6));
+        out[1] = (char)(0x80 | (codePoint & 0x3F));
+        return 2;
+    }
+    if (codePoint < 0x10000) {
+        out[0] = (char)(0xE0 | (codePoint >> 12));
+        out[1] = (char)(0x80 | ((codePoint >> 6) & 0x3F));
+        out[2] = (char)(0x80 | (codePoint & 0x3F));
+        return 3;
+    }
+    out[0] = (char)(0xF0 | (codePoint >> 18));
+    out[1] = (char)(0x80 | ((codePoint >> 12) & 0x3F));
+    out[2] = (char)(0x80 | ((codePoint >> 6) & 0x3F));
+    out[3] = (char)(0x80 | (codePoint & 0x3F));
+    return 4;
+}
+
+size_t rawTODOTitleSize(const TODOEntry *todo) {
+    const char *read = todo->title;
+
+    if (read[0] == '\0') {
+        return 0;
+    }
+
+    while (*read != '"') {
+        read += *read == '\\' ? 2 : 1;
+    }
+
+    return (size_t)(read - todo->title);
+}
+
+void decodeTODOTitle(TODOEntry *todo) {
+    decodeTODOTitleTo(todo, (char *)todo->title);
+}
+
+void decodeTODOTitleTo(const TODOEntry *todo, char *out) {
+    const char *read = todo->title;
+    char *write = out;
+
+    if (read[0] == '\0') {
+        *write = '\0';
+        return;
+    }
+
+    while (*read != '"') {
+        if (*read != '\\') {
+            *write++ = *read++;
+            continue;
+        }
+
+        char kind = read[1];
+        read += 2;
+
+        switch (kind) {
+            case 'b': *write++ = '\b'; break;
+            case 'f': *write++ = '\f'; break;
+            case 'n': *write++ = '\n'; break;
+            case 'r': *write++ = '\r'; break;
+            case 't': *write++ = '\t'; break;
+            case 'u': {
+                /*
+                 * scanTODOObject validated every escape, so the digits
+                 * always read. The fallbacks only keep the values defined.
+                 */
+                uint32_t codePoint = 0xFFFD;
+                readHex4(read, read + 4, &codePoint);
+                read += 4;
+
+                if (codePoint >= 0xD800 && codePoint <= 0xDBFF) {
+                    uint32_t low = 0xDC00;
+                    readHex4(read + 2, read + 6, &low);
+                    read += 6;
+                    codePoint = 0x10000 + ((codePoint - 0xD800) << 10) + (low - 0xDC00);
+                }
+
+                write += writeUTF8(write, codePoint);
+                break;
+            }
+            default: *write++ = kind; break;
+        }
+    }
+
+    *write = '\0';
+}
@@ -0,0 +1,59 @@
+#ifndef scanner_h
+#define scanner_h
+#include <stdlib.h>
+#include <stdbool.h>
+#include "models.h"
+
+typedef enum {
+    scan_result_ok = 0,
+    scan_result_fallback = 1
+} scan_result;
+
+/*
+ * scanTODOObject reads a TODO object straight from raw json bytes, without
+ * building any json-c object. Only the schema we expect (`userId`, `id`,
+ * `title` and `completed`, plus any other key which is skipped) is handled.
+ *
+ * cursor - Points to the `{` of the object. On success, it's moved past the
+ *          closing `}`.
+ * end    - End of the json bytes.
+ * todo   - Where the fields are written. The title is left pointing at the
+ *          raw, still escaped, string contents inside the json bytes and
+ *          must go through decodeTODOTitle before being used.
+ *
+ * Nothing is written to the json bytes, so the caller can still hand them
+ * to json-c. Returns a `scan_result_fallback` for anything unexpected:
+ * invalid json, other value types for known keys, numbers json-c wouldn't
+ * read as an int, or escapes which don't decode cleanly.
+ */
+scan_result scanTODOObject(const char **cursor, const char *end, TODOEntry *todo);
+
+/*
+ * decodeTODOTitle unescapes, in place, a title left raw by scanTODOObject and
+ * NUL terminates it where its closing quote was. The decoded title is never
+ * longer than the raw one, so it always fits.
+ *
+ * todo - Entry returned by scanTODOObject.
+ */
+void decodeTODOTitle(TODOEntry *todo);
+
+/*
+ * decodeTODOTitleTo does the same as decodeTODOTitle, writing the decoded
+ * title to out instead, so the json bytes are left untouched.
+ *
+ * out - Receives the title, and must hold rawTODOTitleSize plus its NUL.
+ */
+void decodeTODOTitleTo(const TODOEntry *todo, char *out);
+
+/*
+ * rawTODOTitleSize returns the size of a title left raw by scanTODOObject,
+ * up to its closing quote.
+ */
+size_t rawTODOTitleSize(const TODOEntry *todo);
+
+/*
+ * skipJsonSpace returns the first non whitespace position from cursor.
+ */
+const char *skipJsonSpace(const char *cursor, const char *end);
+
+#endif
@@ -0,0 +1,415 @@
+#define _GNU_SOURCE
+#include <string.h>
+#include <errno.h>
+#include <poll.h>
+#include <time.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/sendfile.h>
+#include <sys/un.h>
+#include <stats/stats.h>
+#include "serve.h"
+
+/*
+ * ServeCacheEntry is a rendered response.
+ *
+ * key     - Key of the request it answers. NULL marks an unused entry.
+ * keySize - Size of key.
+ * byBytes - Whether key holds the bytes of the request rather than the
+ *           key the handlers gave it, so the two never match.
+ * fd      - Memory file holding the response.
+ * size    - Size of the response.
+ * status  - What the renderer returned.
+ */
+typedef struct {
+    char *key;
+    size_t keySize;
+    bool byBytes;
+    int fd;
+    size_t size;
+    int status;
+} ServeCacheEntry;
+
+/*
+ * ServeState is shared between the serving and the refresh threads. Only
+ * pending is touched by both, under lock.
+ *
+ * handlers - What's served.
+ * lock     - Guards pending.
+ * pending  - Dataset fetched by the refresh thread, not taken yet.
+ * wakeFds  - Pipe the refresh thread writes to when pending is set.
+ * dataset  - Dataset being served.
+ * entries  - Responses rendered from dataset.
+ * next     - Entry replaced by the next response.
+ */
+typedef struct {
+    const ServeHandlers *handlers;
+    pthread_mutex_t lock;
+    void *pending;
+    int wakeFds[2];
+    void *dataset;
+    ServeCacheEntry entries[SERVE_CACHE_ENTRIES];
+    size_t next;
+} ServeState;
+
+static void clearEntry(ServeCacheEntry *entry) {
+    if (entry->fd >= 0) {
+        close(entry->fd);
+    }
+
+    free(entry->key);
+    *entry = (ServeCacheEntry){ key: NULL, keySize: 0, byBytes: false, fd: -1, size: 0, status: 0 };
+}
+
+/*
+ * refreshLoop fetches the dataset on every interval and leaves it pending,
+ * replacing one the serving thread didn't take yet.
+ */
+static void *refreshLoop(void *context) {
+    ServeState *state = (ServeState *)context;
+    const ServeHandlers *handlers = state->handlers;
+
+    for (;;) {
+        struct timespec interval = { tv_sec: handlers->refreshInterval / 1000,
+                                     tv_nsec: (handlers->refreshInterval % 1000) * 1000000 };
+
+        while (nanosleep(&interval, &interval) != 0 && errno == EINTR) {
+        }
+
+        void *dataset = handlers->load(handlers->context);
+
+        if (dataset == NULL) {
+            continue;
+        }
+
+        pthread_mutex_lock(&state->lock);
+        void *replaced = state->pending;
+        state->pending = dataset;
+        pthread_mutex_unlock(&state->lock);
+
+        if (replaced != NULL) {
+            handlers->release(replaced, handlers->context);
+        }
+
+        while (write(state->wakeFds[1], "", 1) < 0 && errno == EINTR) {
+        }
+    }
+
+    return NULL;
+}
+
+/*
+ * takePending swaps the served dataset for the pending one, if any, and
+ * drops every response of the old one.
+ */
+static void takePending(ServeState *state) {
+    char drained[64];
+
+    while (read(state->wakeFds[0], drained, sizeof(drained)) > 0) {
+    }
+
+    pthread_mutex_lock(&state->lock);
+    void *dataset = state->pending;
+    state->pending = NULL;
+    pthread_mutex_unlock(&state->lock);
+
+    if (dataset == NULL) {
+        return;
+    }
+
+    for (size_t i = 0; i < SERVE_CACHE_ENTRIES; i++) {
+        clearEntry(&state->entries[i]);
+    }
+
+    state->handlers->release(state->dataset, state->handlers->context);
+    state->dataset = dataset;
+    state->next = 0;
+}
+
+/*
+ * readRequest reads a whole request, until the client shuts its side down.
+ *
+ * Returns false when it's cut, too large or not NUL terminated.
+ */
+static bool readRequest(int client, char *request, size_t *outSize) {
+    size_t size = 0;
+
+    for (;;) {
+        ssize_t received = recv(client, request + size, SERVE_REQUEST_SIZE - size, 0);
+
+        if (received < 0 && errno == EINTR) {
+            continue;
+        }
+
+        if (received < 0 || (received > 0 && size + (size_t)received == SERVE_REQUEST_SIZE)) {
+            return false;
+        }
+
+        if (received == 0) {
+            break;
+        }
+
+        size += (size_t)received;
+    }
+
+    *outSize = size;
+    return size == 0 || request[size - 1] == '\0';
+}
+
+/*
+ * renderEntry renders the response to a request into a memory file held by
+ * the next cache entry, kept under key.
+ */
+static ServeCacheEntry *renderEntry(ServeState *state, int argc, char **argv, const char *key, size_t size,
+                                    bool byBytes) {
+    ServeCacheEntry *entry = &state->entries[state->next];
+
+    clearEntry(entry);
+    entry->key = malloc(size + 1);
+    statsCountAlloc(stats_component_models, size + 1);
+
+    if (entry->key == NULL) {
+        return NULL;
+    }
+
+    entry->fd = memfd_create("response", MFD_CLOEXEC);
+    int written = entry->fd >= 0 ? dup(entry->fd) : -1;
+    FILE *output = written >= 0 ? fdopen(written, "w") : NULL;
+
+    if (output == NULL) {
+        if (written >= 0) {
+            close(written);
+        }
+        clearEntry(entry);
+        return NULL;
+    }
+
+    memcpy(entry->key, key, size);
+    entry->keySize = size;
+    entry->byBytes = byBytes;
+    entry->status = state->handlers->render(state->dataset, argc, argv, output, state->handlers->context);
+
+    bool flushed = fflush(output) == 0 && !ferror(output);
+    off_t end = lseek(entry->fd, 0, SEEK_END);
+    fclose(output);
+
+    if (!flushed || end < 0) {
+        clearEntry(entry);
+        return NULL;
+    }
+
+    entry->size = (size_t)end;
+    state->next = (state->next + 1) % SERVE_CACHE_ENTRIES;
+    return entry;
+}
+
+/*
+ * answerClient sends the response to a request, rendering it first when
+ * it's not cached.
+ */
+static void answerClient(ServeState *state, int client) {
+    static char request[SERVE_REQUEST_SIZE];
+    static char key[SERVE_REQUEST_SIZE];
+    static char *argv[SERVE_REQUEST_SIZE / 2 + 1];
+    const ServeHandlers *handlers = state->handlers;
+    struct timeval timeout = { tv_sec: SERVE_CLIENT_TIMEOUT, tv_usec: 0 };
+    size_t size;
+    int argc = 0;
+
+    setsockopt(client, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    setsockopt(client, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+
+    if (!readRequest(client, request, &size)) {
+        return;
+    }
+
+    for (size_t offset = 0; offset < size; offset += strlen(request + offset) + 1) {
+        argv[argc++] = request + offset;
+    }
+    argv[argc] = NULL;
+
+    size_t keySize = handlers->key != NULL ? handlers->key(argc, argv, key, sizeof(key), handlers->context) : 0;
+    bool byBytes = keySize == 0 || keySize > sizeof(key);
+    const char *requestKey = byBytes ? request : key;
+    ServeCacheEntry *entry = NULL;
+
+    keySize = byBytes ? size : keySize;
+    for (size_t i = 0; i < SERVE_CACHE_ENTRIES && entry == NULL; i++) {
+        ServeCacheEntry *candidate = &state->entries[i];
+
+        if (candidate->key != NULL && candidate->byBytes == byBytes && candidate->keySize == keySize &&
+            memcmp(candidate->key, requestKey, keySize) == 0) {
+            entry = candidate;
+        }
+    }
+
+    if (entry == NULL) {
+        entry = renderEntry(state, argc, argv, requestKey, keySize, byBytes);
+    }
+
+    char status = entry != NULL ? (char)entry->status : 1;
+    off_t offset = 0;
+
+    if (send(client, &status, 1, MSG_NOSIGNAL | (entry != NULL ? MSG_MORE : 0)) != 1 || entry == NULL) {
+        return;
+    }
+
+    while ((size_t)offset < entry->size) {
+        ssize_t sent = sendfile(client, entry->fd, &offset, entry->size - (size_t)offset);
+
+        if (sent < 0 && errno == EINTR) {
+            continue;
+        }
+
+        if (sent <= 0) {
+            return;
+        }
+    }
+}
+
+/*
+ * bindUnixSocket listens on path, replacing whatever is there.
+ */
+static int bindUnixSocket(const char *path) {
+    struct sockaddr_un address = { sun_family: AF_UNIX };
+
+    if (strlen(path) >= sizeof(address.sun_path)) {
+        return -1;
+    }
+
+    strcpy(address.sun_path, path);
+    unlink(path);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+
+    if (fd < 0) {
+        return -1;
+    }
+
+    if (bind(fd, (struct sockaddr *)&address, sizeof(address)) != 0 || listen(fd, SOMAXCONN) != 0) {
+        close(fd);
+        return -1;
+    }
+
+    return fd;
+}
+
+serve_err serveUnixSocket(const char *path, const ServeHandlers *handlers) {
+    static ServeState state;
+    pthread_t refresher;
+
+    state = (ServeState){ handlers: handlers, pending: NULL, dataset: NULL, next: 0 };
+    for (size_t i = 0; i < SERVE_CACHE_ENTRIES; i++) {
+        state.entries[i] = (ServeCacheEntry){ key: NULL, keySize: 0, byBytes: false, fd: -1, size: 0, status: 0 };
+    }
+
+    state.dataset = handlers->load(handlers->context);
+
+    if (state.dataset == NULL) {
+        return serve_err_load_failed;
+    }
+
+    int listener = bindUnixSocket(path);
+
+    if (listener < 0 || pipe2(state.wakeFds, O_CLOEXEC | O_NONBLOCK) != 0) {
+        if (listener >= 0) {
+            close(listener);
+        }
+        handlers->release(state.dataset, handlers->context);
+        return serve_err_socket_failed;
+    }
+
+    /*
+     * Clients leaving early must not kill the daemon.
+     */
+    signal(SIGPIPE, SIG_IGN);
+    pthread_mutex_init(&state.lock, NULL);
+
+    if (pthread_create(&refresher, NULL, refreshLoop, &state) != 0) {
+        close(listener);
+        handlers->release(state.dataset, handlers->context);
+        return serve_err_thread_failed;
+    }
+
+    struct pollfd fds[2] = { { fd: listener, events: POLLIN }, { fd: state.wakeFds[0], events: POLLIN } };
+
+    for (;;) {
+        if (poll(fds, 2, -1) < 0) {
+            continue;
+        }
+
+        if (fds[1].revents & POLLIN) {
+            takePending(&state);
+        }
+
+        if (fds[0].revents & POLLIN) {
+            int client = accept4(listener, NULL, NULL, SOCK_CLOEXEC);
+
+            if (client >= 0) {
+                answerClient(&state, client);
+                close(client);
+            }
+        }
+    }
+}
+
+serve_err requestUnixSocket(const char *path, int argc, char **argv, int output, int *outStatus) {
+    struct sockaddr_un address = { sun_family: AF_UNIX };
+
+    if (strlen(path) >= sizeof(address.sun_path)) {
+        return serve_err_connect_failed;
+    }
+
+    strcpy(address.sun_path, path);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+
+    if (fd < 0 || connect(fd, (struct sockaddr *)&address, sizeof(address)) != 0) {
+        if (fd >= 0) {
+            close(fd);
+        }
+        return serve_err_connect_failed;
+    }
+
+    bool ok = true;
+
+    for (int i = 0; i < argc && ok; i++) {
+        size_t size = strlen(argv[i]) + 1;
+        ok = send(fd, argv[i], size, MSG_NOSIGNAL) == (ssize_t)size;
+    }
+
+    ok = ok && shutdown(fd, SHUT_WR) == 0;
+
+    char status = 0;
+    char buffer[1 << 16];
+    ok = ok && recv(fd, &status, 1, MSG_WAITALL) == 1;
+
+    while (ok) {
+        ssize_t received = recv(fd, buffer, sizeof(buffer), 0);
+
+        if (received < 0 && errno == EINTR) {
+            continue;
+        }
+
+        if (received <= 0) {
+            ok = received == 0;
+            break;
+        }
+
+        for (ssize_t written = 0; ok && written < received;) {
+            ssize_t size = write(output, buffer + written, (size_t)(received - written));
+            ok = size > 0;
+            written += size;
+        }
+    }
+
+    close(fd);
+    *outStatus = status;
+    return ok ? serve_err_ok : serve_err_transfer_failed;
+}
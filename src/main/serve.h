@@ -0,0 +1,133 @@
+#ifndef serve_h
+#define serve_h
+#include <stdio.h>
+#include <stdlib.h>
+
+typedef enum {
+    serve_err_ok = 0,
+    serve_err_socket_failed = 1,
+    serve_err_load_failed = 2,
+    serve_err_thread_failed = 3,
+    serve_err_connect_failed = 4,
+    serve_err_transfer_failed = 5
+} serve_err;
+
+/*
+ * Amount of rendered responses kept per dataset. Past it, the oldest one
+ * is dropped.
+ */
+#define SERVE_CACHE_ENTRIES 64
+
+/*
+ * Largest request accepted, arguments included.
+ */
+#define SERVE_REQUEST_SIZE ((size_t)1 << 16)
+
+/*
+ * Seconds a client may take to send its request or receive its response
+ * before it's dropped, so a stuck one can't hold the others.
+ */
+#define SERVE_CLIENT_TIMEOUT 5
+
+/*
+ * ServeLoader fetches a fresh dataset.
+ *
+ * Must return NULL when it cannot, in which case the current dataset is
+ * kept. It's never called concurrently, but it's called from the refresh
+ * thread.
+ */
+typedef void *(*ServeLoader)(void *context);
+
+/*
+ * ServeRelease frees a dataset returned by the ServeLoader.
+ */
+typedef void (*ServeRelease)(void *dataset, void *context);
+
+/*
+ * ServeRenderer writes the response to a request.
+ *
+ * dataset - The current dataset.
+ * argc    - Amount of arguments of the request.
+ * argv    - Arguments of the request, without any program name.
+ * output  - Receives the response.
+ * context - The ServeHandlers context.
+ *
+ * Must return 0 on success or the exit status the client should return.
+ */
+typedef int (*ServeRenderer)(void *dataset, int argc, char **argv, FILE *output, void *context);
+
+/*
+ * ServeKeyer writes the key a response is cached under, which must be the
+ * same for every request getting the same response.
+ *
+ * argc    - Amount of arguments of the request.
+ * argv    - Arguments of the request, without any program name.
+ * key     - Receives the key.
+ * size    - Size of key.
+ * context - The ServeHandlers context.
+ *
+ * Must return the size of the key, or 0 for the request to be keyed by its
+ * bytes. A key longer than size is ignored the same way.
+ */
+typedef size_t (*ServeKeyer)(int argc, char **argv, char *key, size_t size, void *context);
+
+/*
+ * ServeHandlers is what a served socket does with its dataset.
+ *
+ * load            - Fetches the dataset, once before serving and then on
+ *                   every refresh.
+ * release         - Frees a dataset once it's replaced.
+ * render          - Renders the response to a request.
+ * key             - Keys the response to a request, or NULL to key it by
+ *                   its bytes.
+ * context         - Passed untouched to each handler.
+ * refreshInterval - Milliseconds between fetches of the dataset.
+ */
+typedef struct {
+    ServeLoader load;
+    ServeRelease release;
+    ServeRenderer render;
+    ServeKeyer key;
+    void *context;
+    size_t refreshInterval;
+} ServeHandlers;
+
+/*
+ * serveUnixSocket answers requests on a unix socket from a dataset kept in
+ * memory, until the process is killed.
+ *
+ * A refresh thread fetches the dataset again on every interval and hands
+ * it over to the serving thread, which drops the responses of the old one.
+ * Responses are rendered once per dataset and kept, under the key of the
+ * request, in memory files which are handed to the socket with sendfile,
+ * so a repeated request copies nothing in user space.
+ *
+ * Each client sends its arguments, each one NUL terminated, and shuts its
+ * side down. It then receives the renderer status as one byte followed by
+ * the response.
+ *
+ * path     - Where the socket is bound. Anything already there is replaced.
+ * handlers - What's served.
+ *
+ * Returns a `serve_err_load_failed` if the first dataset cannot be
+ * fetched, a `serve_err_socket_failed` if the socket cannot be bound or a
+ * `serve_err_thread_failed` if the refresh thread cannot be started.
+ */
+serve_err serveUnixSocket(const char *path, const ServeHandlers *handlers);
+
+/*
+ * requestUnixSocket sends a request to a socket served by serveUnixSocket
+ * and copies the response to a file descriptor.
+ *
+ * path      - Where the socket is.
+ * argc      - Amount of arguments of the request.
+ * argv      - Arguments of the request, without any program name.
+ * output    - File descriptor receiving the response.
+ * outStatus - Receives the status the renderer returned.
+ *
+ * Returns a `serve_err_connect_failed` if nothing answers at path, or a
+ * `serve_err_transfer_failed` if the request or the response is cut.
+ */
+serve_err requestUnixSocket(const char *path, int argc, char **argv, int output, int *outStatus);
+
+#endif
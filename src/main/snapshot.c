@@ -0,0 +1,237 @@
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "snapshot.h"
+
+static const char SNAPSHOT_MAGIC[8] = { 'T', 'O', 'D', 'O', 'S', 'N', 'A', 'P' };
+
+/*
+ * SnapshotHeader starts every snapshot file. The checksum covers every byte
+ * after it.
+ */
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t headerSize;
+    uint64_t sourceKey;
+    uint64_t length;
+    uint64_t titlesSize;
+    uint64_t checksum;
+} SnapshotHeader;
+
+/*
+ * SnapshotLayout holds where each section starts in a snapshot file.
+ */
+typedef struct {
+    size_t userIDs;
+    size_t IDs;
+    size_t titleOffsets;
+    size_t titleLengths;
+    size_t completed;
+    size_t titles;
+    size_t size;
+} SnapshotLayout;
+
+size_t alignSection(size_t size) {
+    return (size + 7) & ~(size_t)7;
+}
+
+static SnapshotLayout snapshotLayout(size_t length, size_t titlesSize) {
+    SnapshotLayout layout;
+
+    layout.userIDs = sizeof(SnapshotHeader);
+    layout.IDs = layout.userIDs + alignSection(length * sizeof(int32_t));
+    layout.titleOffsets = layout.IDs + alignSection(length * sizeof(int32_t));
+    layout.titleLengths = layout.titleOffsets + alignSection(length * sizeof(uint32_t));
+    layout.completed = layout.titleLengths + alignSection(length * sizeof(uint32_t));
+    layout.titles = layout.completed + (length + 63) / 64 * sizeof(uint64_t);
+    layout.size = layout.titles + alignSection(titlesSize);
+    return layout;
+}
+
+uint64_t hashSection(uint64_t hash, const void *data, size_t size) {
+    const unsigned char *bytes = (const unsigned char *)data;
+    size_t i = 0;
+
+    for (; i + 8 <= size; i += 8) {
+        uint64_t word;
+        memcpy(&word, bytes + i, 8);
+        hash = (hash ^ word) * 0x100000001b3ULL;
+        hash ^= hash >> 29;
+    }
+
+    if (i < size) {
+        uint64_t word = 0;
+        memcpy(&word, bytes + i, size - i);
+        hash = (hash ^ word) * 0x100000001b3ULL;
+        hash ^= hash >> 29;
+    }
+
+    return hash;
+}
+
+bool writeSection(FILE *file, const void *data, size_t size) {
+    static const char padding[8] = { 0 };
+    size_t paddingSize = alignSection(size) - size;
+
+    return (size == 0 || fwrite(data, 1, size, file) == size) &&
+           (paddingSize == 0 || fwrite(padding, 1, paddingSize, file) == paddingSize);
+}
+
+snapshot_err writeTodoSnapshot(const TodoStore *store, const char *path, uint64_t sourceKey) {
+    size_t length = store->length;
+    size_t completedSize = (length + 63) / 64 * sizeof(uint64_t);
+    const void *sections[6] = { store->userIDs, store->IDs, store->titleOffsets, store->titleLengths,
+                                store->completed, store->titles };
+    size_t sizes[6] = { length * sizeof(int32_t), length * sizeof(int32_t), length * sizeof(uint32_t),
+                        length * sizeof(uint32_t), completedSize, store->titlesSize };
+    SnapshotHeader header = { magic: { 0 }, version: TODO_SNAPSHOT_VERSION, headerSize: sizeof(SnapshotHeader),
+                              sourceKey: sourceKey, length: length, titlesSize: store->titlesSize,
+                              checksum: SNAPSHOT_CHECKSUM_SEED };
+    char *temporaryPath = malloc(strlen(path) + 8);
+
+    if (temporaryPath == NULL) {
+        return snapshot_err_io_failed;
+    }
+
+    memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC));
+    for (size_t i = 0; i < 6; i++) {
+        header.checksum = hashSection(header.checksum, sections[i], sizes[i]);
+    }
+
+    sprintf(temporaryPath, "%s.XXXXXX", path);
+    int fd = mkstemp(temporaryPath);
+    FILE *file = fd >= 0 ? fdopen(fd, "wb") : NULL;
+    bool ok = file != NULL && fwrite(&header, sizeof(header), 1, file) == 1;
+
+    for (size_t i = 0; ok && i < 6; i++) {
+        ok = writeSection(file, sections[i], sizes[i]);
+    }
+
+    if (file != NULL) {
+        ok = fclose(file) == 0 && ok;
+    } else if (fd >= 0) {
+        close(fd);
+    }
+
+    ok = ok && rename(temporaryPath, path) == 0;
+    if (!ok && fd >= 0) {
+        unlink(temporaryPath);
+    }
+
+    free(temporaryPath);
+    return ok ? snapshot_err_ok : snapshot_err_io_failed;
+}
+
+/*
+ * checkSnapshot validates a mapped file against the expected source.
+ */
+static snapshot_err checkSnapshot(const unsigned char *data, size_t size, uint64_t sourceKey, SnapshotLayout *outLayout) {
+    SnapshotHeader header;
+
+    if (size < sizeof(SnapshotHeader)) {
+        return snapshot_err_corrupt;
+    }
+
+    memcpy(&header, data, sizeof(header));
+    if (memcmp(header.magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC)) != 0) {
+        return snapshot_err_corrupt;
+    }
+
+    if (header.version != TODO_SNAPSHOT_VERSION || header.headerSize != sizeof(SnapshotHeader) ||
+        header.sourceKey != sourceKey) {
+        return snapshot_err_stale;
+    }
+
+    if (header.length > size / 16 || header.titlesSize > size || header.titlesSize > UINT32_MAX) {
+        return snapshot_err_corrupt;
+    }
+
+    SnapshotLayout layout = snapshotLayout(header.length, header.titlesSize);
+
+    if (layout.size != size ||
+        hashSection(SNAPSHOT_CHECKSUM_SEED, data + layout.userIDs, size - layout.userIDs) != header.checksum) {
+        return snapshot_err_corrupt;
+    }
+
+    const uint32_t *titleOffsets = (const uint32_t *)(data + layout.titleOffsets);
+    const uint32_t *titleLengths = (const uint32_t *)(data + layout.titleLengths);
+    const char *titles = (const char *)(data + layout.titles);
+
+    for (size_t i = 0; i < header.length; i++) {
+        if ((uint64_t)titleOffsets[i] + titleLengths[i] >= header.titlesSize ||
+            titles[titleOffsets[i] + titleLengths[i]] != '\0') {
+            return snapshot_err_corrupt;
+        }
+    }
+
+    *outLayout = layout;
+    return snapshot_err_ok;
+}
+
+snapshot_err openTodoSnapshot(Arena *arena, const char *path, uint64_t sourceKey, TodoSnapshot **outSnapshot) {
+    struct stat fileStat;
+    int fd = open(path, O_RDONLY);
+
+    if (fd < 0) {
+        return snapshot_err_io_failed;
+    }
+
+    if (fstat(fd, &fileStat) != 0) {
+        close(fd);
+        return snapshot_err_io_failed;
+    }
+
+    if (fileStat.st_size < (off_t)sizeof(SnapshotHeader)) {
+        close(fd);
+        return snapshot_err_corrupt;
+    }
+
+    size_t size = (size_t)fileStat.st_size;
+    unsigned char *data = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+
+    if (data == MAP_FAILED) {
+        return snapshot_err_io_failed;
+    }
+
+    SnapshotLayout layout;
+    snapshot_err err = checkSnapshot(data, size, sourceKey, &layout);
+    TodoSnapshot *snapshot = err == snapshot_err_ok ? malloc(sizeof(TodoSnapshot)) : NULL;
+
+    if (snapshot == NULL) {
+        munmap(data, size);
+        return err == snapshot_err_ok ? snapshot_err_io_failed : err;
+    }
+
+    SnapshotHeader header;
+    memcpy(&header, data, sizeof(header));
+    memset(&snapshot->store, 0, sizeof(TodoStore));
+    snapshot->data = data;
+    snapshot->size = size;
+    snapshot->store.arena = arena;
+    snapshot->store.length = header.length;
+    snapshot->store.capacity = header.length;
+    snapshot->store.userIDs = (int32_t *)(data + layout.userIDs);
+    snapshot->store.IDs = (int32_t *)(data + layout.IDs);
+    snapshot->store.titleOffsets = (uint32_t *)(data + layout.titleOffsets);
+    snapshot->store.titleLengths = (uint32_t *)(data + layout.titleLengths);
+    snapshot->store.completed = (uint64_t *)(data + layout.completed);
+    snapshot->store.titles = (char *)(data + layout.titles);
+    snapshot->store.titlesSize = header.titlesSize;
+    snapshot->store.titlesCapacity = header.titlesSize;
+    *outSnapshot = snapshot;
+    return snapshot_err_ok;
+}
+
+void closeTodoSnapshot(TodoSnapshot *snapshot) {
+    if (snapshot == NULL) {
+        return;
+    }
+
+    munmap(snapshot->data, snapshot->size);
+    free(snapshot);
+}
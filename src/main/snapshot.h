@@ -0,0 +1,90 @@
+#ifndef snapshot_h
+#define snapshot_h
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <arena/arena.h>
+#include "store.h"
+
+typedef enum {
+    snapshot_err_ok = 0,
+    snapshot_err_io_failed = 1,
+    snapshot_err_corrupt = 2,
+    snapshot_err_stale = 3
+} snapshot_err;
+
+/*
+ * Version of the snapshot layout. Snapshots of any other version are stale.
+ */
+#define TODO_SNAPSHOT_VERSION 1
+
+/*
+ * TodoSnapshot is a TodoStore saved to disk and mapped back, with its columns
+ * pointing straight into the mapping.
+ *
+ * A snapshot file holds a header (magic, version, source key, entries
+ * count, titles size and a checksum of everything after it) followed by the
+ * userIDs, IDs, titleOffsets and titleLengths columns, the completed bitset
+ * and the titles blob, each starting 8 bytes aligned.
+ *
+ * data  - The mapped file.
+ * size  - Size of the mapping.
+ * store - Store reading from the mapping. Appending to it copies the columns
+ *         into its arena first, the mapping is never written.
+ */
+typedef struct {
+    void *data;
+    size_t size;
+    TodoStore store;
+} TodoSnapshot;
+
+/*
+ * writeTodoSnapshot saves a store into path, replacing it atomically.
+ *
+ * store     - Store to be saved.
+ * path      - Snapshot file.
+ * sourceKey - Identifies what the store was built from. openTodoSnapshot
+ *             refuses snapshots of any other source.
+ *
+ * Returns a `snapshot_err_io_failed` if the file cannot be written.
+ */
+snapshot_err writeTodoSnapshot(const TodoStore *store, const char *path, uint64_t sourceKey);
+
+/*
+ * openTodoSnapshot maps a snapshot written by writeTodoSnapshot. Nothing is
+ * parsed or allocated per entry: the file is only checked against its
+ * header, its checksum and the bounds of each title.
+ *
+ * arena       - Arena the snapshot store grows into if it's appended to.
+ * path        - Snapshot file.
+ * sourceKey   - Expected source key.
+ * outSnapshot - Receives the snapshot, released with closeTodoSnapshot.
+ *
+ * Returns a `snapshot_err_io_failed` if the file cannot be read, a
+ * `snapshot_err_stale` if it's from another version or source and a
+ * `snapshot_err_corrupt` if it fails any check.
+ */
+snapshot_err openTodoSnapshot(Arena *arena, const char *path, uint64_t sourceKey, TodoSnapshot **outSnapshot);
+
+/*
+ * Helpers shared by the files written next to a snapshot. Each file is a
+ * header followed by sections starting 8 bytes aligned, covered by a
+ * checksum seeded with SNAPSHOT_CHECKSUM_SEED.
+ *
+ * alignSection - Rounds a section size up to 8 bytes.
+ * hashSection  - Folds a section into a checksum 8 bytes at a time, as if it
+ *                was padded with zeros up to its aligned size.
+ * writeSection - Writes a section, padded with zeros up to its aligned size.
+ */
+#define SNAPSHOT_CHECKSUM_SEED 0xcbf29ce484222325ULL
+
+size_t alignSection(size_t size);
+uint64_t hashSection(uint64_t hash, const void *data, size_t size);
+bool writeSection(FILE *file, const void *data, size_t size);
+
+/*
+ * Releases a snapshot, unmapping its file. Its store cannot be used after.
+ */
+void closeTodoSnapshot(TodoSnapshot *snapshot);
+
+#endif
@@ -0,0 +1,332 @@
+#include <stdio.h>
+#include <string.h>
+#include <stats/stats.h>
+#include "store.h"
+
+/*
+ * Initial length of every column.
+ */
+const size_t STORE_INITIAL_CAPACITY = 256;
+
+/*
+ * Titles blob offsets are 32 bits wide.
+ */
+const size_t STORE_MAX_TITLES_SIZE = UINT32_MAX;
+
+json_err newTodoStore(Arena *arena, bool internTitles, TodoStore **outStore) {
+    TodoStore *store = arenaCalloc(arena, 1, sizeof(TodoStore));
+    statsCountAlloc(stats_component_models, sizeof(TodoStore));
+
+    if (store == NULL) {
+        return json_err_alloc_failed;
+    }
+
+    store->arena = arena;
+    store->internTitles = internTitles;
+    *outStore = store;
+    return json_err_ok;
+}
+
+/*
+ * growColumn doubles a column allocated in the store arena.
+ */
+static json_err growColumn(TodoStore *store, void **column, size_t itemSize, size_t oldLength, size_t newLength) {
+    void *grown = arenaRealloc(store->arena, *column, oldLength * itemSize, newLength * itemSize);
+    statsCountAlloc(stats_component_models, newLength * itemSize);
+
+    if (grown == NULL) {
+        return json_err_alloc_failed;
+    }
+
+    *column = grown;
+    return json_err_ok;
+}
+
+/*
+ * reserveEntries makes sure every column has room for `count` more entries.
+ */
+static json_err reserveEntries(TodoStore *store, size_t count) {
+    if (store->length + count <= store->capacity) {
+        return json_err_ok;
+    }
+
+    size_t capacity = store->capacity > 0 ? store->capacity * 2 : STORE_INITIAL_CAPACITY;
+    size_t oldWords = (store->capacity + 63) / 64;
+
+    while (capacity < store->length + count) {
+        capacity *= 2;
+    }
+
+    size_t newWords = (capacity + 63) / 64;
+
+    if (growColumn(store, (void **)&store->userIDs, sizeof(int32_t), store->capacity, capacity) != json_err_ok ||
+        growColumn(store, (void **)&store->IDs, sizeof(int32_t), store->capacity, capacity) != json_err_ok ||
+        growColumn(store, (void **)&store->titleOffsets, sizeof(uint32_t), store->capacity, capacity) != json_err_ok ||
+        growColumn(store, (void **)&store->titleLengths, sizeof(uint32_t), store->capacity, capacity) != json_err_ok ||
+        growColumn(store, (void **)&store->completed, sizeof(uint64_t), oldWords, newWords) != json_err_ok) {
+        return json_err_alloc_failed;
+    }
+
+    memset(store->completed + oldWords, 0, (newWords - oldWords) * sizeof(uint64_t));
+    store->capacity = capacity;
+    return json_err_ok;
+}
+
+/*
+ * hashTitle is FNV-1a over the title bytes.
+ */
+static inline uint64_t hashTitle(const char *title, size_t size) {
+    uint64_t hash = 0xcbf29ce484222325ULL;
+
+    for (size_t i = 0; i < size; i++) {
+        hash ^= (unsigned char)title[i];
+        hash *= 0x100000001b3ULL;
+    }
+
+    return hash;
+}
+
+/*
+ * growInternSlots doubles the interning table, placing every title again.
+ */
+static json_err growInternSlots(TodoStore *store) {
+    size_t capacity = store->internCapacity > 0 ? store->internCapacity * 2 : STORE_INITIAL_CAPACITY;
+    uint32_t *slots = arenaCalloc(store->arena, capacity, sizeof(uint32_t));
+    statsCountAlloc(stats_component_models, capacity * sizeof(uint32_t));
+
+    if (slots == NULL) {
+        return json_err_alloc_failed;
+    }
+
+    for (size_t i = 0; i < store->internCapacity; i++) {
+        uint32_t slot = store->internSlots[i];
+
+        if (slot == 0) {
+            continue;
+        }
+
+        const char *title = store->titles + slot - 1;
+        size_t index = hashTitle(title, strlen(title)) & (capacity - 1);
+
+        while (slots[index] != 0) {
+            index = (index + 1) & (capacity - 1);
+        }
+
+        slots[index] = slot;
+    }
+
+    store->internSlots = slots;
+    store->internCapacity = capacity;
+    return json_err_ok;
+}
+
+/*
+ * findInterned looks for a title already in the blob. When it's not there,
+ * `outSlot` receives the empty slot where it should be recorded.
+ *
+ * Returns whether the title was found, writing its offset to outOffset.
+ */
+static bool findInterned(TodoStore *store, const char *title, size_t size, uint32_t *outOffset, size_t *outSlot) {
+    size_t index = hashTitle(title, size) & (store->internCapacity - 1);
+
+    while (store->internSlots[index] != 0) {
+        uint32_t offset = store->internSlots[index] - 1;
+        const char *candidate = store->titles + offset;
+
+        if (strncmp(candidate, title, size) == 0 && candidate[size] == '\0') {
+            *outOffset = offset;
+            return true;
+        }
+
+        index = (index + 1) & (store->internCapacity - 1);
+    }
+
+    *outSlot = index;
+    return false;
+}
+
+/*
+ * appendTitle copies a title into the blob, unless it's interned already.
+ */
+static json_err appendTitle(TodoStore *store, const char *title, size_t size, uint32_t *outOffset) {
+    size_t slot = 0;
+
+    if (store->internTitles) {
+        if (store->internCount * 2 >= store->internCapacity && growInternSlots(store) != json_err_ok) {
+            return json_err_alloc_failed;
+        }
+
+        if (findInterned(store, title, size, outOffset, &slot)) {
+            return json_err_ok;
+        }
+    }
+
+    if (store->titlesSize + size + 1 > STORE_MAX_TITLES_SIZE) {
+        return json_err_alloc_failed;
+    }
+
+    if (store->titlesSize + size + 1 > store->titlesCapacity) {
+        size_t capacity = store->titlesCapacity > 0 ? store->titlesCapacity * 2 : STORE_INITIAL_CAPACITY * 32;
+
+        while (capacity < store->titlesSize + size + 1) {
+            capacity *= 2;
+        }
+
+        if (growColumn(store, (void **)&store->titles, 1, store->titlesCapacity, capacity) != json_err_ok) {
+            return json_err_alloc_failed;
+        }
+
+        store->titlesCapacity = capacity;
+    }
+
+    *outOffset = (uint32_t)store->titlesSize;
+    memcpy(store->titles + store->titlesSize, title, size + 1);
+    store->titlesSize += size + 1;
+
+    if (store->internTitles) {
+        store->internSlots[slot] = *outOffset + 1;
+        store->internCount++;
+    }
+
+    return json_err_ok;
+}
+
+json_err todoStoreAppend(TodoStore *store, const TODOEntry *entry) {
+    uint32_t titleOffset;
+    size_t titleSize = strlen(entry->title);
+
+    if (reserveEntries(store, 1) != json_err_ok || appendTitle(store, entry->title, titleSize, &titleOffset) != json_err_ok) {
+        return json_err_alloc_failed;
+    }
+
+    size_t index = store->length++;
+    store->userIDs[index] = entry->userID;
+    store->IDs[index] = entry->ID;
+    store->titleOffsets[index] = titleOffset;
+    store->titleLengths[index] = (uint32_t)titleSize;
+
+    if (entry->completed) {
+        store->completed[index >> 6] |= 1ULL << (index & 63);
+    }
+
+    return json_err_ok;
+}
+
+/*
+ * setCompleted writes the completed flag of a single entry.
+ */
+static inline void setCompleted(TodoStore *store, size_t index, bool completed) {
+    if (completed) {
+        store->completed[index >> 6] |= 1ULL << (index & 63);
+    } else {
+        store->completed[index >> 6] &= ~(1ULL << (index & 63));
+    }
+}
+
+/*
+ * moveEntries moves `count` entries from `from` to `to`, as memmove does,
+ * leaving their titles where they are.
+ */
+static void moveEntries(TodoStore *store, size_t from, size_t to, size_t count) {
+    memmove(store->userIDs + to, store->userIDs + from, count * sizeof(int32_t));
+    memmove(store->IDs + to, store->IDs + from, count * sizeof(int32_t));
+    memmove(store->titleOffsets + to, store->titleOffsets + from, count * sizeof(uint32_t));
+    memmove(store->titleLengths + to, store->titleLengths + from, count * sizeof(uint32_t));
+
+    if (to > from) {
+        for (size_t i = count; i > 0; i--) {
+            setCompleted(store, to + i - 1, todoStoreCompleted(store, from + i - 1));
+        }
+    } else {
+        for (size_t i = 0; i < count; i++) {
+            setCompleted(store, to + i, todoStoreCompleted(store, from + i));
+        }
+    }
+}
+
+json_err todoStoreSplice(TodoStore *store, size_t start, size_t end, const TodoStore *source) {
+    size_t removed = end - start;
+    size_t added = source->length;
+    size_t length = store->length - removed + added;
+
+    if (added > removed && reserveEntries(store, added - removed) != json_err_ok) {
+        return json_err_alloc_failed;
+    }
+
+    if (added != removed) {
+        moveEntries(store, end, start + added, store->length - end);
+    }
+
+    for (size_t i = length; i < store->length; i++) {
+        setCompleted(store, i, false);
+    }
+    store->length = length;
+
+    for (size_t i = 0; i < added; i++) {
+        size_t index = start + i;
+        uint32_t titleSize = source->titleLengths[i];
+        uint32_t titleOffset;
+
+        /*
+         * Entries taking the place of another one reuse its title bytes
+         * when the new title fits, unless they may be shared.
+         */
+        if (i < removed && !store->internTitles && titleSize <= store->titleLengths[index]) {
+            titleOffset = store->titleOffsets[index];
+            memcpy(store->titles + titleOffset, todoStoreTitle(source, i), titleSize + 1);
+        } else if (appendTitle(store, todoStoreTitle(source, i), titleSize, &titleOffset) != json_err_ok) {
+            return json_err_alloc_failed;
+        }
+
+        store->userIDs[index] = source->userIDs[i];
+        store->IDs[index] = source->IDs[i];
+        store->titleOffsets[index] = titleOffset;
+        store->titleLengths[index] = titleSize;
+        setCompleted(store, index, todoStoreCompleted(source, i));
+    }
+
+    return json_err_ok;
+}
+
+void todoStoreGet(const TodoStore *store, size_t index, TODOEntry *outEntry) {
+    outEntry->userID = store->userIDs[index];
+    outEntry->ID = store->IDs[index];
+    outEntry->title = todoStoreTitle(store, index);
+    outEntry->completed = todoStoreCompleted(store, index);
+}
+
+const char *todoStoreCell(void *source, size_t row, size_t column, char *scratch, size_t *outSize) {
+    TodoStore *store = (TodoStore *)source;
+
+    switch (column) {
+        case 0:
+            *outSize = formatTableInteger(store->userIDs[row], scratch);
+            return scratch;
+        case 1:
+            *outSize = formatTableInteger(store->IDs[row], scratch);
+            return scratch;
+        case 2:
+            *outSize = store->titleLengths[row];
+            return todoStoreTitle(store, row);
+        default:
+            *outSize = todoStoreCompleted(store, row) ? 3 : 2;
+            return todoStoreCompleted(store, row) ? "Yes" : "No";
+    }
+}
+
+const char *todoEntryCell(const TODOEntry *entry, size_t column, char *scratch, size_t *outSize) {
+    switch (column) {
+        case 0:
+            *outSize = formatTableInteger(entry->userID, scratch);
+            return scratch;
+        case 1:
+            *outSize = formatTableInteger(entry->ID, scratch);
+            return scratch;
+        case 2:
+            *outSize = strlen(entry->title);
+            return entry->title;
+        default:
+            *outSize = entry->completed ? 3 : 2;
+            return entry->completed ? "Yes" : "No";
+    }
+}
@@ -0,0 +1,109 @@
+#ifndef store_h
+#define store_h
+#include <stdint.h>
+#include <stdbool.h>
+#include <arena/arena.h>
+#include <table/table.h>
+#include "models.h"
+
+/*
+ * TodoStore holds a TODO list column by column instead of as a list of
+ * TODOEntry pointers, so scanning any field walks contiguous memory.
+ *
+ * arena          - Where every column is allocated. Growing a column leaves
+ *                  its old copy in the arena until it's released.
+ * length         - Amount of entries.
+ * capacity       - Allocated length of each column.
+ * userIDs        - userID of each entry.
+ * IDs            - ID of each entry.
+ * completed      - Bitset with the completed flag of each entry.
+ * titleOffsets   - Where each title starts inside titles.
+ * titleLengths   - Length of each title, without its NUL.
+ * titles         - Blob holding every NUL terminated title.
+ * titlesSize     - Bytes used in titles.
+ * titlesCapacity - Allocated size of titles.
+ * internTitles   - Whether repeated titles share a single copy in titles.
+ * internSlots    - Open addressing table of `titleOffsets + 1` used for
+ *                  interning. Zero marks an empty slot.
+ * internCapacity - Amount of slots, always a power of two.
+ * internCount    - Amount of used slots.
+ */
+struct TodoStore {
+    Arena *arena;
+    size_t length;
+    size_t capacity;
+    int32_t *userIDs;
+    int32_t *IDs;
+    uint64_t *completed;
+    uint32_t *titleOffsets;
+    uint32_t *titleLengths;
+    char *titles;
+    size_t titlesSize;
+    size_t titlesCapacity;
+    bool internTitles;
+    uint32_t *internSlots;
+    size_t internCapacity;
+    size_t internCount;
+};
+
+/*
+ * newTodoStore attempts to allocate an empty TodoStore.
+ *
+ * arena        - Where the store and all its columns are allocated.
+ * internTitles - Whether repeated titles should share a single copy.
+ * outStore     - Receives the store, which lives as long as the arena.
+ *
+ * Returns a `json_err_alloc_failed` if the store cannot be allocated.
+ */
+json_err newTodoStore(Arena *arena, bool internTitles, TodoStore **outStore);
+
+/*
+ * todoStoreAppend copies a TODOEntry at the end of the store.
+ *
+ * Returns a `json_err_alloc_failed` if any column cannot grow, or if the
+ * titles would go over 4GiB.
+ */
+json_err todoStoreAppend(TodoStore *store, const TODOEntry *entry);
+
+/*
+ * todoStoreSplice replaces the entries from `start` up to `end` with every
+ * entry of source, in place: the entries after them are only moved when the
+ * amounts differ, and titles replacing one at least as long are written over
+ * it. The bytes of titles no longer used stay in the blob.
+ *
+ * The store columns must be its own, which a snapshot store only holds once
+ * it grew.
+ *
+ * Returns a `json_err_alloc_failed` if any column cannot grow, in which case
+ * the store may hold part of source.
+ */
+json_err todoStoreSplice(TodoStore *store, size_t start, size_t end, const TodoStore *source);
+
+/*
+ * todoStoreGet reads the entry at `index` back as a TODOEntry. Its title
+ * points inside the store.
+ */
+void todoStoreGet(const TodoStore *store, size_t index, TODOEntry *outEntry);
+
+/*
+ * todoStoreCell is the TableCellGetter reading a Table straight from a
+ * TodoStore, with the User ID, ID, Title and Completed? columns. The ids are
+ * formatted into the scratch buffer.
+ */
+const char *todoStoreCell(void *source, size_t row, size_t column, char *scratch, size_t *outSize);
+
+/*
+ * todoEntryCell returns a column of a single TODOEntry, formatted as
+ * todoStoreCell does, for rows written before any store holds them.
+ */
+const char *todoEntryCell(const TODOEntry *entry, size_t column, char *scratch, size_t *outSize);
+
+static inline const char *todoStoreTitle(const TodoStore *store, size_t index) {
+    return store->titles + store->titleOffsets[index];
+}
+
+static inline bool todoStoreCompleted(const TodoStore *store, size_t index) {
+    return (store->completed[index >> 6] >> (index & 63)) & 1;
+}
+
+#endif
@@ -0,0 +1,287 @@
+#include <string.h>
+#include <parallel/parallel.h>
+#include <stats/stats.h>
+#include "summary.h"
+
+/*
+ * Rows below which counting isn't split across threads.
+ */
+#define SUMMARY_PARALLEL_MIN_ROWS ((size_t)1 << 16)
+
+/*
+ * allocUserCounters sets empty counters spanning `[base, base + range)`.
+ */
+static json_err allocUserCounters(UserCounters *counters, int32_t base, size_t range) {
+    counters->base = base;
+    counters->range = range;
+    counters->totals = calloc(range, sizeof(uint64_t));
+    counters->completed = calloc(range, sizeof(uint64_t));
+    statsCountAlloc(stats_component_main, 2 * range * sizeof(uint64_t));
+
+    if (counters->totals == NULL || counters->completed == NULL) {
+        freeUserCounters(counters);
+        return json_err_alloc_failed;
+    }
+
+    return json_err_ok;
+}
+
+/*
+ * widenUserCounters grows some counters until they hold userID, doubling
+ * them towards the side it's on so widening is rare.
+ */
+static json_err widenUserCounters(UserCounters *counters, int32_t userID) {
+    int64_t low = counters->range > 0 && counters->base < userID ? counters->base : userID;
+    int64_t high = counters->range > 0 && counters->base + (int64_t)counters->range - 1 > userID
+                       ? counters->base + (int64_t)counters->range - 1
+                       : userID;
+    size_t needed = (size_t)(high - low + 1);
+
+    if (needed > USER_COUNTERS_MAX_RANGE) {
+        return json_err_alloc_failed;
+    }
+
+    size_t range = counters->range * 2 > needed ? counters->range * 2 : needed;
+    range = range < USER_COUNTERS_MAX_RANGE ? range : USER_COUNTERS_MAX_RANGE;
+
+    /*
+     * The slack goes below the old counters when growing down, and above
+     * them otherwise, without leaving the int32_t range.
+     */
+    int64_t base;
+
+    if (counters->range > 0 && userID < counters->base) {
+        base = high - (int64_t)range + 1 < INT32_MIN ? INT32_MIN : high - (int64_t)range + 1;
+    } else {
+        base = low + (int64_t)range - 1 > INT32_MAX ? INT32_MAX - (int64_t)range + 1 : low;
+    }
+
+    UserCounters widened;
+    json_err err = allocUserCounters(&widened, (int32_t)base, range);
+
+    if (err != json_err_ok) {
+        return err;
+    }
+
+    if (counters->range > 0) {
+        size_t offset = (size_t)((int64_t)counters->base - base);
+        memcpy(widened.totals + offset, counters->totals, counters->range * sizeof(uint64_t));
+        memcpy(widened.completed + offset, counters->completed, counters->range * sizeof(uint64_t));
+    }
+
+    freeUserCounters(counters);
+    *counters = widened;
+    return json_err_ok;
+}
+
+json_err userCountersAdd(UserCounters *counters, int32_t userID, bool completed) {
+    if (counters->range == 0 || userID < counters->base ||
+        (int64_t)userID - counters->base >= (int64_t)counters->range) {
+        json_err err = widenUserCounters(counters, userID);
+
+        if (err != json_err_ok) {
+            return err;
+        }
+    }
+
+    size_t slot = (size_t)((int64_t)userID - counters->base);
+    counters->totals[slot]++;
+    counters->completed[slot] += completed;
+    return json_err_ok;
+}
+
+void freeUserCounters(UserCounters *counters) {
+    free(counters->totals);
+    free(counters->completed);
+    *counters = (UserCounters){ base: 0, range: 0, totals: NULL, completed: NULL };
+}
+
+/*
+ * CountingTask is the context shared by the threads of countTodoUsers.
+ *
+ * store    - Where the entries are read from.
+ * rows     - Rows to be counted, or NULL for the whole store.
+ * lows     - Lowest userID of each chunk.
+ * highs    - Highest userID of each chunk.
+ * partials - Counters of each chunk, all with the same range. The first
+ *            ones are the result.
+ */
+typedef struct {
+    const TodoStore *store;
+    const uint32_t *rows;
+    int32_t *lows;
+    int32_t *highs;
+    UserCounters *partials;
+} CountingTask;
+
+static void rangeTask(size_t chunk, size_t start, size_t end, void *context) {
+    CountingTask *task = (CountingTask *)context;
+    const int32_t *userIDs = task->store->userIDs;
+    int32_t low = INT32_MAX;
+    int32_t high = INT32_MIN;
+
+    for (size_t i = start; i < end; i++) {
+        int32_t userID = userIDs[task->rows != NULL ? task->rows[i] : i];
+        low = userID < low ? userID : low;
+        high = userID > high ? userID : high;
+    }
+
+    task->lows[chunk] = low;
+    task->highs[chunk] = high;
+}
+
+static void countTask(size_t chunk, size_t start, size_t end, void *context) {
+    CountingTask *task = (CountingTask *)context;
+    const TodoStore *store = task->store;
+    UserCounters *counters = &task->partials[chunk];
+
+    for (size_t i = start; i < end; i++) {
+        size_t row = task->rows != NULL ? task->rows[i] : i;
+        size_t slot = (size_t)((int64_t)store->userIDs[row] - counters->base);
+        counters->totals[slot]++;
+        counters->completed[slot] += todoStoreCompleted(store, row);
+    }
+}
+
+json_err countTodoUsers(const TodoStore *store, const uint32_t *rows, size_t length, size_t threads,
+                        UserCounters *outCounters) {
+    *outCounters = (UserCounters){ base: 0, range: 0, totals: NULL, completed: NULL };
+
+    if (length == 0) {
+        return json_err_ok;
+    }
+
+    /*
+     * parallelFor runs at most one chunk per row, so there are never more
+     * bounds to merge than rows.
+     */
+    size_t chunks = length < SUMMARY_PARALLEL_MIN_ROWS || threads == 0 ? 1 : threads < length ? threads : length;
+    int32_t *bounds = malloc(2 * chunks * sizeof(int32_t));
+    statsCountAlloc(stats_component_main, 2 * chunks * sizeof(int32_t));
+
+    if (bounds == NULL) {
+        return json_err_alloc_failed;
+    }
+
+    CountingTask task = { store: store, rows: rows, lows: bounds, highs: bounds + chunks, partials: NULL };
+
+    /*
+     * A chunk which couldn't get a thread is still run by another one, so
+     * a failed start only costs time.
+     */
+    parallelFor(length, chunks, chunks, rangeTask, &task);
+
+    int64_t low = INT32_MAX;
+    int64_t high = INT32_MIN;
+
+    for (size_t chunk = 0; chunk < chunks; chunk++) {
+        low = task.lows[chunk] < low ? task.lows[chunk] : low;
+        high = task.highs[chunk] > high ? task.highs[chunk] : high;
+    }
+
+    free(bounds);
+
+    size_t range = (size_t)(high - low + 1);
+
+    if (range > USER_COUNTERS_MAX_RANGE) {
+        return json_err_alloc_failed;
+    }
+
+    /*
+     * Partials hold the whole range each, so wide ranges get fewer of them.
+     */
+    while (chunks > 1 && chunks * range > USER_COUNTERS_MAX_RANGE) {
+        chunks /= 2;
+    }
+
+    task.partials = calloc(chunks, sizeof(UserCounters));
+    statsCountAlloc(stats_component_main, chunks * sizeof(UserCounters));
+    json_err err = task.partials != NULL ? json_err_ok : json_err_alloc_failed;
+
+    for (size_t chunk = 0; err == json_err_ok && chunk < chunks; chunk++) {
+        err = allocUserCounters(&task.partials[chunk], (int32_t)low, range);
+    }
+
+    if (err == json_err_ok) {
+        parallelFor(length, chunks, chunks, countTask, &task);
+
+        for (size_t chunk = 1; chunk < chunks; chunk++) {
+            for (size_t slot = 0; slot < range; slot++) {
+                task.partials[0].totals[slot] += task.partials[chunk].totals[slot];
+                task.partials[0].completed[slot] += task.partials[chunk].completed[slot];
+            }
+        }
+
+        *outCounters = task.partials[0];
+    }
+
+    for (size_t chunk = err == json_err_ok ? 1 : 0; task.partials != NULL && chunk < chunks; chunk++) {
+        freeUserCounters(&task.partials[chunk]);
+    }
+
+    free(task.partials);
+    return err;
+}
+
+json_err newTodoSummary(Arena *arena, const UserCounters *counters, const UserMap *users, TodoSummary *outSummary) {
+    size_t length = 0;
+
+    for (size_t slot = 0; slot < counters->range; slot++) {
+        length += counters->totals[slot] > 0;
+    }
+
+    uint32_t *slots = arenaAlloc(arena, length * sizeof(uint32_t) + 1);
+    statsCountAlloc(stats_component_main, length * sizeof(uint32_t));
+
+    if (slots == NULL) {
+        return json_err_alloc_failed;
+    }
+
+    length = 0;
+    for (size_t slot = 0; slot < counters->range; slot++) {
+        if (counters->totals[slot] > 0) {
+            slots[length++] = (uint32_t)slot;
+        }
+    }
+
+    *outSummary = (TodoSummary){ counters: counters, users: users, slots: slots, length: length };
+    return json_err_ok;
+}
+
+const char *todoSummaryCell(void *source, size_t row, size_t column, char *scratch, size_t *outSize) {
+    TodoSummary *summary = (TodoSummary *)source;
+    const UserCounters *counters = summary->counters;
+    uint32_t slot = summary->slots[row];
+    uint64_t total = counters->totals[slot];
+    uint64_t completed = counters->completed[slot];
+
+    switch (column) {
+        case 0: {
+            int32_t userID = (int32_t)((int64_t)counters->base + slot);
+            uint32_t user = summary->users != NULL ? userMapFind(summary->users, userID) : USER_MAP_MISSING;
+
+            if (user != USER_MAP_MISSING) {
+                *outSize = summary->users->nameLengths[user];
+                return summary->users->names + summary->users->nameOffsets[user];
+            }
+
+            *outSize = formatTableInteger(userID, scratch);
+            return scratch;
+        }
+        case 1:
+            *outSize = formatTableInteger((long long)total, scratch);
+            return scratch;
+        case 2:
+            *outSize = formatTableInteger((long long)completed, scratch);
+            return scratch;
+        default: {
+            uint64_t tenths = (completed * 1000 + total / 2) / total;
+            size_t size = formatTableInteger((long long)(tenths / 10), scratch);
+            scratch[size++] = '.';
+            scratch[size++] = (char)('0' + tenths % 10);
+            scratch[size++] = '%';
+            *outSize = size;
+            return scratch;
+        }
+    }
+}
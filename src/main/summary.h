@@ -0,0 +1,96 @@
+#ifndef summary_h
+#define summary_h
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <arena/arena.h>
+#include "models.h"
+#include "store.h"
+#include "users.h"
+
+/*
+ * Widest span of userIDs counted, from the lowest one to the highest. It
+ * bounds the counters to 64MiB.
+ */
+#define USER_COUNTERS_MAX_RANGE ((size_t)1 << 22)
+
+/*
+ * UserCounters counts the entries of each user in dense arrays indexed by
+ * `userID - base`, so counting an entry is two increments.
+ *
+ * base      - Lowest userID counted.
+ * range     - Length of totals and completed.
+ * totals    - Amount of entries of each user.
+ * completed - Amount of completed entries of each user.
+ */
+typedef struct {
+    int32_t base;
+    size_t range;
+    uint64_t *totals;
+    uint64_t *completed;
+} UserCounters;
+
+/*
+ * userCountersAdd counts an entry, widening the counters when its userID is
+ * out of their range. They start empty with every field zeroed.
+ *
+ * Returns a `json_err_alloc_failed` if the counters cannot grow, or if they
+ * would span more than USER_COUNTERS_MAX_RANGE userIDs.
+ */
+json_err userCountersAdd(UserCounters *counters, int32_t userID, bool completed);
+
+/*
+ * countTodoUsers counts the entries of rows of a store in parallel: each
+ * thread counts a chunk into its own partial counters, which are then
+ * summed.
+ *
+ * store       - Where the entries are read from.
+ * rows        - Rows to be counted, or NULL to count the whole store.
+ * length      - Amount of rows.
+ * threads     - Amount of threads.
+ * outCounters - Receives the counters, to be freed with freeUserCounters.
+ *
+ * Returns the same errors as userCountersAdd.
+ */
+json_err countTodoUsers(const TodoStore *store, const uint32_t *rows, size_t length, size_t threads,
+                        UserCounters *outCounters);
+
+/*
+ * freeUserCounters frees the arrays of some counters, leaving them empty.
+ */
+void freeUserCounters(UserCounters *counters);
+
+/*
+ * TodoSummary lists the users with any entry, in userID order.
+ *
+ * counters - Where the amounts are read from.
+ * users    - When not NULL, the map users are shown by name from.
+ * slots    - Index in the counters of each listed user.
+ * length   - Amount of listed users.
+ */
+typedef struct {
+    const UserCounters *counters;
+    const UserMap *users;
+    uint32_t *slots;
+    size_t length;
+} TodoSummary;
+
+/*
+ * newTodoSummary lists the users of some counters.
+ *
+ * arena      - Where the list is allocated.
+ * outSummary - Receives the summary, which reads from counters and users.
+ *
+ * Returns a `json_err_alloc_failed` if the list cannot be allocated.
+ */
+json_err newTodoSummary(Arena *arena, const UserCounters *counters, const UserMap *users, TodoSummary *outSummary);
+
+/*
+ * todoSummaryCell is the TableCellGetter reading a Table from a
+ * TodoSummary, with the User ID, Total, Completed and Completed % columns.
+ * The first one holds the user name when the summary has users and the
+ * user is known.
+ */
+const char *todoSummaryCell(void *source, size_t row, size_t column, char *scratch, size_t *outSize);
+
+#endif
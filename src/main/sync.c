@@ -0,0 +1,581 @@
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <stats/stats.h>
+#include "snapshot.h"
+#include "trigram.h"
+#include "sync.h"
+
+static const char SYNC_MAGIC[8] = { 'T', 'O', 'D', 'O', 'S', 'Y', 'N', 'C' };
+
+/*
+ * SyncHeader starts every ranges file, followed by its ranges. The
+ * checksum covers the ranges.
+ *
+ * generation - Increased on every write, so the snapshot key of two
+ *              different syncs never matches.
+ */
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t headerSize;
+    uint64_t generation;
+    uint64_t count;
+    uint64_t checksum;
+} SyncHeader;
+
+/*
+ * SyncRow is an entry of a parsed body, sorted by ID.
+ */
+typedef struct {
+    int32_t ID;
+    uint32_t index;
+} SyncRow;
+
+/*
+ * syncKey is the snapshot source key of a set of ranges.
+ */
+static uint64_t syncKey(const TodoSyncRange *ranges, size_t count, uint64_t generation) {
+    uint64_t key = hashSection(SNAPSHOT_CHECKSUM_SEED, &generation, sizeof(generation));
+    key = hashSection(key, ranges, count * sizeof(TodoSyncRange));
+    return key != 0 ? key : 1;
+}
+
+/*
+ * readSyncRanges loads a ranges file written by writeSyncRanges.
+ *
+ * outRanges - Receives the ranges, released with free.
+ *
+ * Returns false when the file is missing, stale or fails its checksum.
+ */
+static bool readSyncRanges(const char *path, TodoSyncRange **outRanges, size_t *outCount, uint64_t *outGeneration) {
+    FILE *file = fopen(path, "rb");
+    SyncHeader header;
+
+    if (file == NULL) {
+        return false;
+    }
+
+    bool ok = fread(&header, sizeof(header), 1, file) == 1 &&
+              memcmp(header.magic, SYNC_MAGIC, sizeof(SYNC_MAGIC)) == 0 && header.version == TODO_SYNC_VERSION &&
+              header.headerSize == sizeof(SyncHeader) && header.count <= UINT32_MAX / TODO_SYNC_RANGE_IDS + 2;
+    TodoSyncRange *ranges = ok ? malloc((header.count + 1) * sizeof(TodoSyncRange)) : NULL;
+
+    ok = ranges != NULL && fread(ranges, sizeof(TodoSyncRange), header.count, file) == header.count &&
+         hashSection(SNAPSHOT_CHECKSUM_SEED, ranges, header.count * sizeof(TodoSyncRange)) == header.checksum;
+    fclose(file);
+
+    if (!ok) {
+        free(ranges);
+        return false;
+    }
+
+    *outRanges = ranges;
+    *outCount = header.count;
+    *outGeneration = header.generation;
+    return true;
+}
+
+/*
+ * writeSyncRanges saves a set of ranges into path, replacing it atomically.
+ */
+static bool writeSyncRanges(const char *path, const TodoSyncRange *ranges, size_t count, uint64_t generation) {
+    SyncHeader header = { magic: { 0 }, version: TODO_SYNC_VERSION, headerSize: sizeof(SyncHeader),
+                          generation: generation, count: count,
+                          checksum: hashSection(SNAPSHOT_CHECKSUM_SEED, ranges, count * sizeof(TodoSyncRange)) };
+    char *temporaryPath = malloc(strlen(path) + 8);
+
+    if (temporaryPath == NULL) {
+        return false;
+    }
+
+    memcpy(header.magic, SYNC_MAGIC, sizeof(SYNC_MAGIC));
+    sprintf(temporaryPath, "%s.XXXXXX", path);
+
+    int fd = mkstemp(temporaryPath);
+    FILE *file = fd >= 0 ? fdopen(fd, "wb") : NULL;
+    bool ok = file != NULL && fwrite(&header, sizeof(header), 1, file) == 1 &&
+              (count == 0 || fwrite(ranges, sizeof(TodoSyncRange), count, file) == count);
+
+    if (file != NULL) {
+        ok = fclose(file) == 0 && ok;
+    } else if (fd >= 0) {
+        close(fd);
+    }
+
+    ok = ok && rename(temporaryPath, path) == 0;
+    if (!ok && fd >= 0) {
+        unlink(temporaryPath);
+    }
+
+    free(temporaryPath);
+    return ok;
+}
+
+/*
+ * lowerBound returns the first row from `from` on whose ID isn't below ID,
+ * in a store sorted by ID.
+ */
+static size_t lowerBound(const TodoStore *store, size_t from, int64_t ID) {
+    size_t low = from, high = store->length;
+
+    while (low < high) {
+        size_t middle = low + (high - low) / 2;
+
+        if (store->IDs[middle] < ID) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+
+    return low;
+}
+
+static int compareRows(const void *rawLeft, const void *rawRight) {
+    const SyncRow *left = rawLeft, *right = rawRight;
+
+    if (left->ID != right->ID) {
+        return left->ID < right->ID ? -1 : 1;
+    }
+    return left->index < right->index ? -1 : left->index > right->index;
+}
+
+/*
+ * parseSyncBody parses a body, keeping only the entries whose ID is between
+ * first and last, sorted by ID.
+ *
+ * arena    - Where the parsed entries are kept.
+ * outStore - Receives the kept entries.
+ */
+static json_err parseSyncBody(Arena *arena, char *body, size_t size, int64_t first, int64_t last,
+                              TodoStore **outStore) {
+    TodoStore *parsed = NULL;
+    json_err err = newTodoStore(arena, false, &parsed);
+
+    if (err == json_err_ok) {
+        err = parseTODOList(parsed, body, size);
+    }
+
+    if (err == json_err_ok) {
+        err = newTodoStore(arena, false, outStore);
+    }
+
+    if (err != json_err_ok) {
+        return err;
+    }
+
+    SyncRow *rows = malloc((parsed->length + 1) * sizeof(SyncRow));
+    size_t count = 0;
+    statsCountAlloc(stats_component_models, (parsed->length + 1) * sizeof(SyncRow));
+
+    if (rows == NULL) {
+        return json_err_alloc_failed;
+    }
+
+    for (size_t i = 0; i < parsed->length; i++) {
+        if (parsed->IDs[i] >= first && parsed->IDs[i] <= last) {
+            rows[count++] = (SyncRow){ ID: parsed->IDs[i], index: (uint32_t)i };
+        }
+    }
+
+    qsort(rows, count, sizeof(SyncRow), compareRows);
+
+    for (size_t i = 0; err == json_err_ok && i < count; i++) {
+        TODOEntry entry;
+        todoStoreGet(parsed, rows[i].index, &entry);
+        err = todoStoreAppend(*outStore, &entry);
+    }
+
+    free(rows);
+    return err;
+}
+
+/*
+ * compactTitles copies the store over a fresh one once most of its titles
+ * blob holds titles spliced out of it.
+ */
+static json_err compactTitles(TodoStore *store) {
+    size_t used = 0;
+
+    for (size_t i = 0; i < store->length; i++) {
+        used += store->titleLengths[i] + 1;
+    }
+
+    if (store->internTitles || store->titlesSize <= used * 2) {
+        return json_err_ok;
+    }
+
+    TodoStore *compacted = NULL;
+    json_err err = newTodoStore(store->arena, false, &compacted);
+
+    if (err == json_err_ok) {
+        err = todoStoreSplice(compacted, 0, 0, store);
+    }
+
+    if (err == json_err_ok) {
+        *store = *compacted;
+    }
+
+    return err;
+}
+
+/*
+ * rangeUrl formats the request of the IDs from first up to last, or from
+ * first on when last is INT64_MAX.
+ */
+static char *rangeUrl(Arena *arena, const char *url, int64_t first, int64_t last) {
+    size_t size = strlen(url) + 64;
+    char *rangeUrl = arenaAlloc(arena, size);
+    char separator = strchr(url, '?') != NULL ? '&' : '?';
+    statsCountAlloc(stats_component_models, size);
+
+    if (rangeUrl != NULL && last == INT64_MAX) {
+        snprintf(rangeUrl, size, "%s%cid_gte=%lld", url, separator, (long long)first);
+    } else if (rangeUrl != NULL) {
+        snprintf(rangeUrl, size, "%s%cid_gte=%lld&id_lte=%lld", url, separator, (long long)first, (long long)last);
+    }
+
+    return rangeUrl;
+}
+
+/*
+ * loadSyncedStore fills an empty store with the copy kept in directory.
+ *
+ * Returns false when there's no usable copy, leaving the store empty.
+ */
+static bool loadSyncedStore(TodoStore *store, const char *snapshotPath, const TodoSyncRange *ranges, size_t count,
+                            uint64_t generation) {
+    TodoSnapshot *snapshot = NULL;
+    uint64_t length = 0;
+
+    for (size_t i = 0; i < count; i++) {
+        length += ranges[i].count;
+    }
+
+    if (openTodoSnapshot(store->arena, snapshotPath, syncKey(ranges, count, generation), &snapshot) !=
+        snapshot_err_ok) {
+        return false;
+    }
+
+    bool ok = snapshot->store.length == length && todoStoreSplice(store, 0, 0, &snapshot->store) == json_err_ok;
+
+    closeTodoSnapshot(snapshot);
+    if (!ok && store->completed != NULL) {
+        memset(store->completed, 0, (store->capacity + 63) / 64 * sizeof(uint64_t));
+    }
+    if (!ok) {
+        store->length = 0;
+        store->titlesSize = 0;
+    }
+
+    return ok;
+}
+
+/*
+ * spliceSynced replaces the entries of the store from start up to end with
+ * the entries of source, re-indexing only those when there's an index.
+ */
+static json_err spliceSynced(TodoStore *store, size_t start, size_t end, const TodoStore *source,
+                             TrigramIndex *trigrams) {
+    json_err err = todoStoreSplice(store, start, end, source);
+
+    if (err == json_err_ok && trigrams != NULL) {
+        err = trigramIndexSplice(trigrams, start, end, store, source->length);
+    }
+
+    return err;
+}
+
+/*
+ * requestRanges revalidates count ranges with their ETags, and the entries
+ * after the last one when withTail is set.
+ *
+ * etags     - Receives the ETag answered for each request.
+ * responses - Receives the answer of each request.
+ */
+static http_err requestRanges(HttpClient *client, Arena *arena, const char *url, const TodoSyncRange *ranges,
+                              size_t count, bool withTail, char (*etags)[HTTP_ETAG_SIZE], HttpResponse *responses) {
+    size_t requests = count + withTail;
+    const char **urls = malloc(requests * sizeof(char *));
+    http_err err = urls != NULL ? http_err_ok : http_err_write_error;
+    statsCountAlloc(stats_component_models, requests * sizeof(char *));
+
+    for (size_t i = 0; err == http_err_ok && i < requests; i++) {
+        urls[i] = i < count     ? rangeUrl(arena, url, ranges[i].first, ranges[i].last)
+                  : count > 0   ? rangeUrl(arena, url, ranges[count - 1].last + 1, INT64_MAX)
+                                : url;
+        err = urls[i] != NULL ? http_err_ok : http_err_write_error;
+
+        if (i < count) {
+            memcpy(etags[i], ranges[i].etag, HTTP_ETAG_SIZE);
+        }
+    }
+
+    if (err == http_err_ok) {
+        err = httpClientGetManyIfChanged(client, urls, etags, requests, responses);
+    }
+
+    free(urls);
+    return err;
+}
+
+/*
+ * refreshRange splices the body answered for a range over its entries,
+ * unless it wasn't modified or is the one parsed for it last time, and
+ * keeps its ETag and hash.
+ *
+ * scratch - Where the parsed body is kept.
+ * row     - Row the range starts from at the earliest, receiving the row
+ *           after it.
+ * changed - Set when the range changed.
+ */
+static json_err refreshRange(TodoStore *store, Arena *scratch, TodoSyncRange *range, const HttpResponse *response,
+                             const char *etag, TrigramIndex *trigrams, size_t *row, bool *changed) {
+    size_t start = lowerBound(store, *row, range->first);
+    size_t end = lowerBound(store, start, range->last + 1);
+    uint64_t hash = response->status == 304 ? range->hash
+                                            : hashSection(SNAPSHOT_CHECKSUM_SEED, response->body, response->size);
+
+    hash = hash != 0 ? hash : 1;
+    *changed = *changed || strcmp(range->etag, etag) != 0;
+    memcpy(range->etag, etag, HTTP_ETAG_SIZE);
+
+    if (response->status == 304 || hash == range->hash) {
+        if (STATS_ACTIVE) {
+            statsRecordCache(true, 0);
+        }
+        *row = end;
+        return json_err_ok;
+    }
+
+    TodoStore *entries = NULL;
+    json_err err = parseSyncBody(scratch, response->body, response->size, range->first, range->last, &entries);
+
+    if (err == json_err_ok) {
+        err = spliceSynced(store, start, end, entries, trigrams);
+    }
+
+    if (STATS_ACTIVE) {
+        statsRecordCache(false, 0);
+    }
+
+    range->count = err == json_err_ok ? entries->length : range->count;
+    range->hash = hash;
+    *row = start + range->count;
+    *changed = true;
+    return err;
+}
+
+/*
+ * addTailRanges splices entries above every range at the end of the store,
+ * opening a range for each TODO_SYNC_RANGE_IDS wide span holding any.
+ *
+ * outRanges   - Ranges being grown, with outCount of them.
+ * outCapacity - Allocated length of outRanges.
+ */
+static json_err addTailRanges(TodoStore *store, const TodoStore *tail, TrigramIndex *trigrams,
+                              TodoSyncRange **outRanges, size_t *outCount, size_t *outCapacity) {
+    json_err err = spliceSynced(store, store->length, store->length, tail, trigrams);
+
+    for (size_t i = 0; err == json_err_ok && i < tail->length; i++) {
+        int64_t ID = tail->IDs[i];
+
+        if (*outCount > 0 && ID <= (*outRanges)[*outCount - 1].last) {
+            (*outRanges)[*outCount - 1].count++;
+            continue;
+        }
+
+        if (*outCount == *outCapacity) {
+            size_t capacity = *outCapacity > 0 ? *outCapacity * 2 : 16;
+            TodoSyncRange *grown = realloc(*outRanges, capacity * sizeof(TodoSyncRange));
+            statsCountAlloc(stats_component_models, capacity * sizeof(TodoSyncRange));
+
+            if (grown == NULL) {
+                return json_err_alloc_failed;
+            }
+
+            *outRanges = grown;
+            *outCapacity = capacity;
+        }
+
+        int64_t window = ID >= 1 ? (ID - 1) / TODO_SYNC_RANGE_IDS
+                                 : -((TODO_SYNC_RANGE_IDS - ID) / TODO_SYNC_RANGE_IDS);
+        TodoSyncRange *range = &(*outRanges)[(*outCount)++];
+
+        memset(range, 0, sizeof(TodoSyncRange));
+        range->first = *outCount > 1 ? range[-1].last + 1 : INT32_MIN;
+        range->last = (window + 1) * TODO_SYNC_RANGE_IDS;
+        range->count = 1;
+    }
+
+    return err;
+}
+
+/*
+ * seedRanges requests the ranges opened from the tail on their own once,
+ * as their entries came along with other ones, so the next sync has an
+ * ETag and a hash to revalidate them with. Ranges which can't be requested
+ * are left without, and are downloaded again by the next sync.
+ */
+static json_err seedRanges(TodoStore *store, HttpClient *client, const char *url, Arena *scratch,
+                           TodoSyncRange *ranges, size_t count, TrigramIndex *trigrams) {
+    char (*etags)[HTTP_ETAG_SIZE] = calloc(count, HTTP_ETAG_SIZE);
+    HttpResponse *responses = calloc(count, sizeof(HttpResponse));
+    json_err err = json_err_ok;
+    bool changed = false;
+    size_t row = lowerBound(store, 0, ranges[0].first);
+    statsCountAlloc(stats_component_models, count * (HTTP_ETAG_SIZE + sizeof(HttpResponse)));
+
+    if (etags != NULL && responses != NULL &&
+        requestRanges(client, store->arena, url, ranges, count, false, etags, responses) == http_err_ok) {
+        for (size_t i = 0; err == json_err_ok && i < count; i++) {
+            err = refreshRange(store, scratch, &ranges[i], &responses[i], etags[i], trigrams, &row, &changed);
+        }
+    }
+
+    if (responses != NULL) {
+        freeHttpResponses(responses, count);
+    }
+    free(responses);
+    free(etags);
+    return err;
+}
+
+http_err syncTodoStore(TodoStore *store, const char *url, const char *directory, TrigramIndex **outTrigrams,
+                       json_err *outErr) {
+    size_t pathSize = strlen(directory) + sizeof("/todos.synced.trigrams");
+    char *snapshotPath = arenaAlloc(store->arena, pathSize);
+    char *rangesPath = arenaAlloc(store->arena, pathSize);
+    char *trigramsPath = arenaAlloc(store->arena, pathSize);
+    TodoSyncRange *ranges = NULL;
+    TrigramIndex *trigrams = NULL;
+    size_t count = 0;
+    uint64_t generation = 0;
+    statsCountAlloc(stats_component_models, pathSize * 3);
+
+    *outErr = json_err_ok;
+    if (snapshotPath == NULL || rangesPath == NULL || trigramsPath == NULL) {
+        return http_err_write_error;
+    }
+
+    sprintf(snapshotPath, "%s/todos.synced", directory);
+    sprintf(rangesPath, "%s/todos.ranges", directory);
+    sprintf(trigramsPath, "%s/todos.synced.trigrams", directory);
+
+    if (readSyncRanges(rangesPath, &ranges, &count, &generation) &&
+        !loadSyncedStore(store, snapshotPath, ranges, count, generation)) {
+        count = 0;
+    }
+
+    /*
+     * The index kept along with the copy is spliced like the store, so only
+     * the entries a sync changed are indexed again.
+     */
+    if (outTrigrams != NULL && count > 0 &&
+        openTrigramIndex(trigramsPath, syncKey(ranges, count, generation), store->length, &trigrams) !=
+            snapshot_err_ok) {
+        trigrams = NULL;
+    }
+
+    /*
+     * Every range is requested along with the entries after the last one.
+     */
+    size_t requests = count + 1;
+    size_t capacity = count + 1;
+    char (*etags)[HTTP_ETAG_SIZE] = calloc(requests, HTTP_ETAG_SIZE);
+    HttpResponse *responses = calloc(requests, sizeof(HttpResponse));
+    HttpClient *client = NULL;
+    statsCountAlloc(stats_component_models, requests * (HTTP_ETAG_SIZE + sizeof(HttpResponse)));
+    http_err err = etags != NULL && responses != NULL ? newHttpClient(0, &client) : http_err_write_error;
+
+    if (ranges == NULL && err == http_err_ok) {
+        ranges = malloc(capacity * sizeof(TodoSyncRange));
+        err = ranges != NULL ? http_err_ok : http_err_write_error;
+    }
+
+    if (err == http_err_ok) {
+        err = requestRanges(client, store->arena, url, ranges, count, true, etags, responses);
+    }
+
+    Arena *scratch = err == http_err_ok ? newArena(0) : NULL;
+    uint64_t span = statsSpanStart();
+    bool changed = false;
+    bool rebuilt = false;
+    size_t row = 0;
+
+    if (err == http_err_ok && scratch == NULL) {
+        *outErr = json_err_alloc_failed;
+    }
+
+    for (size_t i = 0; err == http_err_ok && *outErr == json_err_ok && i < count; i++) {
+        *outErr = refreshRange(store, scratch, &ranges[i], &responses[i], etags[i], trigrams, &row, &changed);
+    }
+
+    if (err == http_err_ok && *outErr == json_err_ok) {
+        TodoStore *tail = NULL;
+        size_t opened = count;
+        *outErr = parseSyncBody(scratch, responses[count].body, responses[count].size,
+                                count > 0 ? ranges[count - 1].last + 1 : INT32_MIN, INT32_MAX, &tail);
+
+        if (*outErr == json_err_ok && tail->length > 0) {
+            *outErr = addTailRanges(store, tail, trigrams, &ranges, &count, &capacity);
+            changed = true;
+        }
+
+        if (*outErr == json_err_ok && opened < count) {
+            *outErr = seedRanges(store, client, url, scratch, ranges + opened, count - opened, trigrams);
+        }
+    }
+
+    if (err == http_err_ok && *outErr == json_err_ok && outTrigrams != NULL && trigrams == NULL) {
+        *outErr = newTrigramIndex(&trigrams);
+        rebuilt = true;
+
+        if (*outErr == json_err_ok) {
+            *outErr = trigramIndexAddStore(trigrams, store);
+        }
+    }
+
+    uint64_t written = generation;
+
+    if (err == http_err_ok && *outErr == json_err_ok && changed) {
+        *outErr = compactTitles(store);
+
+        if (*outErr == json_err_ok && writeTodoSnapshot(store, snapshotPath, syncKey(ranges, count, generation + 1)) ==
+                                          snapshot_err_ok &&
+            writeSyncRanges(rangesPath, ranges, count, generation + 1)) {
+            written = generation + 1;
+        }
+    }
+
+    /*
+     * The index is saved under the key of the copy it matches, so it's only
+     * written along with a new copy, or on its own for an unchanged one.
+     */
+    bool saveTrigrams = changed ? written != generation : rebuilt && count > 0;
+
+    if (err == http_err_ok && *outErr == json_err_ok && trigrams != NULL && saveTrigrams) {
+        writeTrigramIndex(trigrams, trigramsPath, syncKey(ranges, count, written));
+    }
+
+    statsSpanEnd(stats_stage_parse, span);
+
+    if (err == http_err_ok && *outErr == json_err_ok && outTrigrams != NULL) {
+        *outTrigrams = trigrams;
+    } else {
+        freeTrigramIndex(trigrams);
+    }
+
+    if (responses != NULL) {
+        freeHttpResponses(responses, requests);
+    }
+    if (scratch != NULL) {
+        freeArena(scratch);
+    }
+    freeHttpClient(client);
+    free(responses);
+    free(etags);
+    free(ranges);
+    return err;
+}
@@ -0,0 +1,71 @@
+#ifndef sync_h
+#define sync_h
+#include <stdint.h>
+#include <stdlib.h>
+#include <http/http.h>
+#include "models.h"
+#include "store.h"
+#include "trigram.h"
+
+/*
+ * IDs covered by each range a new entry starts. Ranges are requested on
+ * their own, so a change only costs the range holding it.
+ */
+#define TODO_SYNC_RANGE_IDS 10000
+
+/*
+ * Version of the ranges file layout. Files of any other version are ignored.
+ */
+#define TODO_SYNC_VERSION 1
+
+/*
+ * TodoSyncRange is a span of IDs of a synced TODO list, requested as
+ * `url?id_gte=first&id_lte=last`. Ranges are kept sorted, each one starting
+ * right after the previous one, the first one at INT32_MIN, so together
+ * they cover every ID up to the last one. Anything above is requested as
+ * `url?id_gte=last+1`.
+ *
+ * first - Lowest ID of the range.
+ * last  - Highest ID of the range.
+ * count - Entries of the range held by the store.
+ * hash  - hashSection of the last body parsed for it, or 0 when its entries
+ *         came along with other ones.
+ * etag  - ETag of that body, empty when unknown.
+ */
+typedef struct {
+    int64_t first;
+    int64_t last;
+    uint64_t count;
+    uint64_t hash;
+    char etag[HTTP_ETAG_SIZE];
+} TodoSyncRange;
+
+/*
+ * syncTodoStore keeps a copy of the TODO list at url in directory up to
+ * date, fetching only what changed since the last sync. The copy is a
+ * snapshot of a store sorted by ID along with the ranges it's made of.
+ *
+ * Every range is revalidated concurrently with its ETag, and the ones whose
+ * body did change are parsed and spliced into place, along with the entries
+ * after the last range. Unchanged ranges are neither downloaded again nor
+ * parsed, and the files are only written again when anything changed. A
+ * missing or unreadable copy syncs the whole list from scratch, then
+ * requests each range it opened once on its own, so the next sync can
+ * revalidate them.
+ *
+ * store       - Empty store receiving the synced list, sorted by ID.
+ * url         - Url of the list, which should understand id_gte and id_lte.
+ *               Others work as well, as every body is filtered to its
+ *               range, only without saving anything.
+ * outTrigrams - When not NULL, receives the trigram index of the titles. It's
+ *               kept in directory along with the copy, and only the entries
+ *               a sync changed are indexed again.
+ * outErr      - Receives the parse error, if any.
+ *
+ * Returns the error of the first failed request, in which case the copy is
+ * left untouched.
+ */
+http_err syncTodoStore(TodoStore *store, const char *url, const char *directory, TrigramIndex **outTrigrams,
+                       json_err *outErr);
+
+#endif
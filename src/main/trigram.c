@@ -0,0 +1,729 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <stats/stats.h>
+#include "trigram.h"
+
+static const char TRIGRAM_MAGIC[8] = { 'T', 'O', 'D', 'O', 'T', 'R', 'I', 'G' };
+
+/*
+ * Initial amount of posting lists of a built index.
+ */
+static const size_t TRIGRAM_INITIAL_SLOTS = 1024;
+
+/*
+ * Most distinct trigrams a search intersects. Longer texts are narrowed by
+ * their first ones, then checked.
+ */
+#define TRIGRAM_MAX_QUERY 64
+
+/*
+ * TrigramPostings is the list of rows holding a trigram. An empty count
+ * marks an unused slot.
+ */
+typedef struct {
+    uint32_t key;
+    uint32_t count;
+    uint32_t capacity;
+    uint32_t *rows;
+} TrigramPostings;
+
+/*
+ * slots, slotsCapacity and used hold the open addressing table of a built
+ * index. keys, offsets, rows and keysCount hold the sorted lists of a
+ * mapped one, whose file is data and size.
+ */
+struct TrigramIndex {
+    size_t rowsCount;
+    TrigramPostings *slots;
+    size_t slotsCapacity;
+    size_t used;
+    void *data;
+    size_t size;
+    const uint32_t *keys;
+    const uint32_t *offsets;
+    const uint32_t *rows;
+    size_t keysCount;
+};
+
+/*
+ * TrigramHeader starts every trigram file. The checksum covers every byte
+ * after it.
+ */
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t headerSize;
+    uint64_t sourceKey;
+    uint64_t rowsCount;
+    uint64_t keysCount;
+    uint64_t postingsCount;
+    uint64_t checksum;
+} TrigramHeader;
+
+static inline uint32_t trigramKey(const char *bytes) {
+    return (uint32_t)(unsigned char)bytes[0] << 16 | (uint32_t)(unsigned char)bytes[1] << 8 |
+           (uint32_t)(unsigned char)bytes[2];
+}
+
+static inline size_t slotOf(uint32_t key, size_t capacity) {
+    return (size_t)(key * 0x9e3779b1u) & (capacity - 1);
+}
+
+json_err newTrigramIndex(TrigramIndex **outIndex) {
+    TrigramIndex *index = calloc(1, sizeof(TrigramIndex));
+
+    if (index != NULL) {
+        index->slots = calloc(TRIGRAM_INITIAL_SLOTS, sizeof(TrigramPostings));
+        index->slotsCapacity = TRIGRAM_INITIAL_SLOTS;
+    }
+
+    statsCountAlloc(stats_component_models, sizeof(TrigramIndex) + TRIGRAM_INITIAL_SLOTS * sizeof(TrigramPostings));
+    if (index == NULL || index->slots == NULL) {
+        free(index);
+        return json_err_alloc_failed;
+    }
+
+    *outIndex = index;
+    return json_err_ok;
+}
+
+void freeTrigramIndex(TrigramIndex *index) {
+    if (index == NULL) {
+        return;
+    }
+
+    for (size_t i = 0; i < index->slotsCapacity; i++) {
+        free(index->slots[i].rows);
+    }
+
+    if (index->data != NULL) {
+        munmap(index->data, index->size);
+    }
+
+    free(index->slots);
+    free(index);
+}
+
+/*
+ * rehashSlots moves the lists of a built index to a table of capacity
+ * slots, releasing the ones emptied by a splice.
+ */
+static json_err rehashSlots(TrigramIndex *index, size_t capacity) {
+    TrigramPostings *slots = calloc(capacity, sizeof(TrigramPostings));
+
+    statsCountAlloc(stats_component_models, capacity * sizeof(TrigramPostings));
+    if (slots == NULL) {
+        return json_err_alloc_failed;
+    }
+
+    index->used = 0;
+    for (size_t i = 0; i < index->slotsCapacity; i++) {
+        if (index->slots[i].count == 0) {
+            free(index->slots[i].rows);
+            continue;
+        }
+
+        size_t slot = slotOf(index->slots[i].key, capacity);
+
+        while (slots[slot].count != 0) {
+            slot = (slot + 1) & (capacity - 1);
+        }
+
+        slots[slot] = index->slots[i];
+        index->used++;
+    }
+
+    free(index->slots);
+    index->slots = slots;
+    index->slotsCapacity = capacity;
+    return json_err_ok;
+}
+
+/*
+ * growSlots doubles the table of a built index.
+ */
+static json_err growSlots(TrigramIndex *index) {
+    return rehashSlots(index, index->slotsCapacity * 2);
+}
+
+/*
+ * addPosting appends a row to the list of a trigram, unless the row is
+ * already its last one.
+ */
+static json_err addPosting(TrigramIndex *index, uint32_t key, uint32_t row) {
+    if (index->used * 2 >= index->slotsCapacity && growSlots(index) != json_err_ok) {
+        return json_err_alloc_failed;
+    }
+
+    size_t slot = slotOf(key, index->slotsCapacity);
+
+    while (index->slots[slot].count != 0 && index->slots[slot].key != key) {
+        slot = (slot + 1) & (index->slotsCapacity - 1);
+    }
+
+    TrigramPostings *postings = &index->slots[slot];
+
+    if (postings->count > 0 && postings->rows[postings->count - 1] == row) {
+        return json_err_ok;
+    }
+
+    if (postings->count == postings->capacity) {
+        uint32_t capacity = postings->capacity > 0 ? postings->capacity * 2 : 4;
+        uint32_t *rows = realloc(postings->rows, capacity * sizeof(uint32_t));
+
+        statsCountAlloc(stats_component_models, capacity * sizeof(uint32_t));
+        if (rows == NULL) {
+            return json_err_alloc_failed;
+        }
+
+        postings->rows = rows;
+        postings->capacity = capacity;
+    }
+
+    if (postings->count == 0) {
+        postings->key = key;
+        index->used++;
+    }
+
+    postings->rows[postings->count++] = row;
+    return json_err_ok;
+}
+
+json_err trigramIndexAdd(TrigramIndex *index, uint32_t row, const char *title, size_t size) {
+    if (index->data != NULL) {
+        return json_err_invalid_type;
+    }
+
+    for (size_t i = 0; i + 3 <= size; i++) {
+        if (addPosting(index, trigramKey(title + i), row) != json_err_ok) {
+            return json_err_alloc_failed;
+        }
+    }
+
+    index->rowsCount = (size_t)row + 1 > index->rowsCount ? (size_t)row + 1 : index->rowsCount;
+    return json_err_ok;
+}
+
+json_err trigramIndexAddStore(TrigramIndex *index, const TodoStore *store) {
+    for (size_t row = index->rowsCount; row < store->length; row++) {
+        json_err err = trigramIndexAdd(index, (uint32_t)row, todoStoreTitle(store, row), store->titleLengths[row]);
+
+        if (err != json_err_ok) {
+            return err;
+        }
+    }
+
+    index->rowsCount = store->length;
+    return json_err_ok;
+}
+
+/*
+ * thawIndex copies the lists of a mapped index into a table, unmapping its
+ * file, so it can be changed like a built one.
+ */
+static json_err thawIndex(TrigramIndex *index) {
+    size_t capacity = TRIGRAM_INITIAL_SLOTS;
+
+    while (capacity <= index->keysCount * 2) {
+        capacity *= 2;
+    }
+
+    TrigramPostings *slots = calloc(capacity, sizeof(TrigramPostings));
+    size_t used = 0;
+    statsCountAlloc(stats_component_models, capacity * sizeof(TrigramPostings));
+
+    for (size_t i = 0; slots != NULL && i < index->keysCount; i++) {
+        uint32_t count = index->offsets[i + 1] - index->offsets[i];
+        size_t slot = slotOf(index->keys[i], capacity);
+
+        if (count == 0) {
+            continue;
+        }
+
+        used++;
+        while (slots[slot].count != 0) {
+            slot = (slot + 1) & (capacity - 1);
+        }
+
+        slots[slot] = (TrigramPostings){ key: index->keys[i], count: count, capacity: count,
+                                         rows: malloc(count * sizeof(uint32_t)) };
+        statsCountAlloc(stats_component_models, count * sizeof(uint32_t));
+
+        if (slots[slot].rows == NULL) {
+            for (size_t j = 0; j < capacity; j++) {
+                free(slots[j].rows);
+            }
+            free(slots);
+            slots = NULL;
+        } else {
+            memcpy(slots[slot].rows, index->rows + index->offsets[i], count * sizeof(uint32_t));
+        }
+    }
+
+    if (slots == NULL) {
+        return json_err_alloc_failed;
+    }
+
+    munmap(index->data, index->size);
+    free(index->slots);
+    index->slots = slots;
+    index->slotsCapacity = capacity;
+    index->used = used;
+    index->data = NULL;
+    index->keys = NULL;
+    index->offsets = NULL;
+    index->rows = NULL;
+    index->keysCount = 0;
+    return json_err_ok;
+}
+
+/*
+ * gallop finds the first position of a sorted list, from `from`, holding a
+ * row not smaller than `row`, doubling its steps before a binary search.
+ */
+static size_t gallop(const uint32_t *rows, size_t count, size_t from, uint32_t row) {
+    size_t step = 1;
+    size_t high = from;
+
+    while (high < count && rows[high] < row) {
+        from = high + 1;
+        high += step;
+        step *= 2;
+    }
+
+    high = high < count ? high : count;
+
+    while (from < high) {
+        size_t middle = from + (high - from) / 2;
+
+        if (rows[middle] < row) {
+            from = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+
+    return from;
+}
+
+/*
+ * splicePostings replaces the rows of a list from start up to end with the
+ * added ones, moving the rows after them by shift.
+ */
+static json_err splicePostings(TrigramPostings *postings, uint32_t start, uint32_t end, int64_t shift,
+                               const uint32_t *added, size_t addedCount) {
+    size_t from = gallop(postings->rows, postings->count, 0, start);
+    size_t to = gallop(postings->rows, postings->count, from, end);
+    size_t kept = postings->count - to;
+    size_t count = from + addedCount + kept;
+
+    if (count > postings->capacity) {
+        uint32_t *rows = realloc(postings->rows, count * sizeof(uint32_t));
+
+        statsCountAlloc(stats_component_models, count * sizeof(uint32_t));
+        if (rows == NULL) {
+            return json_err_alloc_failed;
+        }
+
+        postings->rows = rows;
+        postings->capacity = (uint32_t)count;
+    }
+
+    memmove(postings->rows + from + addedCount, postings->rows + to, kept * sizeof(uint32_t));
+    for (size_t i = from + addedCount; i < count; i++) {
+        postings->rows[i] = (uint32_t)((int64_t)postings->rows[i] + shift);
+    }
+
+    memcpy(postings->rows + from, added, addedCount * sizeof(uint32_t));
+    postings->count = (uint32_t)count;
+    return json_err_ok;
+}
+
+json_err trigramIndexSplice(TrigramIndex *index, size_t start, size_t end, const TodoStore *store, size_t count) {
+    TrigramIndex *added = NULL;
+    json_err err = index->data != NULL ? thawIndex(index) : json_err_ok;
+
+    if (err == json_err_ok) {
+        err = newTrigramIndex(&added);
+    }
+
+    for (size_t row = start; err == json_err_ok && row < start + count; row++) {
+        err = trigramIndexAdd(added, (uint32_t)row, todoStoreTitle(store, row), store->titleLengths[row]);
+    }
+
+    /*
+     * The table grows first, so the slots marked as spliced stay in place.
+     */
+    while (err == json_err_ok && (index->used + added->used) * 2 >= index->slotsCapacity) {
+        err = growSlots(index);
+    }
+
+    bool *spliced = err == json_err_ok ? calloc(index->slotsCapacity, sizeof(bool)) : NULL;
+    int64_t shift = (int64_t)count - (int64_t)(end - start);
+    bool emptied = false;
+    statsCountAlloc(stats_component_models, index->slotsCapacity * sizeof(bool));
+
+    if (err == json_err_ok && spliced == NULL) {
+        err = json_err_alloc_failed;
+    }
+
+    for (size_t i = 0; err == json_err_ok && i < added->slotsCapacity; i++) {
+        TrigramPostings *postings = &added->slots[i];
+        size_t slot = slotOf(postings->key, index->slotsCapacity);
+
+        if (postings->count == 0) {
+            continue;
+        }
+
+        while (index->slots[slot].count != 0 && index->slots[slot].key != postings->key) {
+            slot = (slot + 1) & (index->slotsCapacity - 1);
+        }
+
+        if (index->slots[slot].count == 0) {
+            index->slots[slot] = *postings;
+            index->used++;
+            postings->rows = NULL;
+        } else {
+            err = splicePostings(&index->slots[slot], (uint32_t)start, (uint32_t)end, shift, postings->rows,
+                                 postings->count);
+        }
+
+        spliced[slot] = true;
+    }
+
+    for (size_t i = 0; err == json_err_ok && i < index->slotsCapacity; i++) {
+        if (index->slots[i].count > 0 && !spliced[i]) {
+            err = splicePostings(&index->slots[i], (uint32_t)start, (uint32_t)end, shift, NULL, 0);
+            emptied = emptied || index->slots[i].count == 0;
+        }
+    }
+
+    if (err == json_err_ok && emptied) {
+        err = rehashSlots(index, index->slotsCapacity);
+    }
+
+    if (err == json_err_ok) {
+        index->rowsCount = (size_t)((int64_t)index->rowsCount + shift);
+    }
+
+    free(spliced);
+    freeTrigramIndex(added);
+    return err;
+}
+
+/*
+ * findPostings returns the rows holding a trigram, or NULL when none does.
+ */
+static const uint32_t *findPostings(const TrigramIndex *index, uint32_t key, size_t *outCount) {
+    if (index->data != NULL) {
+        size_t low = 0, high = index->keysCount;
+
+        while (low < high) {
+            size_t middle = low + (high - low) / 2;
+
+            if (index->keys[middle] < key) {
+                low = middle + 1;
+            } else {
+                high = middle;
+            }
+        }
+
+        if (low == index->keysCount || index->keys[low] != key) {
+            return NULL;
+        }
+
+        *outCount = index->offsets[low + 1] - index->offsets[low];
+        return index->rows + index->offsets[low];
+    }
+
+    size_t slot = slotOf(key, index->slotsCapacity);
+
+    while (index->slots[slot].count != 0) {
+        if (index->slots[slot].key == key) {
+            *outCount = index->slots[slot].count;
+            return index->slots[slot].rows;
+        }
+
+        slot = (slot + 1) & (index->slotsCapacity - 1);
+    }
+
+    return NULL;
+}
+
+typedef struct {
+    const uint32_t *rows;
+    size_t count;
+} PostingsList;
+
+static int compareLists(const void *a, const void *b) {
+    size_t aCount = ((const PostingsList *)a)->count;
+    size_t bCount = ((const PostingsList *)b)->count;
+    return (aCount > bCount) - (aCount < bCount);
+}
+
+static inline bool titleContains(const TodoStore *store, uint32_t row, const char *text, size_t size) {
+    return memmem(todoStoreTitle(store, row), store->titleLengths[row], text, size) != NULL;
+}
+
+query_err trigramSearch(const TrigramIndex *index, const TodoStore *store, const char *text, Arena *arena,
+                        uint32_t **outRows, size_t *outCount) {
+    size_t size = strlen(text);
+    PostingsList lists[TRIGRAM_MAX_QUERY];
+    size_t listsCount = 0;
+    size_t rowsCount = index->rowsCount < store->length ? index->rowsCount : store->length;
+
+    for (size_t i = 0; i + 3 <= size && listsCount < TRIGRAM_MAX_QUERY; i++) {
+        uint32_t key = trigramKey(text + i);
+        bool seen = false;
+
+        for (size_t j = 0; j < i && !seen; j++) {
+            seen = trigramKey(text + j) == key;
+        }
+
+        if (seen) {
+            continue;
+        }
+
+        lists[listsCount].rows = findPostings(index, key, &lists[listsCount].count);
+
+        /*
+         * The result is still allocated when empty, as a NULL one would
+         * read as every row to the caller.
+         */
+        if (lists[listsCount].rows == NULL) {
+            *outRows = arenaAlloc(arena, sizeof(uint32_t));
+            *outCount = 0;
+            return *outRows != NULL ? query_err_ok : query_err_alloc_failed;
+        }
+
+        listsCount++;
+    }
+
+    qsort(lists, listsCount, sizeof(PostingsList), compareLists);
+
+    size_t candidatesCount = listsCount > 0 ? lists[0].count : store->length;
+    uint32_t *rows = arenaAlloc(arena, candidatesCount * sizeof(uint32_t) + 1);
+    size_t count = 0;
+    size_t cursors[TRIGRAM_MAX_QUERY] = { 0 };
+
+    statsCountAlloc(stats_component_models, candidatesCount * sizeof(uint32_t));
+    if (rows == NULL) {
+        return query_err_alloc_failed;
+    }
+
+    for (size_t i = 0; i < candidatesCount; i++) {
+        uint32_t row = listsCount > 0 ? lists[0].rows[i] : (uint32_t)i;
+        bool candidate = true;
+
+        for (size_t list = 1; list < listsCount && candidate; list++) {
+            cursors[list] = gallop(lists[list].rows, lists[list].count, cursors[list], row);
+            candidate = cursors[list] < lists[list].count && lists[list].rows[cursors[list]] == row;
+        }
+
+        if (candidate && row < store->length && titleContains(store, row, text, size)) {
+            rows[count++] = row;
+        }
+    }
+
+    /*
+     * Rows added to the store after the index was built aren't in any list.
+     */
+    for (size_t row = rowsCount; listsCount > 0 && row < store->length; row++) {
+        if (titleContains(store, (uint32_t)row, text, size)) {
+            rows = arenaRealloc(arena, rows, count * sizeof(uint32_t), (count + 1) * sizeof(uint32_t));
+
+            if (rows == NULL) {
+                return query_err_alloc_failed;
+            }
+
+            rows[count++] = (uint32_t)row;
+        }
+    }
+
+    *outRows = rows;
+    *outCount = count;
+    return query_err_ok;
+}
+
+static int compareKeys(const void *a, const void *b) {
+    uint32_t aKey = ((const TrigramPostings *)a)->key;
+    uint32_t bKey = ((const TrigramPostings *)b)->key;
+    return (aKey > bKey) - (aKey < bKey);
+}
+
+snapshot_err writeTrigramIndex(const TrigramIndex *index, const char *path, uint64_t sourceKey) {
+    bool mapped = index->data != NULL;
+    TrigramPostings *postings = mapped ? NULL : malloc((index->used + 1) * sizeof(TrigramPostings));
+    uint32_t *keys = mapped ? NULL : malloc((index->used + 1) * sizeof(uint32_t));
+    uint32_t *offsets = mapped ? NULL : malloc((index->used + 1) * sizeof(uint32_t));
+    size_t keysCount = mapped ? index->keysCount : 0;
+    size_t postingsCount = mapped ? index->offsets[index->keysCount] : 0;
+    uint32_t *rows = NULL;
+    char *temporaryPath = malloc(strlen(path) + 8);
+    bool ok = (mapped || (postings != NULL && keys != NULL && offsets != NULL)) && temporaryPath != NULL;
+
+    for (size_t i = 0; ok && !mapped && i < index->slotsCapacity; i++) {
+        if (index->slots[i].count > 0) {
+            postings[keysCount++] = index->slots[i];
+            postingsCount += index->slots[i].count;
+        }
+    }
+
+    ok = ok && postingsCount <= UINT32_MAX &&
+         (mapped || (rows = malloc(postingsCount * sizeof(uint32_t) + 1)) != NULL);
+    if (ok && !mapped) {
+        qsort(postings, keysCount, sizeof(TrigramPostings), compareKeys);
+        offsets[0] = 0;
+
+        for (size_t i = 0; i < keysCount; i++) {
+            keys[i] = postings[i].key;
+            memcpy(rows + offsets[i], postings[i].rows, postings[i].count * sizeof(uint32_t));
+            offsets[i + 1] = offsets[i] + postings[i].count;
+        }
+    }
+
+    const void *sections[3] = { mapped ? index->keys : keys, mapped ? index->offsets : offsets,
+                                mapped ? index->rows : rows };
+    size_t sizes[3] = { keysCount * sizeof(uint32_t), (keysCount + 1) * sizeof(uint32_t),
+                        postingsCount * sizeof(uint32_t) };
+    TrigramHeader header = { magic: { 0 }, version: TRIGRAM_INDEX_VERSION, headerSize: sizeof(TrigramHeader),
+                             sourceKey: sourceKey, rowsCount: index->rowsCount, keysCount: keysCount,
+                             postingsCount: postingsCount, checksum: SNAPSHOT_CHECKSUM_SEED };
+    int fd = -1;
+    FILE *file = NULL;
+
+    if (ok) {
+        memcpy(header.magic, TRIGRAM_MAGIC, sizeof(TRIGRAM_MAGIC));
+        for (size_t i = 0; i < 3; i++) {
+            header.checksum = hashSection(header.checksum, sections[i], sizes[i]);
+        }
+
+        sprintf(temporaryPath, "%s.XXXXXX", path);
+        fd = mkstemp(temporaryPath);
+        file = fd >= 0 ? fdopen(fd, "wb") : NULL;
+        ok = file != NULL && fwrite(&header, sizeof(header), 1, file) == 1;
+    }
+
+    for (size_t i = 0; ok && i < 3; i++) {
+        ok = writeSection(file, sections[i], sizes[i]);
+    }
+
+    if (file != NULL) {
+        ok = fclose(file) == 0 && ok;
+    } else if (fd >= 0) {
+        close(fd);
+    }
+
+    ok = ok && rename(temporaryPath, path) == 0;
+    if (!ok && fd >= 0) {
+        unlink(temporaryPath);
+    }
+
+    free(temporaryPath);
+    free(rows);
+    free(offsets);
+    free(keys);
+    free(postings);
+    return ok ? snapshot_err_ok : snapshot_err_io_failed;
+}
+
+/*
+ * checkTrigramIndex validates a mapped file against the expected source and
+ * points the index at its sections.
+ */
+static snapshot_err checkTrigramIndex(TrigramIndex *index, uint64_t sourceKey, size_t rowsCount) {
+    const unsigned char *data = index->data;
+    TrigramHeader header;
+
+    memcpy(&header, data, sizeof(header));
+    if (memcmp(header.magic, TRIGRAM_MAGIC, sizeof(TRIGRAM_MAGIC)) != 0) {
+        return snapshot_err_corrupt;
+    }
+
+    if (header.version != TRIGRAM_INDEX_VERSION || header.headerSize != sizeof(TrigramHeader) ||
+        header.sourceKey != sourceKey || header.rowsCount != rowsCount) {
+        return snapshot_err_stale;
+    }
+
+    if (header.keysCount > index->size / 8 || header.postingsCount > index->size / 4) {
+        return snapshot_err_corrupt;
+    }
+
+    size_t offsets = sizeof(TrigramHeader) + alignSection(header.keysCount * sizeof(uint32_t));
+    size_t rows = offsets + alignSection((header.keysCount + 1) * sizeof(uint32_t));
+
+    if (rows + alignSection(header.postingsCount * sizeof(uint32_t)) != index->size ||
+        hashSection(SNAPSHOT_CHECKSUM_SEED, data + sizeof(TrigramHeader), index->size - sizeof(TrigramHeader)) !=
+            header.checksum) {
+        return snapshot_err_corrupt;
+    }
+
+    index->keys = (const uint32_t *)(data + sizeof(TrigramHeader));
+    index->offsets = (const uint32_t *)(data + offsets);
+    index->rows = (const uint32_t *)(data + rows);
+    index->keysCount = header.keysCount;
+    index->rowsCount = header.rowsCount;
+
+    if (index->offsets[0] != 0 || index->offsets[header.keysCount] != header.postingsCount) {
+        return snapshot_err_corrupt;
+    }
+
+    for (size_t i = 0; i < header.keysCount; i++) {
+        if (index->offsets[i] > index->offsets[i + 1] || (i > 0 && index->keys[i - 1] >= index->keys[i])) {
+            return snapshot_err_corrupt;
+        }
+    }
+
+    return snapshot_err_ok;
+}
+
+snapshot_err openTrigramIndex(const char *path, uint64_t sourceKey, size_t rowsCount, TrigramIndex **outIndex) {
+    struct stat fileStat;
+    int fd = open(path, O_RDONLY);
+
+    if (fd < 0) {
+        return snapshot_err_io_failed;
+    }
+
+    if (fstat(fd, &fileStat) != 0) {
+        close(fd);
+        return snapshot_err_io_failed;
+    }
+
+    if (fileStat.st_size < (off_t)sizeof(TrigramHeader)) {
+        close(fd);
+        return snapshot_err_corrupt;
+    }
+
+    TrigramIndex *index = calloc(1, sizeof(TrigramIndex));
+
+    statsCountAlloc(stats_component_models, sizeof(TrigramIndex));
+    if (index == NULL) {
+        close(fd);
+        return snapshot_err_io_failed;
+    }
+
+    index->size = (size_t)fileStat.st_size;
+    index->data = mmap(NULL, index->size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+
+    if (index->data == MAP_FAILED) {
+        free(index);
+        return snapshot_err_io_failed;
+    }
+
+    snapshot_err err = checkTrigramIndex(index, sourceKey, rowsCount);
+
+    if (err != snapshot_err_ok) {
+        freeTrigramIndex(index);
+        return err;
+    }
+
+    *outIndex = index;
+    return snapshot_err_ok;
+}
@@ -0,0 +1,98 @@
+#ifndef trigram_h
+#define trigram_h
+#include <stdint.h>
+#include <stdlib.h>
+#include <arena/arena.h>
+#include "store.h"
+#include "query.h"
+#include "snapshot.h"
+
+/*
+ * Version of the trigram file layout. Files of any other version are stale.
+ */
+#define TRIGRAM_INDEX_VERSION 1
+
+/*
+ * TrigramIndex maps every three consecutive title bytes to the ascending
+ * list of rows whose title holds them. A substring search intersects the
+ * lists of its trigrams, then checks the few rows left.
+ *
+ * It's either built, growing as rows are added, or mapped from a file
+ * written by writeTrigramIndex, which is read only until it's spliced.
+ */
+typedef struct TrigramIndex TrigramIndex;
+
+/*
+ * newTrigramIndex creates an empty index, to be filled with trigramIndexAdd.
+ *
+ * Returns a `json_err_alloc_failed` if it cannot be allocated.
+ */
+json_err newTrigramIndex(TrigramIndex **outIndex);
+
+/*
+ * Releases an index, unmapping its file if it was opened from one.
+ */
+void freeTrigramIndex(TrigramIndex *index);
+
+/*
+ * trigramIndexAdd indexes the title of a row. Rows must be added in
+ * ascending order, as they're appended to a TodoStore.
+ *
+ * Returns a `json_err_alloc_failed` if a posting list cannot grow, or a
+ * `json_err_invalid_type` if the index is mapped.
+ */
+json_err trigramIndexAdd(TrigramIndex *index, uint32_t row, const char *title, size_t size);
+
+/*
+ * trigramIndexAddStore indexes every row of the store not indexed yet.
+ */
+json_err trigramIndexAddStore(TrigramIndex *index, const TodoStore *store);
+
+/*
+ * trigramIndexSplice follows a todoStoreSplice of the indexed store, which
+ * replaced the rows from start up to end with count rows. Only those are
+ * indexed, the rows after them being moved in the lists holding them. A
+ * mapped index is copied out of its file first.
+ *
+ * store - The store after the splice.
+ *
+ * Returns a `json_err_alloc_failed` if a list cannot grow, in which case
+ * the index must be released.
+ */
+json_err trigramIndexSplice(TrigramIndex *index, size_t start, size_t end, const TodoStore *store, size_t count);
+
+/*
+ * trigramSearch finds the rows whose title contains text.
+ *
+ * index    - Index of the store titles.
+ * store    - Indexed store, used to check the candidates.
+ * text     - Searched bytes. Shorter than a trigram, every title is scanned.
+ * arena    - Where the result is allocated.
+ * outRows  - Receives the matching rows, ascending. Never NULL, even when
+ *            nothing matches.
+ * outCount - Receives the amount of matching rows.
+ *
+ * Returns a `query_err_alloc_failed` if the result cannot be allocated.
+ */
+query_err trigramSearch(const TrigramIndex *index, const TodoStore *store, const char *text, Arena *arena,
+                        uint32_t **outRows, size_t *outCount);
+
+/*
+ * writeTrigramIndex saves an index into path, replacing it atomically, in
+ * the same header and sections layout as a TodoSnapshot. A mapped index is
+ * copied as is, under the new key.
+ *
+ * sourceKey - Identifies what the store was built from, as for snapshots.
+ */
+snapshot_err writeTrigramIndex(const TrigramIndex *index, const char *path, uint64_t sourceKey);
+
+/*
+ * openTrigramIndex maps an index written by writeTrigramIndex.
+ *
+ * rowsCount - Rows of the store it must cover.
+ *
+ * Returns the same errors as openTodoSnapshot.
+ */
+snapshot_err openTrigramIndex(const char *path, uint64_t sourceKey, size_t rowsCount, TrigramIndex **outIndex);
+
+#endif
@@ -0,0 +1,183 @@
+#include <stdio.h>
+#include <string.h>
+#include <json-c/json.h>
+#include <stats/stats.h>
+#include "users.h"
+#include "store.h"
+
+static inline size_t userSlot(int32_t ID, size_t capacity) {
+    return (size_t)((uint32_t)ID * 0x9e3779b1u) & (capacity - 1);
+}
+
+uint32_t userMapFind(const UserMap *map, int32_t ID) {
+    size_t slot = userSlot(ID, map->capacity);
+
+    while (map->slots[slot] != 0) {
+        uint32_t user = map->slots[slot] - 1;
+
+        if (map->IDs[user] == ID) {
+            return user;
+        }
+
+        slot = (slot + 1) & (map->capacity - 1);
+    }
+
+    return USER_MAP_MISSING;
+}
+
+/*
+ * allocUserMap allocates a map able to hold `length` users, with at least
+ * twice as many slots.
+ */
+static json_err allocUserMap(Arena *arena, size_t length, size_t namesSize, UserMap **outMap) {
+    size_t capacity = 16;
+
+    while (capacity < length * 2) {
+        capacity *= 2;
+    }
+
+    UserMap *map = arenaAlloc(arena, sizeof(UserMap));
+    int32_t *IDs = arenaAlloc(arena, length * sizeof(int32_t) + 1);
+    uint32_t *nameOffsets = arenaAlloc(arena, length * sizeof(uint32_t) + 1);
+    uint32_t *nameLengths = arenaAlloc(arena, length * sizeof(uint32_t) + 1);
+    char *names = arenaAlloc(arena, namesSize + 1);
+    uint32_t *slots = arenaCalloc(arena, capacity, sizeof(uint32_t));
+    statsCountAlloc(stats_component_models, sizeof(UserMap) + length * (sizeof(int32_t) + 2 * sizeof(uint32_t)) +
+                                                namesSize + capacity * sizeof(uint32_t));
+
+    if (map == NULL || IDs == NULL || nameOffsets == NULL || nameLengths == NULL || names == NULL || slots == NULL) {
+        return json_err_alloc_failed;
+    }
+
+    *map = (UserMap){ length: 0, IDs: IDs, nameOffsets: nameOffsets, nameLengths: nameLengths, names: names,
+                      slots: slots, capacity: capacity };
+    *outMap = map;
+    return json_err_ok;
+}
+
+/*
+ * readUser returns the id and name of a user object, or false when it
+ * doesn't have both.
+ */
+static bool readUser(json_object *user, int32_t *outID, const char **outName, size_t *outNameLength) {
+    json_object *ID = json_object_object_get(user, "id");
+    json_object *name = json_object_object_get(user, "name");
+
+    if (json_object_get_type(ID) != json_type_int || json_object_get_type(name) != json_type_string) {
+        return false;
+    }
+
+    *outID = json_object_get_int(ID);
+    *outName = json_object_get_string(name);
+    *outNameLength = (size_t)json_object_get_string_len(name);
+    return true;
+}
+
+json_err parseUserMap(Arena *arena, const char *json, size_t size, UserMap **outMap) {
+    struct json_tokener *tok = json_tokener_new();
+
+    if (tok == NULL) {
+        return json_err_alloc_failed;
+    }
+
+    json_object *list = json_tokener_parse_ex(tok, json, (int)size);
+    enum json_tokener_error tokErr = json_tokener_get_error(tok);
+    json_tokener_free(tok);
+
+    if (list == NULL || tokErr != json_tokener_success) {
+        json_object_put(list);
+        return json_err_parse_failed;
+    }
+
+    if (json_object_get_type(list) != json_type_array) {
+        json_object_put(list);
+        return json_err_invalid_type;
+    }
+
+    size_t length = json_object_array_length(list);
+    size_t namesSize = 0;
+    int32_t ID;
+    const char *name;
+    size_t nameLength;
+
+    for (size_t i = 0; i < length; i++) {
+        if (readUser(json_object_array_get_idx(list, i), &ID, &name, &nameLength)) {
+            namesSize += nameLength + 1;
+        }
+    }
+
+    UserMap *map = NULL;
+    json_err err = namesSize <= UINT32_MAX ? allocUserMap(arena, length, namesSize, &map) : json_err_alloc_failed;
+    size_t namesUsed = 0;
+
+    for (size_t i = 0; i < length && err == json_err_ok; i++) {
+        if (!readUser(json_object_array_get_idx(list, i), &ID, &name, &nameLength)) {
+            continue;
+        }
+
+        size_t slot = userSlot(ID, map->capacity);
+
+        while (map->slots[slot] != 0 && map->IDs[map->slots[slot] - 1] != ID) {
+            slot = (slot + 1) & (map->capacity - 1);
+        }
+
+        if (map->slots[slot] != 0) {
+            continue;
+        }
+
+        map->IDs[map->length] = ID;
+        map->nameOffsets[map->length] = (uint32_t)namesUsed;
+        map->nameLengths[map->length] = (uint32_t)nameLength;
+        memcpy(map->names + namesUsed, name, nameLength + 1);
+        namesUsed += nameLength + 1;
+        map->slots[slot] = (uint32_t)++map->length;
+    }
+
+    json_object_put(list);
+
+    if (err == json_err_ok) {
+        *outMap = map;
+    }
+
+    return err;
+}
+
+json_err joinTodoUsers(Arena *arena, const TodoStore *store, const UserMap *map, uint32_t **outRowUsers) {
+    uint32_t *rowUsers = arenaAlloc(arena, store->length * sizeof(uint32_t) + 1);
+    statsCountAlloc(stats_component_models, store->length * sizeof(uint32_t));
+
+    if (rowUsers == NULL) {
+        return json_err_alloc_failed;
+    }
+
+    /*
+     * Lists come grouped by user, so most rows reuse the previous lookup.
+     */
+    int32_t lastID = 0;
+    uint32_t lastUser = userMapFind(map, lastID);
+
+    for (size_t i = 0; i < store->length; i++) {
+        if (store->userIDs[i] != lastID) {
+            lastID = store->userIDs[i];
+            lastUser = userMapFind(map, lastID);
+        }
+
+        rowUsers[i] = lastUser;
+    }
+
+    *outRowUsers = rowUsers;
+    return json_err_ok;
+}
+
+const char *joinedTodoCell(void *source, size_t row, size_t column, char *scratch, size_t *outSize) {
+    JoinedTodoView *joined = (JoinedTodoView *)source;
+    uint32_t storeRow = joined->view.rows[row];
+    uint32_t user = joined->rowUsers[storeRow];
+
+    if (column != 0 || user == USER_MAP_MISSING) {
+        return todoStoreCell((void *)joined->view.store, storeRow, column, scratch, outSize);
+    }
+
+    *outSize = joined->users->nameLengths[user];
+    return joined->users->names + joined->users->nameOffsets[user];
+}
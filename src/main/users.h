@@ -0,0 +1,87 @@
+#ifndef users_h
+#define users_h
+#include <stdint.h>
+#include <stdlib.h>
+#include <arena/arena.h>
+#include "models.h"
+#include "query.h"
+
+/*
+ * Returned by userMapFind for ids without a user.
+ */
+#define USER_MAP_MISSING UINT32_MAX
+
+/*
+ * UserMap holds the names of a users list by id, in a compact open
+ * addressing table built once, so resolving a name never goes back to the
+ * json.
+ *
+ * length      - Amount of users.
+ * IDs         - id of each user.
+ * nameOffsets - Where each name starts inside names.
+ * nameLengths - Length of each name, without its NUL.
+ * names       - Blob holding every NUL terminated name.
+ * slots       - `index + 1` of the user in each slot. Zero marks an empty
+ *               slot.
+ * capacity    - Amount of slots, always a power of two.
+ */
+typedef struct {
+    size_t length;
+    int32_t *IDs;
+    uint32_t *nameOffsets;
+    uint32_t *nameLengths;
+    char *names;
+    uint32_t *slots;
+    size_t capacity;
+} UserMap;
+
+/*
+ * parseUserMap reads a json list of users, keeping the `id` and `name` of
+ * each one. Users without both are skipped, and repeated ids keep the first
+ * name.
+ *
+ * arena  - Where the map is allocated.
+ * json   - The json contents. It's left untouched.
+ * size   - Size of json.
+ * outMap - Receives the map.
+ *
+ * Returns the same errors as parseTODOList.
+ */
+json_err parseUserMap(Arena *arena, const char *json, size_t size, UserMap **outMap);
+
+/*
+ * userMapFind returns the index of the user with an id, or USER_MAP_MISSING.
+ */
+uint32_t userMapFind(const UserMap *map, int32_t ID);
+
+/*
+ * joinTodoUsers resolves the user of every row of a store in a single pass.
+ *
+ * outRowUsers - Receives the index in the map of each row user, or
+ *               USER_MAP_MISSING, allocated in the arena.
+ *
+ * Returns a `json_err_alloc_failed` if the column cannot be allocated.
+ */
+json_err joinTodoUsers(Arena *arena, const TodoStore *store, const UserMap *map, uint32_t **outRowUsers);
+
+/*
+ * JoinedTodoView is a TodoView whose users are shown by name.
+ *
+ * view     - Viewed rows.
+ * users    - Map the names come from.
+ * rowUsers - User of each store row, from joinTodoUsers.
+ */
+typedef struct {
+    TodoView view;
+    const UserMap *users;
+    const uint32_t *rowUsers;
+} JoinedTodoView;
+
+/*
+ * joinedTodoCell is the TableCellGetter reading a Table from a
+ * JoinedTodoView, with the same columns as todoStoreCell except the first
+ * one, which holds the user name. Rows without a known user keep their id.
+ */
+const char *joinedTodoCell(void *source, size_t row, size_t column, char *scratch, size_t *outSize);
+
+#endif
@@ -0,0 +1,81 @@
+#include <pthread.h>
+#include <stdatomic.h>
+#include <unistd.h>
+#include "parallel.h"
+
+/*
+ * ParallelJob is shared by every thread running a parallelFor. Threads pick
+ * the next chunk from it until there's none left.
+ *
+ * count     - Size of the range.
+ * chunks    - Amount of chunks.
+ * nextChunk - Next chunk to be picked.
+ * task      - Task to be run.
+ * context   - Passed to task.
+ */
+typedef struct {
+    size_t count;
+    size_t chunks;
+    atomic_size_t nextChunk;
+    ParallelTask task;
+    void *context;
+} ParallelJob;
+
+void parallelChunkRange(size_t count, size_t chunks, size_t chunk, size_t *outStart, size_t *outEnd) {
+    size_t base = count / chunks;
+    size_t extra = count % chunks;
+
+    *outStart = chunk * base + (chunk < extra ? chunk : extra);
+    *outEnd = *outStart + base + (chunk < extra ? 1 : 0);
+}
+
+static void *runChunks(void *rawJob) {
+    ParallelJob *job = (ParallelJob *)rawJob;
+    size_t chunk;
+
+    while ((chunk = atomic_fetch_add(&job->nextChunk, 1)) < job->chunks) {
+        size_t start;
+        size_t end;
+
+        parallelChunkRange(job->count, job->chunks, chunk, &start, &end);
+        job->task(chunk, start, end, job->context);
+    }
+
+    return NULL;
+}
+
+parallel_err parallelFor(size_t count, size_t chunks, size_t threads, ParallelTask task, void *context) {
+    if (count == 0) {
+        return parallel_err_ok;
+    }
+
+    chunks = chunks < 1 ? 1 : (chunks > count ? count : chunks);
+    threads = threads < 1 ? 1 : (threads > chunks ? chunks : threads);
+
+    ParallelJob job = { count: count, chunks: chunks, task: task, context: context };
+    atomic_init(&job.nextChunk, 0);
+    pthread_t workers[threads];
+    size_t started = 0;
+    parallel_err err = parallel_err_ok;
+
+    for (size_t i = 1; i < threads; i++) {
+        if (pthread_create(&workers[started], NULL, runChunks, &job) != 0) {
+            err = parallel_err_thread_failed;
+            break;
+        }
+        started++;
+    }
+
+    runChunks(&job);
+
+    for (size_t i = 0; i < started; i++) {
+        pthread_join(workers[i], NULL);
+    }
+
+    return err;
+}
+
+size_t parallelAvailableThreads(void) {
+    long online = sysconf(_SC_NPROCESSORS_ONLN);
+    return online > 0 ? (size_t)online : 1;
+}
@@ -0,0 +1,47 @@
+#ifndef parallel_h
+#define parallel_h
+#include <stdlib.h>
+
+typedef enum {
+    parallel_err_ok = 0,
+    parallel_err_thread_failed = 1
+} parallel_err;
+
+/*
+ * ParallelTask processes one chunk of a range split by parallelFor.
+ *
+ * chunk   - Index of the chunk, from 0 to the amount of chunks.
+ * start   - First index of the chunk.
+ * end     - One past the last index of the chunk.
+ * context - The context provided to parallelFor.
+ */
+typedef void (*ParallelTask)(size_t chunk, size_t start, size_t end, void *context);
+
+/*
+ * parallelFor splits `[0, count)` into `chunks` contiguous ranges of about the
+ * same size and runs the task over them using up to `threads` threads,
+ * the calling one included. It returns once every chunk is done.
+ *
+ * count   - Size of the range.
+ * chunks  - Amount of chunks, clamped between 1 and count.
+ * threads - Amount of threads, clamped between 1 and chunks.
+ * task    - Called once per chunk, concurrently.
+ * context - Passed untouched to task.
+ *
+ * Returns a `parallel_err_thread_failed` if a thread cannot be started. The
+ * chunks which couldn't get a thread are still run by the other ones.
+ */
+parallel_err parallelFor(size_t count, size_t chunks, size_t threads, ParallelTask task, void *context);
+
+/*
+ * parallelChunkRange returns the `[start, end)` range of a chunk, the same way
+ * parallelFor splits it.
+ */
+void parallelChunkRange(size_t count, size_t chunks, size_t chunk, size_t *outStart, size_t *outEnd);
+
+/*
+ * parallelAvailableThreads returns the amount of online cpus.
+ */
+size_t parallelAvailableThreads(void);
+
+#endif
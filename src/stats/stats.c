@@ -0,0 +1,95 @@
+#include <time.h>
+#include <stdatomic.h>
+#include "stats.h"
+
+bool statsEnabled = false;
+
+static const char *STAGE_NAMES[stats_stage_count] = { "fetch", "parse", "measure", "format", "render", "total" };
+static const char *COMPONENT_NAMES[stats_component_count] = { "models", "table", "main" };
+
+static _Atomic uint64_t stageNanoseconds[stats_stage_count];
+static _Atomic uint64_t stageSpans[stats_stage_count];
+static _Atomic uint64_t allocCounts[stats_component_count];
+static _Atomic uint64_t allocBytes[stats_component_count];
+/*
+ * Transfers are only recorded by the thread using a HttpClient.
+ */
+static uint64_t transfers;
+static StatsTransfer transferTotals;
+static _Atomic uint64_t httpEvents[stats_http_event_count];
+static _Atomic uint64_t cacheHits;
+static _Atomic uint64_t cacheMisses;
+static _Atomic uint64_t cacheBytesSaved;
+
+void statsEnable(void) {
+    statsEnabled = true;
+}
+
+uint64_t statsNow(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000ULL + (uint64_t)now.tv_nsec;
+}
+
+void statsRecordSpan(stats_stage stage, uint64_t nanoseconds) {
+    atomic_fetch_add_explicit(&stageNanoseconds[stage], nanoseconds, memory_order_relaxed);
+    atomic_fetch_add_explicit(&stageSpans[stage], 1, memory_order_relaxed);
+}
+
+void statsRecordAlloc(stats_component component, size_t bytes) {
+    atomic_fetch_add_explicit(&allocCounts[component], 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&allocBytes[component], bytes, memory_order_relaxed);
+}
+
+void statsRecordTransfer(const StatsTransfer *transfer) {
+    transfers++;
+    transferTotals.bytesReceived += transfer->bytesReceived;
+    transferTotals.nameLookupUs += transfer->nameLookupUs;
+    transferTotals.connectUs += transfer->connectUs;
+    transferTotals.tlsUs += transfer->tlsUs;
+    transferTotals.startTransferUs += transfer->startTransferUs;
+    transferTotals.totalUs += transfer->totalUs;
+}
+
+void statsRecordHttpEvent(stats_http_event event) {
+    atomic_fetch_add_explicit(&httpEvents[event], 1, memory_order_relaxed);
+}
+
+uint64_t statsHttpEvents(stats_http_event event) {
+    return atomic_load_explicit(&httpEvents[event], memory_order_relaxed);
+}
+
+void statsRecordCache(bool hit, size_t bytesSaved) {
+    atomic_fetch_add_explicit(hit ? &cacheHits : &cacheMisses, 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&cacheBytesSaved, bytesSaved, memory_order_relaxed);
+}
+
+void statsReport(FILE *file) {
+    fprintf(file, "{\"stages\":{");
+    for (size_t i = 0; i < stats_stage_count; i++) {
+        fprintf(file, "%s\"%s\":{\"ms\":%.3f,\"spans\":%llu}", i > 0 ? "," : "", STAGE_NAMES[i],
+                (double)atomic_load(&stageNanoseconds[i]) / 1e6, (unsigned long long)atomic_load(&stageSpans[i]));
+    }
+
+    fprintf(file, "},\"allocations\":{");
+    for (size_t i = 0; i < stats_component_count; i++) {
+        fprintf(file, "%s\"%s\":{\"count\":%llu,\"bytes\":%llu}", i > 0 ? "," : "", COMPONENT_NAMES[i],
+                (unsigned long long)atomic_load(&allocCounts[i]), (unsigned long long)atomic_load(&allocBytes[i]));
+    }
+
+    fprintf(file,
+            "},\"http\":{\"transfers\":%llu,\"bytes_received\":%llu,\"name_lookup_ms\":%.3f,\"connect_ms\":%.3f,"
+            "\"tls_ms\":%.3f,\"start_transfer_ms\":%.3f,\"total_ms\":%.3f,\"retries\":%llu,\"timeouts\":%llu,"
+            "\"hedges\":%llu,\"hedges_won\":%llu,\"failures\":%llu}",
+            (unsigned long long)transfers, (unsigned long long)transferTotals.bytesReceived,
+            transferTotals.nameLookupUs / 1e3, transferTotals.connectUs / 1e3, transferTotals.tlsUs / 1e3,
+            transferTotals.startTransferUs / 1e3, transferTotals.totalUs / 1e3,
+            (unsigned long long)atomic_load(&httpEvents[stats_http_retry]),
+            (unsigned long long)atomic_load(&httpEvents[stats_http_timeout]),
+            (unsigned long long)atomic_load(&httpEvents[stats_http_hedge]),
+            (unsigned long long)atomic_load(&httpEvents[stats_http_hedge_won]),
+            (unsigned long long)atomic_load(&httpEvents[stats_http_failure]));
+    fprintf(file, ",\"cache\":{\"hits\":%llu,\"misses\":%llu,\"bytes_saved\":%llu}}\n",
+            (unsigned long long)atomic_load(&cacheHits), (unsigned long long)atomic_load(&cacheMisses),
+            (unsigned long long)atomic_load(&cacheBytesSaved));
+}
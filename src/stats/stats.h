@@ -0,0 +1,149 @@
+#ifndef stats_h
+#define stats_h
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdbool.h>
+
+/*
+ * Pipeline stages timed by statsSpanStart and statsSpanEnd. Each one adds up
+ * every span recorded for it.
+ */
+typedef enum {
+    stats_stage_fetch = 0,
+    stats_stage_parse = 1,
+    stats_stage_measure = 2,
+    stats_stage_format = 3,
+    stats_stage_render = 4,
+    stats_stage_total = 5,
+    stats_stage_count = 6
+} stats_stage;
+
+/*
+ * Modules whose allocations are counted by statsCountAlloc.
+ */
+typedef enum {
+    stats_component_models = 0,
+    stats_component_table = 1,
+    stats_component_main = 2,
+    stats_component_count = 3
+} stats_component;
+
+/*
+ * Outcomes of http requests counted by statsRecordHttpEvent.
+ *
+ * retry     - An attempt was retried.
+ * timeout   - An attempt timed out.
+ * hedge     - A second attempt was sent while the first one was slow.
+ * hedge_won - The second attempt answered first.
+ * failure   - A request failed after every attempt.
+ */
+typedef enum {
+    stats_http_retry = 0,
+    stats_http_timeout = 1,
+    stats_http_hedge = 2,
+    stats_http_hedge_won = 3,
+    stats_http_failure = 4,
+    stats_http_event_count = 5
+} stats_http_event;
+
+/*
+ * StatsTransfer holds what curl reports about a finished transfer.
+ *
+ * bytesReceived   - Body bytes downloaded.
+ * nameLookupUs    - Microseconds until the name was resolved.
+ * connectUs       - Microseconds until the connection was made.
+ * tlsUs           - Microseconds until the TLS handshake was done.
+ * startTransferUs - Microseconds until the first byte was received.
+ * totalUs         - Microseconds of the whole transfer.
+ */
+typedef struct {
+    uint64_t bytesReceived;
+    uint64_t nameLookupUs;
+    uint64_t connectUs;
+    uint64_t tlsUs;
+    uint64_t startTransferUs;
+    uint64_t totalUs;
+} StatsTransfer;
+
+/*
+ * Whether anything is recorded. It's only set by statsEnable, so every hook
+ * costs a single predictable branch while it's off. Building with
+ * STATS_DISABLED defined removes the hooks altogether.
+ */
+extern bool statsEnabled;
+
+/*
+ * statsEnable starts recording. Must be called before any other thread
+ * is started.
+ */
+void statsEnable(void);
+
+/*
+ * statsNow returns the current monotonic time, in nanoseconds.
+ */
+uint64_t statsNow(void);
+
+void statsRecordSpan(stats_stage stage, uint64_t nanoseconds);
+void statsRecordAlloc(stats_component component, size_t bytes);
+
+/*
+ * statsRecordTransfer adds up a finished curl transfer.
+ */
+void statsRecordTransfer(const StatsTransfer *transfer);
+
+/*
+ * statsRecordHttpEvent counts an outcome of a http request.
+ */
+void statsRecordHttpEvent(stats_http_event event);
+
+/*
+ * statsHttpEvents returns how many times an outcome was counted.
+ */
+uint64_t statsHttpEvents(stats_http_event event);
+
+/*
+ * statsRecordCache counts a request that went through a HttpCache.
+ *
+ * hit        - Whether the cached body was used.
+ * bytesSaved - Bytes which weren't downloaded thanks to it.
+ */
+void statsRecordCache(bool hit, size_t bytesSaved);
+
+/*
+ * statsReport writes everything recorded as a single json object:
+ * `{"stages": {...}, "allocations": {...}, "http": {...}, "cache": {...}}`.
+ * Stage times are in milliseconds.
+ */
+void statsReport(FILE *file);
+
+#ifdef STATS_DISABLED
+#define STATS_ACTIVE false
+#else
+#define STATS_ACTIVE __builtin_expect(statsEnabled, 0)
+#endif
+
+/*
+ * statsSpanStart returns the start of a span, to be handed to statsSpanEnd.
+ */
+static inline uint64_t statsSpanStart(void) {
+    return STATS_ACTIVE ? statsNow() : 0;
+}
+
+static inline void statsSpanEnd(stats_stage stage, uint64_t start) {
+    if (STATS_ACTIVE) {
+        statsRecordSpan(stage, statsNow() - start);
+    }
+}
+
+/*
+ * statsCountAlloc counts an allocation of `bytes` made by a component. It's
+ * safe to call from any thread.
+ */
+static inline void statsCountAlloc(stats_component component, size_t bytes) {
+    if (STATS_ACTIVE) {
+        statsRecordAlloc(component, bytes);
+    }
+}
+
+#endif
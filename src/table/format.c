@@ -0,0 +1,390 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "format.h"
+#include "layout.h"
+#include <stats/stats.h>
+
+/*
+ * TableRenderer writes each row through writeRow, after writeHeader and
+ * before writeFooter. The box has none of them, and is only rendered as a
+ * whole Table.
+ */
+struct TableRenderer {
+    const char *name;
+    table_err (*writeHeader)(TableStream *stream);
+    table_err (*writeRow)(TableStream *stream, const char *const *cells, const size_t *sizes);
+    table_err (*writeFooter)(TableStream *stream);
+};
+
+/*
+ * buffer - Pending output.
+ * err    - First error met, returned by every later call.
+ */
+struct TableStream {
+    const TableRenderer *renderer;
+    TABLE_DATA_ROW headers;
+    size_t headersCount;
+    TABLE_DATA_ROW keys;
+    const table_column_type *types;
+    OutputBuffer buffer;
+    table_err err;
+};
+
+/*
+ * append writes bytes to the stream buffer, reserving room for them.
+ */
+static table_err append(TableStream *stream, const char *data, size_t size) {
+    table_err err = reserveBuffer(&stream->buffer, size);
+
+    if (err == table_err_ok) {
+        appendBuffer(&stream->buffer, data, size);
+    }
+
+    return err;
+}
+
+static inline table_err appendString(TableStream *stream, const char *str) {
+    return append(stream, str, strlen(str));
+}
+
+/*
+ * appendCsvField writes a field, quoted when it holds a comma, a quote or
+ * a line break, with its quotes doubled.
+ */
+static table_err appendCsvField(TableStream *stream, const char *cell, size_t size) {
+    bool quoted = false;
+
+    for (size_t i = 0; i < size && !quoted; i++) {
+        quoted = cell[i] == ',' || cell[i] == '"' || cell[i] == '\r' || cell[i] == '\n';
+    }
+
+    if (!quoted) {
+        return append(stream, cell, size);
+    }
+
+    table_err err = append(stream, "\"", 1);
+
+    for (size_t start = 0, i = 0; err == table_err_ok && i <= size; i++) {
+        if (i == size || cell[i] == '"') {
+            err = append(stream, cell + start, i - start + (i < size));
+            start = i;
+        }
+    }
+
+    return err == table_err_ok ? append(stream, "\"", 1) : err;
+}
+
+/*
+ * appendJsonString writes a json string, escaping quotes, backslashes and
+ * control characters.
+ */
+static table_err appendJsonString(TableStream *stream, const char *str, size_t size) {
+    table_err err = append(stream, "\"", 1);
+    size_t start = 0;
+
+    for (size_t i = 0; err == table_err_ok && i < size; i++) {
+        unsigned char byte = (unsigned char)str[i];
+
+        if (byte >= 0x20 && byte != '"' && byte != '\\') {
+            continue;
+        }
+
+        char escape[8];
+        int escapeSize = byte == '"' || byte == '\\' ? snprintf(escape, sizeof(escape), "\\%c", byte)
+                         : byte == '\n'              ? snprintf(escape, sizeof(escape), "\\n")
+                         : byte == '\t'              ? snprintf(escape, sizeof(escape), "\\t")
+                                                     : snprintf(escape, sizeof(escape), "\\u%04x", byte);
+
+        err = append(stream, str + start, i - start);
+        if (err == table_err_ok) {
+            err = append(stream, escape, (size_t)escapeSize);
+        }
+        start = i + 1;
+    }
+
+    if (err == table_err_ok) {
+        err = append(stream, str + start, size - start);
+    }
+
+    return err == table_err_ok ? append(stream, "\"", 1) : err;
+}
+
+/*
+ * isJsonInteger tells whether a cell can be written as a json number.
+ */
+static bool isJsonInteger(const char *cell, size_t size) {
+    size_t i = size > 0 && cell[0] == '-' ? 1 : 0;
+
+    if (i == size || (cell[i] == '0' && size > i + 1)) {
+        return false;
+    }
+
+    for (; i < size; i++) {
+        if (cell[i] < '0' || cell[i] > '9') {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/*
+ * appendMarkdownCell writes a cell with its pipes escaped and its line
+ * breaks turned into spaces, so it stays inside its column.
+ */
+static table_err appendMarkdownCell(TableStream *stream, const char *cell, size_t size) {
+    table_err err = append(stream, " ", 1);
+    size_t start = 0;
+
+    for (size_t i = 0; err == table_err_ok && i < size; i++) {
+        if (cell[i] != '|' && cell[i] != '\n' && cell[i] != '\r') {
+            continue;
+        }
+
+        err = append(stream, cell + start, i - start);
+        if (err == table_err_ok) {
+            err = cell[i] == '|' ? append(stream, "\\|", 2) : append(stream, " ", 1);
+        }
+        start = i + 1;
+    }
+
+    if (err == table_err_ok) {
+        err = append(stream, cell + start, size - start);
+    }
+
+    return err == table_err_ok ? append(stream, " |", 2) : err;
+}
+
+static table_err writeCsvRow(TableStream *stream, const char *const *cells, const size_t *sizes) {
+    table_err err = table_err_ok;
+
+    for (size_t i = 0; i < stream->headersCount && err == table_err_ok; i++) {
+        if (i > 0) {
+            err = append(stream, ",", 1);
+        }
+
+        if (err == table_err_ok) {
+            err = appendCsvField(stream, cells[i], sizes[i]);
+        }
+    }
+
+    return err == table_err_ok ? append(stream, "\n", 1) : err;
+}
+
+static table_err writeCsvHeader(TableStream *stream) {
+    size_t sizes[stream->headersCount + 1];
+
+    for (size_t i = 0; i < stream->headersCount; i++) {
+        sizes[i] = strlen(stream->headers[i]);
+    }
+
+    return writeCsvRow(stream, (const char *const *)stream->headers, sizes);
+}
+
+static table_err writeNdjsonRow(TableStream *stream, const char *const *cells, const size_t *sizes) {
+    table_err err = append(stream, "{", 1);
+
+    for (size_t i = 0; i < stream->headersCount && err == table_err_ok; i++) {
+        if (i > 0) {
+            err = append(stream, ",", 1);
+        }
+
+        const char *key = stream->keys != NULL ? stream->keys[i] : stream->headers[i];
+        table_column_type type = stream->types != NULL ? stream->types[i] : table_column_text;
+
+        if (err == table_err_ok) {
+            err = appendJsonString(stream, key, strlen(key));
+        }
+
+        if (err == table_err_ok) {
+            err = append(stream, ":", 1);
+        }
+
+        if (err != table_err_ok) {
+            break;
+        }
+
+        if (type == table_column_number && isJsonInteger(cells[i], sizes[i])) {
+            err = append(stream, cells[i], sizes[i]);
+        } else if (type == table_column_boolean && sizes[i] == 3 && memcmp(cells[i], "Yes", 3) == 0) {
+            err = appendString(stream, "true");
+        } else if (type == table_column_boolean && sizes[i] == 2 && memcmp(cells[i], "No", 2) == 0) {
+            err = appendString(stream, "false");
+        } else {
+            err = appendJsonString(stream, cells[i], sizes[i]);
+        }
+    }
+
+    return err == table_err_ok ? append(stream, "}\n", 2) : err;
+}
+
+static table_err writeMarkdownRow(TableStream *stream, const char *const *cells, const size_t *sizes) {
+    table_err err = append(stream, "|", 1);
+
+    for (size_t i = 0; i < stream->headersCount && err == table_err_ok; i++) {
+        err = appendMarkdownCell(stream, cells[i], sizes[i]);
+    }
+
+    return err == table_err_ok ? append(stream, "\n", 1) : err;
+}
+
+static table_err writeMarkdownHeader(TableStream *stream) {
+    size_t sizes[stream->headersCount + 1];
+
+    for (size_t i = 0; i < stream->headersCount; i++) {
+        sizes[i] = strlen(stream->headers[i]);
+    }
+
+    table_err err = writeMarkdownRow(stream, (const char *const *)stream->headers, sizes);
+
+    if (err == table_err_ok) {
+        err = append(stream, "|", 1);
+    }
+
+    for (size_t i = 0; i < stream->headersCount && err == table_err_ok; i++) {
+        err = appendString(stream, " --- |");
+    }
+
+    return err == table_err_ok ? append(stream, "\n", 1) : err;
+}
+
+static const TableRenderer RENDERERS[] = {
+    { name: "box", writeHeader: NULL, writeRow: NULL, writeFooter: NULL },
+    { name: "csv", writeHeader: writeCsvHeader, writeRow: writeCsvRow, writeFooter: NULL },
+    { name: "ndjson", writeHeader: NULL, writeRow: writeNdjsonRow, writeFooter: NULL },
+    { name: "markdown", writeHeader: writeMarkdownHeader, writeRow: writeMarkdownRow, writeFooter: NULL }
+};
+
+const TableRenderer *findTableRenderer(const char *name) {
+    for (size_t i = 0; i < sizeof(RENDERERS) / sizeof(RENDERERS[0]); i++) {
+        if (strcmp(RENDERERS[i].name, name) == 0) {
+            return &RENDERERS[i];
+        }
+    }
+
+    return NULL;
+}
+
+bool tableRendererStreams(const TableRenderer *renderer) {
+    return renderer->writeRow != NULL;
+}
+
+table_err newTableStream(const TableRenderer *renderer, TABLE_DATA_ROW headers, size_t headersCount,
+                         TABLE_DATA_ROW keys, const table_column_type *types, TableSink sink, void *sinkContext,
+                         TableStream **outStream) {
+    if (renderer == NULL || !tableRendererStreams(renderer) || sink == NULL) {
+        return table_err_invalid_input;
+    }
+
+    for (size_t i = 0; i < headersCount; i++) {
+        if (headers[i] == NULL || (keys != NULL && keys[i] == NULL)) {
+            return table_err_invalid_input;
+        }
+    }
+
+    TableStream *stream = malloc(sizeof(TableStream));
+    char *data = malloc(OUTPUT_CHUNK_SIZE);
+    statsCountAlloc(stats_component_table, sizeof(TableStream) + OUTPUT_CHUNK_SIZE);
+
+    if (stream == NULL || data == NULL) {
+        free(stream);
+        free(data);
+        return table_err_allocation_failed;
+    }
+
+    *stream = (TableStream){ renderer: renderer, headers: headers, headersCount: headersCount, keys: keys,
+                             types: types, buffer: { data: data, size: 0, capacity: OUTPUT_CHUNK_SIZE, sink: sink,
+                                       sinkContext: sinkContext },
+                             err: table_err_ok };
+
+    if (renderer->writeHeader != NULL) {
+        stream->err = renderer->writeHeader(stream);
+    }
+
+    *outStream = stream;
+    return table_err_ok;
+}
+
+table_err tableStreamRow(TableStream *stream, const char *const *cells, const size_t *sizes) {
+    if (stream->err != table_err_ok) {
+        return stream->err;
+    }
+
+    for (size_t i = 0; i < stream->headersCount; i++) {
+        if (cells[i] == NULL) {
+            return table_err_invalid_input;
+        }
+    }
+
+    stream->err = stream->renderer->writeRow(stream, cells, sizes);
+    return stream->err;
+}
+
+table_err flushTableStream(TableStream *stream) {
+    if (stream->err == table_err_ok) {
+        stream->err = flushBuffer(&stream->buffer);
+    }
+
+    return stream->err;
+}
+
+table_err closeTableStream(TableStream *stream) {
+    if (stream == NULL) {
+        return table_err_ok;
+    }
+
+    if (stream->err == table_err_ok && stream->renderer->writeFooter != NULL) {
+        stream->err = stream->renderer->writeFooter(stream);
+    }
+
+    table_err err = flushTableStream(stream);
+
+    free(stream->buffer.data);
+    free(stream);
+    return err;
+}
+
+/*
+ * streamTable writes every row of a Table through a TableStream.
+ */
+static table_err streamTable(const TableRenderer *renderer, Table *table, TableSink sink, void *sinkContext) {
+    if (table->rows == NULL && table->getCell == NULL && table->rowsCount > 0) {
+        return table_err_invalid_input;
+    }
+
+    TableStream *stream = NULL;
+    table_err err = newTableStream(renderer, table->headers, table->headersCount, table->keys, table->types, sink,
+                                   sinkContext, &stream);
+    char scratch[table->headersCount + 1][TABLE_CELL_SCRATCH_SIZE];
+    const char *cells[table->headersCount + 1];
+    size_t sizes[table->headersCount + 1];
+    uint64_t span = statsSpanStart();
+
+    for (size_t row = 0; row < table->rowsCount && err == table_err_ok; row++) {
+        for (size_t i = 0; i < table->headersCount; i++) {
+            sizes[i] = 0;
+            cells[i] = readCell(table, row, i, scratch[i], &sizes[i]);
+        }
+
+        err = tableStreamRow(stream, cells, sizes);
+    }
+
+    statsSpanEnd(stats_stage_format, span);
+
+    table_err closeErr = closeTableStream(stream);
+    return err != table_err_ok ? err : closeErr;
+}
+
+table_err renderTableWith(const TableRenderer *renderer, Table *table, size_t threads, TableSink sink,
+                          void *sinkContext) {
+    if (renderer == NULL || table == NULL || sink == NULL) {
+        return table_err_invalid_input;
+    }
+
+    if (!tableRendererStreams(renderer)) {
+        return renderTableParallel(table, threads, sink, sinkContext);
+    }
+
+    return streamTable(renderer, table, sink, sinkContext);
+}
@@ -0,0 +1,93 @@
+#ifndef format_h
+#define format_h
+#include <stdbool.h>
+#include "table.h"
+
+/*
+ * TableRenderer is an output format for a Table: the box drawn by
+ * renderTable, CSV, NDJSON or Markdown.
+ *
+ * Every format but the box writes each row on its own, without column
+ * widths, so it can also stream rows through a TableStream as they're
+ * produced, with no Table at all.
+ */
+typedef struct TableRenderer TableRenderer;
+
+/*
+ * findTableRenderer returns the renderer named `box`, `csv`, `ndjson` or
+ * `markdown`, or NULL for any other name.
+ */
+const TableRenderer *findTableRenderer(const char *name);
+
+/*
+ * tableRendererStreams tells whether a renderer writes rows as they come,
+ * so it can be used by a TableStream.
+ */
+bool tableRendererStreams(const TableRenderer *renderer);
+
+/*
+ * renderTableWith renders a whole Table in the renderer format.
+ *
+ * renderer    - Output format.
+ * table       - Table to be rendered.
+ * threads     - Threads used by the box, as in renderTableParallel. The
+ *               other formats take a single pass on the calling thread.
+ * sink        - Receives each chunk of output.
+ * sinkContext - Passed untouched to every sink call.
+ *
+ * Returns the same errors as renderTableParallel.
+ */
+table_err renderTableWith(const TableRenderer *renderer, Table *table, size_t threads, TableSink sink,
+                          void *sinkContext);
+
+/*
+ * TableStream writes rows in a streaming format as soon as they're given.
+ */
+typedef struct TableStream TableStream;
+
+/*
+ * newTableStream starts a stream, writing what goes before the first row,
+ * such as the headers.
+ *
+ * renderer     - Output format. It must stream.
+ * headers      - Headers of the columns, kept until the stream is closed.
+ * headersCount - Amount of columns.
+ * keys         - Name of each column in the formats keyed by them, or NULL
+ *                to key them by their headers, kept as headers.
+ * types        - Type of each column, or NULL, kept as headers.
+ * sink         - Receives each chunk of output.
+ * sinkContext  - Passed untouched to every sink call.
+ * outStream    - Receives the stream.
+ *
+ * Returns a `table_err_invalid_input` if the renderer doesn't stream or a
+ * header is NULL, and a `table_err_allocation_failed` if the stream cannot
+ * be allocated.
+ */
+table_err newTableStream(const TableRenderer *renderer, TABLE_DATA_ROW headers, size_t headersCount,
+                         TABLE_DATA_ROW keys, const table_column_type *types, TableSink sink, void *sinkContext,
+                         TableStream **outStream);
+
+/*
+ * tableStreamRow writes a row, as headersCount cells which don't need to be
+ * NUL terminated.
+ *
+ * Returns a `table_err_invalid_input` if a cell is NULL, or the errors of
+ * the sink.
+ */
+table_err tableStreamRow(TableStream *stream, const char *const *cells, const size_t *sizes);
+
+/*
+ * flushTableStream hands the rows written so far to the sink, which
+ * otherwise only receives full chunks.
+ */
+table_err flushTableStream(TableStream *stream);
+
+/*
+ * closeTableStream writes what goes after the last row, flushes and
+ * releases the stream.
+ *
+ * Returns the first error of the stream, if any.
+ */
+table_err closeTableStream(TableStream *stream);
+
+#endif
@@ -0,0 +1,43 @@
+#include <string.h>
+#include "table.h"
+
+/*
+ * DIGIT_PAIRS holds "00" to "99", so each division by 100 writes two digits.
+ */
+static const char DIGIT_PAIRS[201] = "00010203040506070809"
+                                     "10111213141516171819"
+                                     "20212223242526272829"
+                                     "30313233343536373839"
+                                     "40414243444546474849"
+                                     "50515253545556575859"
+                                     "60616263646566676869"
+                                     "70717273747576777879"
+                                     "80818283848586878889"
+                                     "90919293949596979899";
+
+size_t formatTableInteger(long long value, char *out) {
+    unsigned long long magnitude = value < 0 ? 0ULL - (unsigned long long)value : (unsigned long long)value;
+    char digits[20];
+    char *cursor = digits + sizeof(digits);
+
+    while (magnitude >= 100) {
+        size_t pair = (size_t)(magnitude % 100) * 2;
+        magnitude /= 100;
+        cursor -= 2;
+        memcpy(cursor, DIGIT_PAIRS + pair, 2);
+    }
+
+    if (magnitude >= 10) {
+        cursor -= 2;
+        memcpy(cursor, DIGIT_PAIRS + magnitude * 2, 2);
+    } else {
+        *--cursor = (char)('0' + magnitude);
+    }
+
+    size_t length = (size_t)(digits + sizeof(digits) - cursor);
+    size_t sign = value < 0;
+
+    out[0] = '-';
+    memcpy(out + sign, cursor, length);
+    return sign + length;
+}
@@ -0,0 +1,63 @@
+#ifndef table_layout_h
+#define table_layout_h
+#include <string.h>
+#include "table.h"
+#include "output.h"
+
+/*
+ * readCell returns a cell from the table rows, or from its getter when
+ * there are no rows.
+ */
+static inline const char *readCell(Table *table, size_t row, size_t column, char *scratch, size_t *outSize) {
+    if (table->rows == NULL) {
+        return table->getCell(table->source, row, column, scratch, outSize);
+    }
+
+    const char *cell = table->rows[row][column];
+
+    if (cell != NULL) {
+        *outSize = strlen(cell);
+    }
+
+    return cell;
+}
+
+/*
+ * calculateWidths attempts to calculate the correct width for each table column
+ * based on a received table. Widths are terminal columns, not bytes.
+ *
+ * table           - Source Table to get rows and headers to properly calculate
+ *                   each column cell size.
+ * outColumnsWidth - Where to write columns widths after calculation.
+ *
+ * Returns a `table_err_invalid_input` if any header or cell is NULL.
+ */
+table_err calculateWidths(Table *table, size_t *outColumnsWidth);
+
+/*
+ * makeRow writes a row padding each cell with spaces until it reaches its
+ * column width. It leaves room for the line break after it.
+ *
+ * buffer       - Where to write the row.
+ * table        - Table holding the row.
+ * row          - Index of the row, or the headers when it's the rowsCount.
+ * columnsWidth - The list containing the width for each column cell.
+ */
+table_err makeRow(OutputBuffer *buffer, Table *table, size_t row, size_t *columnsWidth);
+
+/*
+ * makeHeader writes the top border, the headers and the line under them.
+ */
+table_err makeHeader(OutputBuffer *buffer, Table *table, size_t *columnsWidth);
+
+/*
+ * makeRows writes the rows in `[start, end)`, one per line.
+ */
+table_err makeRows(OutputBuffer *buffer, Table *table, size_t start, size_t end, size_t *columnsWidth);
+
+/*
+ * makeFooter writes the bottom border.
+ */
+table_err makeFooter(OutputBuffer *buffer, Table *table, size_t *columnsWidth);
+
+#endif
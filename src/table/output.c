@@ -0,0 +1,46 @@
+#include <stats/stats.h>
+#include "output.h"
+
+table_err flushBuffer(OutputBuffer *buffer) {
+    if (buffer->sink == NULL || buffer->size == 0) {
+        return table_err_ok;
+    }
+
+    size_t written = buffer->sink(buffer->data, buffer->size, buffer->sinkContext);
+
+    if (written != buffer->size) {
+        return table_err_write_failed;
+    }
+
+    buffer->size = 0;
+    return table_err_ok;
+}
+
+table_err growBuffer(OutputBuffer *buffer, size_t amount) {
+    table_err err = flushBuffer(buffer);
+
+    if (err != table_err_ok) {
+        return err;
+    }
+
+    if (buffer->size + amount <= buffer->capacity) {
+        return table_err_ok;
+    }
+
+    size_t newCapacity = buffer->capacity > 0 ? buffer->capacity : OUTPUT_CHUNK_SIZE;
+
+    while (newCapacity < buffer->size + amount) {
+        newCapacity *= 2;
+    }
+
+    char *newData = realloc(buffer->data, newCapacity);
+    statsCountAlloc(stats_component_table, newCapacity);
+
+    if (newData == NULL) {
+        return table_err_allocation_failed;
+    }
+
+    buffer->data = newData;
+    buffer->capacity = newCapacity;
+    return table_err_ok;
+}
@@ -0,0 +1,85 @@
+#ifndef output_h
+#define output_h
+#include <stdlib.h>
+#include <string.h>
+#include "table.h"
+
+/*
+ * Size of the chunks handed to a TableSink. Large enough to turn a render
+ * into a handful of write calls.
+ */
+#define OUTPUT_CHUNK_SIZE ((size_t)1 << 16)
+
+/*
+ * OutputBuffer accumulates rendered bytes before handing them to a sink.
+ *
+ * data        - Buffer holding the pending output.
+ * size        - Amount of bytes currently in data.
+ * capacity    - Allocated size of data.
+ * sink        - Where full chunks are flushed to. When NULL, the buffer just
+ *               grows and keeps the whole output.
+ * sinkContext - Context passed to the sink.
+ */
+typedef struct {
+    char *data;
+    size_t size;
+    size_t capacity;
+    TableSink sink;
+    void *sinkContext;
+} OutputBuffer;
+
+/*
+ * flushBuffer hands every pending byte to the buffer sink.
+ *
+ * Returns a `table_err_write_failed` if the sink doesn't consume everything.
+ */
+table_err flushBuffer(OutputBuffer *buffer);
+
+/*
+ * growBuffer is the slow path of reserveBuffer, flushing to the sink when
+ * there's one, or growing the buffer otherwise.
+ */
+table_err growBuffer(OutputBuffer *buffer, size_t amount);
+
+/*
+ * reserveBuffer makes sure there's room for `amount` more bytes.
+ *
+ * Returns a `table_err_allocation_failed` if the buffer cannot grow, or
+ * a `table_err_write_failed` if the sink fails.
+ */
+static inline table_err reserveBuffer(OutputBuffer *buffer, size_t amount) {
+    if (buffer->size + amount <= buffer->capacity) {
+        return table_err_ok;
+    }
+
+    return growBuffer(buffer, amount);
+}
+
+/*
+ * appendBuffer copies `size` bytes from `data` at the end of the buffer.
+ * The caller must have reserved enough room before.
+ */
+static inline void appendBuffer(OutputBuffer *buffer, const char *data, size_t size) {
+    memcpy(buffer->data + buffer->size, data, size);
+    buffer->size += size;
+}
+
+/*
+ * appendRepeat writes `times` copies of `str` at the end of the buffer.
+ * The caller must have reserved enough room before.
+ */
+static inline void appendRepeat(OutputBuffer *buffer, const char *str, size_t strSize, size_t times) {
+    char *cursor = buffer->data + buffer->size;
+
+    if (strSize == 1) {
+        memset(cursor, str[0], times);
+    } else {
+        for (size_t i = 0; i < times; i++) {
+            memcpy(cursor + i * strSize, str, strSize);
+        }
+    }
+
+    buffer->size += strSize * times;
+}
+
+#endif
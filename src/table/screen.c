@@ -0,0 +1,335 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "screen.h"
+#include "layout.h"
+#include <stats/stats.h>
+
+/*
+ * Terminal line of the first row: the top border, the headers and the line
+ * under them come before it.
+ */
+#define SCREEN_FIRST_ROW_LINE 4
+
+/*
+ * painted      - Whether the terminal holds the box described below.
+ * headersCount - Columns of the painted box.
+ * columnsWidth - Widths of the painted box.
+ * rowsCount    - Rows of the painted box.
+ * rowHashes    - Hash of the cells of each painted row.
+ * rowsCapacity - Allocated length of rowHashes.
+ */
+struct TableScreen {
+    bool painted;
+    size_t headersCount;
+    size_t *columnsWidth;
+    size_t rowsCount;
+    uint64_t *rowHashes;
+    size_t rowsCapacity;
+};
+
+table_err newTableScreen(TableScreen **outScreen) {
+    TableScreen *screen = calloc(1, sizeof(TableScreen));
+    statsCountAlloc(stats_component_table, sizeof(TableScreen));
+
+    if (screen == NULL) {
+        return table_err_allocation_failed;
+    }
+
+    *outScreen = screen;
+    return table_err_ok;
+}
+
+void freeTableScreen(TableScreen *screen) {
+    if (screen == NULL) {
+        return;
+    }
+
+    free(screen->columnsWidth);
+    free(screen->rowHashes);
+    free(screen);
+}
+
+/*
+ * hashRow folds the cells of a row into a FNV-1a hash, with a separator
+ * after each cell so moving bytes across cells changes it.
+ */
+static uint64_t hashRow(Table *table, size_t row) {
+    char scratch[TABLE_CELL_SCRATCH_SIZE];
+    uint64_t hash = 0xcbf29ce484222325ULL;
+
+    for (size_t i = 0; i < table->headersCount; i++) {
+        size_t size = 0;
+        const char *cell = readCell(table, row, i, scratch, &size);
+
+        for (size_t j = 0; cell != NULL && j < size; j++) {
+            hash = (hash ^ (unsigned char)cell[j]) * 0x100000001b3ULL;
+        }
+
+        hash = (hash ^ 0xff) * 0x100000001b3ULL;
+    }
+
+    return hash;
+}
+
+/*
+ * moveTo writes the escape sequence placing the cursor at the start of a
+ * terminal line, counted from 1.
+ */
+static table_err moveTo(OutputBuffer *buffer, size_t line) {
+    char sequence[32];
+    int size = snprintf(sequence, sizeof(sequence), "\x1b[%zu;1H", line);
+    table_err err = reserveBuffer(buffer, (size_t)size);
+
+    if (err == table_err_ok) {
+        appendBuffer(buffer, sequence, (size_t)size);
+    }
+
+    return err;
+}
+
+/*
+ * appendSequence writes a fixed escape sequence.
+ */
+static table_err appendSequence(OutputBuffer *buffer, const char *sequence) {
+    table_err err = reserveBuffer(buffer, strlen(sequence));
+
+    if (err == table_err_ok) {
+        appendBuffer(buffer, sequence, strlen(sequence));
+    }
+
+    return err;
+}
+
+/*
+ * paintBox clears the terminal and draws the whole table.
+ */
+static table_err paintBox(OutputBuffer *buffer, Table *table, size_t *columnsWidth) {
+    table_err err = appendSequence(buffer, "\x1b[H\x1b[2J");
+
+    if (err == table_err_ok) {
+        err = makeHeader(buffer, table, columnsWidth);
+    }
+
+    if (err == table_err_ok) {
+        err = makeRows(buffer, table, 0, table->rowsCount, columnsWidth);
+    }
+
+    if (err == table_err_ok) {
+        err = makeFooter(buffer, table, columnsWidth);
+    }
+
+    return err;
+}
+
+/*
+ * moveLines writes the escape sequence inserting (`L`) or deleting (`M`)
+ * lines at the cursor, which moves every line under it.
+ */
+static table_err moveLines(OutputBuffer *buffer, size_t line, size_t count, char kind) {
+    char sequence[48];
+    int size = snprintf(sequence, sizeof(sequence), "\x1b[%zu;1H\x1b[%zu%c", line, count, kind);
+    table_err err = reserveBuffer(buffer, (size_t)size);
+
+    if (err == table_err_ok) {
+        appendBuffer(buffer, sequence, (size_t)size);
+    }
+
+    return err;
+}
+
+/*
+ * paintRow writes a row over its line, cleared up to its end.
+ */
+static table_err paintRow(TableScreen *screen, OutputBuffer *buffer, Table *table, size_t row) {
+    table_err err = moveTo(buffer, SCREEN_FIRST_ROW_LINE + row);
+
+    if (err == table_err_ok) {
+        err = makeRow(buffer, table, row, screen->columnsWidth);
+    }
+
+    if (err == table_err_ok) {
+        err = appendSequence(buffer, "\x1b[K");
+    }
+
+    return err;
+}
+
+/*
+ * paintRows brings the painted rows to the ones of table, walking both in
+ * order. Rows kept from the last paint stay on their line, which is moved
+ * up or down by deleting the lines of the rows gone before it or inserting
+ * lines for the new ones, and are only written again when their hash
+ * changed. Other rows are written over a line which isn't kept, or a new
+ * one. The footer is written again when any line moved.
+ *
+ * sources - Painted row each row held before, or TABLE_SCREEN_NEW_ROW.
+ * kept    - Scratch of a flag per row.
+ */
+static table_err paintRows(TableScreen *screen, OutputBuffer *buffer, Table *table, const uint64_t *hashes,
+                           const size_t *sources, bool *kept) {
+    table_err err = table_err_ok;
+    bool moved = table->rowsCount != screen->rowsCount;
+    size_t lastKept = TABLE_SCREEN_NEW_ROW;
+
+    /*
+     * Kept rows must hold their painted rows in the same order, so a row
+     * coming back from above the last kept one is written again instead.
+     */
+    for (size_t i = 0; i < table->rowsCount; i++) {
+        kept[i] = sources[i] < screen->rowsCount && (lastKept == TABLE_SCREEN_NEW_ROW || sources[i] > lastKept);
+        lastKept = kept[i] ? sources[i] : lastKept;
+    }
+
+    /*
+     * The line of row i holds the painted row `painted`, followed by the
+     * ones after it.
+     */
+    size_t painted = 0;
+    size_t next = 0;
+
+    for (size_t i = 0; i < table->rowsCount && err == table_err_ok; i++) {
+        if (kept[i]) {
+            if (sources[i] > painted) {
+                err = moveLines(buffer, SCREEN_FIRST_ROW_LINE + i, sources[i] - painted, 'M');
+                moved = true;
+            }
+
+            if (err == table_err_ok && screen->rowHashes[sources[i]] != hashes[i]) {
+                err = paintRow(screen, buffer, table, i);
+            }
+
+            painted = sources[i] + 1;
+            continue;
+        }
+
+        while (next < table->rowsCount && (next <= i || !kept[next])) {
+            next++;
+        }
+
+        /*
+         * The line is written over unless a later row keeps what it holds.
+         */
+        if (painted < (next < table->rowsCount ? sources[next] : screen->rowsCount)) {
+            painted++;
+        } else {
+            err = moveLines(buffer, SCREEN_FIRST_ROW_LINE + i, 1, 'L');
+            moved = true;
+        }
+
+        if (err == table_err_ok) {
+            err = paintRow(screen, buffer, table, i);
+        }
+    }
+
+    if (err == table_err_ok && moved) {
+        err = moveTo(buffer, SCREEN_FIRST_ROW_LINE + table->rowsCount);
+
+        if (err == table_err_ok) {
+            err = makeFooter(buffer, table, screen->columnsWidth);
+        }
+    }
+
+    return err;
+}
+
+table_err paintTableScreen(TableScreen *screen, Table *table, TableSink sink, void *sinkContext) {
+    return paintTableScreenMoved(screen, table, NULL, sink, sinkContext);
+}
+
+table_err paintTableScreenMoved(TableScreen *screen, Table *table, const size_t *sources, TableSink sink,
+                                void *sinkContext) {
+    if (screen == NULL || table == NULL || sink == NULL) {
+        return table_err_invalid_input;
+    }
+
+    size_t columnsWidth[table->headersCount];
+    uint64_t span = statsSpanStart();
+    table_err err = calculateWidths(table, columnsWidth);
+
+    statsSpanEnd(stats_stage_measure, span);
+    if (err != table_err_ok) {
+        return err;
+    }
+
+    if (table->headersCount != screen->headersCount) {
+        size_t *widths = realloc(screen->columnsWidth, table->headersCount * sizeof(size_t) + 1);
+        statsCountAlloc(stats_component_table, table->headersCount * sizeof(size_t));
+
+        if (widths == NULL) {
+            return table_err_allocation_failed;
+        }
+
+        screen->columnsWidth = widths;
+        screen->headersCount = table->headersCount;
+        screen->painted = false;
+    }
+
+    if (table->rowsCount > screen->rowsCapacity) {
+        uint64_t *rowHashes = realloc(screen->rowHashes, table->rowsCount * 2 * sizeof(uint64_t));
+        statsCountAlloc(stats_component_table, table->rowsCount * 2 * sizeof(uint64_t));
+
+        if (rowHashes == NULL) {
+            return table_err_allocation_failed;
+        }
+
+        screen->rowHashes = rowHashes;
+        screen->rowsCapacity = table->rowsCount * 2;
+    }
+
+    uint64_t *hashes = malloc(table->rowsCount * (sizeof(uint64_t) + sizeof(size_t) + sizeof(bool)) + 1);
+    OutputBuffer buffer = { data: malloc(OUTPUT_CHUNK_SIZE), size: 0, capacity: OUTPUT_CHUNK_SIZE,
+                            sink: sink, sinkContext: sinkContext };
+    statsCountAlloc(stats_component_table,
+                    table->rowsCount * (sizeof(uint64_t) + sizeof(size_t) + sizeof(bool)) + OUTPUT_CHUNK_SIZE);
+
+    if (hashes == NULL || buffer.data == NULL) {
+        free(hashes);
+        free(buffer.data);
+        return table_err_allocation_failed;
+    }
+
+    size_t *rowSources = (size_t *)(hashes + table->rowsCount);
+    bool *kept = (bool *)(rowSources + table->rowsCount);
+
+    span = statsSpanStart();
+    for (size_t i = 0; i < table->rowsCount; i++) {
+        hashes[i] = hashRow(table, i);
+        rowSources[i] = sources != NULL ? sources[i] : i;
+    }
+
+    if (!screen->painted || memcmp(columnsWidth, screen->columnsWidth, table->headersCount * sizeof(size_t)) != 0) {
+        err = paintBox(&buffer, table, columnsWidth);
+        memcpy(screen->columnsWidth, columnsWidth, table->headersCount * sizeof(size_t));
+    } else {
+        err = paintRows(screen, &buffer, table, hashes, rowSources, kept);
+    }
+
+    /*
+     * Leaves the cursor under the footer, clearing whatever a longer box
+     * or other output left there.
+     */
+    if (err == table_err_ok) {
+        err = moveTo(&buffer, SCREEN_FIRST_ROW_LINE + table->rowsCount + 1);
+    }
+
+    if (err == table_err_ok) {
+        err = appendSequence(&buffer, "\x1b[J");
+    }
+
+    if (err == table_err_ok) {
+        err = flushBuffer(&buffer);
+    }
+
+    statsSpanEnd(stats_stage_format, span);
+
+    screen->painted = err == table_err_ok;
+    screen->rowsCount = table->rowsCount;
+    if (table->rowsCount > 0) {
+        memcpy(screen->rowHashes, hashes, table->rowsCount * sizeof(uint64_t));
+    }
+
+    free(hashes);
+    free(buffer.data);
+    return err;
+}
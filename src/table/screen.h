@@ -0,0 +1,60 @@
+#ifndef screen_h
+#define screen_h
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include "table.h"
+
+/*
+ * TableScreen keeps a Table drawn on a terminal and repaints it in place as
+ * the Table changes, with ANSI cursor addressing. Only rows whose cells
+ * changed are written again. The borders and headers are only redrawn when
+ * a column width changes, which repaints the whole box.
+ *
+ * The box is drawn from the top left corner of the terminal, and must fit
+ * its height: taller tables should be painted through a TablePage.
+ */
+typedef struct TableScreen TableScreen;
+
+/*
+ * Source of a row which wasn't painted before, for paintTableScreenMoved.
+ */
+#define TABLE_SCREEN_NEW_ROW SIZE_MAX
+
+/*
+ * newTableScreen creates a screen with nothing drawn yet.
+ *
+ * Returns a `table_err_allocation_failed` if it cannot be allocated.
+ */
+table_err newTableScreen(TableScreen **outScreen);
+
+void freeTableScreen(TableScreen *screen);
+
+/*
+ * paintTableScreen brings the terminal from the last painted Table to this
+ * one. The first paint clears the terminal and draws the whole box.
+ *
+ * screen      - Screen holding what's currently drawn.
+ * table       - Table to be drawn.
+ * sink        - Receives the escape sequences and rows to be written.
+ * sinkContext - Passed untouched to every sink call.
+ *
+ * Returns the same errors as renderTable. After an error, the next paint
+ * draws the whole box.
+ */
+table_err paintTableScreen(TableScreen *screen, Table *table, TableSink sink, void *sinkContext);
+
+/*
+ * paintTableScreenMoved does the same as paintTableScreen, knowing which row
+ * of the last painted Table each row of this one was. The lines of kept rows
+ * are moved in place of the rows inserted or removed around them, so rows
+ * only shifted by those aren't written again. paintTableScreen compares
+ * every row with the one painted at the same position instead.
+ *
+ * sources - For each row, the row it was in the last painted Table, or
+ *           TABLE_SCREEN_NEW_ROW.
+ */
+table_err paintTableScreenMoved(TableScreen *screen, Table *table, const size_t *sources, TableSink sink,
+                                void *sinkContext);
+
+#endif
@@ -1,191 +1,501 @@
 #include <stdio.h>
+#include <stdbool.h>
 #include <stdlib.h>
 #include <string.h>
 #include "table.h"
+#include "width.h"
+#include "output.h"
+#include "layout.h"
+#include <parallel/parallel.h>
+#include <stats/stats.h>
 
 const size_t CELL_SPACING = 2;
 
 /*
- * calculateWidths attempts to calculate the correct width for each table column
- * based on a received table.
+ * Rows each thread formats per round of a parallel render. It bounds the
+ * memory held by the per thread buffers.
+ */
+const size_t TABLE_PARALLEL_CHUNK_ROWS = 1 << 14;
+
+#define LINE "─"
+#define VERTICAL "│"
+#define ELLIPSIS "…"
+
+/*
+ * measureRows widens each column to fit the rows in `[start, end)`.
  *
- * table           - Source Table to get rows and headers to properly calculate
- *                   each column cell size.
- * outColumnsWidth - Where to write columns widths after calculation.
+ * table           - Source Table to get rows from.
+ * start           - First row to be measured.
+ * end             - One past the last row to be measured.
+ * outColumnsWidth - Holds the widths so far, updated in place.
  *
- * In case of an allocation error, it returns a `table_err_allocation_failed`,
- * which is exposed for the consumer of table.
+ * Returns a `table_err_invalid_input` if any cell is NULL.
  */
-void calculateWidths(Table *table, size_t *outColumnsWidth) {
+static table_err measureRows(Table *table, size_t start, size_t end, size_t *outColumnsWidth) {
+    char scratch[TABLE_CELL_SCRATCH_SIZE];
+
     for (size_t i = 0; i < table->headersCount; i++) {
-        size_t cellWidth = strlen(table->headers[i]);
+        size_t cellWidth = outColumnsWidth[i];
+
+        for (size_t j = start; j < end; j++) {
+            size_t size;
+            const char *cell = readCell(table, j, i, scratch, &size);
 
-        for (size_t j = 0; j < table->rowsCount; j++) {
-            size_t size = strlen(table->rows[j][i]);
-            if (size > cellWidth) {
-                cellWidth = size;
+            if (cell == NULL) {
+                return table_err_invalid_input;
+            }
+
+            size_t width = displayWidth(cell, size);
+            if (width > cellWidth) {
+                cellWidth = width;
+            }
+
+            if (table->maxWidth > 0 && cellWidth >= table->maxWidth) {
+                cellWidth = table->maxWidth;
+                break;
             }
         }
 
         outColumnsWidth[i] = cellWidth;
     }
+
+    return table_err_ok;
 }
 
 /*
- * padString attempts to add spacing to a string until it
- * reaches the desired size.
+ * measureHeaders sets each column width to the width of its header.
  *
- * string      - A string to receive the padding
- * desiredSize - A number representing the desired size.
- * outResult   - Where to place the result string.
- *
- * Returns a `table_err`, which becames `table_err_invalid_input`
- * in case of an invalid input, `table_err_allocation_failed` or
- * a `table_err_ok` if it's everything okay.
+ * Returns a `table_err_invalid_input` if any header is NULL, or if the table
+ * has rows but neither rows nor getCell to read them from.
  */
-table_err padString(char *string, size_t desiredSize, char **outResult) {
-    if (string == NULL) {
-        return table_err_invalid_input;
-    }
-
-    if (strlen(string) > desiredSize) {
+static table_err measureHeaders(Table *table, size_t *outColumnsWidth) {
+    if (table->rows == NULL && table->getCell == NULL && table->rowsCount > 0) {
         return table_err_invalid_input;
     }
 
-    char *result = calloc(desiredSize + 1, sizeof(char));
-
-    if (result == NULL) {
-        return table_err_allocation_failed;
-    }
+    for (size_t i = 0; i < table->headersCount; i++) {
+        if (table->headers[i] == NULL) {
+            return table_err_invalid_input;
+        }
 
-    strcpy(result, string);
-    for (size_t i = strlen(string); i < desiredSize; i++) {
-        result[i] = ' ';
+        outColumnsWidth[i] = displayWidth(table->headers[i], strlen(table->headers[i]));
+        if (table->maxWidth > 0 && outColumnsWidth[i] > table->maxWidth) {
+            outColumnsWidth[i] = table->maxWidth;
+        }
     }
 
-    *outResult = result;
     return table_err_ok;
 }
 
-/*
- * repeat attempts to return a string repeated N times.
- *
- * c     - String to be repeated.
- * times - Amount of times to repeat the string.
- *
- * Returns NULL in case allocation fails. Otherwise, returns the generated string.
- * The result of this function must be manually freed after it is no longer used.
- */
-char *repeat(char *c, size_t times) {
-    if (c == NULL) {
-        return "";
-    }
-
-    size_t cSize = strlen(c);
-    size_t finalSize = cSize * times;
-    char *result = calloc(finalSize + 1, sizeof(char));
-
-    if (result == NULL) {
-        return NULL;
-    }
+table_err calculateWidths(Table *table, size_t *outColumnsWidth) {
+    table_err err = measureHeaders(table, outColumnsWidth);
 
-    for (size_t i = 0; i < times; i++) {
-        snprintf(result + (i * cSize), finalSize, "%s", c);
+    if (err != table_err_ok) {
+        return err;
     }
 
-    return result;
+    return measureRows(table, 0, table->rowsCount, outColumnsWidth);
 }
 
 /*
- * makeLine prints a line based on a char to be repeated, a separator
+ * makeLine writes a line based on a string to be repeated, a separator
  * and a end string.
  *
- * str          - A string to be repeated based on the table cell size.
+ * buffer       - Where to write the line.
+ * start        - A string to be drawn at the start of the line.
  * separator    - A string to be drawn between cells.
  * end          - A string to be drawn at the end of a line.
  * columnsWidth - The list containing the width for each column cell.
  * headersCount - Amount of headers of the current table.
  */
-table_err makeLine(char *str, char *separator, char *end, size_t *columnsWidth, size_t headersCount) {
+static table_err makeLine(OutputBuffer *buffer, const char *start, const char *separator, const char *end,
+                          size_t *columnsWidth, size_t headersCount) {
+    size_t lineSize = strlen(LINE);
+    size_t separatorSize = strlen(separator);
+    size_t lineLength = strlen(start) + strlen(end) + 1;
+
     for (size_t i = 0; i < headersCount; i++) {
-        char *tableLine = repeat(str, columnsWidth[i] + CELL_SPACING);
+        lineLength += (columnsWidth[i] + CELL_SPACING) * lineSize + separatorSize;
+    }
+
+    table_err err = reserveBuffer(buffer, lineLength);
 
-        if (tableLine == NULL) {
-            return table_err_allocation_failed;
+    if (err != table_err_ok) {
+        return err;
+    }
+
+    appendBuffer(buffer, start, strlen(start));
+    for (size_t i = 0; i < headersCount; i++) {
+        appendRepeat(buffer, LINE, lineSize, columnsWidth[i] + CELL_SPACING);
+
+        if (i < headersCount - 1) {
+            appendBuffer(buffer, separator, separatorSize);
         }
+    }
 
-        printf("%s", tableLine);
-        free(tableLine);
+    appendBuffer(buffer, end, strlen(end));
+    appendBuffer(buffer, "\n", 1);
+    return table_err_ok;
+}
 
-        if (i < headersCount - 1 && headersCount != 1) {
-            printf("%s", separator);
+table_err makeRow(OutputBuffer *buffer, Table *table, size_t row, size_t *columnsWidth) {
+    size_t verticalSize = strlen(VERTICAL);
+    char scratch[TABLE_CELL_SCRATCH_SIZE];
+    table_err err = reserveBuffer(buffer, verticalSize + 1);
+
+    if (err != table_err_ok) {
+        return err;
+    }
+
+    appendBuffer(buffer, VERTICAL, verticalSize);
+    for (size_t i = 0; i < table->headersCount; i++) {
+        size_t cellSize;
+        const char *cell;
+
+        if (row == table->rowsCount) {
+            cell = table->headers[i];
+            cellSize = strlen(cell);
+        } else {
+            cell = readCell(table, row, i, scratch, &cellSize);
+        }
+
+        size_t width = displayWidth(cell, cellSize);
+        bool cut = width > columnsWidth[i];
+
+        /*
+         * Only cells of a table with a maxWidth can be wider than their
+         * column, and they leave a column for the ellipsis.
+         */
+        if (cut) {
+            cellSize = displayPrefix(cell, cellSize, columnsWidth[i] > 0 ? columnsWidth[i] - 1 : 0, &width);
+            width += columnsWidth[i] > 0;
+        }
+
+        size_t padding = columnsWidth[i] - width + 1;
+        err = reserveBuffer(buffer, cellSize + strlen(ELLIPSIS) + padding + verticalSize + 2);
+
+        if (err != table_err_ok) {
+            return err;
         }
+
+        appendBuffer(buffer, " ", 1);
+        appendBuffer(buffer, cell, cellSize);
+        if (cut && columnsWidth[i] > 0) {
+            appendBuffer(buffer, ELLIPSIS, strlen(ELLIPSIS));
+        }
+        appendRepeat(buffer, " ", 1, padding);
+        appendBuffer(buffer, VERTICAL, verticalSize);
     }
 
-    printf("%s\n", end);
     return table_err_ok;
 }
 
-table_err drawTable(Table *table) {
-    size_t columnsWidth[table->headersCount];
-    calculateWidths(table, columnsWidth);
+size_t tableFileSink(const char *data, size_t size, void *context) {
+    return fwrite(data, sizeof(char), size, (FILE *)context);
+}
 
-    printf("╭");
-    table_err err = makeLine("─", "┬", "╮", columnsWidth, table->headersCount);
+table_err makeHeader(OutputBuffer *buffer, Table *table, size_t *columnsWidth) {
+    table_err err = makeLine(buffer, "╭", "┬", "╮", columnsWidth, table->headersCount);
 
     if (err != table_err_ok) {
         return err;
     }
 
-    printf("│");
+    err = makeRow(buffer, table, table->rowsCount, columnsWidth);
 
-    for (size_t i = 0; i < table->headersCount; i++) {
-        char *cellContent = NULL;
-        err = padString(table->headers[i], (size_t)columnsWidth[i], &cellContent);
+    if (err != table_err_ok) {
+        return err;
+    }
+
+    if (table->headersCount > 0) {
+        appendBuffer(buffer, "\n", 1);
+    }
+
+    return makeLine(buffer, table->headersCount > 0 ? "├" : "", "┼", table->headersCount > 0 ? "┤" : VERTICAL,
+                    columnsWidth, table->headersCount);
+}
+
+table_err makeRows(OutputBuffer *buffer, Table *table, size_t start, size_t end, size_t *columnsWidth) {
+    for (size_t i = start; i < end; i++) {
+        table_err err = makeRow(buffer, table, i, columnsWidth);
 
         if (err != table_err_ok) {
             return err;
         }
 
-        printf(" %s │", cellContent);
-        free(cellContent);
+        appendBuffer(buffer, "\n", 1);
+    }
 
-        if (i == table->headersCount - 1) {
-            printf("\n");
-        }
+    return table_err_ok;
+}
+
+table_err makeFooter(OutputBuffer *buffer, Table *table, size_t *columnsWidth) {
+    return makeLine(buffer, "╰", "┴", "╯", columnsWidth, table->headersCount);
+}
+
+/*
+ * renderInto writes the whole table into an OutputBuffer, leaving whatever
+ * wasn't flushed yet inside it.
+ */
+static table_err renderInto(Table *table, OutputBuffer *buffer) {
+    size_t columnsWidth[table->headersCount];
+    uint64_t span = statsSpanStart();
+    table_err err = calculateWidths(table, columnsWidth);
+
+    statsSpanEnd(stats_stage_measure, span);
+    span = statsSpanStart();
+
+    if (err == table_err_ok) {
+        err = makeHeader(buffer, table, columnsWidth);
     }
 
-    if (table->headersCount > 0) {
-        printf("├");
+    if (err == table_err_ok) {
+        err = makeRows(buffer, table, 0, table->rowsCount, columnsWidth);
     }
 
-    err = makeLine("─", "┼", table->headersCount > 0 ? "┤" : "│", columnsWidth, table->headersCount);
+    if (err == table_err_ok) {
+        err = makeFooter(buffer, table, columnsWidth);
+    }
 
-    if (err != table_err_ok) {
+    statsSpanEnd(stats_stage_format, span);
+    return err;
+}
+
+table_err renderTable(Table *table, TableSink sink, void *sinkContext) {
+    if (table == NULL || sink == NULL) {
+        return table_err_invalid_input;
+    }
+
+    OutputBuffer buffer = { data: malloc(OUTPUT_CHUNK_SIZE), size: 0, capacity: OUTPUT_CHUNK_SIZE,
+                            sink: sink, sinkContext: sinkContext };
+    statsCountAlloc(stats_component_table, OUTPUT_CHUNK_SIZE);
+
+    if (buffer.data == NULL) {
         return table_err_allocation_failed;
     }
 
-    for (size_t i = 0; i < table->rowsCount; i++) {
-        printf("│");
-        for (size_t j = 0; j < table->headersCount; j++) {
-            char *cellContent = NULL;
-            err = padString(table->rows[i][j], (size_t)columnsWidth[j], &cellContent);
+    table_err err = renderInto(table, &buffer);
 
-            if (cellContent == NULL) {
-                return table_err_allocation_failed;
-            }
+    if (err == table_err_ok) {
+        err = flushBuffer(&buffer);
+    }
 
-            printf(" %s │", cellContent);
-            free(cellContent);
-        }
-        printf("\n");
+    free(buffer.data);
+    return err;
+}
+
+table_err renderTableToBuffer(Table *table, char **outBuffer, size_t *outSize) {
+    if (table == NULL) {
+        return table_err_invalid_input;
+    }
+
+    OutputBuffer buffer = { data: NULL, size: 0, capacity: 0, sink: NULL, sinkContext: NULL };
+    table_err err = renderInto(table, &buffer);
+
+    if (err == table_err_ok) {
+        err = reserveBuffer(&buffer, 1);
     }
-    printf("╰");
-    err = makeLine("─", "┴", "╯", columnsWidth, table->headersCount);
 
     if (err != table_err_ok) {
-        return table_err_allocation_failed;
+        free(buffer.data);
+        return err;
+    }
+
+    buffer.data[buffer.size] = '\0';
+    *outBuffer = buffer.data;
+    *outSize = buffer.size;
+    return table_err_ok;
+}
+
+table_err drawTable(Table *table) {
+    return renderTable(table, tableFileSink, stdout);
+}
+
+/*
+ * pageCell is the TableCellGetter of a TablePage.
+ */
+static const char *pageCell(void *source, size_t row, size_t column, char *scratch, size_t *outSize) {
+    TablePage *page = (TablePage *)source;
+    return readCell(page->source, page->first + row, column, scratch, outSize);
+}
+
+void tablePage(Table *source, size_t first, size_t count, TablePage *outPage) {
+    first = first < source->rowsCount ? first : source->rowsCount;
+    count = count < source->rowsCount - first ? count : source->rowsCount - first;
+
+    *outPage = (TablePage){ table: *source, source: source, first: first };
+    outPage->table.rowsCount = count;
+
+    if (source->rows != NULL) {
+        outPage->table.rows = source->rows + first;
+    } else {
+        outPage->table.getCell = pageCell;
+        outPage->table.source = outPage;
+    }
+}
+
+/*
+ * ParallelRender is shared by the tasks of a renderTableParallel.
+ *
+ * table        - Table being rendered.
+ * columnsWidth - Width of each column, once reduced.
+ * partials     - Widths measured by each chunk, headersCount per chunk.
+ * buffers      - Output buffer of each chunk.
+ * errs         - Error found by each chunk.
+ * offset       - First row of the current round.
+ */
+typedef struct {
+    Table *table;
+    size_t *columnsWidth;
+    size_t *partials;
+    OutputBuffer *buffers;
+    table_err *errs;
+    size_t offset;
+} ParallelRender;
+
+static void measureTask(size_t chunk, size_t start, size_t end, void *context) {
+    ParallelRender *render = (ParallelRender *)context;
+    size_t *widths = render->partials + chunk * render->table->headersCount;
+
+    memset(widths, 0, render->table->headersCount * sizeof(size_t));
+    render->errs[chunk] = measureRows(render->table, start, end, widths);
+}
+
+static void formatTask(size_t chunk, size_t start, size_t end, void *context) {
+    ParallelRender *render = (ParallelRender *)context;
+
+    render->buffers[chunk].size = 0;
+    render->errs[chunk] = makeRows(&render->buffers[chunk], render->table, render->offset + start,
+                                   render->offset + end, render->columnsWidth);
+}
+
+/*
+ * firstError returns the first error found by any chunk.
+ */
+static table_err firstError(table_err *errs, size_t chunks) {
+    for (size_t i = 0; i < chunks; i++) {
+        if (errs[i] != table_err_ok) {
+            return errs[i];
+        }
     }
 
     return table_err_ok;
 }
+
+/*
+ * renderParallel measures the rows across the threads and reduces their
+ * widths, then formats the rows in rounds of `threads` chunks, handing each
+ * chunk to the sink in order once the round is over.
+ */
+static table_err renderParallel(Table *table, size_t threads, ParallelRender *render, OutputBuffer *buffer) {
+    size_t headersCount = table->headersCount;
+    uint64_t span = statsSpanStart();
+    table_err err = measureHeaders(table, render->columnsWidth);
+
+    if (err != table_err_ok) {
+        return err;
+    }
+
+    if (parallelFor(table->rowsCount, threads, threads, measureTask, render) != parallel_err_ok) {
+        return table_err_thread_failed;
+    }
+
+    err = firstError(render->errs, threads);
+    statsSpanEnd(stats_stage_measure, span);
+
+    if (err != table_err_ok) {
+        return err;
+    }
+
+    for (size_t chunk = 0; chunk < threads; chunk++) {
+        for (size_t i = 0; i < headersCount; i++) {
+            size_t width = render->partials[chunk * headersCount + i];
+            render->columnsWidth[i] = width > render->columnsWidth[i] ? width : render->columnsWidth[i];
+        }
+    }
+
+    span = statsSpanStart();
+    err = makeHeader(buffer, table, render->columnsWidth);
+
+    if (err == table_err_ok) {
+        err = flushBuffer(buffer);
+    }
+
+    size_t roundSize = threads * TABLE_PARALLEL_CHUNK_ROWS;
+
+    for (render->offset = 0; render->offset < table->rowsCount && err == table_err_ok; render->offset += roundSize) {
+        size_t rows = table->rowsCount - render->offset < roundSize ? table->rowsCount - render->offset : roundSize;
+
+        for (size_t chunk = 0; chunk < threads; chunk++) {
+            render->buffers[chunk].size = 0;
+            render->errs[chunk] = table_err_ok;
+        }
+
+        if (parallelFor(rows, threads, threads, formatTask, render) != parallel_err_ok) {
+            return table_err_thread_failed;
+        }
+
+        err = firstError(render->errs, threads);
+
+        for (size_t chunk = 0; chunk < threads && err == table_err_ok; chunk++) {
+            OutputBuffer *chunkBuffer = &render->buffers[chunk];
+
+            if (chunkBuffer->size > 0 &&
+                buffer->sink(chunkBuffer->data, chunkBuffer->size, buffer->sinkContext) != chunkBuffer->size) {
+                err = table_err_write_failed;
+            }
+        }
+    }
+
+    if (err == table_err_ok) {
+        err = makeFooter(buffer, table, render->columnsWidth);
+    }
+
+    statsSpanEnd(stats_stage_format, span);
+    return err;
+}
+
+table_err renderTableParallel(Table *table, size_t threads, TableSink sink, void *sinkContext) {
+    if (table == NULL || sink == NULL) {
+        return table_err_invalid_input;
+    }
+
+    if (threads <= 1 || table->rowsCount < threads * 2) {
+        return renderTable(table, sink, sinkContext);
+    }
+
+    ParallelRender render = {
+        table: table,
+        columnsWidth: calloc(table->headersCount + 1, sizeof(size_t)),
+        partials: calloc(threads * table->headersCount + 1, sizeof(size_t)),
+        buffers: calloc(threads, sizeof(OutputBuffer)),
+        errs: calloc(threads, sizeof(table_err)),
+        offset: 0
+    };
+    OutputBuffer buffer = { data: malloc(OUTPUT_CHUNK_SIZE), size: 0, capacity: OUTPUT_CHUNK_SIZE,
+                            sink: sink, sinkContext: sinkContext };
+    table_err err = table_err_allocation_failed;
+    statsCountAlloc(stats_component_table, OUTPUT_CHUNK_SIZE + (table->headersCount + 1) * sizeof(size_t) +
+                                               (threads * table->headersCount + 1) * sizeof(size_t) +
+                                               threads * (sizeof(OutputBuffer) + sizeof(table_err)));
+
+    if (render.columnsWidth != NULL && render.partials != NULL && render.buffers != NULL && render.errs != NULL &&
+        buffer.data != NULL) {
+        err = renderParallel(table, threads, &render, &buffer);
+    }
+
+    if (err == table_err_ok) {
+        err = flushBuffer(&buffer);
+    }
+
+    for (size_t i = 0; render.buffers != NULL && i < threads; i++) {
+        free(render.buffers[i].data);
+    }
+
+    free(render.columnsWidth);
+    free(render.partials);
+    free(render.buffers);
+    free(render.errs);
+    free(buffer.data);
+    return err;
+}
@@ -1,5 +1,6 @@
 #ifndef table_h
 #define table_h
+#include <stdio.h>
 #include <stdlib.h>
 
 typedef char *TABLE_DATA_ITEM;
@@ -8,9 +9,54 @@ typedef TABLE_DATA_ITEM *TABLE_DATA_ROW;
 typedef enum {
     table_err_ok = 0,
     table_err_allocation_failed = 1,
-    table_err_invalid_input = 2
+    table_err_invalid_input = 2,
+    table_err_write_failed = 3,
+    table_err_thread_failed = 4
 } table_err;
 
+/*
+ * Size of the scratch buffer a TableCellGetter may format a cell into.
+ */
+#define TABLE_CELL_SCRATCH_SIZE 64
+
+/*
+ * formatTableInteger writes the decimal digits of value, two at a time from
+ * a digit pair table, for getters formatting numeric cells.
+ *
+ * value - Integer to be formatted.
+ * out   - Receives the digits, which aren't NUL terminated. 20 bytes are
+ *         always enough.
+ *
+ * Returns the amount of bytes written.
+ */
+size_t formatTableInteger(long long value, char *out);
+
+/*
+ * TableCellGetter returns the contents of a cell, for tables reading their
+ * rows from another structure instead of TABLE_DATA_ROWs.
+ *
+ * source  - The Table source.
+ * row     - Index of the row.
+ * column  - Index of the column.
+ * scratch - TABLE_CELL_SCRATCH_SIZE bytes the getter may format the cell
+ *           into. They're only read until the next call.
+ * outSize - Receives the cell length.
+ *
+ * Must return the cell contents, which don't need to be NUL terminated.
+ */
+typedef const char *(*TableCellGetter)(void *source, size_t row, size_t column, char *scratch, size_t *outSize);
+
+/*
+ * Type of a column, kept by the formats which have types, such as NDJSON.
+ * Every other format, and cells which don't read as their type, write
+ * them as text. Boolean cells read `Yes` or `No`, as the box shows them.
+ */
+typedef enum {
+    table_column_text = 0,
+    table_column_number = 1,
+    table_column_boolean = 2
+} table_column_type;
+
 /*
  * Table represents a virtual table structure, used by drawTable to return a formatted
  * version of it.
@@ -21,6 +67,13 @@ typedef enum {
  * rows         - TABLE_DATA_ITEM list holding each row (each TABLE_DATA_ITEM must have
  *                the same size of headersCount).
  * rowsCount    - Length of the Table rows list.
+ * getCell      - Used instead of rows when these are NULL.
+ * source       - Passed to getCell.
+ * types        - Type of each column, or NULL when they're all text.
+ * keys         - Name of each column in the formats keyed by them, such as
+ *                NDJSON, or NULL to key them by their headers.
+ * maxWidth     - Widest a box column gets, or 0 for no limit. Wider cells
+ *                and headers are cut to fit, ending with an ellipsis.
  * columnsWidth - Responsible for holding each column width. It's calculated
  *                dynamically padding the smaller words of each cell in a
  *                column.
@@ -30,8 +83,99 @@ typedef struct {
     size_t headersCount;
     TABLE_DATA_ROW *rows;
     size_t rowsCount;
+    TableCellGetter getCell;
+    void *source;
+    const table_column_type *types;
+    TABLE_DATA_ROW keys;
+    size_t maxWidth;
 } Table;
 
+/*
+ * TablePage is a window over the rows of another Table, itself a Table, so
+ * any renderer draws only the rows of the window. The box measures its
+ * widths over them alone, which makes drawing a page cost as much as its
+ * rows whatever the size of the whole table.
+ *
+ * table  - The window. It must not be copied, as it reads its rows through
+ *          the TablePage.
+ * source - Table the rows are read from.
+ * first  - Row of source shown first.
+ */
+typedef struct {
+    Table table;
+    Table *source;
+    size_t first;
+} TablePage;
+
+/*
+ * tablePage sets a window over the rows `[first, first + count)` of a
+ * Table, or fewer when it runs out of rows. Nothing is copied: the source
+ * must outlive the page.
+ */
+void tablePage(Table *source, size_t first, size_t count, TablePage *outPage);
+
+/*
+ * TableSink receives chunks of rendered output from renderTable.
+ *
+ * data    - Bytes to be written. They are only valid during the call.
+ * size    - Amount of bytes in data.
+ * context - The sinkContext provided to renderTable.
+ *
+ * Must return the amount of bytes consumed. Anything different from `size`
+ * aborts the render with a `table_err_write_failed`.
+ */
+typedef size_t (*TableSink)(const char *data, size_t size, void *context);
+
+/*
+ * tableFileSink is a TableSink writing to the `FILE *` received as context.
+ */
+size_t tableFileSink(const char *data, size_t size, void *context);
+
+/*
+ * renderTable draws a Table in the same format as drawTable, but instead of
+ * printing each piece it writes the whole output into a single internal buffer
+ * which is handed to the sink in large chunks. No allocation is made per cell.
+ *
+ * table       - Table to be rendered.
+ * sink        - Receives each filled chunk of output.
+ * sinkContext - Passed untouched to every sink call.
+ *
+ * Returns a `table_err_invalid_input` if any cell is NULL or the table has
+ * neither rows nor getCell, a `table_err_allocation_failed` if the output
+ * buffer cannot be allocated or a `table_err_write_failed` if the sink does
+ * not consume a chunk.
+ */
+table_err renderTable(Table *table, TableSink sink, void *sinkContext);
+
+/*
+ * renderTableParallel renders a Table with the same output as renderTable,
+ * splitting the rows across threads: each thread measures a chunk of rows,
+ * the widths are reduced, then each thread formats its chunk into its own
+ * buffer, which are handed to the sink in order.
+ *
+ * table       - Table to be rendered. When it reads from getCell, getCell
+ *               must be safe to call from several threads at once.
+ * threads     - Amount of threads. With 1, or too few rows to be worth it,
+ *               it's the same as renderTable.
+ * sink        - Receives each chunk of output, always from the calling thread.
+ * sinkContext - Passed untouched to every sink call.
+ *
+ * Returns the same errors as renderTable, plus a `table_err_thread_failed`
+ * if a thread cannot be started.
+ */
+table_err renderTableParallel(Table *table, size_t threads, TableSink sink, void *sinkContext);
+
+/*
+ * renderTableToBuffer renders a Table into a single growable buffer.
+ *
+ * table     - Table to be rendered.
+ * outBuffer - Receives the NUL terminated output. Must be freed by the caller.
+ * outSize   - Receives the output size, without the NUL terminator.
+ *
+ * Returns the same errors as renderTable.
+ */
+table_err renderTableToBuffer(Table *table, char **outBuffer, size_t *outSize);
+
 /*
  * Draw a Table with the following format:
  * ╭─────────┬────┬────────────────────┬────────────╮
@@ -40,6 +184,8 @@ typedef struct {
  * │ 1       │ 1  │ delectus aut autem │ No         │
  * ╰─────────┴────┴────────────────────┴────────────╯
  * Where the first row is made from the table->headers and the others from table->rows.
+ *
+ * It's a wrapper over renderTable writing to stdout.
  */
 table_err drawTable(Table *table);
 #endif
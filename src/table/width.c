@@ -0,0 +1,323 @@
+#include <stdint.h>
+#include <stdbool.h>
+#include <immintrin.h>
+#include "width.h"
+
+/*
+ * WidthRange is an inclusive range of code points sharing a width.
+ */
+typedef struct {
+    uint32_t first;
+    uint32_t last;
+} WidthRange;
+
+/*
+ * Code points taking no column: combining marks, zero width spaces and
+ * joiners, variation selectors and emoji modifiers.
+ */
+static const WidthRange ZERO_WIDTH[] = {
+    { 0x0300, 0x036F }, { 0x0483, 0x0489 }, { 0x0591, 0x05BD }, { 0x05BF, 0x05BF },
+    { 0x05C1, 0x05C2 }, { 0x05C4, 0x05C5 }, { 0x05C7, 0x05C7 }, { 0x0610, 0x061A },
+    { 0x064B, 0x065F }, { 0x0670, 0x0670 }, { 0x06D6, 0x06DC }, { 0x06DF, 0x06E4 },
+    { 0x06E7, 0x06E8 }, { 0x06EA, 0x06ED }, { 0x0900, 0x0902 }, { 0x093A, 0x093A },
+    { 0x093C, 0x093C }, { 0x0941, 0x0948 }, { 0x094D, 0x094D }, { 0x0951, 0x0957 },
+    { 0x0E31, 0x0E31 }, { 0x0E34, 0x0E3A }, { 0x0E47, 0x0E4E }, { 0x1AB0, 0x1AFF },
+    { 0x1DC0, 0x1DFF }, { 0x200B, 0x200F }, { 0x2028, 0x202E }, { 0x2060, 0x2064 },
+    { 0x20D0, 0x20FF }, { 0xFE00, 0xFE0F }, { 0xFE20, 0xFE2F }, { 0xFEFF, 0xFEFF },
+    { 0x1F3FB, 0x1F3FF }, { 0xE0000, 0xE0FFF }
+};
+
+/*
+ * Code points taking two columns: East Asian wide and fullwidth chars and
+ * emoji presented as such.
+ */
+static const WidthRange DOUBLE_WIDTH[] = {
+    { 0x1100, 0x115F }, { 0x231A, 0x231B }, { 0x2329, 0x232A }, { 0x23E9, 0x23EC },
+    { 0x23F0, 0x23F0 }, { 0x23F3, 0x23F3 }, { 0x25FD, 0x25FE }, { 0x2614, 0x2615 },
+    { 0x2648, 0x2653 }, { 0x267F, 0x267F }, { 0x2693, 0x2693 }, { 0x26A1, 0x26A1 },
+    { 0x26AA, 0x26AB }, { 0x26BD, 0x26BE }, { 0x26C4, 0x26C5 }, { 0x26CE, 0x26CE },
+    { 0x26D4, 0x26D4 }, { 0x26EA, 0x26EA }, { 0x26F2, 0x26F3 }, { 0x26F5, 0x26F5 },
+    { 0x26FA, 0x26FA }, { 0x26FD, 0x26FD }, { 0x2705, 0x2705 }, { 0x270A, 0x270B },
+    { 0x2728, 0x2728 }, { 0x274C, 0x274C }, { 0x274E, 0x274E }, { 0x2753, 0x2755 },
+    { 0x2757, 0x2757 }, { 0x2795, 0x2797 }, { 0x27B0, 0x27B0 }, { 0x27BF, 0x27BF },
+    { 0x2B1B, 0x2B1C }, { 0x2B50, 0x2B50 }, { 0x2B55, 0x2B55 }, { 0x2E80, 0x303E },
+    { 0x3041, 0x33FF }, { 0x3400, 0x4DBF }, { 0x4E00, 0x9FFF }, { 0xA000, 0xA4CF },
+    { 0xA960, 0xA97F }, { 0xAC00, 0xD7A3 }, { 0xF900, 0xFAFF }, { 0xFE10, 0xFE19 },
+    { 0xFE30, 0xFE6F }, { 0xFF00, 0xFF60 }, { 0xFFE0, 0xFFE6 }, { 0x16FE0, 0x16FE4 },
+    { 0x17000, 0x18AFF }, { 0x1B000, 0x1B2FF }, { 0x1F004, 0x1F004 }, { 0x1F0CF, 0x1F0CF },
+    { 0x1F18E, 0x1F18E }, { 0x1F191, 0x1F19A }, { 0x1F200, 0x1F202 }, { 0x1F210, 0x1F23B },
+    { 0x1F240, 0x1F248 }, { 0x1F250, 0x1F251 }, { 0x1F260, 0x1F265 }, { 0x1F300, 0x1F320 },
+    { 0x1F32D, 0x1F335 }, { 0x1F337, 0x1F37C }, { 0x1F37E, 0x1F393 }, { 0x1F3A0, 0x1F3CA },
+    { 0x1F3CF, 0x1F3D3 }, { 0x1F3E0, 0x1F3F0 }, { 0x1F3F4, 0x1F3F4 }, { 0x1F3F8, 0x1F3FA },
+    { 0x1F400, 0x1F43E }, { 0x1F440, 0x1F440 }, { 0x1F442, 0x1F4FC }, { 0x1F4FF, 0x1F53D },
+    { 0x1F54B, 0x1F54E }, { 0x1F550, 0x1F567 }, { 0x1F57A, 0x1F57A }, { 0x1F595, 0x1F596 },
+    { 0x1F5A4, 0x1F5A4 }, { 0x1F5FB, 0x1F64F }, { 0x1F680, 0x1F6C5 }, { 0x1F6CC, 0x1F6CC },
+    { 0x1F6D0, 0x1F6D2 }, { 0x1F6D5, 0x1F6D7 }, { 0x1F6EB, 0x1F6EC }, { 0x1F6F4, 0x1F6FC },
+    { 0x1F7E0, 0x1F7EB }, { 0x1F90C, 0x1F93A }, { 0x1F93C, 0x1F945 }, { 0x1F947, 0x1F9FF },
+    { 0x1FA70, 0x1FAFF }, { 0x20000, 0x2FFFD }, { 0x30000, 0x3FFFD }
+};
+
+/*
+ * Width of every code point of the Basic Multilingual Plane, two bits each,
+ * filled from the tables above when the library is loaded. Code points
+ * outside of it are binary searched in the tables.
+ */
+static uint8_t BMP_WIDTHS[0x10000 / 4];
+
+typedef size_t (*AsciiRunFunc)(const unsigned char *str, size_t size);
+
+static size_t asciiRunScalar(const unsigned char *str, size_t size);
+static AsciiRunFunc asciiRun = asciiRunScalar;
+static width_impl chosenImpl = width_impl_scalar;
+
+/*
+ * asciiRunScalar returns how many bytes from the start of str are ASCII.
+ */
+static size_t asciiRunScalar(const unsigned char *str, size_t size) {
+    size_t i = 0;
+
+    while (i < size && str[i] < 0x80) {
+        i++;
+    }
+
+    return i;
+}
+
+static size_t asciiRunSSE2(const unsigned char *str, size_t size) {
+    size_t i = 0;
+
+    for (; i + 16 <= size; i += 16) {
+        int mask = _mm_movemask_epi8(_mm_loadu_si128((const __m128i *)(str + i)));
+
+        if (mask != 0) {
+            return i + (size_t)__builtin_ctz((unsigned)mask);
+        }
+    }
+
+    return i + asciiRunScalar(str + i, size - i);
+}
+
+/*
+ * The 16 byte tail is kept inside the AVX2 function so it's VEX encoded as
+ * well, avoiding the penalty of mixing it with legacy SSE code.
+ */
+__attribute__((target("avx2")))
+static size_t asciiRunAVX2(const unsigned char *str, size_t size) {
+    size_t i = 0;
+
+    for (; i + 32 <= size; i += 32) {
+        int mask = _mm256_movemask_epi8(_mm256_loadu_si256((const __m256i *)(str + i)));
+
+        if (mask != 0) {
+            return i + (size_t)__builtin_ctz((unsigned)mask);
+        }
+    }
+
+    if (i + 16 <= size) {
+        int mask = _mm_movemask_epi8(_mm_loadu_si128((const __m128i *)(str + i)));
+
+        if (mask != 0) {
+            return i + (size_t)__builtin_ctz((unsigned)mask);
+        }
+
+        i += 16;
+    }
+
+    return i + asciiRunScalar(str + i, size - i);
+}
+
+/*
+ * chooseImpl picks the widest implementation the cpu supports, once, when
+ * the library is loaded.
+ */
+__attribute__((constructor))
+static void chooseImpl(void) {
+    __builtin_cpu_init();
+
+    if (__builtin_cpu_supports("avx2")) {
+        asciiRun = asciiRunAVX2;
+        chosenImpl = width_impl_avx2;
+    } else {
+        asciiRun = asciiRunSSE2;
+        chosenImpl = width_impl_sse2;
+    }
+}
+
+/*
+ * inRanges binary searches a sorted WidthRange list.
+ */
+static bool inRanges(const WidthRange *ranges, size_t count, uint32_t codePoint) {
+    if (codePoint < ranges[0].first || codePoint > ranges[count - 1].last) {
+        return false;
+    }
+
+    size_t low = 0;
+    size_t high = count;
+
+    while (low < high) {
+        size_t middle = (low + high) / 2;
+
+        if (codePoint > ranges[middle].last) {
+            low = middle + 1;
+        } else if (codePoint < ranges[middle].first) {
+            high = middle;
+        } else {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+static size_t searchWidth(uint32_t codePoint) {
+    if (inRanges(ZERO_WIDTH, sizeof(ZERO_WIDTH) / sizeof(WidthRange), codePoint)) {
+        return 0;
+    }
+
+    if (inRanges(DOUBLE_WIDTH, sizeof(DOUBLE_WIDTH) / sizeof(WidthRange), codePoint)) {
+        return 2;
+    }
+
+    return 1;
+}
+
+static inline size_t codePointWidth(uint32_t codePoint) {
+    if (codePoint < 0x10000) {
+        return (BMP_WIDTHS[codePoint >> 2] >> ((codePoint & 3) * 2)) & 3;
+    }
+
+    return searchWidth(codePoint);
+}
+
+/*
+ * fillBMPWidths builds BMP_WIDTHS out of the range tables, once, when the
+ * library is loaded.
+ */
+__attribute__((constructor))
+static void fillBMPWidths(void) {
+    for (uint32_t codePoint = 0; codePoint < 0x10000; codePoint++) {
+        BMP_WIDTHS[codePoint >> 2] |= (uint8_t)(searchWidth(codePoint) << ((codePoint & 3) * 2));
+    }
+}
+
+/*
+ * decodeUTF8 reads a multibyte sequence. Invalid sequences are read as a
+ * single byte, which is given a one column width.
+ *
+ * Returns how many bytes were read.
+ */
+static inline size_t decodeUTF8(const unsigned char *str, size_t size, uint32_t *outCodePoint) {
+    unsigned char lead = str[0];
+    size_t length;
+    uint32_t codePoint;
+    uint32_t minimum;
+
+    if (lead >= 0xC2 && lead <= 0xDF) {
+        length = 2;
+        codePoint = lead & 0x1F;
+        minimum = 0x80;
+    } else if (lead >= 0xE0 && lead <= 0xEF) {
+        length = 3;
+        codePoint = lead & 0x0F;
+        minimum = 0x800;
+    } else if (lead >= 0xF0 && lead <= 0xF4) {
+        length = 4;
+        codePoint = lead & 0x07;
+        minimum = 0x10000;
+    } else {
+        *outCodePoint = 0xFFFD;
+        return 1;
+    }
+
+    if (length > size) {
+        *outCodePoint = 0xFFFD;
+        return 1;
+    }
+
+    for (size_t i = 1; i < length; i++) {
+        if ((str[i] & 0xC0) != 0x80) {
+            *outCodePoint = 0xFFFD;
+            return 1;
+        }
+
+        codePoint = (codePoint << 6) | (str[i] & 0x3F);
+    }
+
+    if (codePoint < minimum || codePoint > 0x10FFFF || (codePoint >= 0xD800 && codePoint <= 0xDFFF)) {
+        *outCodePoint = 0xFFFD;
+        return 1;
+    }
+
+    *outCodePoint = codePoint;
+    return length;
+}
+
+/*
+ * measure walks str alternating ASCII runs, counted by `run`, and single
+ * multibyte code points, looked up in the width tables.
+ */
+static inline size_t measure(AsciiRunFunc run, const char *str, size_t size) {
+    const unsigned char *bytes = (const unsigned char *)str;
+    size_t width = 0;
+    size_t i = 0;
+
+    while (i < size) {
+        if (bytes[i] < 0x80) {
+            size_t ascii = run(bytes + i, size - i);
+            width += ascii;
+            i += ascii;
+
+            if (i >= size) {
+                break;
+            }
+        }
+
+        uint32_t codePoint;
+        i += decodeUTF8(bytes + i, size - i, &codePoint);
+        width += codePointWidth(codePoint);
+    }
+
+    return width;
+}
+
+size_t displayWidth(const char *str, size_t size) {
+    return measure(asciiRun, str, size);
+}
+
+size_t displayPrefix(const char *str, size_t size, size_t columns, size_t *outWidth) {
+    const unsigned char *bytes = (const unsigned char *)str;
+    size_t width = 0;
+    size_t i = 0;
+
+    while (i < size) {
+        uint32_t codePoint = bytes[i];
+        size_t length = bytes[i] < 0x80 ? 1 : decodeUTF8(bytes + i, size - i, &codePoint);
+        size_t codePointColumns = bytes[i] < 0x80 ? 1 : codePointWidth(codePoint);
+
+        if (width + codePointColumns > columns) {
+            break;
+        }
+
+        width += codePointColumns;
+        i += length;
+    }
+
+    *outWidth = width;
+    return i;
+}
+
+size_t displayWidthUsing(width_impl impl, const char *str, size_t size) {
+    if (impl == width_impl_avx2 && chosenImpl == width_impl_avx2) {
+        return measure(asciiRunAVX2, str, size);
+    }
+
+    if (impl == width_impl_sse2) {
+        return measure(asciiRunSSE2, str, size);
+    }
+
+    return measure(asciiRunScalar, str, size);
+}
+
+width_impl displayWidthImpl(void) {
+    return chosenImpl;
+}
@@ -0,0 +1,46 @@
+#ifndef width_h
+#define width_h
+#include <stdlib.h>
+
+typedef enum {
+    width_impl_scalar = 0,
+    width_impl_sse2 = 1,
+    width_impl_avx2 = 2
+} width_impl;
+
+/*
+ * displayWidth returns how many terminal columns a UTF-8 string takes.
+ *
+ * str  - String to be measured. It doesn't need to be NUL terminated.
+ * size - Amount of bytes in str.
+ *
+ * ASCII bytes take one column each and are counted in 16 or 32 byte runs
+ * with SSE2 or AVX2. Every other code point is looked up in a table: East
+ * Asian wide and fullwidth chars and emoji take two columns, combining marks
+ * and other zero width chars take none. Invalid UTF-8 bytes take one column.
+ */
+size_t displayWidth(const char *str, size_t size);
+
+/*
+ * displayPrefix returns how many bytes from the start of str fit in
+ * `columns` terminal columns, without splitting a code point. Zero width
+ * code points after the last one that fits are kept along with it.
+ *
+ * outWidth - Receives the columns the prefix takes.
+ */
+size_t displayPrefix(const char *str, size_t size, size_t columns, size_t *outWidth);
+
+/*
+ * displayWidthUsing does the same as displayWidth, forcing an implementation
+ * for the ASCII runs. Meant for benchmarks: an unsupported implementation
+ * falls back to the scalar one.
+ */
+size_t displayWidthUsing(width_impl impl, const char *str, size_t size);
+
+/*
+ * displayWidthImpl returns the implementation displayWidth picked for the
+ * current cpu.
+ */
+width_impl displayWidthImpl(void);
+
+#endif